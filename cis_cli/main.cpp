@@ -33,11 +33,13 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "cis_opencv.h"
 #include "io_util.h"
+#include "benchmark.h"
+#include "batch_server.h"
 #include "superpixel_tools.h"
-#include "visualization.h"
+#include "async_loader.h"
+#include "async_writer.h"
 
 /** \brief Command line tool for running CIS.
  * Usage:
@@ -57,11 +59,18 @@
  *     -o [ --csv ] arg                save segmentation as CSV file
  *     -v [ --vis ] arg                visualize contours
  *     -x [ --prefix ] arg             output file prefix
+ *     --warm-up arg (=0)              number of discarded runs per image
+ *     --repeat arg (=1)               number of timed runs per image
+ *     --queue-depth arg (=4)          number of images loaded ahead and written behind
+ *     --load-threads arg (=1)         number of threads loading images
+ *     --write-threads arg (=1)        number of threads writing results
  *     -w [ --wordy ]                  verbose/wordy/debug
+ *     --batch                         read jobs (arguments) line by line from stdin
+ *     --socket arg                    read jobs from the given UNIX socket
  * \endcode
  * \author David Stutz
  */
-int main (int argc, char ** argv) {
+int run(int argc, const char** argv) {
     
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
@@ -76,6 +85,11 @@ int main (int argc, char ** argv) {
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("warm-up", boost::program_options::value<int>()->default_value(0), "number of discarded runs per image")
+        ("repeat", boost::program_options::value<int>()->default_value(1), "number of timed runs per image")
+        ("queue-depth", boost::program_options::value<int>()->default_value(4), "number of images loaded ahead and written behind")
+        ("load-threads", boost::program_options::value<int>()->default_value(1), "number of threads loading images")
+        ("write-threads", boost::program_options::value<int>()->default_value(1), "number of threads writing results")
         ("wordy,w", "verbose/wordy/debug");
     
     boost::program_options::positional_options_description positionals;
@@ -134,27 +148,34 @@ int main (int argc, char ** argv) {
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
-    float total = 0;
+    Benchmark benchmark(parameters["warm-up"].as<int>(), parameters["repeat"].as<int>());
+    int queue_depth = parameters["queue-depth"].as<int>();
+    AsyncLoader loader(images, parameters["load-threads"].as<int>(), queue_depth);
+    AsyncWriter writer(parameters["write-threads"].as<int>(), queue_depth);
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
-        cv::Mat image = cv::imread(it->first);
+        benchmark.startImage(it->second.stem().string());
+        benchmark.startPhase(Benchmark::LOAD);
+        cv::Mat image = loader.read(it->first);
         cv::Mat labels;
         
         // Same conversion for all algorithms.
         int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(image, 
                 superpixels);
         
-        boost::timer timer;
-        CIS_OpenCV::computeSuperpixels(image, region_size, lambda, iterations, 
-                type, sigma, color, labels);
-        float elapsed = timer.elapsed();
-        total += elapsed;
+        while (benchmark.repeat(Benchmark::SEGMENTATION)) {
+            CIS_OpenCV::computeSuperpixels(image, region_size, lambda, iterations, 
+                    type, sigma, color, labels);
+        }
+        float elapsed = benchmark.getWallTime(Benchmark::SEGMENTATION);
         
+        benchmark.startPhase(Benchmark::POST_PROCESSING);
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
 //        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
 //        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
 //        SuperpixelTools::relabelSuperpixels(labels);
+        benchmark.stopPhase();
         
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
@@ -163,32 +184,45 @@ int main (int argc, char ** argv) {
                     << elapsed <<")." << std::endl;
         }
         
+        benchmark.startPhase(Benchmark::WRITE);
         if (!output_dir.empty()) {
             boost::filesystem::path csv_file(output_dir 
                     / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            writer.writeCSV(csv_file, labels);
         }
         
         if (!vis_dir.empty()) {
             boost::filesystem::path contours_file(vis_dir 
                     / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
-            cv::Mat image_contours;
-            Visualization::drawContours(image, labels, image_contours);
-            cv::imwrite(contours_file.string(), image_contours);
+            writer.writeContours(contours_file, image, labels);
         }
+        
+        benchmark.stopImage();
     }
     
+    writer.finish();
+    
     if (wordy) {
-        std::cout << "Average time: " << total / images.size() << "." << std::endl;
+        std::cout << "Average time: " 
+                << benchmark.getAverageWallTime(Benchmark::SEGMENTATION) << "." << std::endl;
     }
     
     if (!output_dir.empty()) {
         std::ofstream runtime_file(output_dir.string() + "/" + prefix + "runtime.txt", 
                 std::ofstream::out | std::ofstream::app);
         
-        runtime_file << total / images.size() << "\n";
+        runtime_file << benchmark.getAverageWallTime(Benchmark::SEGMENTATION) << "\n";
         runtime_file.close();
+        
+        benchmark.writeCSV(output_dir / boost::filesystem::path(prefix + "benchmark.csv"));
+        benchmark.writeJSON(output_dir / boost::filesystem::path(prefix + "benchmark.json"));
     }
     
     return 0;
 }
+
+/** \brief Run a single invocation or serve jobs, see BatchServer.
+ */
+int main(int argc, const char** argv) {
+    return BatchServer::main(argc, argv, run);
+}
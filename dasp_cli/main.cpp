@@ -32,13 +32,15 @@
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
-#include <boost/timer.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include "dasp_opencv.h"
+#include "dasp_stream.h"
 #include "io_util.h"
+#include "benchmark.h"
+#include "batch_server.h"
 #include "superpixel_tools.h"
-#include "visualization.h"
+#include "async_loader.h"
+#include "async_writer.h"
 
 /** \brief Command line tool for running DASP.
  * Usage:
@@ -72,15 +74,27 @@
  *     -n [ --normal-weight ] arg (=0.200000003)
  *                                           normal weight
  *     -t [ --iterations ] arg (=5)          iterations
+ *     --stream                              process images in order as RGB-D 
+ *                                           stream, keeping DASP state between 
+ *                                           frames; with seed mode 2, the 
+ *                                           previous superpixels seed the next 
+ *                                           frame
  *     -o [ --csv ] arg                      specify the output directory (default 
  *                                           is ./output)
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
+ *     --warm-up arg (=0)                    number of discarded runs per image
+ *     --repeat arg (=1)                     number of timed runs per image
+ *     --queue-depth arg (=4)                number of images loaded ahead and written behind
+ *     --load-threads arg (=1)               number of threads loading images
+ *     --write-threads arg (=1)              number of threads writing results
  *     -w [ --wordy ]                        verbose/wordy/debug
+ *     --batch                               read jobs (arguments) line by line from stdin
+ *     --socket arg                          read jobs from the given UNIX socket
  * \endcode 
  * \author David Stutz
  */
-int main(int argc, const char** argv) {
+int run(int argc, const char** argv) {
     
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
@@ -99,9 +113,15 @@ int main(int argc, const char** argv) {
 //        ("color-weight,c", boost::program_options::value<float>()->default_value(2.0f), "color weight")
         ("normal-weight,n", boost::program_options::value<float>()->default_value(0.2f), "normal weight")
         ("iterations,t", boost::program_options::value<int>()->default_value(5), "iterations")
+        ("stream", "process images in order as RGB-D stream, keeping DASP state between frames; with seed mode 2, the previous superpixels seed the next frame")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("warm-up", boost::program_options::value<int>()->default_value(0), "number of discarded runs per image")
+        ("repeat", boost::program_options::value<int>()->default_value(1), "number of timed runs per image")
+        ("queue-depth", boost::program_options::value<int>()->default_value(4), "number of images loaded ahead and written behind")
+        ("load-threads", boost::program_options::value<int>()->default_value(1), "number of threads loading images")
+        ("write-threads", boost::program_options::value<int>()->default_value(1), "number of threads writing results")
         ("wordy,w", "verbose/wordy/debug");
 
     boost::program_options::positional_options_description positionals;
@@ -165,6 +185,11 @@ int main(int argc, const char** argv) {
     int seed_mode = parameters["seed-mode"].as<int>();
     int iterations = parameters["iterations"].as<int>();
     
+    bool stream = false;
+    if (parameters.find("stream") != parameters.end()) {
+        stream = true;
+    }
+    
     if (spatial_weight < 0 || spatial_weight > 1) {
         std::cout << "Invalid spatial weight, select spatial weight in [0,1]." << std::endl;
         return 1;
@@ -185,11 +210,18 @@ int main(int argc, const char** argv) {
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(image_dir, extensions, images);
     
-    float total = 0;
+    std::unique_ptr<DASPStream> dasp_stream;
+    
+    Benchmark benchmark(parameters["warm-up"].as<int>(), parameters["repeat"].as<int>());
+    int queue_depth = parameters["queue-depth"].as<int>();
+    AsyncLoader loader(images, parameters["load-threads"].as<int>(), queue_depth);
+    AsyncWriter writer(parameters["write-threads"].as<int>(), queue_depth);
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin(); 
             it != images.end(); ++it) {
         
-        cv::Mat image = cv::imread(it->first);
+        benchmark.startImage(it->second.stem().string());
+        benchmark.startPhase(Benchmark::LOAD);
+        cv::Mat image = loader.read(it->first);
         
         boost::filesystem::path depth_file = depth_dir 
                 / boost::filesystem::path(it->second.stem().string() + ".png");
@@ -204,7 +236,7 @@ int main(int argc, const char** argv) {
             }
         }
         
-        cv::Mat depth = cv::imread(depth_file.string(), CV_LOAD_IMAGE_ANYDEPTH);
+        cv::Mat depth = BatchServer::readImage(depth_file.string(), CV_LOAD_IMAGE_ANYDEPTH);
         
         if (depth.rows != image.rows || depth.cols != image.cols) {
             std::cout << "Image and depth dimensions do not match for: " 
@@ -236,17 +268,31 @@ int main(int argc, const char** argv) {
             camera.z_slope = 0.001f;
         }
         
-        boost::timer timer;
         cv::Mat labels;
-        DASP_OpenCV::computeSuperpixels(image, depth, superpixels, spatial_weight, 
-                normal_weight, seed_mode, iterations, camera, labels);
-        float elapsed = timer.elapsed();
-        total += elapsed;
+        while (benchmark.repeat(Benchmark::SEGMENTATION)) {
+            if (stream) {
+                if (!dasp_stream) {
+                    dasp_stream.reset(new DASPStream(DASP_OpenCV::createParameters(image, 
+                            superpixels, spatial_weight, normal_weight, seed_mode, 
+                            iterations, camera), seed_mode == DASP_OpenCV::SEEDS_MODE_DELTA));
+                }
+                
+                dasp_stream->setCamera(camera);
+                dasp_stream->computeSuperpixels(image, depth, labels);
+            }
+            else {
+                DASP_OpenCV::computeSuperpixels(image, depth, superpixels, spatial_weight, 
+                        normal_weight, seed_mode, iterations, camera, labels);
+            }
+        }
+        float elapsed = benchmark.getWallTime(Benchmark::SEGMENTATION);
         
+        benchmark.startPhase(Benchmark::POST_PROCESSING);
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
         int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
         merged_components += SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
 //        SuperpixelTools::relabelSuperpixels(labels);
+        benchmark.stopPhase();
         
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
@@ -255,32 +301,45 @@ int main(int argc, const char** argv) {
                     << elapsed <<")." << std::endl;
         }
         
+        benchmark.startPhase(Benchmark::WRITE);
         if (!output_dir.empty()) {
             boost::filesystem::path csv_file(output_dir 
                     / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            writer.writeCSV(csv_file, labels);
         }
         
         if (!vis_dir.empty()) {
             boost::filesystem::path contours_file(vis_dir 
                     / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
-            cv::Mat image_contours;
-            Visualization::drawContours(image, labels, image_contours);
-            cv::imwrite(contours_file.string(), image_contours);
+            writer.writeContours(contours_file, image, labels);
         }
+        
+        benchmark.stopImage();
     }
     
+    writer.finish();
+    
     if (wordy) {
-        std::cout << "Average time: " << total / images.size() << "." << std::endl;
+        std::cout << "Average time: " 
+                << benchmark.getAverageWallTime(Benchmark::SEGMENTATION) << "." << std::endl;
     }
     
     if (!output_dir.empty()) {
         std::ofstream runtime_file(output_dir.string() + "/" + prefix + "runtime.txt", 
                 std::ofstream::out | std::ofstream::app);
         
-        runtime_file << total / images.size() << "\n";
+        runtime_file << benchmark.getAverageWallTime(Benchmark::SEGMENTATION) << "\n";
         runtime_file.close();
+        
+        benchmark.writeCSV(output_dir / boost::filesystem::path(prefix + "benchmark.csv"));
+        benchmark.writeJSON(output_dir / boost::filesystem::path(prefix + "benchmark.json"));
     }
     
     return 0;
 }
+
+/** \brief Run a single invocation or serve jobs, see BatchServer.
+ */
+int main(int argc, const char** argv) {
+    return BatchServer::main(argc, argv, run);
+}
@@ -39,11 +39,17 @@
 
 #include "io_util.h"
 #include "evaluation.h"
+#include "evaluation_summary.h"
 
 /** \brief Compute average metrics given a CSV file containing several evaluation summaries.
  * Use evaluation_summary_cli with the --append-file option to gather multiple
  * summaries in one file.
  * 
+ * With --merge-directory, the shards written by eval_summary_cli --shard
+ * in the given superpixel directory are first merged into results.csv,
+ * correlation.csv and summary.csv, exactly as written by a single
+ * eval_summary_cli run (including --append-file).
+ * 
  * Usage:
  * \code[sh]
  * $ ../bin/eval_average_cli --help
@@ -51,6 +57,8 @@
  *   --summary-file arg                    CSV summary file
  *   -o [ --output-file ] arg (=average.csv)
  *                                         output file
+ *   --merge-directory arg                 merge shards in superpixel directory
+ *   --append-file arg                     append file for merged summary
  *   --help                                produce help message
  * \endcode
  * \author David Stutz
@@ -61,6 +69,8 @@ int main(int argc, const char** argv) {
     desc.add_options()
         ("summary-file", boost::program_options::value<std::string>(), "CSV summary file")
         ("output-file,o", boost::program_options::value<std::string>()->default_value("average.csv"), "output file")
+        ("merge-directory", boost::program_options::value<std::string>()->default_value(""), "merge shards in superpixel directory")
+        ("append-file", boost::program_options::value<std::string>()->default_value(""), "append file for merged summary")
         ("help", "produce help message");
 
     boost::program_options::positional_options_description positionals;
@@ -75,6 +85,34 @@ int main(int argc, const char** argv) {
         return 1;
     }
     
+    boost::filesystem::path merge_directory(parameters["merge-directory"].as<std::string>());
+    if (!merge_directory.empty()) {
+        if (!boost::filesystem::is_directory(merge_directory)) {
+            std::cout << "Merge directory does not exist." << std::endl;
+            return 1;
+        }
+        
+        EvaluationSummary summary(merge_directory, merge_directory, merge_directory);
+        summary.setComputeCorrelation(true);
+        
+        boost::filesystem::path append_file(parameters["append-file"].as<std::string>());
+        if (!append_file.empty()) {
+            summary.setAppendFile(append_file);
+        }
+        
+        int gt_max = 0;
+        summary.mergeShards(gt_max);
+        
+        if (parameters.find("summary-file") == parameters.end()) {
+            return 0;
+        }
+    }
+    
+    if (parameters.find("summary-file") == parameters.end()) {
+        std::cout << "No CSV summary file given." << std::endl;
+        return 1;
+    }
+    
     boost::filesystem::path summary_file(parameters["summary-file"].as<std::string>());
     if (!boost::filesystem::is_regular_file(summary_file)) {
         std::cout << "CSV summary file not found." << std::endl;
@@ -33,8 +33,10 @@
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include <glog/logging.h>
+#include <mutex>
 #include "superpixel_tools.h"
 #include "io_util.h"
+#include "parallel_util.h"
 
 /** \brief Convert boundaries, as generated by TP, to superpixel labels.
  * Usage:
@@ -48,6 +50,8 @@
  *     -r [ --overwrite ]         Overwrite original files
  *     -o [ --csv ] arg (=output) save segmentation as CSV file
  *     -w [ --wordy ]             wordy/verbose
+ *     -t [ --threads ] arg (=0)  number of worker threads (0 = all hardware 
+ *                                threads)
  * \endcode
  * \author David Stutz
  */
@@ -60,7 +64,8 @@ int main (int argc, char ** argv) {
         ("input-images,m", boost::program_options::value<std::string>(), "folder containing the corresponding images to process")
         ("overwrite,r", "Overwrite original files")
         ("csv,o", boost::program_options::value<std::string>()->default_value("output"), "save segmentation as CSV file")
-        ("wordy,w", "wordy/verbose");
+        ("wordy,w", "wordy/verbose")
+        ("threads,t", boost::program_options::value<int>()->default_value(0), "number of worker threads (0 = all hardware threads)");
     
     boost::program_options::positional_options_description positionals;
     positionals.add("input-csv", 1);
@@ -109,14 +114,19 @@ int main (int argc, char ** argv) {
     IOUtil::getCSVExtensions(extensions);
     IOUtil::readDirectory(boundaries_dir, extensions, boundaries);
     
-    for(std::multimap<std::string, boost::filesystem::path>::iterator it = boundaries.begin(); 
-            it != boundaries.end(); ++it) {
+    std::vector<std::pair<std::string, boost::filesystem::path> > files(boundaries.begin(), boundaries.end());
+    bool overwrite = (parameters.find("overwrite") != parameters.end());
+    std::mutex output_mutex;
+    
+    // Files are independent, so each worker converts and writes whole files
+    // using a single labeling thread.
+    ParallelUtil::parallelFor(0, files.size(), parameters["threads"].as<int>(), [&](int k) {
         
         boost::filesystem::path image_file = images_dir / 
-                boost::filesystem::path(it->second.stem().string() + ".png");
+                boost::filesystem::path(files[k].second.stem().string() + ".png");
         if (!boost::filesystem::is_regular_file(image_file)) {
             image_file = images_dir / 
-                    boost::filesystem::path(it->second.stem().string() + ".jpg");
+                    boost::filesystem::path(files[k].second.stem().string() + ".jpg");
         }
         
         LOG_IF(FATAL, !boost::filesystem::is_regular_file(image_file)) 
@@ -126,25 +136,26 @@ int main (int argc, char ** argv) {
         
         cv::Mat boundaries;
         cv::Mat labels;
-        IOUtil::readMatCSVInt(it->second, boundaries);
+        IOUtil::readMatCSVInt(files[k].second, boundaries);
         SuperpixelTools::computeLabelsFromBoundaries(image, boundaries, labels);
         int superpixels = SuperpixelTools::countSuperpixels(labels);
         
         if (wordy) {
-            std::cout << superpixels << " superpixels for " << it->first << "." << std::endl;
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << superpixels << " superpixels for " << files[k].first << "." << std::endl;
         }
         
-        if (parameters.find("overwrite") != parameters.end()) {
+        if (overwrite) {
             boost::filesystem::path label_file(boundaries_dir 
-                    / boost::filesystem::path(it->second.stem().string() + ".csv"));
+                    / boost::filesystem::path(files[k].second.stem().string() + ".csv"));
             IOUtil::writeMatCSV<int>(label_file, labels);
         }
         else {
             boost::filesystem::path label_file(output_dir 
-                    / boost::filesystem::path(it->second.stem().string() + ".csv"));
+                    / boost::filesystem::path(files[k].second.stem().string() + ".csv"));
             IOUtil::writeMatCSV<int>(label_file, labels);
         }
-    }
+    });
     
     return 0;
 }
@@ -33,8 +33,10 @@
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 #include <glog/logging.h>
+#include <mutex>
 #include "superpixel_tools.h"
 #include "io_util.h"
+#include "parallel_util.h"
 
 /** \brief Relabel superpixels in order to be connected.
  * Usage:
@@ -48,6 +50,8 @@
  *     -r [ --overwrite ]         Overwrite original files
  *     -o [ --csv ] arg (=output) save segmentation as CSV file
  *     -w [ --wordy ]             wordy/verbose
+ *     -t [ --threads ] arg (=0)  number of worker threads (0 = all hardware 
+ *                                threads)
  * \endcode
  * \author David Stutz
  */
@@ -60,7 +64,8 @@ int main (int argc, char ** argv) {
         ("input-images,m", boost::program_options::value<std::string>()->default_value(""), "dummy option!")
         ("overwrite,r", "Overwrite original files")
         ("csv,o", boost::program_options::value<std::string>()->default_value("output"), "save segmentation as CSV file")
-        ("wordy,w", "wordy/verbose");
+        ("wordy,w", "wordy/verbose")
+        ("threads,t", boost::program_options::value<int>()->default_value(0), "number of worker threads (0 = all hardware threads)");
     
     boost::program_options::positional_options_description positionals;
     positionals.add("input-csv", 1);
@@ -102,33 +107,39 @@ int main (int argc, char ** argv) {
     IOUtil::getCSVExtensions(extensions);
     IOUtil::readDirectory(labels_dir, extensions, labels);
     
-    for(std::multimap<std::string, boost::filesystem::path>::iterator it = labels.begin(); 
-            it != labels.end(); ++it) {
+    std::vector<std::pair<std::string, boost::filesystem::path> > files(labels.begin(), labels.end());
+    bool overwrite = (parameters.find("overwrite") != parameters.end());
+    std::mutex output_mutex;
+    
+    // Files are independent, so each worker labels and writes whole files
+    // using a single labeling thread.
+    ParallelUtil::parallelFor(0, files.size(), parameters["threads"].as<int>(), [&](int k) {
         
         cv::Mat labels;
-        IOUtil::readMatCSVInt(it->second, labels);
+        IOUtil::readMatCSVInt(files[k].second, labels);
         
         int superpixels = SuperpixelTools::countSuperpixels(labels);
         int components = SuperpixelTools::relabelConnectedSuperpixels(labels);
         
         if (wordy) {
+            std::lock_guard<std::mutex> lock(output_mutex);
             std::cout << superpixels << " superpixels / " 
-                    << components << " new components for " << it->first << "." << std::endl; 
+                    << components << " new components for " << files[k].first << "." << std::endl; 
         }
         
         if (components > 0) {
-            if (parameters.find("overwrite") != parameters.end()) {
+            if (overwrite) {
                 boost::filesystem::path label_file(labels_dir 
-                        / boost::filesystem::path(it->second.stem().string() + ".csv"));
+                        / boost::filesystem::path(files[k].second.stem().string() + ".csv"));
                 IOUtil::writeMatCSV<int>(label_file, labels);
             }
             else {
                 boost::filesystem::path label_file(output_dir 
-                        / boost::filesystem::path(it->second.stem().string() + ".csv"));
+                        / boost::filesystem::path(files[k].second.stem().string() + ".csv"));
                 IOUtil::writeMatCSV<int>(label_file, labels);
             }
         }
-    }
+    });
     
     return 0;
 }
\ No newline at end of file
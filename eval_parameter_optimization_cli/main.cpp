@@ -43,6 +43,7 @@ std::string FAIR = "-f ";
 std::string RELATIVE_PATH = ".";
 std::string MATLAB_EXECUTABLE = "/home/david/MATLAB/R2014b/bin/matlab";
 std::string JAVA_EXECUTABLE = "/home/david/jdk-1.8.0_45/release/java";
+std::string BATCH_SOCKET = "";
 
 ////////////////////////////////////////////////////////////////////////////////
 // CCS
@@ -63,6 +64,7 @@ void connector_CCS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory, 
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/ccs_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("compactness", "--compactness", std::vector<int>{25, 50, 100, 250, 500}); // 5
@@ -92,6 +94,7 @@ void connector_CIS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory, 
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/cis_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("lambda", "--lambda", std::vector<int>{1, 3, 5, 7, 10}); // 5
@@ -122,6 +125,7 @@ void connector_CRS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/crs_cli", FAIR);
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{0.001f, 0.005f, 0.01f, 0.05f, 0.1f}); // 5
@@ -152,6 +156,7 @@ void connector_CW(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/cw_cli", FAIR);
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{0.01f, 0.05f, 0.1f, 0.5f, 1.0f, 5.0f, 10.0f}); // 7
@@ -182,6 +187,7 @@ void connector_DASP(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/dasp_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
         tool.useDepth(depth_directory);
 
         if (!intrinsics_directory.empty()) {
@@ -248,6 +254,7 @@ void connector_ERGC(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/ergc_cli", FAIR);
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("perturb-seeds", "--perturb-seeds", std::vector<int>{0, 1}); // 2
@@ -277,6 +284,7 @@ void connector_ERS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/ers_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("lambda", "--lambda", std::vector<float>{0.1f, 0.5f, 1.0f, 2.5f, 5.0f, 10.0f}); // 6
@@ -305,6 +313,7 @@ void connector_ETPS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/etps_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{400});
         tool.addFloatParameter("regularization-weight", "--regularization-weight", std::vector<float>{0.01f, 0.05f, 0.1f, 0.5f, 1.f, 5.f, 10.f}); // 7
@@ -332,6 +341,7 @@ void connector_FH(boost::filesystem::path img_directory,
     
     ParameterOptimizationTool tool(img_directory, gt_directory, base_directory,
             RELATIVE_PATH + "/bin/fh_cli", "");
+    tool.setBatchSocket(BATCH_SOCKET);
 
     tool.addFloatParameter("sigma", "--sigma", std::vector<float>{0.0f, 1.0f, 2.0f}); // 3
     tool.addIntegerParameter("minimum-size", "--minimum-size", std::vector<int>{10, 15, 30, 60, 90, 120, 180}); // 7
@@ -359,6 +369,7 @@ void connector_MSS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory, 
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/mss_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("structure-size", "--structure-size", std::vector<int>{3,7,11,15}); // 4
@@ -389,6 +400,7 @@ void connector_PB(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/pb_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("sigma", "--sigma", std::vector<float>{1.0f, 2.5f, 5.0f, 7.5f, 10.0f, 20.0f}); // 6
@@ -448,6 +460,7 @@ void connector_preSLIC(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/preslic_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{1.0f, 5.0f, 10.0f, 20.0f, 40.0f, 80.0f, 160.0f}); // 9
@@ -480,6 +493,7 @@ void connector_reSEEDS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
             RELATIVE_PATH + "/bin/reseeds_cli", FAIR);
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("bins", "--bins", std::vector<int>{1, 3, 5, 7}); // 4
@@ -550,6 +564,7 @@ void connector_SEEDS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/seeds_cli", FAIR);
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("bins", "--bins", std::vector<int>{1, 3, 5, 7, 9}); // 5
@@ -582,6 +597,7 @@ void connector_SLIC(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/slic_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addFloatParameter("compactness", "--compactness", std::vector<float>{1.0f, 5.0f, 10.0f, 20.0f, 40.0f, 80.0f, 160.0f}); // 9
@@ -673,6 +689,7 @@ void connector_vlSLIC(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/vlslic_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
         tool.addIntegerParameter("minimum-region-size", "--minimum-region-size", std::vector<int>{20});
@@ -702,6 +719,7 @@ void connector_W(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/w_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
 
@@ -787,6 +805,7 @@ void connector_LSC(boost::filesystem::path img_directory,
                 RELATIVE_PATH + "/bin/lsc_cli", FAIR);      
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
+        tool.setBatchSocket(BATCH_SOCKET);
         tool.addFloatParameter("ratio", "--ratio", std::vector<float>{0.0f, 0.01f, 0.05f, 0.1f, 0.25f, 0.5f}); // 6
         tool.addIntegerParameter("iterations", "--iterations", std::vector<int>{1, 5, 10 ,25, 50}); // 5
         tool.addIntegerParameter("threshold", "--threshold", std::vector<int>{10}); // 1
@@ -907,6 +926,7 @@ void connector_VCCS(boost::filesystem::path img_directory,
         ParameterOptimizationTool tool(img_directory, gt_directory,
                 base_directory / boost::filesystem::path(std::to_string(superpixels[k])),
                 RELATIVE_PATH + "/bin/vccs_cli", "");
+        tool.setBatchSocket(BATCH_SOCKET);
         tool.useDepth(depth_directory);
 
         if (!intrinsics_directory.empty()) {
@@ -954,6 +974,7 @@ void connector_VC(boost::filesystem::path img_directory,
                 RELATIVE_PATH + "/bin/vc_cli", "");      
 
         tool.addIntegerParameter("superpixels", "--superpixels", std::vector<int>{superpixels[k]});
+        tool.setBatchSocket(BATCH_SOCKET);
         tool.addFloatParameter("weight", "--weight", std::vector<float>{10, 25, 50, 100, 250}); // 5
         tool.addIntegerParameter("radius", "--radius", std::vector<int>{3, 15}); // 2
         tool.addIntegerParameter("threshold", "--threshold", std::vector<int>{10});
@@ -997,6 +1018,7 @@ int main(int argc, const char** argv) {
         ("matlab-executable", boost::program_options::value<std::string>()->default_value("../../MATLAB/R2014b/release/matlab"), "matlab executable path")
         ("java-executable", boost::program_options::value<std::string>()->default_value("../../jdk-1.8.0_45/release/java"), "java executable")
         ("not-fair", "do not use fair parameters")
+        ("batch-socket", boost::program_options::value<std::string>()->default_value(""), "submit the jobs of C++ algorithms to the tool serving jobs on this socket (started with --socket)")
         ("help", "produce help message");
 
     boost::program_options::positional_options_description positionals;
@@ -1016,6 +1038,7 @@ int main(int argc, const char** argv) {
     
     MATLAB_EXECUTABLE = parameters["matlab-executable"].as<std::string>();
     JAVA_EXECUTABLE = parameters["java-executable"].as<std::string>();
+    BATCH_SOCKET = parameters["batch-socket"].as<std::string>();
     
     boost::filesystem::path img_directory(parameters["img-directory"].as<std::string>());
     if (!boost::filesystem::is_directory(img_directory)) {
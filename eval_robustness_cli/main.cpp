@@ -0,0 +1,201 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+ 
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <glog/logging.h>
+
+#include "robustness_tool.h"
+
+/** \brief Evaluate an algorithm on transformed images and ground truths, 
+ * e.g. with increasing noise or blur, using RobustnessTool.
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/eval_robustness_cli --help
+ *   Allowed options:
+ *     --command-line arg        command line of the algorithm without -i and -o,
+ *                               e.g. "./bin/slic_cli --superpixels 400"
+ *     --img-directory arg       image directory
+ *     --gt-directory arg        ground truth directory
+ *     --base-directory arg      base directory
+ *     --transformation arg      transformation: additive-noise, sampling-noise, 
+ *                               salt-and-pepper, poisson-noise, blur, 
+ *                               gaussian-blur, median-blur, motion-blur, 
+ *                               horizontal-shear, vertical-shear, rotation
+ *     --values arg              values to evaluate (variances, probabilities, 
+ *                               filter sizes, shear strengths or angles)
+ *     --crop arg (=0)           crop used for shear and rotation
+ *     --seed arg (=0)           seed of the noise, 0 for a random seed per 
+ *                               image
+ *     --batch-socket arg        submit the jobs to the algorithm serving jobs 
+ *                               on this socket (started with --socket)
+ *     --help                    produce help message
+ * \endcode
+ * \author David Stutz
+ */
+
+/** \brief Run the robustness evaluation with the given driver.
+ * \param[in] base_directory base directory
+ * \param[in] img_directory image directory
+ * \param[in] gt_directory ground truth directory
+ * \param[in] command_line command line of the algorithm
+ * \param[in] batch_socket socket of the algorithm serving jobs, may be empty
+ * \param[in] driver driver implementing the transformation
+ */
+void evaluate(boost::filesystem::path base_directory, boost::filesystem::path img_directory, 
+        boost::filesystem::path gt_directory, const std::string &command_line, 
+        const std::string &batch_socket, RobustnessToolDriver* driver) {
+    
+    RobustnessTool tool(base_directory, img_directory, gt_directory, command_line, driver);
+    tool.setBatchSocket(batch_socket);
+    tool.evaluate();
+}
+
+int main(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("command-line", boost::program_options::value<std::string>(), "command line of the algorithm without -i and -o, e.g. \"./bin/slic_cli --superpixels 400\"")
+        ("img-directory", boost::program_options::value<std::string>(), "image directory")
+        ("gt-directory", boost::program_options::value<std::string>(), "ground truth directory")
+        ("base-directory", boost::program_options::value<std::string>(), "base directory")
+        ("transformation", boost::program_options::value<std::string>(), "transformation: additive-noise, sampling-noise, salt-and-pepper, poisson-noise, blur, gaussian-blur, median-blur, motion-blur, horizontal-shear, vertical-shear, rotation")
+        ("values", boost::program_options::value<std::vector<float> >()->multitoken(), "values to evaluate (variances, probabilities, filter sizes, shear strengths or angles)")
+        ("crop", boost::program_options::value<int>()->default_value(0), "crop used for shear and rotation")
+        ("seed", boost::program_options::value<unsigned int>()->default_value(0), "seed of the noise, 0 for a random seed per image")
+        ("batch-socket", boost::program_options::value<std::string>()->default_value(""), "submit the jobs to the algorithm serving jobs on this socket (started with --socket)")
+        ("help", "produce help message");
+
+    boost::program_options::positional_options_description positionals;
+    positionals.add("command-line", 1);
+    positionals.add("img-directory", 1);
+    positionals.add("gt-directory", 1);
+    positionals.add("base-directory", 1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    if (parameters.find("command-line") == parameters.end()
+            || parameters.find("transformation") == parameters.end()) {
+        std::cout << "Command line and transformation need to be given." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path img_directory(parameters["img-directory"].as<std::string>());
+    if (!boost::filesystem::is_directory(img_directory)) {
+        std::cout << "Image directory does not exist." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path gt_directory(parameters["gt-directory"].as<std::string>());
+    if (!boost::filesystem::is_directory(gt_directory)) {
+        std::cout << "Ground truth directory does not exist." << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path base_directory(parameters["base-directory"].as<std::string>());
+    if (!boost::filesystem::is_directory(base_directory)) {
+        boost::filesystem::create_directories(base_directory);
+    }
+    
+    std::string command_line = parameters["command-line"].as<std::string>();
+    std::string batch_socket = parameters["batch-socket"].as<std::string>();
+    std::string transformation = parameters["transformation"].as<std::string>();
+    int crop = parameters["crop"].as<int>();
+    unsigned int seed = parameters["seed"].as<unsigned int>();
+    
+    std::vector<float> values;
+    if (parameters.find("values") != parameters.end()) {
+        values = parameters["values"].as<std::vector<float> >();
+    }
+    
+    if (values.empty() && transformation != "poisson-noise") {
+        std::cout << "Values to evaluate need to be given." << std::endl;
+        return 1;
+    }
+    
+    // Filter sizes are given as values; Gaussian and motion blur use the
+    // default sigma for the size and horizontal motion, respectively.
+    std::vector<int> sizes(values.begin(), values.end());
+    std::vector<float> zeros(values.size(), 0.f);
+    
+    if (transformation == "additive-noise" || transformation == "sampling-noise") {
+        GaussianNoiseDriver driver(transformation == "additive-noise" ? "additive" : "sampling", 
+                values, seed);
+        evaluate(base_directory, img_directory, gt_directory, command_line, batch_socket, &driver);
+    }
+    else if (transformation == "salt-and-pepper") {
+        SaltAndPepperNoiseDriver driver(values, seed);
+        evaluate(base_directory, img_directory, gt_directory, command_line, batch_socket, &driver);
+    }
+    else if (transformation == "poisson-noise") {
+        PoissonNoiseDriver driver(seed);
+        evaluate(base_directory, img_directory, gt_directory, command_line, batch_socket, &driver);
+    }
+    else if (transformation == "blur") {
+        BlurDriver driver(sizes);
+        evaluate(base_directory, img_directory, gt_directory, command_line, batch_socket, &driver);
+    }
+    else if (transformation == "gaussian-blur") {
+        GaussianBlurDriver driver(sizes, zeros);
+        evaluate(base_directory, img_directory, gt_directory, command_line, batch_socket, &driver);
+    }
+    else if (transformation == "median-blur") {
+        MedianBlurDriver driver(sizes);
+        evaluate(base_directory, img_directory, gt_directory, command_line, batch_socket, &driver);
+    }
+    else if (transformation == "motion-blur") {
+        MotionBlurDriver driver(sizes, zeros);
+        evaluate(base_directory, img_directory, gt_directory, command_line, batch_socket, &driver);
+    }
+    else if (transformation == "horizontal-shear" || transformation == "vertical-shear") {
+        ShearDriver driver(transformation == "horizontal-shear" ? "horizontal" : "vertical", 
+                crop, values);
+        evaluate(base_directory, img_directory, gt_directory, command_line, batch_socket, &driver);
+    }
+    else if (transformation == "rotation") {
+        RotationDriver driver(crop, values);
+        evaluate(base_directory, img_directory, gt_directory, command_line, batch_socket, &driver);
+    }
+    else {
+        std::cout << "Invalid transformation." << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}
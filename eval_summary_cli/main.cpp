@@ -35,6 +35,7 @@
 #include <boost/program_options.hpp>
 #include <glog/logging.h>
 
+#include <cstdio>
 #include "io_util.h"
 #include "parameter_optimization_tool.h"
 
@@ -48,8 +49,14 @@
  *     --gt-directory arg    ground truth directory
  *     --append-file arg     append file
  *     --vis                 visualize results
+ *     --shard arg           only evaluate shard i/n, e.g. 0/4
  *     --help                produce help message
  * \endcode
+ * 
+ * Results are written per image, so an interrupted evaluation is resumed
+ * by running the same command again. With --shard i/n only every n-th image
+ * (starting with image i) is evaluated and written to results-i-of-n.csv;
+ * eval_average_cli --merge-directory combines all shards into a summary.
  * \author David Stutz
  */
 int main(int argc, const char** argv) {
@@ -61,6 +68,7 @@ int main(int argc, const char** argv) {
         ("gt-directory", boost::program_options::value<std::string>(), "ground truth directory")
         ("append-file", boost::program_options::value<std::string>()->default_value(""), "append file")
         ("vis", "visualize results")
+        ("shard", boost::program_options::value<std::string>()->default_value(""), "only evaluate shard i/n, e.g. 0/4")
         ("help", "produce help message");
 
     boost::program_options::positional_options_description positionals;
@@ -116,6 +124,19 @@ int main(int argc, const char** argv) {
         summary.setAppendFile(append_file);
     }
     
+    std::string shard_string = parameters["shard"].as<std::string>();
+    if (!shard_string.empty()) {
+        int shard = -1;
+        int shards = -1;
+        if (std::sscanf(shard_string.c_str(), "%d/%d", &shard, &shards) != 2
+                || shards <= 0 || shard < 0 || shard >= shards) {
+            std::cout << "Invalid shard, expected i/n with 0 <= i < n." << std::endl;
+            return 1;
+        }
+        
+        summary.setShard(shard, shards);
+    }
+    
     int gt_max = 0;
     summary.computeSummary(gt_max);
     
@@ -374,16 +374,10 @@ double ContourRelaxation<TLabelImage>::calculateCliqueCost(cv::Mat const& labelI
     // Direct cliques.
 
     // Store the differences in coordinates of all direct cliques in reference to the central pixel.
-    // Fill this static vector on the first function call, the elements will never change.
-    static std::vector<cv::Point2i> directCoordDiffs;
-
-    if (directCoordDiffs.size() == 0)
-    {
-        directCoordDiffs.push_back(cv::Point2i(-1, 0));
-        directCoordDiffs.push_back(cv::Point2i(1, 0));
-        directCoordDiffs.push_back(cv::Point2i(0, -1));
-        directCoordDiffs.push_back(cv::Point2i(0, 1));
-    }
+    // Initialized once (thread safe), the elements never change.
+    static std::vector<cv::Point2i> const directCoordDiffs = {
+        cv::Point2i(-1, 0), cv::Point2i(1, 0), cv::Point2i(0, -1), cv::Point2i(0, 1)
+    };
 
     int numDirectCliques = 0;
 
@@ -406,16 +400,10 @@ double ContourRelaxation<TLabelImage>::calculateCliqueCost(cv::Mat const& labelI
     // Diagonal cliques.
 
     // Store the differences in coordinates of all diagonal cliques in reference to the central pixel.
-    // Fill this static vector on the first function call, the elements will never change.
-    static std::vector<cv::Point2i> diagonalCoordDiffs;
-
-    if (diagonalCoordDiffs.size() == 0)
-    {
-        diagonalCoordDiffs.push_back(cv::Point2i(-1, -1));
-        diagonalCoordDiffs.push_back(cv::Point2i(-1, 1));
-        diagonalCoordDiffs.push_back(cv::Point2i(1, -1));
-        diagonalCoordDiffs.push_back(cv::Point2i(1, 1));
-    }
+    // Initialized once (thread safe), the elements never change.
+    static std::vector<cv::Point2i> const diagonalCoordDiffs = {
+        cv::Point2i(-1, -1), cv::Point2i(-1, 1), cv::Point2i(1, -1), cv::Point2i(1, 1)
+    };
 
     int numDiagonalCliques = 0;
 
@@ -67,7 +67,10 @@
  */
 
 #include "compact_watershed.h"
-#include <cxmisc.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
 
 /****************************************************************************************\
 *                                Compact Watershed                                      *
@@ -80,188 +83,176 @@ using namespace cv;
 
 namespace cws
 {
-  typedef struct CvWSNode
+  // Priority queue of FIFO buckets. Every pixel is queued at most once, so the nodes are
+  // preallocated in a single array and linked by index. Priorities (color difference plus
+  // compactness value) beyond the fixed number of buckets go to an overflow heap ordered
+  // by priority and node index, i.e. FIFO for equal priorities as in the buckets; the heap
+  // is the last bucket as seen by nonEmpty(), empty() and pop(). All state is local, so
+  // concurrent calls are safe.
+  class WSQueue
   {
-      struct CvWSNode* next;
-      int mask_ofs;
-      int img_ofs;
-      float compVal;
-  }
-  CvWSNode;
+  public:
+    WSQueue(int nodes, int buckets)
+      : next(nodes), mask_ofs(nodes), img_ofs(nodes), compVal(nodes),
+        first(buckets, -1), last(buckets, -1), size(0), bucket_size(0)
+    {
+    }
 
-  typedef struct CvWSQueue
-  {
-      CvWSNode* first;
-      CvWSNode* last;
-  }
-  CvWSQueue;
+    // first non-empty queue starting at idx, -1 if there is none
+    int nonEmpty(int idx) const
+    {
+      if( bucket_size > 0 )
+        for( ; idx < (int) first.size(); idx++ )
+          if( first[idx] >= 0 )
+            return idx;
+      return overflow.empty() ? -1 : (int) first.size();
+    }
 
-  static CvWSNode* icvAllocWSNodes( CvMemStorage* storage )
-  {
-      CvWSNode* n = 0;
-      
-      int i, count = (storage->block_size - sizeof(CvMemBlock))/sizeof(*n) - 1;
+    bool empty(int idx) const
+    {
+      if( idx >= (int) first.size() )
+        return overflow.empty();
+      return first[idx] < 0;
+    }
 
-      n = (CvWSNode*)cvMemStorageAlloc( storage, count*sizeof(*n) );
-      for( i = 0; i < count-1; i++ )
-          n[i].next = n + i + 1;
-      n[count-1].next = 0;
+    void push(double priority, int mofs, int iofs, float cV)
+    {
+      int node = size++;
+      next[node] = -1;
+      mask_ofs[node] = mofs;
+      img_ofs[node] = iofs;
+      compVal[node] = cV;
 
-      return n;
-  }
+      if( !(priority < first.size()) )
+      {
+        overflow.push(std::make_pair(priority, node));
+        return;
+      }
 
+      int idx = (int) priority;
+      bucket_size++;
+      if( last[idx] >= 0 )
+        next[last[idx]] = node;
+      else
+        first[idx] = node;
+      last[idx] = node;
+    }
 
-  void  cvWatershed( const CvArr* srcarr, CvArr* dstarr, float compValStep)
-  {
-      if(compValStep>5)
-          printf("cws::cvWatershed Warning: Large compValStep values can cause seg faults");
-      
-      const int IN_QUEUE = -2;
-      const int WSHED = -1;
-      const int NQ = 1024;
-      cv::Ptr<CvMemStorage> storage;
-      
-      CvMat sstub, *src;
-      CvMat dstub, *dst;
-      CvSize size;
-      CvWSNode* free_node = 0, *node;
-      CvWSQueue q[NQ];
-      int active_queue;
-      int i, j;
-      int db, dg, dr;
-      int* mask;
-      uchar* img;
-      int mstep, istep;
-      int subs_tab[2*NQ+1];
-      
-      // MAX(a,b) = b + MAX(a-b,0)
-      #define ws_max(a,b) ((b) + subs_tab[(a)-(b)+NQ])
-      // MIN(a,b) = a - MAX(a-b,0)
-      #define ws_min(a,b) ((a) - subs_tab[(a)-(b)+NQ])
-
-      #define ws_push(idx,mofs,iofs,cV)  \
-      {                               \
-          if( !free_node )            \
-              free_node = icvAllocWSNodes( storage );\
-          node = free_node;           \
-          free_node = free_node->next;\
-          node->next = 0;             \
-          node->mask_ofs = mofs;      \
-          node->img_ofs = iofs;       \
-          node->compVal = cV;    \
-          if( q[idx].last )           \
-              q[idx].last->next=node; \
-          else                        \
-              q[idx].first = node;    \
-          q[idx].last = node;         \
+    void pop(int idx, int& mofs, int& iofs, float& cV)
+    {
+      int node;
+      if( idx >= (int) first.size() )
+      {
+        node = overflow.top().second;
+        overflow.pop();
       }
-
-      #define ws_pop(idx,mofs,iofs,cV)   \
-      {                               \
-          node = q[idx].first;        \
-          q[idx].first = node->next;  \
-          if( !node->next )           \
-              q[idx].last = 0;        \
-          node->next = free_node;     \
-          free_node = node;           \
-          mofs = node->mask_ofs;      \
-          iofs = node->img_ofs;       \
-          cV = node->compVal;       \
+      else
+      {
+        node = first[idx];
+        bucket_size--;
+        first[idx] = next[node];
+        if( first[idx] < 0 )
+          last[idx] = -1;
       }
 
-      #define c_diff(ptr1,ptr2,diff)      \
-      {                                   \
-          db = abs((ptr1)[0] - (ptr2)[0]);\
-          dg = abs((ptr1)[1] - (ptr2)[1]);\
-          dr = abs((ptr1)[2] - (ptr2)[2]);\
-          diff = ws_max(db,dg);           \
-          diff = ws_max(diff,dr);         \
-          assert( 0 <= diff && diff <= 255 ); \
-      }
+      mofs = mask_ofs[node];
+      iofs = img_ofs[node];
+      cV = compVal[node];
+    }
+
+  private:
+    typedef std::pair<double, int> Entry;
+
+    std::vector<int> next;
+    std::vector<int> mask_ofs;
+    std::vector<int> img_ofs;
+    std::vector<float> compVal;
+    std::vector<int> first;
+    std::vector<int> last;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > overflow;
+    int size;
+    int bucket_size;
+  };
+
+  // maximum absolute difference over the three color channels
+  static inline int c_diff(const uchar* ptr1, const uchar* ptr2)
+  {
+    int db = abs(ptr1[0] - ptr2[0]);
+    int dg = abs(ptr1[1] - ptr2[1]);
+    int dr = abs(ptr1[2] - ptr2[2]);
+    return std::max(std::max(db, dg), dr);
+  }
 
-      src = cvGetMat( srcarr, &sstub );
-      dst = cvGetMat( dstarr, &dstub );
+  void compact_watershed( InputArray _src, InputOutputArray _markers, float compValStep)
+  {
+      const int IN_QUEUE = -2;
+      const int WSHED = -1;
 
-      if( CV_MAT_TYPE(src->type) != CV_8UC3 )
-          CV_Error( CV_StsUnsupportedFormat, "Only 8-bit, 3-channel input images are supported" );
+      Mat src = _src.getMat();
+      Mat dst = _markers.getMat();
 
-      if( CV_MAT_TYPE(dst->type) != CV_32SC1 )
-          CV_Error( CV_StsUnsupportedFormat,
-              "Only 32-bit, 1-channel output images are supported" );
-      
-      if( !CV_ARE_SIZES_EQ( src, dst ))
-          CV_Error( CV_StsUnmatchedSizes, "The input and output images must have the same size" );
+      CV_Assert( src.type() == CV_8UC3 && dst.type() == CV_32SC1 );
+      CV_Assert( src.rows == dst.rows && src.cols == dst.cols );
+      CV_Assert( compValStep >= 0 );
 
-      size = cvGetMatSize(src);
-      storage = cvCreateMemStorage();
+      const int rows = src.rows;
+      const int cols = src.cols;
+      const int istep = (int) src.step;
+      const int mstep = (int) (dst.step / sizeof(int));
+      uchar* img = src.data;
+      int* mask = dst.ptr<int>(0);
 
-      istep = src->step;
-      img = src->data.ptr;
-      mstep = dst->step / sizeof(mask[0]);
-      mask = dst->data.i;
+      // the compactness values grow by compValStep along the flooding paths, which are
+      // rarely much longer than the image diagonal; larger priorities use the overflow
+      // heap, so the number of buckets is bounded independent of compValStep
+      const double buckets = 256 + ceil((double) compValStep*(rows + cols));
+      WSQueue q(rows*cols, (int) std::min(buckets, 256. + rows*cols));
 
-      memset( q, 0, NQ*sizeof(q[0]) );
+      int active_queue;
+      int i, j;
 
-      for( i = 0; i < NQ; i++ )
-          subs_tab[i] = 0;
-      for( i = NQ; i <= 2*NQ; i++ )
-          subs_tab[i] = i - NQ;
-      
       // draw a pixel-wide border of dummy "watershed" (i.e. boundary) pixels
-      for( j = 0; j < size.width; j++ )
-          mask[j] = mask[j + mstep*(size.height-1)] = WSHED;
+      for( j = 0; j < cols; j++ )
+          mask[j] = mask[j + mstep*(rows-1)] = WSHED;
 
       // initial phase: put all the neighbor pixels of each marker to the ordered queue -
       // determine the initial boundaries of the basins
-      for( i = 1; i < size.height-1; i++ )
+      for( i = 1; i < rows-1; i++ )
       {
           img += istep; mask += mstep;
-          mask[0] = mask[size.width-1] = WSHED;
+          mask[0] = mask[cols-1] = WSHED;
 
-          for( j = 1; j < size.width-1; j++ )
+          for( j = 1; j < cols-1; j++ )
           {
               int* m = mask + j;
               if( m[0] < 0 ) m[0] = 0;
               if( m[0] == 0 && (m[-1] > 0 || m[1] > 0 || m[-mstep] > 0 || m[mstep] > 0) )
               {
                   uchar* ptr = img + j*3;
-                  int idx = 256, t;
+                  int idx = 256;
                   if( m[-1] > 0 )
-                      c_diff( ptr, ptr - 3, idx );
+                      idx = c_diff( ptr, ptr - 3 );
                   if( m[1] > 0 )
-                  {
-                      c_diff( ptr, ptr + 3, t );
-                      idx = ws_min( idx, t );
-                  }
+                      idx = std::min( idx, c_diff( ptr, ptr + 3 ) );
                   if( m[-mstep] > 0 )
-                  {
-                      c_diff( ptr, ptr - istep, t );
-                      idx = ws_min( idx, t );
-                  }
+                      idx = std::min( idx, c_diff( ptr, ptr - istep ) );
                   if( m[mstep] > 0 )
-                  {
-                      c_diff( ptr, ptr + istep, t );
-                      idx = ws_min( idx, t );
-                  }
-                  assert( 0 <= idx && idx <= NQ-1 );
-                  ws_push( idx, i*mstep + j, i*istep + j*3, 0.0);
+                      idx = std::min( idx, c_diff( ptr, ptr + istep ) );
+                  q.push( idx, i*mstep + j, i*istep + j*3, 0.0f );
                   m[0] = IN_QUEUE;
               }
           }
       }
 
       // find the first non-empty queue
-      for( i = 0; i < NQ; i++ )
-          if( q[i].first )
-              break;
+      active_queue = q.nonEmpty(0);
 
       // if there is no markers, exit immediately
-      if( i == NQ )
+      if( active_queue < 0 )
           return;
 
-      active_queue = i;
-      img = src->data.ptr;
-      mask = dst->data.i;
+      img = src.data;
+      mask = dst.ptr<int>(0);
 
       // recursively fill the basins
       for(;;)
@@ -270,25 +261,22 @@ namespace cws
           int lab = 0, t;
           int* m;
           uchar* ptr;
-          
+          float compVal;
+
           // search for next queue
-          if( q[active_queue].first == 0 )
+          if( q.empty(active_queue) )
           {
-              for( i = active_queue+1; i < NQ; i++ )
-                  if( q[i].first )
-                      break;
-              if( i == NQ )
+              active_queue = q.nonEmpty(active_queue+1);
+              if( active_queue < 0 )
                   break;
-              active_queue = i;
           }
 
           // get next element of this queue
-          float compVal;
-          ws_pop( active_queue, mofs, iofs, compVal);
+          q.pop( active_queue, mofs, iofs, compVal );
 
           m = mask + mofs; // pointer to element in mask
           ptr = img + iofs; // pointer to element in image
-          
+
           // have a look at all neighbors, if they have different label, mark
           // as watershed and continue
           t = m[-1];
@@ -311,54 +299,46 @@ namespace cws
               if( lab == 0 ) lab = t;
               else if( t != lab ) lab = WSHED;
           }
-          assert( lab != 0 );
-          m[0] = lab;     
-          
+          CV_DbgAssert( lab != 0 );
+          m[0] = lab;
+
           if( lab == WSHED )
             continue;
-          
-          
-          // have a look at all neighbors
-          // 
-          
+
+          // have a look at all neighbors; the queue of a neighbor is its color difference
+          // plus the accumulated compactness value, but the active queue only moves back
+          // by the color difference (as in the original implementation); the priority is
+          // passed as floating point value so large compactness values cannot overflow
           if( m[-1] == 0 )
           {
-              c_diff( ptr, ptr - 3, t ); // store difference to this neighbor in t (current gradient)
-              ws_push( int(round(t+compVal)), mofs - 1, iofs - 3, compVal+compValStep); // store in queue
-              active_queue = ws_min( active_queue, t ); // check if queue of this element is prior to the current queue (and should be proceeded in the next iteration)
-              m[-1] = IN_QUEUE; // mark in mask as in a queue
+              t = c_diff( ptr, ptr - 3 );
+              q.push( round(t+compVal), mofs - 1, iofs - 3, compVal+compValStep );
+              active_queue = std::min( active_queue, t );
+              m[-1] = IN_QUEUE;
           }
           if( m[1] == 0 )
           {
-              c_diff( ptr, ptr + 3, t );
-              ws_push( int(round(t+compVal)), mofs + 1, iofs + 3, compVal+compValStep );
-              active_queue = ws_min( active_queue, t );
+              t = c_diff( ptr, ptr + 3 );
+              q.push( round(t+compVal), mofs + 1, iofs + 3, compVal+compValStep );
+              active_queue = std::min( active_queue, t );
               m[1] = IN_QUEUE;
           }
           if( m[-mstep] == 0 )
           {
-              c_diff( ptr, ptr - istep, t );
-              ws_push( int(round(t+compVal)), mofs - mstep, iofs - istep, compVal+compValStep );
-              active_queue = ws_min( active_queue, t );
+              t = c_diff( ptr, ptr - istep );
+              q.push( round(t+compVal), mofs - mstep, iofs - istep, compVal+compValStep );
+              active_queue = std::min( active_queue, t );
               m[-mstep] = IN_QUEUE;
           }
           if( m[mstep] == 0 )
           {
-              c_diff( ptr, ptr + istep, t );
-              ws_push( int(round(t+compVal)), mofs + mstep, iofs + istep, compVal+compValStep );
-              active_queue = ws_min( active_queue, t );
+              t = c_diff( ptr, ptr + istep );
+              q.push( round(t+compVal), mofs + mstep, iofs + istep, compVal+compValStep );
+              active_queue = std::min( active_queue, t );
               m[mstep] = IN_QUEUE;
           }
       }
   }
-
-
-  void compact_watershed( InputArray _src, InputOutputArray markers , float compValStep)
-  {
-      Mat src = _src.getMat();
-      CvMat c_src = _src.getMat(), c_markers = markers.getMat();
-      cws::cvWatershed( &c_src, &c_markers,compValStep );
-  }
 } // namespace cws
 
 void compact_watershed(Mat& img, Mat& B, float n, float compValStep, Mat& seeds)
@@ -23,6 +23,21 @@
 #include <opencv2/opencv.hpp>
 #include <stdio.h>
 
+namespace cws
+{
+  /**
+  Compact watershed on a marker image: flood the positive labels in markers over img,
+  ordered by color difference plus a compactness value growing by compValStep per pixel.
+  Priorities beyond the bucket range go to an overflow heap, so large compValStep values are
+  supported in bounded memory; no state is shared between calls, so images can be processed
+  concurrently.
+
+  @param img input image CV_8UC3
+  @param markers CV_32SC1 seed labels (> 0), overwritten by the labels and -1 at boundaries
+  @param compValStep input parameter for the desired compactness, >= 0
+  */
+  void compact_watershed(cv::InputArray img, cv::InputOutputArray markers, float compValStep);
+}
 
 /**
 Compact watershed is a superpixel or oversegmentation algorithm.
@@ -39,9 +39,9 @@
 #include "lib_dasp_slimage/Slimage/Slimage.hpp"
 #include "dasp_opencv.h"
 
-void DASP_OpenCV::computeSuperpixels(const cv::Mat &image, const cv::Mat &depth, 
+dasp::Parameters DASP_OpenCV::createParameters(const cv::Mat &image, 
         int desired_superpixels, float spatial_weight, float normal_weight, 
-        int seed_mode, int iterations, dasp::Camera camera, cv::Mat &labels) {
+        int seed_mode, int iterations, dasp::Camera camera) {
     
     dasp::Parameters opt;
     opt.camera = camera;
@@ -66,6 +66,16 @@ void DASP_OpenCV::computeSuperpixels(const cv::Mat &image, const cv::Mat &depth,
         // TODO
     }
     
+    return opt;
+}
+
+void DASP_OpenCV::computeSuperpixels(const cv::Mat &image, const cv::Mat &depth, 
+        int desired_superpixels, float spatial_weight, float normal_weight, 
+        int seed_mode, int iterations, dasp::Camera camera, cv::Mat &labels) {
+    
+    dasp::Parameters opt = createParameters(image, desired_superpixels, 
+            spatial_weight, normal_weight, seed_mode, iterations, camera);
+    
     dasp::Superpixels superpixels;
     slimage::Image3ub slimage_color;
     slimage::Image1ui16 slimage_depth;
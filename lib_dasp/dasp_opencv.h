@@ -34,6 +34,7 @@
 
 #include <opencv2/opencv.hpp>
 #include "Tools.hpp"
+#include "Parameters.hpp"
 
 /** \brief Wrapper for running DASP on OpenCV images.
  * \author David Stutz
@@ -61,6 +62,20 @@ public:
     static void computeSuperpixels(const cv::Mat &image, const cv::Mat &depth, 
             int superpixels, float spatial_weight, float normal_weight, 
             int seed_mode, int iterations, dasp::Camera camera, cv::Mat &labels);
+    
+    /** \brief Create DASP parameters as used by computeSuperpixels.
+     * \param[in] image image to compute superpixels on (only the size is used)
+     * \param[in] superpixels number of superpixels to generate
+     * \param[in] spatial_weight weight of spatial dimensions
+     * \param[in] normal_weight weight of normals
+     * \param[in] seed_mode seed mode to use
+     * \param[in] iterations number of iterations
+     * \param[in] camera dasp::Camera object specifying camera parameters
+     * \return parameters
+     */
+    static dasp::Parameters createParameters(const cv::Mat &image, 
+            int superpixels, float spatial_weight, float normal_weight, 
+            int seed_mode, int iterations, dasp::Camera camera);
 };
 
 #endif	/* DASP_OPENCV_H */
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Superpixels.hpp"
+#include "lib_dasp_slimage/Slimage/Slimage.hpp"
+#include "dasp_stream.h"
+
+DASPStream::DASPStream(const dasp::Parameters &parameters_, bool temporal_) 
+        : parameters(parameters_), superpixels(new dasp::Superpixels()),
+        temporal(temporal_), frames(0) {
+    
+}
+
+DASPStream::~DASPStream() {
+    
+}
+
+void DASPStream::setCamera(dasp::Camera camera) {
+    parameters.camera = camera;
+}
+
+void DASPStream::reset() {
+    superpixels.reset(new dasp::Superpixels());
+    frames = 0;
+}
+
+int DASPStream::getFrames() const {
+    return frames;
+}
+
+const dasp::Superpixels& DASPStream::getSuperpixels() const {
+    return *superpixels;
+}
+
+void DASPStream::computeSuperpixels(const cv::Mat &image, const cv::Mat &depth, 
+        cv::Mat &labels) {
+    
+    // convertTo only converts the depth, not the number of channels
+    CV_Assert(image.channels() == 3 && depth.channels() == 1);
+    CV_Assert(image.rows == depth.rows && image.cols == depth.cols);
+    
+    if (frames > 0 && (image.cols != superpixels->width() 
+            || image.rows != superpixels->height())) {
+        reset();
+    }
+    
+    superpixels->opt = parameters;
+    superpixels->opt.width = image.cols;
+    superpixels->opt.height = image.rows;
+    
+    if (temporal && frames > 0) {
+        superpixels->opt.seed_mode = dasp::SeedModes::Delta;
+    }
+    
+    // Wrap the OpenCV memory if possible; repairing or smoothing depth
+    // works in place, so the caller's depth is never wrapped in that case.
+    const cv::Mat* color_mat = &image;
+    if (image.type() != CV_8UC3 || !image.isContinuous()) {
+        image.convertTo(image_buffer, CV_8UC3);
+        if (!image_buffer.isContinuous()) {
+            image_buffer = image_buffer.clone();
+        }
+        
+        color_mat = &image_buffer;
+    }
+    
+    const cv::Mat* depth_mat = &depth;
+    if (depth.type() != CV_16UC1 || !depth.isContinuous() 
+            || parameters.is_repair_depth || parameters.is_smooth_depth) {
+        depth.convertTo(depth_buffer, CV_16UC1);
+        if (!depth_buffer.isContinuous()) {
+            depth_buffer = depth_buffer.clone();
+        }
+        
+        depth_mat = &depth_buffer;
+    }
+    
+    slimage::Image3ub slimage_color(image.cols, image.rows, 
+            slimage::Buffer<unsigned char>(3*image.rows*image.cols, color_mat->data));
+    slimage::Image1ui16 slimage_depth(image.cols, image.rows, 
+            slimage::Buffer<uint16_t>(image.rows*image.cols, 
+            reinterpret_cast<uint16_t*>(depth_mat->data)));
+    
+    dasp::ComputeSuperpixelsIncremental(*superpixels, slimage_color, slimage_depth);
+    ++frames;
+    
+    // The state must not refer to the wrapped memory once the caller's images
+    // go away; the color copy is not needed between frames, so drop it.
+    superpixels->color_raw = slimage::Image3ub();
+    
+    // Write labels directly instead of going through an slimage label image;
+    // unassigned pixels are -1, so labels are shifted by one in this case
+    // (same as DASP_OpenCV::computeSuperpixels).
+    labels.create(image.rows, image.cols, CV_32SC1);
+    labels.setTo(-1);
+    
+    int* labels_ptr = labels.ptr<int>(0);
+    for (unsigned int j = 0; j < superpixels->cluster.size(); ++j) {
+        for (unsigned int i : superpixels->cluster[j].pixel_ids) {
+            labels_ptr[i] = j;
+        }
+    }
+    
+    for (int i = 0; i < labels.rows*labels.cols; ++i) {
+        if (labels_ptr[i] < 0) {
+            labels += 1;
+            break;
+        }
+    }
+}
@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DASP_STREAM_H
+#define	DASP_STREAM_H
+
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include "Tools.hpp"
+#include "Parameters.hpp"
+
+namespace dasp {
+    class Superpixels;
+}
+
+/** \brief DASP session for RGB-D streams.
+ * 
+ * In contrast to DASP_OpenCV::computeSuperpixels, the dasp::Superpixels state
+ * is kept between frames: the point buffers and the density mipmaps used for
+ * seeding are only reallocated if the frame size changes. Color and depth
+ * images are wrapped instead of copied as long as they are continuous
+ * CV_8UC3 and CV_16UC1 matrices. In temporal mode, the superpixel centers of
+ * the previous frame are used to seed the next frame (delta density sampling).
+ * 
+ * Usage:
+ * \code{cpp}
+ *   DASPStream stream(DASP_OpenCV::createParameters(image, 400, 0.3f, 0.2f, 
+ *           DASP_OpenCV::SEED_MODE_SPDS, 5, camera), true);
+ *   for (...) {
+ *       stream.computeSuperpixels(image, depth, labels);
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class DASPStream {
+public:
+    /** \brief Constructor.
+     * \param[in] parameters DASP parameters, see DASP_OpenCV::createParameters
+     * \param[in] temporal whether to seed frames from the previous superpixels
+     */
+    DASPStream(const dasp::Parameters &parameters, bool temporal);
+    
+    /** \brief Destructor. */
+    ~DASPStream();
+    
+    /** \brief Compute superpixels on the next frame.
+     * \param[in] image three-channel image to compute superpixels on
+     * \param[in] depth depth image as unsigned short
+     * \param[out] labels superpixel labels
+     */
+    void computeSuperpixels(const cv::Mat &image, const cv::Mat &depth, 
+            cv::Mat &labels);
+    
+    /** \brief Update the camera, e.g. when intrinsics change between frames.
+     * \param[in] camera camera parameters
+     */
+    void setCamera(dasp::Camera camera);
+    
+    /** \brief Forget the previous frame; the next frame is seeded from scratch. */
+    void reset();
+    
+    /** \brief Number of frames processed since construction or last reset.
+     * \return number of frames
+     */
+    int getFrames() const;
+    
+    /** \brief Get the underlying superpixel state of the last frame; the
+     * color image (color_raw) is not kept.
+     * \return superpixels
+     */
+    const dasp::Superpixels& getSuperpixels() const;
+    
+private:
+    
+    /** \brief Parameters as given, reset before each frame as DASP adapts 
+     * base_radius to the number of superpixels in place. */
+    dasp::Parameters parameters;
+    /** \brief Superpixel state kept between frames. */
+    std::unique_ptr<dasp::Superpixels> superpixels;
+    /** \brief Whether to seed from previous superpixels. */
+    bool temporal;
+    /** \brief Number of processed frames. */
+    int frames;
+    /** \brief Buffers for images which cannot be wrapped directly. */
+    cv::Mat image_buffer;
+    cv::Mat depth_buffer;
+    
+};
+
+#endif	/* DASP_STREAM_H */
+
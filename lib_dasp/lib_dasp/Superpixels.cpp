@@ -737,7 +737,7 @@ std::vector<Seed> Superpixels::FindSeeds()
 			pds::SimplifiedPDSOld(density));
 	case SeedModes::SimplifiedPDS:
 		return CreateSeedPoints(points,
-			pds::SimplifiedPDS(density));
+			pds::SimplifiedPDS(density, density_pyramid));
 	case SeedModes::FloydSteinberg:
 		return CreateSeedPoints(points,
 			pds::FloydSteinberg(density));
@@ -759,7 +759,7 @@ std::vector<Seed> Superpixels::FindSeeds()
 		std::vector<int> seed_origin;
 		std::vector<Eigen::Vector2f> pnts = pds::DeltaDensitySampling(density, pnts_prev, &seed_origin);
 		std::vector<Seed> seeds = CreateSeedPoints(points, pnts, &seed_origin);
-		assert(seeds.size() != seed_origin.size());
+		assert(seeds.size() == seed_origin.size());
 		if(seeds.size() != seed_origin.size()) {
 			std::cerr << "ERROR with DDS: invalid point!" << std::endl;
 		}
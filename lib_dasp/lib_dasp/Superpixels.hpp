@@ -13,6 +13,7 @@
 #include "Seed.hpp"
 #include <Slimage/Slimage.hpp>
 #include <Slimage/Parallel.h>
+#include <density/ScalePyramid.hpp>
 #include <eigen3/Eigen/Dense>
 #include <boost/graph/adjacency_list.hpp>
 #include <vector>
@@ -61,6 +62,9 @@ namespace dasp
 
 		Eigen::MatrixXf density;
 
+		/** Mipmaps of density used for seeding, kept to avoid reallocation between frames */
+		density::ScalePyramid density_pyramid;
+
 		Eigen::MatrixXf saliency;
 
 		std::vector<Cluster> cluster;
@@ -7,12 +7,19 @@ namespace density {
 //----------------------------------------------------------------------------//
 
 Eigen::MatrixXf SumMipMapWithBlackBorder(const Eigen::MatrixXf& img_big)
+{
+	Eigen::MatrixXf img_small;
+	SumMipMapWithBlackBorder(img_big, img_small);
+	return img_small;
+}
+
+void SumMipMapWithBlackBorder(const Eigen::MatrixXf& img_big, Eigen::MatrixXf& img_small)
 {
 	size_t w_big = img_big.rows();
 	size_t h_big = img_big.cols();
 	// the computed mipmap will have 2^i size
 	unsigned int size = Danvil::MoreMath::P2Ceil(std::max(w_big, h_big));
-	Eigen::MatrixXf img_small(size / 2, size / 2);
+	img_small.resize(size / 2, size / 2);
 	img_small.fill({0.0f});
 	// only the part where at least one of the four pixels lies in the big image is iterated
 	// the rest was set to 0 with the fill op
@@ -42,7 +49,6 @@ Eigen::MatrixXf SumMipMapWithBlackBorder(const Eigen::MatrixXf& img_big)
 			img_small(x, y) = sum;
 		}
 	}
-	return img_small;
 }
 
 Eigen::MatrixXf ScaleUp(const Eigen::MatrixXf& img_small, const unsigned int S)
@@ -148,6 +154,31 @@ std::vector<std::pair<Eigen::MatrixXf,Eigen::MatrixXf>> ComputeMipmapsWithAbs(co
 	return mipmaps;
 }
 
+const std::vector<Eigen::MatrixXf>& ScalePyramid::update(const Eigen::MatrixXf& img)
+{
+	is_640x480_ = (img.rows() == 640 && img.cols() == 480);
+	if(is_640x480_) {
+		// same layout as ComputeMipmaps640x480
+		mipmaps_.resize(6);
+		SumMipMap<5>(img, mipmaps_[0]);
+		for(unsigned int i=0; i<5; i++) {
+			SumMipMap<2>(mipmaps_[i], mipmaps_[i+1]);
+		}
+	}
+	else {
+		// same layout as ComputeMipmaps(img, 1)
+		unsigned int max_size = std::max(img.rows(), img.cols());
+		int n_mipmaps = Danvil::MoreMath::PowerOfTwoExponent(max_size);
+		BOOST_ASSERT(n_mipmaps >= 1);
+		mipmaps_.resize(n_mipmaps);
+		SumMipMapWithBlackBorder(img, mipmaps_[0]);
+		for(unsigned int i=1; i<n_mipmaps; i++) {
+			SumMipMap<2>(mipmaps_[i - 1], mipmaps_[i]);
+		}
+	}
+	return mipmaps_;
+}
+
 //----------------------------------------------------------------------------//
 }
 //----------------------------------------------------------------------------//
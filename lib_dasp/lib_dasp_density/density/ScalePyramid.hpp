@@ -19,8 +19,11 @@ namespace density {
 
 Eigen::MatrixXf SumMipMapWithBlackBorder(const Eigen::MatrixXf& img_big);
 
+void SumMipMapWithBlackBorder(const Eigen::MatrixXf& img_big, Eigen::MatrixXf& img_small);
+
+/** Sums QxQ blocks of img_big into img_small; img_small is only reallocated if its size changes */
 template<unsigned int Q>
-Eigen::MatrixXf SumMipMap(const Eigen::MatrixXf& img_big)
+void SumMipMap(const Eigen::MatrixXf& img_big, Eigen::MatrixXf& img_small)
 {
 	// size of original image
 	const unsigned int w_big = img_big.rows();
@@ -32,7 +35,7 @@ Eigen::MatrixXf SumMipMap(const Eigen::MatrixXf& img_big)
 	if(Q*w_sma != w_big || Q*h_sma != h_big) {
 		throw std::runtime_error("ERROR: Q and size does not match in function SumMipMap!");
 	}
-	Eigen::MatrixXf img_small(w_sma, h_sma);
+	img_small.resize(w_sma, h_sma);
 	for(unsigned int y=0; y<h_sma; ++y) {
 		const unsigned int y_big = Q*y;
 		for(unsigned int x=0; x<w_sma; ++x) {
@@ -46,6 +49,13 @@ Eigen::MatrixXf SumMipMap(const Eigen::MatrixXf& img_big)
 			img_small(x, y) = sum;
 		}
 	}
+}
+
+template<unsigned int Q>
+Eigen::MatrixXf SumMipMap(const Eigen::MatrixXf& img_big)
+{
+	Eigen::MatrixXf img_small;
+	SumMipMap<Q>(img_big, img_small);
 	return img_small;
 }
 
@@ -59,6 +69,31 @@ std::vector<Eigen::MatrixXf> ComputeMipmaps640x480(const Eigen::MatrixXf& img);
 
 std::vector<std::pair<Eigen::MatrixXf,Eigen::MatrixXf>> ComputeMipmapsWithAbs(const Eigen::MatrixXf& img, unsigned int min_size);
 
+/** Mipmaps which are kept alive between calls
+ * Recomputing the pyramid of a density image with the same size as in the
+ * previous call reuses all level matrices, so no memory is allocated when
+ * processing a stream of equally sized frames.
+ */
+class ScalePyramid
+{
+public:
+	/** Recomputes the pyramid for img (uses the 640x480 layout if possible) */
+	const std::vector<Eigen::MatrixXf>& update(const Eigen::MatrixXf& img);
+
+	const std::vector<Eigen::MatrixXf>& levels() const {
+		return mipmaps_;
+	}
+
+	/** True if the 640x480 layout (base level is 5x5 reduced) is used */
+	bool is640x480() const {
+		return is_640x480_;
+	}
+
+private:
+	std::vector<Eigen::MatrixXf> mipmaps_;
+	bool is_640x480_ = false;
+};
+
 }
 
 #endif
@@ -68,9 +68,10 @@ namespace pds
 					it_min = it;
 				}
 			}
+			const std::size_t i_min = std::distance(samples.begin(), it_min);
 			samples.erase(it_min);
 			if(seed_origin) {
-				seed_origin->erase(seed_origin->begin() + std::distance(samples.begin(), it_min));
+				seed_origin->erase(seed_origin->begin() + i_min);
 			}
 		}
 		// add points
@@ -4,6 +4,11 @@
 #include <Eigen/Dense>
 #include <vector>
 
+namespace density
+{
+	class ScalePyramid;
+}
+
 namespace pds
 {
 
@@ -15,6 +20,9 @@ namespace pds
 
 	std::vector<Eigen::Vector2f> SimplifiedPDS(const Eigen::MatrixXf& density);
 
+	/** Like SimplifiedPDS but keeps the mipmaps in the given pyramid (reused between calls) */
+	std::vector<Eigen::Vector2f> SimplifiedPDS(const Eigen::MatrixXf& density, density::ScalePyramid& pyramid);
+
 	std::vector<Eigen::Vector2f> SimplifiedPDSOld(const Eigen::MatrixXf& density);
 
 	std::vector<Eigen::Vector2f> FloydSteinberg(const Eigen::MatrixXf& density);
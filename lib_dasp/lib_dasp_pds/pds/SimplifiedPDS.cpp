@@ -57,6 +57,31 @@ namespace pds
 //			std::cout << "<- up" << std::endl;
 		}
 
+		std::vector<Eigen::Vector2f> spds_sample(const std::vector<Eigen::MatrixXf>& mipmaps)
+		{
+			// sample points
+			std::vector<Eigen::Vector2f> seeds;
+			spds_rec(seeds, mipmaps, mipmaps.size() - 1, 0, 0);
+			// scale points with base constant
+			impl::ScalePoints(seeds, 2.f);
+			return seeds;
+		}
+
+		std::vector<Eigen::Vector2f> spds_sample_640x480(const std::vector<Eigen::MatrixXf>& mipmaps)
+		{
+			// now create pixel seeds
+			std::vector<Eigen::Vector2f> seeds;
+			const unsigned int l0 = mipmaps.size() - 1;
+			for(unsigned int y=0; y<mipmaps[l0].cols(); ++y) {
+				for(unsigned int x=0; x<mipmaps[l0].rows(); x++) {
+					spds_rec(seeds, mipmaps, l0, x, y);
+				}
+			}
+			// scale points with base constant
+			impl::ScalePoints(seeds, 5.f);
+			return seeds;
+		}
+
 		std::vector<Eigen::Vector2f> spds_impl(const Eigen::MatrixXf& density)
 		{
 			// compute mipmaps
@@ -69,12 +94,7 @@ namespace pds
 				DebugWriteMatrix(mipmaps[i], tag);
 			}
 		#endif
-			// sample points
-			std::vector<Eigen::Vector2f> seeds;
-			spds_rec(seeds, mipmaps, mipmaps.size() - 1, 0, 0);
-			// scale points with base constant
-			impl::ScalePoints(seeds, 2.f);
-			return seeds;
+			return spds_sample(mipmaps);
 		}
 
 		std::vector<Eigen::Vector2f> spds_impl_640x480(const Eigen::MatrixXf& density)
@@ -89,17 +109,7 @@ namespace pds
 				DebugWriteMatrix(mipmaps[i], tag);
 			}
 		#endif
-			// now create pixel seeds
-			std::vector<Eigen::Vector2f> seeds;
-			const unsigned int l0 = mipmaps.size() - 1;
-			for(unsigned int y=0; y<mipmaps[l0].cols(); ++y) {
-				for(unsigned int x=0; x<mipmaps[l0].rows(); x++) {
-					spds_rec(seeds, mipmaps, l0, x, y);
-				}
-			}
-			// scale points with base constant
-			impl::ScalePoints(seeds, 5.f);
-			return seeds;
+			return spds_sample_640x480(mipmaps);
 		}
 	}
 
@@ -113,4 +123,15 @@ namespace pds
 		}
 	}
 
+	std::vector<Eigen::Vector2f> SimplifiedPDS(const Eigen::MatrixXf& density, density::ScalePyramid& pyramid)
+	{
+		const std::vector<Eigen::MatrixXf>& mipmaps = pyramid.update(density);
+		if(pyramid.is640x480()) {
+			return spds::spds_sample_640x480(mipmaps);
+		}
+		else {
+			return spds::spds_sample(mipmaps);
+		}
+	}
+
 }
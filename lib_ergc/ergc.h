@@ -1,4 +1,5 @@
 #include <CImg.h>
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -791,3 +792,268 @@ CImg<> compute_gradient(CImg<> &im) {
   gradient.sqrt();
   return gradient;
 }
+
+
+//////////////////////////////////
+// direct 2d functions on interleaved images
+//////////////////////////////////
+// binary min-heap of pixel indices growing on demand, with the same
+// tie breaking as HeapL so that the propagation order is unchanged
+class PixelHeap {
+ public:
+  PixelHeap(int n) { _data.reserve(n); }
+
+  bool Empty() const { return _data.empty(); }
+
+  void Push(int item, float pkey) {
+    int child=_data.size();
+    _data.resize(child+1);
+    int parent=(child-1)/2;
+
+    while(child>0 && pkey<=_data[parent].pkey) {
+      _data[child]=_data[parent];
+      child=parent;
+      parent=(parent-1)/2;
+    }
+    _data[child].pkey=pkey;
+    _data[child].element=item;
+  }
+
+  int Pop() {
+    int item=_data[0].element;
+    int nitem=_data.size()-1;
+    int parent=0;
+    int child=1;
+
+    while(child<nitem) {
+      if(child+1<nitem && _data[child+1].pkey<=_data[child].pkey)
+	child++;
+      if(_data[nitem].pkey<=_data[child].pkey)
+	break;
+      _data[parent]=_data[child];
+      parent=child;
+      child=child*2+1;
+    }
+    _data[parent]=_data[nitem];
+    _data.pop_back();
+    return item;
+  }
+
+ private:
+  struct Theap {
+    float pkey;
+    int element;
+  };
+  vector<Theap> _data;
+};
+//////////////////////////////////
+// gradient norm of an interleaved W x H x C image, using the rotation
+// invariant kernel and Neumann boundaries of CImg's default get_gradient()
+template<typename T>
+void compute_gradient2d(const T *im, int W, int H, int C, float *gradient) {
+  const float a=0.25f*(2-sqrt(2.0f)), b=0.5f*(sqrt(2.0f)-1);
+
+  for(int y=0;y<H;y++) {
+    const T *rp=im+(y>0?y-1:0)*W*C;
+    const T *rc=im+y*W*C;
+    const T *rn=im+(y<H-1?y+1:y)*W*C;
+    for(int x=0;x<W;x++) {
+      int xp=(x>0?x-1:0)*C, xc=x*C, xn=(x<W-1?x+1:x)*C;
+      float g=0, gx, gy;
+      for(int c=0;c<C;c++) {
+	gx=-a*(float)rp[xp+c] - b*(float)rc[xp+c] - a*(float)rn[xp+c] + a*(float)rp[xn+c] + b*(float)rc[xn+c] + a*(float)rn[xn+c];
+	g+=gx*gx;
+      }
+      for(int c=0;c<C;c++) {
+	gy=-a*(float)rp[xp+c] - b*(float)rp[xc+c] - a*(float)rp[xn+c] + a*(float)rn[xp+c] + b*(float)rn[xc+c] + a*(float)rn[xn+c];
+	g+=gy*gy;
+      }
+      gradient[y*W+x]=sqrt(g);
+    }
+  }
+}
+//////////////////////////////////
+// same seeds as placeSeedsOnCustomGrid2d (followed by perturbSeeds2d if
+// perturbMap is given), written directly into a W x H row-major label buffer
+int placeSeedsOnCustomGrid2d(int W, int H, int dx, int dy, const float *perturbMap, int *labels) {
+  int v8x []={-1, 0, 1, 0, -1, -1, 1, 1};
+  int v8y []={0 ,-1, 0, 1, -1, 1, 1, -1};
+
+  std::fill(labels, labels+W*H, -1);
+
+  int xoff=dx/2;
+  int yoff=dy/2;
+  int nx=(xoff<W)?(W-1-xoff)/dx+1:0;
+  int ny=(yoff<H)?(H-1-yoff)/dy+1:0;
+
+  int x,y,xx,yy,k,xmin,ymin;
+  float v;
+  for(int j=0;j<ny;j++) {
+    y=yoff+j*dy;
+    for(int i=0;i<nx;i++) {
+      x=xoff+i*dx;
+      xmin=x;
+      ymin=y;
+      if(perturbMap) {
+	v=perturbMap[y*W+x];
+	for(k=0;k<8;k++) {
+	  xx=x+v8x[k];
+	  yy=y+v8y[k];
+	  if((xx>=0) && (xx<W) && (yy>=0) && (yy<H))
+	    if(perturbMap[yy*W+xx]<v) {
+	      v=perturbMap[yy*W+xx];
+	      xmin=xx;
+	      ymin=yy;
+	    }
+	}
+      }
+      labels[ymin*W+xmin]=i*ny+j; // seeds are numbered column by column
+    }
+  }
+  return nx*ny;
+}
+//////////////////////////////////
+// initialize_superpixels, initialize_images and fmm3d on an interleaved
+// W x H x C image; labels holds the seeds (-1 elsewhere) and receives the superpixels
+template<typename T>
+void ergc2d(const T *im, int W, int H, int C, int *labels, int m) {
+  /* states S:
+   * -1: OK
+   *  0: NB
+   *  1: FA
+   */
+  int v4x[] ={-1,0,1,0};
+  int v4y[] ={0,1,0,-1};
+  int x,y,xx,yy,k,c,i,ii,lab;
+  float P,a1,a2,a3,A1,delta;
+
+  float INF=100000;
+
+  int N=W*H;
+  int nseeds=0;
+  for(i=0;i<N;i++)
+    if(labels[i]+1>nseeds)
+      nseeds=labels[i]+1;
+  if(nseeds==0)
+    return;
+
+  vector<float> D(N);
+  vector<signed char> S(N);
+  vector<int> xs(nseeds,-1), ys(nseeds,-1), count(nseeds,0);
+  vector<float> meanColor(nseeds*C,0);
+  PixelHeap tas(nseeds+2*(W+H));
+
+  //////////////////////////////
+  // initialize distances, states, superpixels and heap
+  for(y=0,i=0;y<H;y++)
+    for(x=0;x<W;x++,i++) {
+      lab=labels[i];
+      if(lab==-1) {
+	D[i]=1000000;
+	S[i]=1;
+	continue;
+      }
+      D[i]=0;
+      S[i]=0;
+      tas.Push(i,0);
+
+      float *mc=&meanColor[lab*C];
+      xs[lab]=x;
+      ys[lab]=y;
+      for(c=0;c<C;c++)
+	mc[c]=im[i*C+c];
+      count[lab]++;
+      for(k=0;k<4;k++) { // initialization with neighbors too
+	xx=x+v4x[k];
+	yy=y+v4y[k];
+	if((xx<W) && (xx>=0) && (yy>=0) && (yy<H) && labels[yy*W+xx]==-1) {
+	  for(c=0;c<C;c++)
+	    mc[c]+=im[(yy*W+xx)*C+c];
+	  count[lab]++;
+	}
+      }
+      for(c=0;c<C;c++)
+	mc[c]/=count[lab];
+    }
+
+  float Sz=(float)W*H/(float)nseeds;
+
+  ////////////////////////////////
+  // let's go
+  while(!tas.Empty()) {
+    i=tas.Pop();
+    if(S[i]==-1) // consider only non fixed points
+      continue;
+    S[i]=-1; // fix it !
+    x=i%W;
+    y=i/W;
+
+    // update the mean color of the SP
+    lab=labels[i];
+    float *mc=&meanColor[lab*C];
+    for(c=0;c<C;c++)
+      mc[c]=mc[c]*count[lab] + im[i*C+c];
+    count[lab]++;
+    for(c=0;c<C;c++)
+      mc[c]/=count[lab];
+
+    // go for the neighborhood investigation
+    for(k=0;k<4;k++) {
+      xx=x+v4x[k];
+      yy=y+v4y[k];
+      if((xx>=W) || (xx<0) || (yy<0) || (yy>=H))
+	continue;
+      ii=yy*W+xx;
+      if(S[ii]==-1) // the update below would be discarded anyway
+	continue;
+
+      P=0;
+      for(c=0;c<C;c++)
+	P += distance_float(mc[c], im[ii*C+c]);
+
+      if(m>0) {
+	float dxy=distance_xy(xs[lab], ys[lab], xx, yy);
+	P=sqrt(P*P + dxy*dxy*m*m/(Sz*Sz));
+      }
+      // compute its neighboring values
+      a1=INF;
+      if(xx<W-1)
+	a1=D[ii+1];
+      if(xx>0)
+	a1=(a1<D[ii-1])?a1:D[ii-1];
+
+      a2=INF;
+      if(yy<H-1)
+	a2=D[ii+W];
+      if(yy>0)
+	a2=(a2<D[ii-W])?a2:D[ii-W];
+
+      // the missing z neighbors count as INF, as in fmm3d on a single slice
+      a3=INF;
+      SWAPIF(a2,a3);
+      SWAPIF(a1,a2);
+      SWAPIF(a2,a3);
+
+      // update its distance, see fmm3d
+      delta=(a2+a1+a3)*(a2+a1+a3) - 3*(a1*a1 + a2*a2 + a3*a3 - P*P);
+      A1 = 0;
+      if( delta>=0 )
+	A1 = ( a2+a1+a3 + sqrt(delta) )/3.0;
+      if( A1<=a3 ) {
+	delta = (a2+a1)*(a2+a1) - 2*(a1*a1 + a2*a2 - P*P);
+	A1 = 0;
+	if( delta>=0 )
+	  A1 = 0.5 * ( a2+a1 +sqrt(delta) );
+	if( A1<=a2 )
+	  A1 = a1 + P;
+      }
+      if(S[ii]==1 || A1<D[ii]) {
+	// add new point or update distance
+	S[ii]=0;
+	D[ii]=A1;
+	labels[ii]=lab;
+	tas.Push(ii,A1);
+      }
+    }
+  }
+}
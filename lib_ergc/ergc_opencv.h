@@ -42,6 +42,10 @@
 class ERGC_OpenCV {
 public:
     /** \brief Computer superpixels using ERGC. 
+     * 
+     * Runs directly on the interleaved image data and writes the labels in
+     * place.
+     * 
      * \param[in] image image to computer superpixels on
      * \param[in] region_height horizontal step between superpixel centers, implicitly defining the number of superpixels
      * \param[in] region_width vertical step between superpixel centers, implicitly defining the number of superpixels
@@ -53,62 +57,101 @@ public:
     static void computeSuperpixels(const cv::Mat &image, int region_height, int region_width, 
             bool lab, bool perturb_seeds, int m, cv::Mat &labels) {
         
-        int dx = region_width; // Seeds sampling wrt axis x (for custom grids)
-        int dy = region_height; // Seeds sampling wrt axis y (for custom grids)
-        // int m = 0; // Compacity value
-
-        /////////////////////////////////////////////////////////
-        /////////////////////////////////////////////////////////
-        CImg<> im(image.cols, image.rows, 1, 3);
-        for (int i = 0; i < image.rows; i++) {
-            for (int j = 0; j < image.cols; j++) {
-                im(j, i, 0, 0) = image.at<cv::Vec3b>(i, j)[0];
-                im(j, i, 0, 1) = image.at<cv::Vec3b>(i, j)[1];
-                im(j, i, 0, 2) = image.at<cv::Vec3b>(i, j)[2];
-            }
+        CV_Assert(image.type() == CV_8UC3);
+        
+        if (!labels.isContinuous()) {
+            labels.release();
         }
+        labels.create(image.rows, image.cols, CV_32SC1);
         
-        // useful variables
-        CImg<> distances;
-        CImg<int> states, seeds;
-        vector<SP*> SPs;
-
-        // convert to Lab if needed (better superpixels with color images)
         if (lab) {
-            im.RGBtoLab();
-        }
-
-        CImg<> gradient;
-        if (perturb_seeds) {
-            gradient = compute_gradient(im);
+            std::vector<float> image_lab(3*image.cols*image.rows);
+            convertToLab(image, &image_lab[0]);
+            
+            computeSuperpixels2d(&image_lab[0], image.cols, image.rows, 3,
+                    region_height, region_width, perturb_seeds, m, labels.ptr<int>(0));
         }
-
-        placeSeedsOnCustomGrid2d(im.width(), im.height(), dx, dy, seeds);
-
-        if (perturb_seeds) {
-            CImg<int> perturbedSeeds;
-            if (im.depth() == 1) {
-                perturbSeeds2d(seeds, gradient, perturbedSeeds);
-            }
-            else {
-                perturbSeeds3d(seeds, gradient, perturbedSeeds);
+        else {
+            cv::Mat image_continuous = image;
+            if (!image.isContinuous()) {
+                image_continuous = image.clone();
             }
             
-            seeds = perturbedSeeds;
+            computeSuperpixels2d(image_continuous.ptr<unsigned char>(0), image.cols, image.rows, 3,
+                    region_height, region_width, perturb_seeds, m, labels.ptr<int>(0));
         }
-
-        initialize_images(seeds, distances, states);
-        SPs = initialize_superpixels(im, seeds);
-
-        fmm3d(distances, seeds, states, im, SPs, m);
-
-        labels.create(image.rows, image.cols, CV_32SC1);
+    }
+    
+private:
+    /** \brief Lab conversion as done by CImg's RGBtoLab, i.e. RGBtoXYZ followed
+     * by XYZtoLab, applied to the channels in BGR order as the image was
+     * passed to CImg originally.
+     * \param[in] image image of type CV_8UC3
+     * \param[out] image_lab W x H x 3 interleaved Lab image
+     */
+    static void convertToLab(const cv::Mat &image, float* image_lab) {
+        
+        const float Xn = 0.412453f + 0.357580f + 0.180423f;
+        const float Yn = 0.212671f + 0.715160f + 0.072169f;
+        const float Zn = 0.019334f + 0.119193f + 0.950227f;
+        
         for (int i = 0; i < image.rows; i++) {
-            for (int j = 0; j < image.cols; j++) {
-                labels.at<int>(i, j) = seeds(j, i, 0, 0);
+            const unsigned char* image_row = image.ptr<unsigned char>(i);
+            float* lab_row = image_lab + 3*i*image.cols;
+            
+            for (int j = 0; j < 3*image.cols; j += 3) {
+                const float R = image_row[j]/255.f;
+                const float G = image_row[j + 1]/255.f;
+                const float B = image_row[j + 2]/255.f;
+                
+                const float X = 0.412453f*R + 0.357580f*G + 0.180423f*B;
+                const float Y = 0.212671f*R + 0.715160f*G + 0.072169f*B;
+                const float Z = 0.019334f*R + 0.119193f*G + 0.950227f*B;
+                
+                const float fX = labf(X/Xn);
+                const float fY = labf(Y/Yn);
+                const float fZ = labf(Z/Zn);
+                
+                lab_row[j] = std::max(0.f, 116*fY - 16);
+                lab_row[j + 1] = 500*(fX - fY);
+                lab_row[j + 2] = 200*(fY - fZ);
             }
         }
     }
+    
+    /** \brief The function f of the XYZ to Lab conversion as in CImg.
+     * \param[in] t normalized X, Y or Z
+     * \return f(t)
+     */
+    static float labf(float t) {
+        return t >= 0.008856f ? std::pow(t, 1.f/3) : 7.787f*t + 16.f/116;
+    }
+    
+    /** \brief ERGC on an interleaved, continuous image.
+     * \param[in] im image data, W x H x C interleaved
+     * \param[in] W image width
+     * \param[in] H image height
+     * \param[in] C number of channels
+     * \param[in] region_height vertical step between superpixel centers
+     * \param[in] region_width horizontal step between superpixel centers
+     * \param[in] perturb_seeds whether to perturb seeds
+     * \param[in] m m parameter, see paper
+     * \param[out] labels W x H superpixel labels
+     */
+    template<typename T>
+    static void computeSuperpixels2d(const T* im, int W, int H, int C, int region_height,
+            int region_width, bool perturb_seeds, int m, int* labels) {
+        
+        std::vector<float> gradient;
+        if (perturb_seeds) {
+            gradient.resize(W*H);
+            compute_gradient2d(im, W, H, C, &gradient[0]);
+        }
+        
+        placeSeedsOnCustomGrid2d(W, H, region_width, region_height, 
+                perturb_seeds ? &gradient[0] : 0, labels);
+        ergc2d(im, W, H, C, labels, m);
+    }
 };
 
 #endif	/* ERGC_OPENCV_H */
@@ -21,6 +21,9 @@
 #include <algorithm>
 #include <nmmintrin.h>
 #include <stdexcept>
+#include <vector>
+#include <thread>
+#include <chrono>
 
 // Default parameters
 const int SGMSTEREO_DEFAULT_DISPARITY_TOTAL = 256;
@@ -33,6 +36,12 @@ const int SGMSTEREO_DEFAULT_SMOOTHNESS_PENALTY_SMALL = 100;
 const int SGMSTEREO_DEFAULT_SMOOTHNESS_PENALTY_LARGE = 1600;
 const int SGMSTEREO_DEFAULT_CONSISTENCY_THRESHOLD = 1;
 
+typedef std::chrono::steady_clock SGMStereoClock;
+
+static double elapsedSeconds(const SGMStereoClock::time_point& startTime) {
+	return std::chrono::duration<double>(SGMStereoClock::now() - startTime).count();
+}
+
 
 SGMStereo::SGMStereo() : disparityTotal_(SGMSTEREO_DEFAULT_DISPARITY_TOTAL),
 						 disparityFactor_(SGMSTEREO_DEFAULT_DISPARITY_FACTOR),
@@ -42,7 +51,10 @@ SGMStereo::SGMStereo() : disparityTotal_(SGMSTEREO_DEFAULT_DISPARITY_TOTAL),
 						 aggregationWindowRadius_(SGMSTEREO_DEFAULT_AGGREGATION_WINDOW_RADIUS),
 						 smoothnessPenaltySmall_(SGMSTEREO_DEFAULT_SMOOTHNESS_PENALTY_SMALL),
 						 smoothnessPenaltyLarge_(SGMSTEREO_DEFAULT_SMOOTHNESS_PENALTY_LARGE),
-						 consistencyThreshold_(SGMSTEREO_DEFAULT_CONSISTENCY_THRESHOLD) {}
+						 consistencyThreshold_(SGMSTEREO_DEFAULT_CONSISTENCY_THRESHOLD)
+{
+	setThreadTotal(0);
+}
 
 void SGMStereo::setDisparityTotal(const int disparityTotal) {
 	if (disparityTotal <= 0 || disparityTotal%16 != 0) {
@@ -100,41 +112,111 @@ void SGMStereo::setConsistencyThreshold(const int consistencyThreshold) {
 	consistencyThreshold_ = consistencyThreshold;
 }
 
+
+void SGMStereo::setThreadTotal(const int threadTotal) {
+	if (threadTotal < 0) {
+		throw std::invalid_argument("[SGMStereo::setThreadTotal] the number of threads is less than zero");
+	}
+	threadTotal_ = threadTotal > 0 ? threadTotal : std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+}
+
 void SGMStereo::compute(const png::image<png::rgb_pixel>& leftImage,
 						const png::image<png::rgb_pixel>& rightImage,
 						float* disparityImage)
 {
-	initialize(leftImage, rightImage);
+	SGMStereoClock::time_point startTime = SGMStereoClock::now();
+
+	setImageSize(static_cast<int>(leftImage.get_width()), static_cast<int>(leftImage.get_height()),
+				 static_cast<int>(rightImage.get_width()), static_cast<int>(rightImage.get_height()));
+
+	unsigned char* leftGrayscaleImage = reinterpret_cast<unsigned char*>(malloc(width_*height_*sizeof(unsigned char)));
+	unsigned char* rightGrayscaleImage = reinterpret_cast<unsigned char*>(malloc(width_*height_*sizeof(unsigned char)));
+	convertToGrayscale(leftImage, rightImage, leftGrayscaleImage, rightGrayscaleImage);
+	timing_.cost = elapsedSeconds(startTime);
+
+	computeDisparityImage(leftGrayscaleImage, rightGrayscaleImage, disparityImage);
+	timing_.total = elapsedSeconds(startTime);
+
+	free(leftGrayscaleImage);
+	free(rightGrayscaleImage);
+}
+
+void SGMStereo::compute(const cv::Mat& leftImage,
+						const cv::Mat& rightImage,
+						float* disparityImage)
+{
+	SGMStereoClock::time_point startTime = SGMStereoClock::now();
+
+	if (leftImage.depth() != CV_8U || rightImage.depth() != CV_8U
+		|| (leftImage.channels() != 3 && leftImage.channels() != 1)
+		|| (rightImage.channels() != 3 && rightImage.channels() != 1))
+	{
+		throw std::invalid_argument("[SGMStereo::compute] images must be 8-bit BGR or grayscale images");
+	}
+	setImageSize(leftImage.cols, leftImage.rows, rightImage.cols, rightImage.rows);
+
+	unsigned char* leftGrayscaleImage = reinterpret_cast<unsigned char*>(malloc(width_*height_*sizeof(unsigned char)));
+	unsigned char* rightGrayscaleImage = reinterpret_cast<unsigned char*>(malloc(width_*height_*sizeof(unsigned char)));
+	convertToGrayscale(leftImage, leftGrayscaleImage);
+	convertToGrayscale(rightImage, rightGrayscaleImage);
+	timing_.cost = elapsedSeconds(startTime);
+
+	computeDisparityImage(leftGrayscaleImage, rightGrayscaleImage, disparityImage);
+	timing_.total = elapsedSeconds(startTime);
+
+	free(leftGrayscaleImage);
+	free(rightGrayscaleImage);
+}
+
+
+void SGMStereo::computeDisparityImage(const unsigned char* leftGrayscaleImage,
+									  const unsigned char* rightGrayscaleImage,
+									  float* disparityImage)
+{
+	SGMStereoClock::time_point stageTime = SGMStereoClock::now();
 
-	computeCostImage(leftImage, rightImage);
+	allocateDataBuffer();
+	computeCostImage(leftGrayscaleImage, rightGrayscaleImage);
+	timing_.cost += elapsedSeconds(stageTime);
 
+	stageTime = SGMStereoClock::now();
 	unsigned short* leftDisparityImage = reinterpret_cast<unsigned short*>(malloc(width_*height_*sizeof(unsigned short)));
 	performSGM(leftCostImage_, leftDisparityImage);
 	unsigned short* rightDisparityImage = reinterpret_cast<unsigned short*>(malloc(width_*height_*sizeof(unsigned short)));
 	performSGM(rightCostImage_, rightDisparityImage);
+	timing_.aggregation = elapsedSeconds(stageTime);
+
+	stageTime = SGMStereoClock::now();
+	const int maxSpeckleSize = 100;
+	const int maxSpeckleDifference = static_cast<int>(2*disparityFactor_);
+	if (threadTotal_ > 1) {
+		std::thread rightSpeckleThread(&SGMStereo::speckleFilter, this, maxSpeckleSize, maxSpeckleDifference, rightDisparityImage);
+		speckleFilter(maxSpeckleSize, maxSpeckleDifference, leftDisparityImage);
+		rightSpeckleThread.join();
+	} else {
+		speckleFilter(maxSpeckleSize, maxSpeckleDifference, leftDisparityImage);
+		speckleFilter(maxSpeckleSize, maxSpeckleDifference, rightDisparityImage);
+	}
 	enforceLeftRightConsistency(leftDisparityImage, rightDisparityImage);
 
-	for (int y = 0; y < height_; ++y) {
-		for (int x = 0; x < width_; ++x) {
-			disparityImage[width_*y + x] = static_cast<float>(leftDisparityImage[width_*y + x]/disparityFactor_);
+	parallelFor(height_, 1, [&](int startY, int endY) {
+		for (int y = startY; y < endY; ++y) {
+			for (int x = 0; x < width_; ++x) {
+				disparityImage[width_*y + x] = static_cast<float>(leftDisparityImage[width_*y + x]/disparityFactor_);
+			}
 		}
-	}
+	});
+	timing_.postprocessing = elapsedSeconds(stageTime);
 
 	freeDataBuffer();
 	free(leftDisparityImage);
 	free(rightDisparityImage);
 }
 
-
-void SGMStereo::initialize(const png::image<png::rgb_pixel>& leftImage, const png::image<png::rgb_pixel>& rightImage) {
-	setImageSize(leftImage, rightImage);
-	allocateDataBuffer();
-}
-
-void SGMStereo::setImageSize(const png::image<png::rgb_pixel>& leftImage, const png::image<png::rgb_pixel>& rightImage) {
-	width_ = static_cast<int>(leftImage.get_width());
-	height_ = static_cast<int>(leftImage.get_height());
-	if (rightImage.get_width() != width_ || rightImage.get_height() != height_) {
+void SGMStereo::setImageSize(const int leftWidth, const int leftHeight, const int rightWidth, const int rightHeight) {
+	width_ = leftWidth;
+	height_ = leftHeight;
+	if (rightWidth != width_ || rightHeight != height_) {
 		throw std::invalid_argument("[SGMStereo::setImageSize] sizes of left and right images are different");
 	}
 	widthStep_ = width_ + 15 - (width_ - 1)%16;
@@ -144,51 +226,43 @@ void SGMStereo::allocateDataBuffer() {
 	leftCostImage_ = reinterpret_cast<unsigned short*>(_mm_malloc(width_*height_*disparityTotal_*sizeof(unsigned short), 16));
 	rightCostImage_ = reinterpret_cast<unsigned short*>(_mm_malloc(width_*height_*disparityTotal_*sizeof(unsigned short), 16));
 
-	int pixelwiseCostRowBufferSize = width_*disparityTotal_;
-	int rowAggregatedCostBufferSize = width_*disparityTotal_*(aggregationWindowRadius_*2 + 2);
-	int halfPixelRightBufferSize = widthStep_;
-
-	pixelwiseCostRow_ = reinterpret_cast<unsigned char*>(_mm_malloc(pixelwiseCostRowBufferSize*sizeof(unsigned char), 16));
-	rowAggregatedCost_ = reinterpret_cast<unsigned short*>(_mm_malloc(rowAggregatedCostBufferSize*sizeof(unsigned short), 16));
-	halfPixelRightMin_ = reinterpret_cast<unsigned char*>(_mm_malloc(halfPixelRightBufferSize*sizeof(unsigned char), 16));
-	halfPixelRightMax_ = reinterpret_cast<unsigned char*>(_mm_malloc(halfPixelRightBufferSize*sizeof(unsigned char), 16));
-
-	pathRowBufferTotal_ = 2;
 	disparitySize_ = disparityTotal_ + 16;
-	pathTotal_ = 8;
-	pathDisparitySize_ = pathTotal_*disparitySize_;
-
 	costSumBufferRowSize_ = width_*disparityTotal_;
 	costSumBufferSize_ = costSumBufferRowSize_*height_;
-	pathMinCostBufferSize_ = (width_ + 2)*pathTotal_;
-	pathCostBufferSize_ = pathMinCostBufferSize_*disparitySize_;
-	totalBufferSize_ = (pathMinCostBufferSize_ + pathCostBufferSize_)*pathRowBufferTotal_ + costSumBufferSize_ + 16;
 
-	sgmBuffer_ = reinterpret_cast<short*>(_mm_malloc(totalBufferSize_*sizeof(short), 16));
+	costSums_ = reinterpret_cast<short*>(_mm_malloc(costSumBufferSize_*sizeof(short), 16));
 }
 
 void SGMStereo::freeDataBuffer() {
 	_mm_free(leftCostImage_);
 	_mm_free(rightCostImage_);
-	_mm_free(pixelwiseCostRow_);
-	_mm_free(rowAggregatedCost_);
-	_mm_free(halfPixelRightMin_);
-	_mm_free(halfPixelRightMax_);
-	_mm_free(sgmBuffer_);
+	_mm_free(costSums_);
 }
 
-void SGMStereo::computeCostImage(const png::image<png::rgb_pixel>& leftImage, const png::image<png::rgb_pixel>& rightImage) {
-	unsigned char* leftGrayscaleImage = reinterpret_cast<unsigned char*>(malloc(width_*height_*sizeof(unsigned char)));
-	unsigned char* rightGrayscaleImage = reinterpret_cast<unsigned char*>(malloc(width_*height_*sizeof(unsigned char)));
-	convertToGrayscale(leftImage, rightImage, leftGrayscaleImage, rightGrayscaleImage);
+void SGMStereo::allocateCostWorkspace(CostWorkspace& workspace) const {
+	int pixelwiseCostRowBufferSize = width_*disparityTotal_;
+	int rowAggregatedCostBufferSize = width_*disparityTotal_*(aggregationWindowRadius_*2 + 2);
+	int halfPixelRightBufferSize = widthStep_;
 
-	memset(leftCostImage_, 0, width_*height_*disparityTotal_*sizeof(unsigned short));
-	computeLeftCostImage(leftGrayscaleImage, rightGrayscaleImage);
+	workspace.pixelwiseCostRow = reinterpret_cast<unsigned char*>(_mm_malloc(pixelwiseCostRowBufferSize*sizeof(unsigned char), 16));
+	workspace.rowAggregatedCost = reinterpret_cast<unsigned short*>(_mm_malloc(rowAggregatedCostBufferSize*sizeof(unsigned short), 16));
+	workspace.halfPixelRightMin = reinterpret_cast<unsigned char*>(_mm_malloc(halfPixelRightBufferSize*sizeof(unsigned char), 16));
+	workspace.halfPixelRightMax = reinterpret_cast<unsigned char*>(_mm_malloc(halfPixelRightBufferSize*sizeof(unsigned char), 16));
+}
 
-	computeRightCostImage();
+void SGMStereo::freeCostWorkspace(CostWorkspace& workspace) const {
+	_mm_free(workspace.pixelwiseCostRow);
+	_mm_free(workspace.rowAggregatedCost);
+	_mm_free(workspace.halfPixelRightMin);
+	_mm_free(workspace.halfPixelRightMax);
+}
 
-	free(leftGrayscaleImage);
-	free(rightGrayscaleImage);
+void SGMStereo::computeCostImage(const unsigned char* leftGrayscaleImage, const unsigned char* rightGrayscaleImage) {
+	computeLeftCostImage(leftGrayscaleImage, rightGrayscaleImage);
+
+	parallelFor(height_, 1, [this](int startY, int endY) {
+		computeRightCostImage(startY, endY);
+	});
 }
 
 
@@ -207,41 +281,59 @@ void SGMStereo::convertToGrayscale(const png::image<png::rgb_pixel>& leftImage,
 	}
 }
 
+void SGMStereo::convertToGrayscale(const cv::Mat& image, unsigned char* grayscaleImage) const {
+	parallelFor(height_, 1, [&](int startY, int endY) {
+		for (int y = startY; y < endY; ++y) {
+			const unsigned char* imageRow = image.ptr<unsigned char>(y);
+			unsigned char* grayscaleRow = grayscaleImage + width_*y;
+			if (image.channels() == 1) {
+				memcpy(grayscaleRow, imageRow, width_*sizeof(unsigned char));
+				continue;
+			}
+			for (int x = 0; x < width_; ++x) {
+				// BGR order, same weights as for png::rgb_pixel
+				const unsigned char* pix = imageRow + 3*x;
+				grayscaleRow[x] = static_cast<unsigned char>(0.299*pix[2] + 0.587*pix[1] + 0.114*pix[0] + 0.5);
+			}
+		}
+	});
+}
+
 void SGMStereo::computeLeftCostImage(const unsigned char* leftGrayscaleImage, const unsigned char* rightGrayscaleImage) {
-	unsigned char* leftSobelImage = reinterpret_cast<unsigned char*>(_mm_malloc(widthStep_*height_*sizeof(unsigned char), 16));
-	unsigned char* rightSobelImage = reinterpret_cast<unsigned char*>(_mm_malloc(widthStep_*height_*sizeof(unsigned char), 16));
-	computeCappedSobelImage(leftGrayscaleImage, false, leftSobelImage);
-	computeCappedSobelImage(rightGrayscaleImage, true, rightSobelImage);
-
-	int* leftCensusImage = reinterpret_cast<int*>(malloc(width_*height_*sizeof(int)));
-	int* rightCensusImage = reinterpret_cast<int*>(malloc(width_*height_*sizeof(int)));
-	computeCensusImage(leftGrayscaleImage, leftCensusImage);
-	computeCensusImage(rightGrayscaleImage, rightCensusImage);
-
-	unsigned char* leftSobelRow = leftSobelImage;
-	unsigned char* rightSobelRow = rightSobelImage;
-	int* leftCensusRow = leftCensusImage;
-	int* rightCensusRow = rightCensusImage;
-	unsigned short* costImageRow = leftCostImage_;
-	calcTopRowCost(leftSobelRow, leftCensusRow,
-				   rightSobelRow, rightCensusRow,
-				   costImageRow);
-	costImageRow += width_*disparityTotal_;
-	calcRowCosts(leftSobelRow, leftCensusRow,
-				 rightSobelRow, rightCensusRow,
-				 costImageRow);
-
-	_mm_free(leftSobelImage);
-	_mm_free(rightSobelImage);
-	free(leftCensusImage);
-	free(rightCensusImage);
-}
-
-void SGMStereo::computeCappedSobelImage(const unsigned char* image, const bool horizontalFlip, unsigned char* sobelImage) const {
-	memset(sobelImage, sobelCapValue_, widthStep_*height_);
+	leftSobelImage_ = reinterpret_cast<unsigned char*>(_mm_malloc(widthStep_*height_*sizeof(unsigned char), 16));
+	rightSobelImage_ = reinterpret_cast<unsigned char*>(_mm_malloc(widthStep_*height_*sizeof(unsigned char), 16));
+	leftCensusImage_ = reinterpret_cast<int*>(malloc(width_*height_*sizeof(int)));
+	rightCensusImage_ = reinterpret_cast<int*>(malloc(width_*height_*sizeof(int)));
+
+	parallelFor(height_, 1, [&](int startY, int endY) {
+		computeCappedSobelImage(leftGrayscaleImage, false, leftSobelImage_, startY, endY);
+		computeCappedSobelImage(rightGrayscaleImage, true, rightSobelImage_, startY, endY);
+		computeCensusImage(leftGrayscaleImage, leftCensusImage_, startY, endY);
+		computeCensusImage(rightGrayscaleImage, rightCensusImage_, startY, endY);
+	});
+
+	// Rows of the cost image are computed in strips, each strip first recomputes the aggregated
+	// rows and the cost row above it. This reproduces the sequential running sums only if they
+	// cannot saturate, otherwise the whole image is a single strip.
+	const int aggregationWindowSize = aggregationWindowRadius_*2 + 1;
+	const bool independentStrips = aggregationWindowSize*aggregationWindowSize*UCHAR_MAX <= SHRT_MAX;
+	parallelFor(height_, independentStrips ? 4*(aggregationWindowRadius_*2 + 2) : height_, [this](int startY, int endY) {
+		computeLeftCostStrip(startY, endY);
+	});
+
+	_mm_free(leftSobelImage_);
+	_mm_free(rightSobelImage_);
+	free(leftCensusImage_);
+	free(rightCensusImage_);
+}
+
+void SGMStereo::computeCappedSobelImage(const unsigned char* image, const bool horizontalFlip, unsigned char* sobelImage,
+										const int startY, const int endY) const
+{
+	memset(sobelImage + widthStep_*startY, sobelCapValue_, widthStep_*(endY - startY));
 
 	if (horizontalFlip) {
-		for (int y = 1; y < height_ - 1; ++y) {
+		for (int y = std::max(startY, 1); y < std::min(endY, height_ - 1); ++y) {
 			for (int x = 1; x < width_ - 1; ++x) {
 				int sobelValue = (image[width_*(y - 1) + x + 1] + 2*image[width_*y + x + 1] + image[width_*(y + 1) + x + 1])
 					- (image[width_*(y - 1) + x - 1] + 2*image[width_*y + x - 1] + image[width_*(y + 1) + x - 1]);
@@ -252,7 +344,7 @@ void SGMStereo::computeCappedSobelImage(const unsigned char* image, const bool h
 			}
 		}
 	} else {
-		for (int y = 1; y < height_ - 1; ++y) {
+		for (int y = std::max(startY, 1); y < std::min(endY, height_ - 1); ++y) {
 			for (int x = 1; x < width_ - 1; ++x) {
 				int sobelValue = (image[width_*(y - 1) + x + 1] + 2*image[width_*y + x + 1] + image[width_*(y + 1) + x + 1])
 					- (image[width_*(y - 1) + x - 1] + 2*image[width_*y + x - 1] + image[width_*(y + 1) + x - 1]);
@@ -265,8 +357,8 @@ void SGMStereo::computeCappedSobelImage(const unsigned char* image, const bool h
 	}
 }
 
-void SGMStereo::computeCensusImage(const unsigned char* image, int* censusImage) const {
-	for (int y = 0; y < height_; ++y) {
+void SGMStereo::computeCensusImage(const unsigned char* image, int* censusImage, const int startY, const int endY) const {
+	for (int y = startY; y < endY; ++y) {
 		for (int x = 0; x < width_; ++x) {
 			unsigned char centerValue = image[width_*y + x];
 
@@ -284,84 +376,93 @@ void SGMStereo::computeCensusImage(const unsigned char* image, int* censusImage)
 	}
 }
 
-void SGMStereo::calcTopRowCost(unsigned char*& leftSobelRow, int*& leftCensusRow,
-							   unsigned char*& rightSobelRow, int*& rightCensusRow,
-							   unsigned short* costImageRow)
-{
-	for (int rowIndex = 0; rowIndex <= aggregationWindowRadius_; ++rowIndex) {
-		int rowAggregatedCostIndex = std::min(rowIndex, height_ - 1)%(aggregationWindowRadius_*2 + 2);
-		unsigned short* rowAggregatedCostCurrent = rowAggregatedCost_ + rowAggregatedCostIndex*width_*disparityTotal_;
+void SGMStereo::computeLeftCostStrip(const int startY, const int endY) {
+	const int widthStepCost = width_*disparityTotal_;
+	memset(leftCostImage_ + widthStepCost*startY, 0, widthStepCost*(endY - startY)*sizeof(unsigned short));
+
+	CostWorkspace workspace;
+	allocateCostWorkspace(workspace);
+
+	if (startY == 0) {
+		calcTopRowCost(workspace);
+		calcRowCosts(1, endY, leftCostImage_, workspace);
+	} else if (startY + aggregationWindowRadius_ < height_) {
+		unsigned short* previousCostRow = reinterpret_cast<unsigned short*>(_mm_malloc(widthStepCost*sizeof(unsigned short), 16));
+		calcStripPreviousRowCost(startY, workspace, previousCostRow);
+		calcRowCosts(startY, endY, previousCostRow, workspace);
+		_mm_free(previousCostRow);
+	}
 
-		calcPixelwiseSAD(leftSobelRow, rightSobelRow);
-		addPixelwiseHamming(leftCensusRow, rightCensusRow);
+	freeCostWorkspace(workspace);
+}
 
-		memset(rowAggregatedCostCurrent, 0, disparityTotal_*sizeof(unsigned short));
-		// x = 0
-		for (int x = 0; x <= aggregationWindowRadius_; ++x) {
-			int scale = x == 0 ? aggregationWindowRadius_ + 1 : 1;
-			for (int d = 0; d < disparityTotal_; ++d) {
-				rowAggregatedCostCurrent[d] += static_cast<unsigned short>(pixelwiseCostRow_[disparityTotal_*x + d]*scale);
-			}
-		}
-		// x = 1...width-1
-		for (int x = 1; x < width_; ++x) {
-			const unsigned char* addPixelwiseCost = pixelwiseCostRow_
-				+ std::min((x + aggregationWindowRadius_)*disparityTotal_, (width_ - 1)*disparityTotal_);
-			const unsigned char* subPixelwiseCost = pixelwiseCostRow_
-				+ std::max((x - aggregationWindowRadius_ - 1)*disparityTotal_, 0);
+void SGMStereo::calcTopRowCost(CostWorkspace& workspace) {
+	for (int rowIndex = 0; rowIndex <= aggregationWindowRadius_; ++rowIndex) {
+		int rowAggregatedCostIndex = std::min(rowIndex, height_ - 1)%(aggregationWindowRadius_*2 + 2);
+		unsigned short* rowAggregatedCostCurrent = workspace.rowAggregatedCost + rowAggregatedCostIndex*width_*disparityTotal_;
 
-			for (int d = 0; d < disparityTotal_; ++d) {
-				rowAggregatedCostCurrent[disparityTotal_*x + d]
-					= static_cast<unsigned short>(rowAggregatedCostCurrent[disparityTotal_*(x - 1) + d]
-					+ addPixelwiseCost[d] - subPixelwiseCost[d]);
-			}
-		}
+		calcPixelwiseCost(rowIndex, workspace);
+		calcRowAggregatedCost(workspace, rowAggregatedCostCurrent);
 
 		// Add to cost
 		int scale = rowIndex == 0 ? aggregationWindowRadius_ + 1 : 1;
 		for (int i = 0; i < width_*disparityTotal_; ++i) {
-			costImageRow[i] += rowAggregatedCostCurrent[i]*scale;
+			leftCostImage_[i] += rowAggregatedCostCurrent[i]*scale;
 		}
+	}
+}
+
+void SGMStereo::calcStripPreviousRowCost(const int startY, CostWorkspace& workspace, unsigned short* previousCostRow) {
+	const int widthStepCost = width_*disparityTotal_;
+	const int rowAggregatedCostTotal = aggregationWindowRadius_*2 + 2;
+	const int previousY = startY - 1;
+
+	// Aggregated rows the sequential pass holds when it reaches startY
+	for (int rowIndex = std::max(previousY - aggregationWindowRadius_, 0); rowIndex <= previousY + aggregationWindowRadius_; ++rowIndex) {
+		calcPixelwiseCost(rowIndex, workspace);
+		calcRowAggregatedCost(workspace, workspace.rowAggregatedCost + widthStepCost*(rowIndex%rowAggregatedCostTotal));
+	}
 
-		leftSobelRow += widthStep_;
-		rightSobelRow += widthStep_;
-		leftCensusRow += width_;
-		rightCensusRow += width_;
+	// Cost row startY - 1, rows above the image are replaced by the top row
+	for (int i = 0; i < widthStepCost; ++i) {
+		int costValue = 0;
+		for (int rowIndex = previousY - aggregationWindowRadius_; rowIndex <= previousY + aggregationWindowRadius_; ++rowIndex) {
+			costValue += workspace.rowAggregatedCost[widthStepCost*(std::max(rowIndex, 0)%rowAggregatedCostTotal) + i];
+		}
+		previousCostRow[i] = static_cast<unsigned short>(costValue);
 	}
 }
 
-void SGMStereo::calcRowCosts(unsigned char*& leftSobelRow, int*& leftCensusRow,
-							 unsigned char*& rightSobelRow, int*& rightCensusRow,
-							 unsigned short* costImageRow)
+void SGMStereo::calcRowCosts(const int startY, const int endY, const unsigned short* startPreviousCostRow, CostWorkspace& workspace)
 {
 	const int widthStepCost = width_*disparityTotal_;
 	const __m128i registerZero = _mm_setzero_si128();
 
-	for (int y = 1; y < height_; ++y) {
+	for (int y = startY; y < endY; ++y) {
 		int addRowIndex = y + aggregationWindowRadius_;
 		int addRowAggregatedCostIndex = std::min(addRowIndex, height_ - 1)%(aggregationWindowRadius_*2 + 2);
-		unsigned short* addRowAggregatedCost = rowAggregatedCost_ + width_*disparityTotal_*addRowAggregatedCostIndex;
+		unsigned short* addRowAggregatedCost = workspace.rowAggregatedCost + width_*disparityTotal_*addRowAggregatedCostIndex;
+		unsigned short* costImageRow = leftCostImage_ + widthStepCost*y;
 
 		if (addRowIndex < height_) {
-			calcPixelwiseSAD(leftSobelRow, rightSobelRow);
-			addPixelwiseHamming(leftCensusRow, rightCensusRow);
+			calcPixelwiseCost(addRowIndex, workspace);
 
 			memset(addRowAggregatedCost, 0, disparityTotal_*sizeof(unsigned short));
 			// x = 0
 			for (int x = 0; x <= aggregationWindowRadius_; ++x) {
 				int scale = x == 0 ? aggregationWindowRadius_ + 1 : 1;
 				for (int d = 0; d < disparityTotal_; ++d) {
-					addRowAggregatedCost[d] += static_cast<unsigned short>(pixelwiseCostRow_[disparityTotal_*x + d]*scale);
+					addRowAggregatedCost[d] += static_cast<unsigned short>(workspace.pixelwiseCostRow[disparityTotal_*x + d]*scale);
 				}
 			}
 			// x = 1...width-1
 			int subRowAggregatedCostIndex = std::max(y - aggregationWindowRadius_ - 1, 0)%(aggregationWindowRadius_*2 + 2);
-			const unsigned short* subRowAggregatedCost = rowAggregatedCost_ + width_*disparityTotal_*subRowAggregatedCostIndex;
-			const unsigned short* previousCostRow = costImageRow - widthStepCost;
+			const unsigned short* subRowAggregatedCost = workspace.rowAggregatedCost + width_*disparityTotal_*subRowAggregatedCostIndex;
+			const unsigned short* previousCostRow = y == startY ? startPreviousCostRow : costImageRow - widthStepCost;
 			for (int x = 1; x < width_; ++x) {
-				const unsigned char* addPixelwiseCost = pixelwiseCostRow_
+				const unsigned char* addPixelwiseCost = workspace.pixelwiseCostRow
 					+ std::min((x + aggregationWindowRadius_)*disparityTotal_, (width_ - 1)*disparityTotal_);
-				const unsigned char* subPixelwiseCost = pixelwiseCostRow_
+				const unsigned char* subPixelwiseCost = workspace.pixelwiseCostRow
 					+ std::max((x - aggregationWindowRadius_ - 1)*disparityTotal_, 0);
 
 				for (int d = 0; d < disparityTotal_; d += 16) {
@@ -397,17 +498,40 @@ void SGMStereo::calcRowCosts(unsigned char*& leftSobelRow, int*& leftCensusRow,
 				}
 			}
 		}
+	}
+}
 
-		leftSobelRow += widthStep_;
-		rightSobelRow += widthStep_;
-		leftCensusRow += width_;
-		rightCensusRow += width_;
-		costImageRow += widthStepCost;
+void SGMStereo::calcRowAggregatedCost(const CostWorkspace& workspace, unsigned short* rowAggregatedCostCurrent) const {
+	memset(rowAggregatedCostCurrent, 0, disparityTotal_*sizeof(unsigned short));
+	// x = 0
+	for (int x = 0; x <= aggregationWindowRadius_; ++x) {
+		int scale = x == 0 ? aggregationWindowRadius_ + 1 : 1;
+		for (int d = 0; d < disparityTotal_; ++d) {
+			rowAggregatedCostCurrent[d] += static_cast<unsigned short>(workspace.pixelwiseCostRow[disparityTotal_*x + d]*scale);
+		}
+	}
+	// x = 1...width-1
+	for (int x = 1; x < width_; ++x) {
+		const unsigned char* addPixelwiseCost = workspace.pixelwiseCostRow
+			+ std::min((x + aggregationWindowRadius_)*disparityTotal_, (width_ - 1)*disparityTotal_);
+		const unsigned char* subPixelwiseCost = workspace.pixelwiseCostRow
+			+ std::max((x - aggregationWindowRadius_ - 1)*disparityTotal_, 0);
+
+		for (int d = 0; d < disparityTotal_; ++d) {
+			rowAggregatedCostCurrent[disparityTotal_*x + d]
+				= static_cast<unsigned short>(rowAggregatedCostCurrent[disparityTotal_*(x - 1) + d]
+				+ addPixelwiseCost[d] - subPixelwiseCost[d]);
+		}
 	}
 }
 
-void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsigned char* rightSobelRow) {
-	calcHalfPixelRight(rightSobelRow);
+void SGMStereo::calcPixelwiseCost(const int rowIndex, CostWorkspace& workspace) const {
+	calcPixelwiseSAD(leftSobelImage_ + widthStep_*rowIndex, rightSobelImage_ + widthStep_*rowIndex, workspace);
+	addPixelwiseHamming(leftCensusImage_ + width_*rowIndex, rightCensusImage_ + width_*rowIndex, workspace);
+}
+
+void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsigned char* rightSobelRow, CostWorkspace& workspace) const {
+	calcHalfPixelRight(rightSobelRow, workspace);
 
 	for (int x = 0; x < 16; ++x) {
 		int leftCenterValue = leftSobelRow[x];
@@ -420,8 +544,8 @@ void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsign
 
 		for (int d = 0; d <= x; ++d) {
 			int rightCenterValue = rightSobelRow[width_ - 1 - x + d];
-			int rightMinValue = halfPixelRightMin_[width_ - 1 - x + d];
-			int rightMaxValue = halfPixelRightMax_[width_ - 1 - x + d];
+			int rightMinValue = workspace.halfPixelRightMin[width_ - 1 - x + d];
+			int rightMaxValue = workspace.halfPixelRightMax[width_ - 1 - x + d];
 
 			int costLtoR = std::max(0, leftCenterValue - rightMaxValue);
 			costLtoR = std::max(costLtoR, rightMinValue - leftCenterValue);
@@ -429,10 +553,10 @@ void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsign
 			costRtoL = std::max(costRtoL, leftMinValue - rightCenterValue);
 			int costValue = std::min(costLtoR, costRtoL);
 
-			pixelwiseCostRow_[disparityTotal_*x + d] = costValue;
+			workspace.pixelwiseCostRow[disparityTotal_*x + d] = costValue;
 		}
 		for (int d = x + 1; d < disparityTotal_; ++d) {
-			pixelwiseCostRow_[disparityTotal_*x + d] = pixelwiseCostRow_[disparityTotal_*x + d - 1];
+			workspace.pixelwiseCostRow[disparityTotal_*x + d] = workspace.pixelwiseCostRow[disparityTotal_*x + d - 1];
 		}
 	}
 	for (int x = 16; x < disparityTotal_; ++x) {
@@ -450,8 +574,8 @@ void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsign
 
 		for (int d = 0; d < x/16; d += 16) {
 			__m128i registerRightCenterValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rightSobelRow + width_ - 1 - x + d));
-			__m128i registerRightMinValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(halfPixelRightMin_ + width_ - 1 - x + d));
-			__m128i registerRightMaxValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(halfPixelRightMax_ + width_ - 1 - x + d));
+			__m128i registerRightMinValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(workspace.halfPixelRightMin + width_ - 1 - x + d));
+			__m128i registerRightMaxValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(workspace.halfPixelRightMax + width_ - 1 - x + d));
 
 			__m128i registerCostLtoR = _mm_max_epu8(_mm_subs_epu8(registerLeftCenterValue, registerRightMaxValue),
 													_mm_subs_epu8(registerRightMinValue, registerLeftCenterValue));
@@ -459,12 +583,12 @@ void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsign
 													_mm_subs_epu8(registerLeftMinValue, registerRightCenterValue));
 			__m128i registerCost = _mm_min_epu8(registerCostLtoR, registerCostRtoL);
 
-			_mm_store_si128(reinterpret_cast<__m128i*>(pixelwiseCostRow_ + disparityTotal_*x + d), registerCost);
+			_mm_store_si128(reinterpret_cast<__m128i*>(workspace.pixelwiseCostRow + disparityTotal_*x + d), registerCost);
 		}
 		for (int d = x/16; d <= x; ++d) {
 			int rightCenterValue = rightSobelRow[width_ - 1 - x + d];
-			int rightMinValue = halfPixelRightMin_[width_ - 1 - x + d];
-			int rightMaxValue = halfPixelRightMax_[width_ - 1 - x + d];
+			int rightMinValue = workspace.halfPixelRightMin[width_ - 1 - x + d];
+			int rightMaxValue = workspace.halfPixelRightMax[width_ - 1 - x + d];
 
 			int costLtoR = std::max(0, leftCenterValue - rightMaxValue);
 			costLtoR = std::max(costLtoR, rightMinValue - leftCenterValue);
@@ -472,10 +596,10 @@ void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsign
 			costRtoL = std::max(costRtoL, leftMinValue - rightCenterValue);
 			int costValue = std::min(costLtoR, costRtoL);
 
-			pixelwiseCostRow_[disparityTotal_*x + d] = costValue;
+			workspace.pixelwiseCostRow[disparityTotal_*x + d] = costValue;
 		}
 		for (int d = x + 1; d < disparityTotal_; ++d) {
-			pixelwiseCostRow_[disparityTotal_*x + d] = pixelwiseCostRow_[disparityTotal_*x + d - 1];
+			workspace.pixelwiseCostRow[disparityTotal_*x + d] = workspace.pixelwiseCostRow[disparityTotal_*x + d - 1];
 		}
 	}
 	for (int x = disparityTotal_; x < width_; ++x) {
@@ -493,8 +617,8 @@ void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsign
 
 		for (int d = 0; d < disparityTotal_; d += 16) {
 			__m128i registerRightCenterValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rightSobelRow + width_ - 1 - x + d));
-			__m128i registerRightMinValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(halfPixelRightMin_ + width_ - 1 - x + d));
-			__m128i registerRightMaxValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(halfPixelRightMax_ + width_ - 1 - x + d));
+			__m128i registerRightMinValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(workspace.halfPixelRightMin + width_ - 1 - x + d));
+			__m128i registerRightMaxValue = _mm_loadu_si128(reinterpret_cast<const __m128i*>(workspace.halfPixelRightMax + width_ - 1 - x + d));
 
 			__m128i registerCostLtoR = _mm_max_epu8(_mm_subs_epu8(registerLeftCenterValue, registerRightMaxValue),
 													_mm_subs_epu8(registerRightMinValue, registerLeftCenterValue));
@@ -502,12 +626,12 @@ void SGMStereo::calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsign
 													_mm_subs_epu8(registerLeftMinValue, registerRightCenterValue));
 			__m128i registerCost = _mm_min_epu8(registerCostLtoR, registerCostRtoL);
 
-			_mm_store_si128(reinterpret_cast<__m128i*>(pixelwiseCostRow_ + disparityTotal_*x + d), registerCost);
+			_mm_store_si128(reinterpret_cast<__m128i*>(workspace.pixelwiseCostRow + disparityTotal_*x + d), registerCost);
 		}
 	}
 }
 
-void SGMStereo::calcHalfPixelRight(const unsigned char* rightSobelRow) {
+void SGMStereo::calcHalfPixelRight(const unsigned char* rightSobelRow, CostWorkspace& workspace) const {
 	for (int x = 0; x < width_; ++x) {
 		int centerValue = rightSobelRow[x];
 		int leftHalfValue = x > 0 ? (centerValue + rightSobelRow[x - 1])/2 : centerValue;
@@ -517,23 +641,23 @@ void SGMStereo::calcHalfPixelRight(const unsigned char* rightSobelRow) {
 		int maxValue = std::max(leftHalfValue, rightHalfValue);
 		maxValue = std::max(maxValue, centerValue);
 
-		halfPixelRightMin_[x] = minValue;
-		halfPixelRightMax_[x] = maxValue;
+		workspace.halfPixelRightMin[x] = minValue;
+		workspace.halfPixelRightMax[x] = maxValue;
 	}
 }
 
-void SGMStereo::addPixelwiseHamming(const int* leftCensusRow, const int* rightCensusRow) {
+void SGMStereo::addPixelwiseHamming(const int* leftCensusRow, const int* rightCensusRow, CostWorkspace& workspace) const {
 	for (int x = 0; x < disparityTotal_; ++x) {
 		int leftCencusCode = leftCensusRow[x];
 		int hammingDistance = 0;
 		for (int d = 0; d <= x; ++d) {
 			int rightCensusCode = rightCensusRow[x - d];
 			hammingDistance = static_cast<int>(_mm_popcnt_u32(static_cast<unsigned int>(leftCencusCode^rightCensusCode)));
-			pixelwiseCostRow_[disparityTotal_*x + d] += static_cast<unsigned char>(hammingDistance*censusWeightFactor_);
+			workspace.pixelwiseCostRow[disparityTotal_*x + d] += static_cast<unsigned char>(hammingDistance*censusWeightFactor_);
 		}
 		hammingDistance = static_cast<unsigned char>(hammingDistance*censusWeightFactor_);
 		for (int d = x + 1; d < disparityTotal_; ++d) {
-			pixelwiseCostRow_[disparityTotal_*x + d] += hammingDistance;
+			workspace.pixelwiseCostRow[disparityTotal_*x + d] += hammingDistance;
 		}
 	}
 	for (int x = disparityTotal_; x < width_; ++x) {
@@ -541,15 +665,15 @@ void SGMStereo::addPixelwiseHamming(const int* leftCensusRow, const int* rightCe
 		for (int d = 0; d < disparityTotal_; ++d) {
 			int rightCensusCode = rightCensusRow[x - d];
 			int hammingDistance = static_cast<int>(_mm_popcnt_u32(static_cast<unsigned int>(leftCencusCode^rightCensusCode)));
-			pixelwiseCostRow_[disparityTotal_*x + d] += static_cast<unsigned char>(hammingDistance*censusWeightFactor_);
+			workspace.pixelwiseCostRow[disparityTotal_*x + d] += static_cast<unsigned char>(hammingDistance*censusWeightFactor_);
 		}
 	}
 }
 
-void SGMStereo::computeRightCostImage() {
+void SGMStereo::computeRightCostImage(const int startY, const int endY) {
 	const int widthStepCost = width_*disparityTotal_;
 
-	for (int y = 0; y < height_; ++y) {
+	for (int y = startY; y < endY; ++y) {
 		unsigned short* leftCostRow = leftCostImage_ + widthStepCost*y;
 		unsigned short* rightCostRow = rightCostImage_ + widthStepCost*y;
 
@@ -586,157 +710,157 @@ void SGMStereo::computeRightCostImage() {
 	}
 }
 
-void SGMStereo::performSGM(unsigned short* costImage, unsigned short* disparityImage) {
-	const short costMax = SHRT_MAX;
-
-	int widthStepCostImage = width_*disparityTotal_;
-
-	short* costSums = sgmBuffer_;
-	memset(costSums, 0, costSumBufferSize_*sizeof(short));
-
-	short** pathCosts = new short*[pathRowBufferTotal_];
-	short** pathMinCosts = new short*[pathRowBufferTotal_];
+void SGMStereo::performSGM(const unsigned short* costImage, unsigned short* disparityImage) {
+	parallelFor(height_, 1, [this](int startY, int endY) {
+		memset(costSums_ + costSumBufferRowSize_*startY, 0, costSumBufferRowSize_*(endY - startY)*sizeof(short));
+	});
 
+	// Every path direction is independent along its scanlines; the directions are summed in
+	// a fixed order (left-right, top-bottom, right-left, bottom-top) so that the saturating
+	// sums do not depend on the number of threads
 	const int processPassTotal = 2;
 	for (int processPassCount = 0; processPassCount < processPassTotal; ++processPassCount) {
-		int startX, endX, stepX;
-		int startY, endY, stepY;
-		if (processPassCount == 0) {
-			startX = 0; endX = width_; stepX = 1;
-			startY = 0; endY = height_; stepY = 1;
-		} else {
-			startX = width_ - 1; endX = -1; stepX = -1;
-			startY = height_ - 1; endY = -1; stepY = -1;
-		}
+		const bool reverse = processPassCount == 1;
+
+		parallelFor(height_, 1, [&](int startY, int endY) {
+			aggregateHorizontalPaths(costImage, reverse, startY, endY);
+		});
+		parallelFor(width_, 16, [&](int startX, int endX) {
+			aggregateVerticalPaths(costImage, reverse, startX, endX);
+		});
+	}
 
-		for (int i = 0; i < pathRowBufferTotal_; ++i) {
-			pathCosts[i] = costSums + costSumBufferSize_ + pathCostBufferSize_*i + pathDisparitySize_ + 8;
-			memset(pathCosts[i] - pathDisparitySize_ - 8, 0, pathCostBufferSize_*sizeof(short));
-			pathMinCosts[i] = costSums + costSumBufferSize_ + pathCostBufferSize_*pathRowBufferTotal_
-				+ pathMinCostBufferSize_*i + pathTotal_*2;
-			memset(pathMinCosts[i] - pathTotal_, 0, pathMinCostBufferSize_*sizeof(short));
-		}
+	parallelFor(height_, 1, [&](int startY, int endY) {
+		selectDisparity(startY, endY, disparityImage);
+	});
+}
 
-		for (int y = startY; y != endY; y += stepY) {
-			unsigned short* pixelCostRow = costImage + widthStepCostImage*y;
-			short* costSumRow = costSums + costSumBufferRowSize_*y;
+void SGMStereo::aggregateHorizontalPaths(const unsigned short* costImage, const bool reverse, const int startY, const int endY) {
+	// Path costs of the previous and the current pixel, padded for the unaligned loads at d - 1 and d + 1
+	short* pathCostBuffer = reinterpret_cast<short*>(_mm_malloc((disparitySize_*2 + 16)*sizeof(short), 16));
 
-			memset(pathCosts[0] - pathDisparitySize_ - 8, 0, pathDisparitySize_*sizeof(short));
-			memset(pathCosts[0] + width_*pathDisparitySize_ - 8, 0, pathDisparitySize_*sizeof(short));
-			memset(pathMinCosts[0] - pathTotal_, 0, pathTotal_*sizeof(short));
-			memset(pathMinCosts[0] + width_*pathTotal_, 0, pathTotal_*sizeof(short));
+	const int startX = reverse ? width_ - 1 : 0;
+	const int endX = reverse ? -1 : width_;
+	const int stepX = reverse ? -1 : 1;
 
-			for (int x = startX; x != endX; x += stepX) {
-				int pathMinX = x*pathTotal_;
-				int pathX = pathMinX*disparitySize_;
+	for (int y = startY; y < endY; ++y) {
+		memset(pathCostBuffer, 0, (disparitySize_*2 + 16)*sizeof(short));
+		short* previousPathCost = pathCostBuffer + 8;
+		short* pathCost = previousPathCost + disparitySize_;
+		short previousPathMin = 0;
 
-				int previousPathMin0 = pathMinCosts[0][pathMinX - stepX*pathTotal_] + smoothnessPenaltyLarge_;
-				int previousPathMin2 = pathMinCosts[1][pathMinX + 2] + smoothnessPenaltyLarge_;
+		for (int x = startX; x != endX; x += stepX) {
+			int pixelIndex = width_*y + x;
+			previousPathMin = updatePathCost(previousPathCost, previousPathMin, costImage + disparityTotal_*pixelIndex,
+											 pathCost, costSums_ + disparityTotal_*pixelIndex);
+			std::swap(previousPathCost, pathCost);
+		}
+	}
 
-				short* previousPathCosts0 = pathCosts[0] + pathX - stepX*pathDisparitySize_;
-				short* previousPathCosts2 = pathCosts[1] + pathX + disparitySize_*2;
+	_mm_free(pathCostBuffer);
+}
 
-				previousPathCosts0[-1] = previousPathCosts0[disparityTotal_] = costMax;
-				previousPathCosts2[-1] = previousPathCosts2[disparityTotal_] = costMax;
+void SGMStereo::aggregateVerticalPaths(const unsigned short* costImage, const bool reverse, const int startX, const int endX) {
+	// Path costs of the columns startX...endX-1 in the previous and the current row
+	const int columnTotal = endX - startX;
+	const int rowBufferSize = disparitySize_*columnTotal + 16;
+	short* pathCostBuffer = reinterpret_cast<short*>(_mm_malloc(rowBufferSize*2*sizeof(short), 16));
+	memset(pathCostBuffer, 0, rowBufferSize*2*sizeof(short));
+	short* previousPathCosts = pathCostBuffer + 8;
+	short* pathCosts = previousPathCosts + rowBufferSize;
+	std::vector<short> previousPathMins(columnTotal, 0);
+
+	const int startY = reverse ? height_ - 1 : 0;
+	const int endY = reverse ? -1 : height_;
+	const int stepY = reverse ? -1 : 1;
+
+	for (int y = startY; y != endY; y += stepY) {
+		for (int x = startX; x < endX; ++x) {
+			int pixelIndex = width_*y + x;
+			int columnIndex = x - startX;
+			previousPathMins[columnIndex] = updatePathCost(previousPathCosts + disparitySize_*columnIndex, previousPathMins[columnIndex],
+														   costImage + disparityTotal_*pixelIndex,
+														   pathCosts + disparitySize_*columnIndex, costSums_ + disparityTotal_*pixelIndex);
+		}
+		std::swap(previousPathCosts, pathCosts);
+	}
 
-				short* pathCostCurrent = pathCosts[0] + pathX;
-				const unsigned short* pixelCostCurrent = pixelCostRow + disparityTotal_*x;
-				short* costSumCurrent = costSumRow + disparityTotal_*x;
+	_mm_free(pathCostBuffer);
+}
 
-				__m128i regPenaltySmall = _mm_set1_epi16(static_cast<short>(smoothnessPenaltySmall_));
+short SGMStereo::updatePathCost(short* previousPathCost, const short previousPathMin,
+								const unsigned short* pixelCost, short* pathCost, short* costSum) const
+{
+	const short costMax = SHRT_MAX;
 
-				__m128i regPathMin0, regPathMin2;
-				regPathMin0 = _mm_set1_epi16(static_cast<short>(previousPathMin0));
-				regPathMin2 = _mm_set1_epi16(static_cast<short>(previousPathMin2));
-				__m128i regNewPathMin = _mm_set1_epi16(costMax);
+	previousPathCost[-1] = previousPathCost[disparityTotal_] = costMax;
 
-				for (int d = 0; d < disparityTotal_; d += 8) {
-					__m128i regPixelCost = _mm_load_si128(reinterpret_cast<const __m128i*>(pixelCostCurrent + d));
+	__m128i regPenaltySmall = _mm_set1_epi16(static_cast<short>(smoothnessPenaltySmall_));
+	__m128i regPathMin = _mm_set1_epi16(static_cast<short>(previousPathMin + smoothnessPenaltyLarge_));
+	__m128i regNewPathMin = _mm_set1_epi16(costMax);
 
-					__m128i regPathCost0, regPathCost2;
-					regPathCost0 = _mm_load_si128(reinterpret_cast<const __m128i*>(previousPathCosts0 + d));
-					regPathCost2 = _mm_load_si128(reinterpret_cast<const __m128i*>(previousPathCosts2 + d));
+	for (int d = 0; d < disparityTotal_; d += 8) {
+		__m128i regPixelCost = _mm_load_si128(reinterpret_cast<const __m128i*>(pixelCost + d));
 
-					regPathCost0 = _mm_min_epi16(regPathCost0,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts0 + d - 1)),
-												 regPenaltySmall));
-					regPathCost0 = _mm_min_epi16(regPathCost0,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts0 + d + 1)),
-												 regPenaltySmall));
-					regPathCost2 = _mm_min_epi16(regPathCost2,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts2 + d - 1)),
-												 regPenaltySmall));
-					regPathCost2 = _mm_min_epi16(regPathCost2,
-												 _mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCosts2 + d + 1)),
-												 regPenaltySmall));
+		__m128i regPathCost = _mm_load_si128(reinterpret_cast<const __m128i*>(previousPathCost + d));
+		regPathCost = _mm_min_epi16(regPathCost,
+									_mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCost + d - 1)),
+									regPenaltySmall));
+		regPathCost = _mm_min_epi16(regPathCost,
+									_mm_adds_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(previousPathCost + d + 1)),
+									regPenaltySmall));
 
-					regPathCost0 = _mm_min_epi16(regPathCost0, regPathMin0);
-					regPathCost0 = _mm_adds_epi16(_mm_subs_epi16(regPathCost0, regPathMin0), regPixelCost);
-					regPathCost2 = _mm_min_epi16(regPathCost2, regPathMin2);
-					regPathCost2 = _mm_adds_epi16(_mm_subs_epi16(regPathCost2, regPathMin2), regPixelCost);
+		regPathCost = _mm_min_epi16(regPathCost, regPathMin);
+		regPathCost = _mm_adds_epi16(_mm_subs_epi16(regPathCost, regPathMin), regPixelCost);
 
-					_mm_store_si128(reinterpret_cast<__m128i*>(pathCostCurrent + d), regPathCost0);
-					_mm_store_si128(reinterpret_cast<__m128i*>(pathCostCurrent + d + disparitySize_*2), regPathCost2);
+		_mm_store_si128(reinterpret_cast<__m128i*>(pathCost + d), regPathCost);
+		regNewPathMin = _mm_min_epi16(regNewPathMin, regPathCost);
 
-					__m128i regMin02 = _mm_min_epi16(_mm_unpacklo_epi16(regPathCost0, regPathCost2),
-													 _mm_unpackhi_epi16(regPathCost0, regPathCost2));
-					regMin02 = _mm_min_epi16(_mm_unpacklo_epi16(regMin02, regMin02),
-											 _mm_unpackhi_epi16(regMin02, regMin02));
-					regNewPathMin = _mm_min_epi16(regNewPathMin, regMin02);
+		__m128i regCostSum = _mm_load_si128(reinterpret_cast<const __m128i*>(costSum + d));
+		regCostSum = _mm_adds_epi16(regCostSum, regPathCost);
+		_mm_store_si128(reinterpret_cast<__m128i*>(costSum + d), regCostSum);
+	}
 
-					__m128i regCostSum = _mm_load_si128(reinterpret_cast<const __m128i*>(costSumCurrent + d));
+	regNewPathMin = _mm_min_epi16(regNewPathMin, _mm_srli_si128(regNewPathMin, 8));
+	regNewPathMin = _mm_min_epi16(regNewPathMin, _mm_srli_si128(regNewPathMin, 4));
+	regNewPathMin = _mm_min_epi16(regNewPathMin, _mm_srli_si128(regNewPathMin, 2));
+	return static_cast<short>(_mm_extract_epi16(regNewPathMin, 0));
+}
 
-					regCostSum = _mm_adds_epi16(regCostSum, regPathCost0);
-					regCostSum = _mm_adds_epi16(regCostSum, regPathCost2);
+void SGMStereo::selectDisparity(const int startY, const int endY, unsigned short* disparityImage) const {
+	for (int y = startY; y < endY; ++y) {
+		const short* costSumRow = costSums_ + costSumBufferRowSize_*y;
+		unsigned short* disparityRow = disparityImage + width_*y;
 
-					_mm_store_si128(reinterpret_cast<__m128i*>(costSumCurrent + d), regCostSum);
+		for (int x = 0; x < width_; ++x) {
+			const short* costSumCurrent = costSumRow + disparityTotal_*x;
+			int bestSumCost = costSumCurrent[0];
+			int bestDisparity = 0;
+			for (int d = 1; d < disparityTotal_; ++d) {
+				if (costSumCurrent[d] < bestSumCost) {
+					bestSumCost = costSumCurrent[d];
+					bestDisparity = d;
 				}
-
-				regNewPathMin = _mm_min_epi16(regNewPathMin, _mm_srli_si128(regNewPathMin, 8));
-				_mm_storel_epi64(reinterpret_cast<__m128i*>(&pathMinCosts[0][pathMinX]), regNewPathMin);
 			}
 
-			if (processPassCount == processPassTotal - 1) {
-				unsigned short* disparityRow = disparityImage + width_*y;
-
-				for (int x = 0; x < width_; ++x) {
-					short* costSumCurrent = costSumRow + disparityTotal_*x;
-					int bestSumCost = costSumCurrent[0];
-					int bestDisparity = 0;
-					for (int d = 1; d < disparityTotal_; ++d) {
-						if (costSumCurrent[d] < bestSumCost) {
-							bestSumCost = costSumCurrent[d];
-							bestDisparity = d;
-						}
-					}
-
-					if (bestDisparity > 0 && bestDisparity < disparityTotal_ - 1) {
-						int centerCostValue = costSumCurrent[bestDisparity];
-						int leftCostValue = costSumCurrent[bestDisparity - 1];
-						int rightCostValue = costSumCurrent[bestDisparity + 1];
-						if (rightCostValue < leftCostValue) {
-							bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
-															 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - leftCostValue)/2.0*disparityFactor_ + 0.5);
-						} else {
-							bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
-															 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - rightCostValue)/2.0*disparityFactor_ + 0.5);
-						}
-					} else {
-						bestDisparity = static_cast<int>(bestDisparity*disparityFactor_);
-					}
-
-					disparityRow[x] = static_cast<unsigned short>(bestDisparity);
+			if (bestDisparity > 0 && bestDisparity < disparityTotal_ - 1) {
+				int centerCostValue = costSumCurrent[bestDisparity];
+				int leftCostValue = costSumCurrent[bestDisparity - 1];
+				int rightCostValue = costSumCurrent[bestDisparity + 1];
+				if (rightCostValue < leftCostValue) {
+					bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
+													 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - leftCostValue)/2.0*disparityFactor_ + 0.5);
+				} else {
+					bestDisparity = static_cast<int>(bestDisparity*disparityFactor_
+													 + static_cast<double>(rightCostValue - leftCostValue)/(centerCostValue - rightCostValue)/2.0*disparityFactor_ + 0.5);
 				}
+			} else {
+				bestDisparity = static_cast<int>(bestDisparity*disparityFactor_);
 			}
 
-			std::swap(pathCosts[0], pathCosts[1]);
-			std::swap(pathMinCosts[0], pathMinCosts[1]);
+			disparityRow[x] = static_cast<unsigned short>(bestDisparity);
 		}
 	}
-	delete[] pathCosts;
-	delete[] pathMinCosts;
-
-	speckleFilter(100, static_cast<int>(2*disparityFactor_), disparityImage);
 }
 
 void SGMStereo::speckleFilter(const int maxSpeckleSize, const int maxDifference, unsigned short* image) const {
@@ -815,38 +939,60 @@ void SGMStereo::speckleFilter(const int maxSpeckleSize, const int maxDifference,
 
 void SGMStereo::enforceLeftRightConsistency(unsigned short* leftDisparityImage, unsigned short* rightDisparityImage) const {
 	// Check left disparity image
-	for (int y = 0; y < height_; ++y) {
-		for (int x = 0; x < width_; ++x) {
-			if (leftDisparityImage[width_*y + x] == 0) continue;
-
-			int leftDisparityValue = static_cast<int>(static_cast<double>(leftDisparityImage[width_*y + x])/disparityFactor_ + 0.5);
-			if (x - leftDisparityValue < 0) {
-				leftDisparityImage[width_*y + x] = 0;
-				continue;
-			}
+	parallelFor(height_, 1, [&](int startY, int endY) {
+		for (int y = startY; y < endY; ++y) {
+			for (int x = 0; x < width_; ++x) {
+				if (leftDisparityImage[width_*y + x] == 0) continue;
+
+				int leftDisparityValue = static_cast<int>(static_cast<double>(leftDisparityImage[width_*y + x])/disparityFactor_ + 0.5);
+				if (x - leftDisparityValue < 0) {
+					leftDisparityImage[width_*y + x] = 0;
+					continue;
+				}
 
-			int rightDisparityValue = static_cast<int>(static_cast<double>(rightDisparityImage[width_*y + x-leftDisparityValue])/disparityFactor_ + 0.5);
-			if (rightDisparityValue == 0 || abs(leftDisparityValue - rightDisparityValue) > consistencyThreshold_) {
-				leftDisparityImage[width_*y + x] = 0;
+				int rightDisparityValue = static_cast<int>(static_cast<double>(rightDisparityImage[width_*y + x-leftDisparityValue])/disparityFactor_ + 0.5);
+				if (rightDisparityValue == 0 || abs(leftDisparityValue - rightDisparityValue) > consistencyThreshold_) {
+					leftDisparityImage[width_*y + x] = 0;
+				}
 			}
 		}
-	}
+	});
 
 	// Check right disparity image
-	for (int y = 0; y < height_; ++y) {
-		for (int x = 0; x < width_; ++x) {
-			if (rightDisparityImage[width_*y + x] == 0)  continue;
-
-			int rightDisparityValue = static_cast<int>(static_cast<double>(rightDisparityImage[width_*y + x])/disparityFactor_ + 0.5);
-			if (x + rightDisparityValue >= width_) {
-				rightDisparityImage[width_*y + x] = 0;
-				continue;
-			}
+	parallelFor(height_, 1, [&](int startY, int endY) {
+		for (int y = startY; y < endY; ++y) {
+			for (int x = 0; x < width_; ++x) {
+				if (rightDisparityImage[width_*y + x] == 0)  continue;
+
+				int rightDisparityValue = static_cast<int>(static_cast<double>(rightDisparityImage[width_*y + x])/disparityFactor_ + 0.5);
+				if (x + rightDisparityValue >= width_) {
+					rightDisparityImage[width_*y + x] = 0;
+					continue;
+				}
 
-			int leftDisparityValue = static_cast<int>(static_cast<double>(leftDisparityImage[width_*y + x+rightDisparityValue])/disparityFactor_ + 0.5);
-			if (leftDisparityValue == 0 || abs(rightDisparityValue - leftDisparityValue) > consistencyThreshold_) {
-				rightDisparityImage[width_*y + x] = 0;
+				int leftDisparityValue = static_cast<int>(static_cast<double>(leftDisparityImage[width_*y + x+rightDisparityValue])/disparityFactor_ + 0.5);
+				if (leftDisparityValue == 0 || abs(rightDisparityValue - leftDisparityValue) > consistencyThreshold_) {
+					rightDisparityImage[width_*y + x] = 0;
+				}
 			}
 		}
+	});
+}
+
+void SGMStereo::parallelFor(const int total, const int minChunkSize, const std::function<void(int, int)>& body) const {
+	int chunkTotal = std::min(threadTotal_, total/std::max(minChunkSize, 1));
+	if (chunkTotal <= 1) {
+		body(0, total);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (int chunkIndex = 1; chunkIndex < chunkTotal; ++chunkIndex) {
+		threads.push_back(std::thread(body, static_cast<int>(static_cast<long long>(total)*chunkIndex/chunkTotal),
+									  static_cast<int>(static_cast<long long>(total)*(chunkIndex + 1)/chunkTotal)));
+	}
+	body(0, total/chunkTotal);
+	for (size_t i = 0; i < threads.size(); ++i) {
+		threads[i].join();
 	}
 }
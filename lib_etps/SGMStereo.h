@@ -18,6 +18,8 @@
 #pragma once
 
 #include <png++/png.hpp>
+#include <opencv2/core/core.hpp>
+#include <functional>
 
 class SGMStereo {
 public:
@@ -31,38 +33,74 @@ public:
 							   const int aggregationWindowRadius);
 	void setSmoothnessCostParameters(const int smoothnessPenaltySmall, const int smoothnessPenaltyLarge);
 	void setConsistencyThreshold(const int consistencyThreshold);
+	// Number of threads used for cost computation, path aggregation and post-processing
+	// (0 uses all hardware threads); the disparity image does not depend on it
+	void setThreadTotal(const int threadTotal);
 
 	void compute(const png::image<png::rgb_pixel>& leftImage,
 				 const png::image<png::rgb_pixel>& rightImage,
 				 float* disparityImage);
+	// Same as above for 8-bit BGR (or grayscale) images, avoids the conversion to png::image
+	void compute(const cv::Mat& leftImage,
+				 const cv::Mat& rightImage,
+				 float* disparityImage);
+
+	// Wall clock times (in seconds) of the stages of the last call to compute
+	struct Timing {
+		Timing() : cost(0.0), aggregation(0.0), postprocessing(0.0), total(0.0) {}
+		double cost;
+		double aggregation;
+		double postprocessing;
+		double total;
+	};
+	const Timing& timing() const { return timing_; }
 
 private:
-	void initialize(const png::image<png::rgb_pixel>& leftImage, const png::image<png::rgb_pixel>& rightImage);
-	void setImageSize(const png::image<png::rgb_pixel>& leftImage, const png::image<png::rgb_pixel>& rightImage);
+	// Per-thread buffers of the left cost image computation
+	struct CostWorkspace {
+		unsigned char* pixelwiseCostRow;
+		unsigned short* rowAggregatedCost;
+		unsigned char* halfPixelRightMin;
+		unsigned char* halfPixelRightMax;
+	};
+
+	void computeDisparityImage(const unsigned char* leftGrayscaleImage,
+							   const unsigned char* rightGrayscaleImage,
+							   float* disparityImage);
+	void setImageSize(const int leftWidth, const int leftHeight, const int rightWidth, const int rightHeight);
 	void allocateDataBuffer();
 	void freeDataBuffer();
-	void computeCostImage(const png::image<png::rgb_pixel>& leftImage, const png::image<png::rgb_pixel>& rightImage);
+	void allocateCostWorkspace(CostWorkspace& workspace) const;
+	void freeCostWorkspace(CostWorkspace& workspace) const;
+	void computeCostImage(const unsigned char* leftGrayscaleImage, const unsigned char* rightGrayscaleImage);
 	void convertToGrayscale(const png::image<png::rgb_pixel>& leftImage,
 							const png::image<png::rgb_pixel>& rightImage,
 							unsigned char* leftGrayscaleImage,
 							unsigned char* rightGrayscaleImage) const;
+	void convertToGrayscale(const cv::Mat& image, unsigned char* grayscaleImage) const;
 	void computeLeftCostImage(const unsigned char* leftGrayscaleImage, const unsigned char* rightGrayscaleImage);
-	void computeCappedSobelImage(const unsigned char* image, const bool horizontalFlip, unsigned char* sobelImage) const;
-	void computeCensusImage(const unsigned char* image, int* censusImage) const;
-	void calcTopRowCost(unsigned char*& leftSobelRow, int*& leftCensusRow,
-						unsigned char*& rightSobelRow, int*& rightCensusRow,
-						unsigned short* costImageRow);
-	void calcRowCosts(unsigned char*& leftSobelRow, int*& leftCensusRow,
-					  unsigned char*& rightSobelRow, int*& rightCensusRow,
-					  unsigned short* costImageRow);
-	void calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsigned char* rightSobelRow);
-	void calcHalfPixelRight(const unsigned char* rightSobelRow);
-	void addPixelwiseHamming(const int* leftCensusRow, const int* rightCensusRow);
-	void computeRightCostImage();
-	void performSGM(unsigned short* costImage, unsigned short* disparityImage);
+	void computeCappedSobelImage(const unsigned char* image, const bool horizontalFlip, unsigned char* sobelImage,
+								 const int startY, const int endY) const;
+	void computeCensusImage(const unsigned char* image, int* censusImage, const int startY, const int endY) const;
+	void computeLeftCostStrip(const int startY, const int endY);
+	void calcTopRowCost(CostWorkspace& workspace);
+	void calcStripPreviousRowCost(const int startY, CostWorkspace& workspace, unsigned short* previousCostRow);
+	void calcRowCosts(const int startY, const int endY, const unsigned short* startPreviousCostRow, CostWorkspace& workspace);
+	void calcRowAggregatedCost(const CostWorkspace& workspace, unsigned short* rowAggregatedCostCurrent) const;
+	void calcPixelwiseCost(const int rowIndex, CostWorkspace& workspace) const;
+	void calcPixelwiseSAD(const unsigned char* leftSobelRow, const unsigned char* rightSobelRow, CostWorkspace& workspace) const;
+	void calcHalfPixelRight(const unsigned char* rightSobelRow, CostWorkspace& workspace) const;
+	void addPixelwiseHamming(const int* leftCensusRow, const int* rightCensusRow, CostWorkspace& workspace) const;
+	void computeRightCostImage(const int startY, const int endY);
+	void performSGM(const unsigned short* costImage, unsigned short* disparityImage);
+	void aggregateHorizontalPaths(const unsigned short* costImage, const bool reverse, const int startY, const int endY);
+	void aggregateVerticalPaths(const unsigned short* costImage, const bool reverse, const int startX, const int endX);
+	short updatePathCost(short* previousPathCost, const short previousPathMin,
+						 const unsigned short* pixelCost, short* pathCost, short* costSum) const;
+	void selectDisparity(const int startY, const int endY, unsigned short* disparityImage) const;
 	void speckleFilter(const int maxSpeckleSize, const int maxDifference, unsigned short* image) const;
 	void enforceLeftRightConsistency(unsigned short* leftDisparityImage, unsigned short* rightDisparityImage) const;
-
+	void parallelFor(const int total, const int minChunkSize, const std::function<void(int, int)>& body) const;
 
 	// Parameter
 	int disparityTotal_;
@@ -81,18 +119,15 @@ private:
 	int widthStep_;
 	unsigned short* leftCostImage_;
 	unsigned short* rightCostImage_;
-	unsigned char* pixelwiseCostRow_;
-	unsigned short* rowAggregatedCost_;
-	unsigned char* halfPixelRightMin_;
-	unsigned char* halfPixelRightMax_;
-	int pathRowBufferTotal_;
+	unsigned char* leftSobelImage_;
+	unsigned char* rightSobelImage_;
+	int* leftCensusImage_;
+	int* rightCensusImage_;
 	int disparitySize_;
-	int pathTotal_;
-	int pathDisparitySize_;
 	int costSumBufferRowSize_;
 	int costSumBufferSize_;
-	int pathMinCostBufferSize_;
-	int pathCostBufferSize_;
-	int totalBufferSize_;
-	short* sgmBuffer_;
+	short* costSums_;
+
+	int threadTotal_;
+	Timing timing_;
 };
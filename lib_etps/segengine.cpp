@@ -3,6 +3,7 @@
 #include "functions.h"
 #include "utils.h"
 #include "tsdeque.h"
+#include "SGMStereo.h"
 #include <unordered_map>
 #include <fstream>   
 #include <thread>
@@ -304,13 +305,18 @@ SPSegmentationEngine::SPSegmentationEngine(SPSegmentationParameters params, Mat
     planeSmoothWeightHi = 0.1;
     
     img = ConvertRGBToLab(im);
+    SetDisparity(depthIm);
+    //depthImg = FillGapsInDisparityImage(depthImg);
+    //inliers = Mat1b(depthImg.rows, depthImg.cols);
+}
+
+void SPSegmentationEngine::SetDisparity(const Mat& depthIm)
+{
     depthImg = AdjustDisparityImage(depthIm);
-    if (params.stereo) {
+    if (params.stereo && !depthImg.empty()) {
         if (params.inpaint) depthImgAdj = InpaintDisparityImage(depthImg);
         else depthImgAdj = FillGapsInDisparityImage(depthImg);
     }
-    //depthImg = FillGapsInDisparityImage(depthImg);
-    //inliers = Mat1b(depthImg.rows, depthImg.cols);
 }
 
 SPSegmentationEngine::~SPSegmentationEngine()
@@ -338,6 +344,8 @@ void calcPixelSizes(int actualGridSize, int maxPixelSize,
 void SPSegmentationEngine::Initialize(Superpixel* spGenerator(int))
 {
     int imageSize = img.rows * img.cols;
+
+    imgIntegrals.Compute(img);
     if (params.superpixelNum <= 0 && params.gridSize <= 0) {
         std::cerr << "superpixelNum and gridSize are both zero!" << std::endl;
         return;
@@ -431,7 +439,7 @@ void SPSegmentationEngine::Initialize(Superpixel* spGenerator(int))
             // Update superpixels pointers in each pixel
             for (int i = i0; i < i1; i++) {
                 for (int j = j0; j < j1; j++) {
-                    pixelsImg(i, j).CalcPixelData(img, pd);
+                    pixelsImg(i, j).CalcPixelData(imgIntegrals, pd);
                     sp->AddPixelInit(pd);
                 }
             }
@@ -576,6 +584,33 @@ void SPSegmentationEngine::ProcessImageStereo()
     performanceInfo.imgproc = t1.GetTimeInSec();
 }
 
+bool SPSegmentationEngine::ProcessImageStereoSGM(const Mat& rightImg)
+{
+    SGMStereo sgm;
+    vector<float> disparity(origImg.rows * origImg.cols);
+
+    try {
+        sgm.setThreadTotal(params.sgmThreads);
+        sgm.compute(origImg, rightImg, disparity.data());
+    } catch (const std::invalid_argument& e) {
+        if (params.debugOutput) cout << e.what() << endl;
+        return false;
+    }
+    SetDisparity(ConvertFloatToOCV(origImg.cols, origImg.rows, disparity.data()));
+
+    // SGMStereo measures wall clock time as it runs multi-threaded
+    const SGMStereo::Timing& timing = sgm.timing();
+
+    performanceInfo.sgm = timing.total;
+    performanceInfo.sgmCost = timing.cost;
+    performanceInfo.sgmAggregation = timing.aggregation;
+    performanceInfo.sgmPostprocessing = timing.postprocessing;
+
+    ProcessImageStereo();
+    performanceInfo.total += performanceInfo.sgm;
+    return true;
+}
+
 void SPSegmentationEngine::ReEstimatePlaneParameters()
 {
     UpdateBoundaryData2();
@@ -1060,8 +1095,6 @@ void LockStereo(Pixel*& p, unordered_set<Superpixel*>& toLock, const Matrix<Pixe
     }
 }
 
-static int dbgImageNum = 0;
-
 int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
 {
     PixelMoveData tryMoveData[4];
@@ -1112,7 +1145,7 @@ int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
                 //    cout << "Disp sum mismatch";
                 //}
                 //sps->CheckRegEnergy();
-                //sps->CheckAppEnergy(img);
+                //sps->CheckAppEnergy(imgIntegrals);
 
                 //double delta = TotalEnergyDelta(params, bestMoveData);
 
@@ -1225,7 +1258,7 @@ int SPSegmentationEngine::Iterate(Deque<Pixel*>& list, Matrix<bool>& inList)
 //                //    cout << "Disp sum mismatch";
 //                //}
 //                //sps->CheckRegEnergy();
-//                //sps->CheckAppEnergy(img);
+//                //sps->CheckAppEnergy(imgIntegrals);
 //
 //                double delta = TotalEnergyDelta(params, bestMoveData);
 //
@@ -1515,10 +1548,16 @@ int SPSegmentationEngine::GetNoOfSuperpixels() const
 void SPSegmentationEngine::PrintPerformanceInfo()
 {
     if (params.timingOutput && !params.debugOutput) {
+        if (performanceInfo.sgm > 0) cout << "SGM processing time: " << performanceInfo.sgm << " sec." << endl;
         cout << "Processing time: " << performanceInfo.total << " sec." << endl;
     }
     if (params.debugOutput) {
         cout << "No. of superpixels: " << GetNoOfSuperpixels() << endl;
+        if (performanceInfo.sgm > 0) {
+            cout << "SGM time: " << performanceInfo.sgm << " sec. (cost: " << performanceInfo.sgmCost
+                << ", aggregation: " << performanceInfo.sgmAggregation
+                << ", post-processing: " << performanceInfo.sgmPostprocessing << ")" << endl;
+        }
         cout << "Initialization time: " << performanceInfo.init << " sec." << endl;
         cout << "Ransac time: " << performanceInfo.ransac << " sec." << endl;
         cout << "Time of image processing: " << performanceInfo.imgproc << " sec." << endl;
@@ -1614,7 +1653,7 @@ bool SPSegmentationEngine::TryMovePixel(Pixel* p, Pixel* q, PixelMoveData& psd)
     PixelData pd;
     int spbl, sqbl, sobl;
 
-    p->CalcPixelData(img, pd);
+    p->CalcPixelData(imgIntegrals, pd);
     sp->GetRemovePixelData(pd, pcd);
     sq->GetAddPixelData(pd, qcd);
     CalcSuperpixelBoundaryLength(pixelsImg, p, sp, sq, spbl, sqbl, sobl);
@@ -1654,7 +1693,7 @@ bool SPSegmentationEngine::TryMovePixelStereo(Pixel* p, Pixel* q, PixelMoveData&
     PixelData pd;
     int spbl, sqbl, sobl;
 
-    p->CalcPixelDataStereo(img, depthImg, sp->plane, sq->plane, params.inlierThreshold, params.noDisp, pd);
+    p->CalcPixelDataStereo(imgIntegrals, depthImg, sp->plane, sq->plane, params.inlierThreshold, params.noDisp, pd);
     sp->GetRemovePixelDataStereo(pd, pcd);
     sq->GetAddPixelDataStereo(pd, qcd);
     if (params.instantBoundary) CalcBorderChangeDataStereo(pixelsImg, depthImg, params, p, q, psd.bDataP, psd.bDataQ, psd.prem);
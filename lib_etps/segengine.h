@@ -70,6 +70,7 @@ struct SPSegmentationParameters {
         instantBoundary(false),   // Boundary re-estimation on each step of iteration
         stereo(false),
         computeSGM(false),
+        sgmThreads(0),            // threads of the SGM disparity computation (0 = all)
         batchProcessing(true),
         inpaint(false),           // use opencv's inpaint method to fill gaps in
         debugOutput(false),
@@ -104,6 +105,7 @@ struct SPSegmentationParameters {
     bool instantBoundary;   // Boundary re-estimation on each step of iteration
     bool stereo;
     bool computeSGM;
+    int sgmThreads;
     bool batchProcessing;
     bool inpaint;           // use opencv's inpaint method to fill gaps in
                                     // disparity image
@@ -135,6 +137,7 @@ struct SPSegmentationParameters {
         UpdateFromNode(noDisp, node["noDisp"]);
         UpdateFromNode(stereo, node["stereo"]);
         UpdateFromNode(computeSGM, node["computeSGM"]);
+        UpdateFromNode(sgmThreads, node["sgmThreads"]);
         UpdateFromNode(batchProcessing, node["batchProcessing"]);
         UpdateFromNode(inpaint, node["inpaint"]);
         UpdateFromNode(instantBoundary, node["instantBoundary"]);
@@ -204,7 +207,12 @@ private:
 class SPSegmentationEngine {
 private:
     struct PerformanceInfo {
-        PerformanceInfo() : init(0.0), imgproc(0.0), ransac(0.0), total(0.0) {}
+        PerformanceInfo() : sgm(0.0), sgmCost(0.0), sgmAggregation(0.0), sgmPostprocessing(0.0),
+            init(0.0), imgproc(0.0), ransac(0.0), total(0.0) {}
+        double sgm;                 // Wall clock time of the SGM disparity computation (ProcessImageStereoSGM)
+        double sgmCost;
+        double sgmAggregation;
+        double sgmPostprocessing;
         double init;
         double imgproc;
         double ransac;
@@ -234,6 +242,9 @@ private:
     // Image to process (in lab color space)
     Mat img;
 
+    // Integral images of img, block color sums are looked up in constant time
+    ImageIntegrals imgIntegrals;
+
     // Support structures
     Matrix<Pixel> pixelsImg;    // pixels matrix, dimension varies, depends on level
     Matrix<Pixel*> ppImg;       // matrix of dimension of img, pointers to pixelsImg pixels (for stereo)
@@ -244,6 +255,9 @@ public:
 
     void ProcessImage();
     void ProcessImageStereo();
+    // Computes the disparity image of origImg and rightImg with SGM and runs ProcessImageStereo on it.
+    // Returns false if the disparity could not be computed (e.g. image sizes differ).
+    bool ProcessImageStereoSGM(const Mat& rightImg);
     Mat GetSegmentedImage();
     Mat GetSegmentedImagePlain();
     Mat GetSegmentedImageStereo();
@@ -257,6 +271,7 @@ public:
     int GetNoOfSuperpixels() const;
     double ProcessingTime() { return performanceInfo.total; }
 private:
+    void SetDisparity(const Mat& depthIm);
     void Initialize(Superpixel* spGenerator(int));
     void InitializeStereo();
     void InitializeStereoEnergies();
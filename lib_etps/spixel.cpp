@@ -7,64 +7,10 @@
 #include "utils.h"
 #include <fstream>
 #include <cstdlib>
-#include "SGMStereo.h"
 
 using namespace cv;
 using namespace std;
 
-void ConvertOCVToPNG(const Mat& ocvImg, png::image<png::rgb_pixel>& pngImg)
-{
-    pngImg.resize(ocvImg.cols, ocvImg.rows);
-
-    for (int r = 0; r < ocvImg.rows; r++) {
-        for (int c = 0; c < ocvImg.cols; c++) {
-            const Vec3b& bgrColor = ocvImg.at<Vec3b>(r, c);
-            pngImg.set_pixel(c, r, png::rgb_pixel(bgrColor[2], bgrColor[1], bgrColor[0]));
-        }
-    }
-}
-
-Mat ConvertFloatToOCV(int width, int height, const float* data)
-{
-    Mat1w result(height, width);
-
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
-            result(y, x) = (ushort)(data[width*y + x] * 256.0f + 0.5);
-        }
-    }
-    return result;
-}
-
-double SGMPreprocessing(const Mat& leftImage, const Mat& rightImage, Mat& dispImage)
-{
-    png::image<png::rgb_pixel> leftImageSGM, rightImageSGM;
-
-    ConvertOCVToPNG(leftImage, leftImageSGM);
-    ConvertOCVToPNG(rightImage, rightImageSGM);
-
-    size_t width = leftImageSGM.get_width();
-    size_t height = leftImageSGM.get_height();
-
-    if (width != rightImageSGM.get_width() || height != rightImageSGM.get_height()) {
-        dispImage = Mat1w();
-        return 0.0;
-    }
-
-    float* dispImageFloat = (float*)malloc(width*height*sizeof(float));
-
-    SGMStereo sgm;
-    Timer t;
-
-    sgm.compute(leftImageSGM, rightImageSGM, dispImageFloat);
-    t.Stop();
-    dispImage = ConvertFloatToOCV(width, height, dispImageFloat);
-
-    free(dispImageFloat);
-    
-    return t.GetTimeInSec();
-}
-
 void ProcessFilesBatch(SPSegmentationParameters& params, const vector<string>& files, const string& fileDir)
 {
     MkDir(fileDir + "out");
@@ -184,24 +130,12 @@ void ProcessFilesStereoBatchSGM(SPSegmentationParameters& params, const vector<s
         }
         cout << "Processing: " << leftFileName << "/" << rightFileName << endl;
 
-        Mat dispImage;
-        double sgmTime;
-        
-        sgmTime = SGMPreprocessing(leftImage, rightImage, dispImage);
-        totalTime += sgmTime;
+        SPSegmentationEngine engine(params, leftImage);
 
-        if (dispImage.empty()) {
-            cout << "Failed creating SGM image for '" << leftImage << "'/'" << rightImage << "' pair" << endl;
+        if (!engine.ProcessImageStereoSGM(rightImage)) {
+            cout << "Failed creating SGM image for '" << leftFileName << "'/'" << rightFileName << "' pair" << endl;
             continue;
         }
-
-        if (params.timingOutput) {
-            cout << "SGM processing time: " << sgmTime << " sec." << endl;
-        }
-
-        SPSegmentationEngine engine(params, leftImage, dispImage);
-
-        engine.ProcessImageStereo();
         engine.PrintDebugInfoStereo();
         engine.PrintPerformanceInfo();
         totalTime += engine.ProcessingTime();
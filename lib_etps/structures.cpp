@@ -2,6 +2,34 @@
 #include "structures.h"
 #include "functions.h"
 
+// ImageIntegrals defininions
+///////////////////////////
+
+void ImageIntegrals::Compute(const cv::Mat& img)
+{
+    CV_Assert(img.type() == CV_64FC3);
+
+    sum = cv::Mat_<cv::Vec3d>(img.rows + 1, img.cols + 1, cv::Vec3d(0, 0, 0));
+    sqSum = cv::Mat_<cv::Vec3d>(img.rows + 1, img.cols + 1, cv::Vec3d(0, 0, 0));
+    for (int i = 0; i < img.rows; i++) {
+        const cv::Vec3d* imgRow = img.ptr<cv::Vec3d>(i);
+        const cv::Vec3d* sumPrev = sum[i];
+        const cv::Vec3d* sqSumPrev = sqSum[i];
+        cv::Vec3d* sumRow = sum[i + 1];
+        cv::Vec3d* sqSumRow = sqSum[i + 1];
+        cv::Vec3d rowSum(0, 0, 0), rowSqSum(0, 0, 0);
+
+        for (int j = 0; j < img.cols; j++) {
+            const cv::Vec3d& val = imgRow[j];
+
+            rowSum += val;
+            rowSqSum += val.mul(val);
+            sumRow[j + 1] = sumPrev[j + 1] + rowSum;
+            sqSumRow[j + 1] = sqSumPrev[j + 1] + rowSqSum;
+        }
+    }
+}
+
 // Pixel defininions
 ///////////////////////////
 
@@ -162,13 +190,13 @@ double SuperpixelStereo::CalcDispEnergy(const cv::Mat1d& dispImg, double inlierT
     return sum;
 }
 
-void SuperpixelStereo::CheckAppEnergy(const cv::Mat& img)
+void SuperpixelStereo::CheckAppEnergy(const ImageIntegrals& integrals)
 {
     double rr = 0, rr2 = 0, gg = 0, gg2 = 0, bb = 0, bb2 = 0;
 
     for (Pixel* p : pixels) {
         double r = 0, r2 = 0, g = 0, g2 = 0, b = 0, b2 = 0;
-        p->CalcRGBSum(img, r, r2, g, g2, b, b2);
+        p->CalcRGBSum(integrals, r, r2, g, g2, b, b2);
         rr += r; rr2 += r2; gg += g; gg2 += g2; bb += b; bb2 += b2;
     }
     if (fabs(rr - sumR) > 0.01 || fabs(rr2 - sumR2) > 0.01 || fabs(gg - sumG) > 0.01
@@ -182,6 +182,27 @@ struct PixelData {
     int size;
 };
 
+// Integral images of the image to process (Vec3d, in Lab color space) and of
+// its squares; both are of size (rows + 1) x (cols + 1) such that the color
+// sums over any block are obtained in constant time.
+struct ImageIntegrals {
+    cv::Mat_<cv::Vec3d> sum;
+    cv::Mat_<cv::Vec3d> sqSum;
+
+    void Compute(const cv::Mat& img);
+
+    // Sums over rows [r0, r1) and columns [c0, c1)
+    inline cv::Vec3d BlockSum(int r0, int c0, int r1, int c1) const
+    {
+        return sum(r1, c1) - sum(r0, c1) - sum(r1, c0) + sum(r0, c0);
+    }
+
+    inline cv::Vec3d BlockSqSum(int r0, int c0, int r1, int c1) const
+    {
+        return sqSum(r1, c1) - sqSum(r0, c1) - sqSum(r1, c0) + sqSum(r0, c0);
+    }
+};
+
 
 typedef unordered_map<SuperpixelStereo*, BInfo> BorderDataMap;
 
@@ -237,21 +258,33 @@ struct Pixel { // : public custom_alloc {
         superPixel = nullptr;
     }
 
+    // Sums of i and i^2 for i in [a, b)
+    static inline double RangeSum(int a, int b) { return 0.5*((double)b*(b - 1) - (double)a*(a - 1)); }
+    static inline double RangeSum2(int a, int b)
+    {
+        return ((double)(b - 1)*b*(2*b - 1) - (double)(a - 1)*a*(2*a - 1)) / 6.0;
+    }
+
+    // Coordinate moments over the block in closed form
     void CalcRowColSum(double& sumRow, double& sumRow2, double& sumCol, double& sumCol2, double& sumRowCol) const
     {
-        sumRow = 0.0; sumRow2 = 0.0;
-        sumCol = 0.0; sumCol2 = 0.0;
-        sumRowCol = 0.0;
-        for (int i = ulr; i < (int)lrr; i++) {
-            for (int j = ulc; j < (int)lrc; j++) {
-                sumRow += i; sumCol += j;
-                sumRowCol += i*j;
-                sumRow2 += i*i; sumCol2 += j*j;
-                if (sumCol2 < 0) {
-                    exit(0);
-                }
-            }
-        }
+        double rows = lrr - ulr, cols = lrc - ulc;
+        double sumI = RangeSum(ulr, lrr), sumJ = RangeSum(ulc, lrc);
+
+        sumRow = cols*sumI; sumRow2 = cols*RangeSum2(ulr, lrr);
+        sumCol = rows*sumJ; sumCol2 = rows*RangeSum2(ulc, lrc);
+        sumRowCol = sumI*sumJ;
+    }
+
+    void CalcRGBSum(const ImageIntegrals& integrals, double& sumR, double& sumR2, double& sumG, double& sumG2,
+        double& sumB, double& sumB2) const
+    {
+        const cv::Vec3d s = integrals.BlockSum(ulr, ulc, lrr, lrc);
+        const cv::Vec3d s2 = integrals.BlockSqSum(ulr, ulc, lrr, lrc);
+
+        sumB = s[0]; sumB2 = s2[0];
+        sumG = s[1]; sumG2 = s2[1];
+        sumR = s[2]; sumR2 = s2[2];
     }
 
     void CalcRGBSum(const cv::Mat& img, double& sumR, double& sumR2, double& sumG, double& sumG2,
@@ -532,18 +565,18 @@ struct Pixel { // : public custom_alloc {
         }
     }
     
-    inline void CalcPixelData(const cv::Mat& img, PixelData& pd)
+    inline void CalcPixelData(const ImageIntegrals& integrals, PixelData& pd)
     {
         pd.p = this;
         CalcRowColSum(pd.sumRow, pd.sumRow2, pd.sumCol, pd.sumCol2, pd.sumRowCol);
-        CalcRGBSum(img, pd.sumR, pd.sumR2, pd.sumG, pd.sumG2, pd.sumB, pd.sumB2);
+        CalcRGBSum(integrals, pd.sumR, pd.sumR2, pd.sumG, pd.sumG2, pd.sumB, pd.sumB2);
         pd.size = GetSize();
     }
 
-    inline void CalcPixelDataStereo(const cv::Mat& img, const cv::Mat1d& imgDisp,
+    inline void CalcPixelDataStereo(const ImageIntegrals& integrals, const cv::Mat1d& imgDisp,
         Plane_d& planeP, Plane_d& planeQ, double inlierThresh, double noDisp, PixelData& pd)
     {
-        CalcPixelData(img, pd);
+        CalcPixelData(integrals, pd);
         pd.sumDispP = CalcDispSum(imgDisp, planeP, inlierThresh, noDisp);
         pd.sumDispQ = CalcDispSum(imgDisp, planeQ, inlierThresh, noDisp);
     }
@@ -606,7 +639,6 @@ struct Pixel { // : public custom_alloc {
     //    int& sumIRow, int& sumIRow2, int& sumICol, int& sumICol2, int& sumIRowCol, double& sumIRowD, double& sumIColD, double& sumID, int& nI); 
     string GetPixelsAsString();
 
-    //CLASS_ALLOCATION()
 };
 
 class Superpixel {
@@ -998,7 +1030,7 @@ public:
 
     // For debug purposes!
     double CalcDispEnergy(const cv::Mat1d& dispImg, double inlierThresh, double noDisp);
-    void CheckAppEnergy(const cv::Mat& img);
+    void CheckAppEnergy(const ImageIntegrals& integrals);
     void CheckRegEnergy();
 };
 
@@ -252,6 +252,18 @@ cv::Mat AdjustDisparityImage(const cv::Mat& img)
     return imgConv;
 }
 
+Mat ConvertFloatToOCV(int width, int height, const float* data)
+{
+    Mat1w result(height, width);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            result(y, x) = (ushort)(data[width*y + x] * 256.0f + 0.5);
+        }
+    }
+    return result;
+}
+
 string Format(const string& fs, ...)
 {
     unique_ptr<char[]> result;
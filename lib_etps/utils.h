@@ -28,6 +28,9 @@ cv::Mat ConvertRGBToLab(const cv::Mat& img);
 // Input is divided by 256.0 and gaps (regions with value 0) are "filled", 
 cv::Mat AdjustDisparityImage(const cv::Mat& img);
 
+// Converts float disparities (e.g. SGMStereo output) to a single channel ushort image scaled by 256
+cv::Mat ConvertFloatToOCV(int width, int height, const float* data);
+
 cv::Mat FillGapsInDisparityImage(const cv::Mat& img);
 
 cv::Mat InpaintDisparityImage(const cv::Mat& img);
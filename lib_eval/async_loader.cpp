@@ -0,0 +1,155 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "batch_server.h"
+#include "async_loader.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// AsyncLoader
+////////////////////////////////////////////////////////////////////////////////
+
+AsyncLoader::AsyncLoader(const std::multimap<std::string, boost::filesystem::path> &images,
+        int threads, int queue_size_, int flags_) 
+        : queue_size(std::max(1, queue_size_)), flags(flags_), next(0), 
+        current(0), stop(false) {
+    
+    for (std::multimap<std::string, boost::filesystem::path>::const_iterator it = images.begin();
+            it != images.end(); ++it) {
+        indices.insert(std::make_pair(it->first, static_cast<unsigned int>(files.size())));
+        files.push_back(it->first);
+    }
+    
+    taken.resize(files.size(), false);
+    skipped.resize(files.size(), false);
+    
+    threads = std::min(std::max(1, threads), static_cast<int>(files.size()));
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::thread(&AsyncLoader::work, this));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ~AsyncLoader
+////////////////////////////////////////////////////////////////////////////////
+
+AsyncLoader::~AsyncLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    
+    consumed.notify_all();
+    for (unsigned int t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// read
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Mat AsyncLoader::read(const std::string &file) {
+    cv::Mat image;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        std::map<std::string, unsigned int>::const_iterator index = indices.find(file);
+        if (index == indices.end() || taken[index->second]) {
+            lock.unlock();
+            return BatchServer::readImage(file, flags);
+        }
+        
+        const unsigned int i = index->second;
+        taken[i] = true;
+        
+        // Images beyond the window are not decoded yet and are skipped
+        // by the decoding threads.
+        if (i >= current + queue_size) {
+            skipped[i] = true;
+            lock.unlock();
+            return BatchServer::readImage(file, flags);
+        }
+        
+        ready.wait(lock, [this, i]() { return decoded.find(i) != decoded.end(); });
+        
+        std::map<unsigned int, cv::Mat>::iterator it = decoded.find(i);
+        image = it->second;
+        decoded.erase(it);
+        
+        while (current < files.size() && taken[current]) {
+            current++;
+        }
+    }
+    
+    consumed.notify_all();
+    return image;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// work
+////////////////////////////////////////////////////////////////////////////////
+
+void AsyncLoader::work() {
+    while (true) {
+        unsigned int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            consumed.wait(lock, [this]() { 
+                while (next < files.size() && skipped[next]) {
+                    next++;
+                }
+                
+                return stop || next >= files.size() || next < current + queue_size; 
+            });
+            
+            if (stop || next >= files.size()) {
+                return;
+            }
+            
+            index = next++;
+        }
+        
+        // Failures are reported by handing out an empty image, as cv::imread does.
+        cv::Mat image;
+        try {
+            image = BatchServer::readImage(files[index], flags);
+        }
+        catch (...) {
+            image = cv::Mat();
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded[index] = image;
+        }
+        
+        ready.notify_all();
+    }
+}
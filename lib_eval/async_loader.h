@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ASYNC_LOADER_H
+#define	ASYNC_LOADER_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+
+/** \brief Decodes the images of a directory on background threads ahead of
+ * their use, such that decoding overlaps with the segmentation of the 
+ * current image(s). Images are read through BatchServer::readImage and 
+ * decoded in the order of the given map, e.g. as returned by 
+ * IOUtil::readDirectory, at most queue_size images ahead of the first image
+ * not yet handed out. read may be called concurrently (e.g. from 
+ * Benchmark::forEachImage) and in any order; images outside of this window
+ * are read synchronously.
+ * 
+ * Usage in the command line tools, together with AsyncWriter:
+ * \code{cpp}
+ *   AsyncLoader loader(images, load_threads, queue_depth);
+ *   AsyncWriter writer(write_threads, queue_depth);
+ *   for (it = images.begin(); it != images.end(); ++it) {
+ *       cv::Mat image = loader.read(it->first);
+ *       // segment image into labels ...
+ *       writer.writeCSV(csv_file, labels);
+ *   }
+ *   writer.finish();
+ * \endcode
+ * \author David Stutz
+ */
+class AsyncLoader {
+public:
+    /** \brief Constructor, starts decoding the first images.
+     * \param[in] images images to load, only the keys (file names) are used
+     * \param[in] threads number of decoding threads, at least one
+     * \param[in] queue_size maximum number of images decoded ahead, at least one
+     * \param[in] flags flags passed to cv::imread
+     */
+    AsyncLoader(const std::multimap<std::string, boost::filesystem::path> &images,
+            int threads = 1, int queue_size = 4, int flags = CV_LOAD_IMAGE_COLOR);
+    
+    /** \brief Destructor, stops decoding. */
+    ~AsyncLoader();
+    
+    /** \brief Get the given image; waits for it to be decoded if it is
+     * within the decoding window, otherwise it is read synchronously.
+     * \param[in] file image file
+     * \return image
+     */
+    cv::Mat read(const std::string &file);
+    
+private:
+    
+    /** \brief Main loop of the decoding threads. */
+    void work();
+    
+    /** \brief Files to load, in order. */
+    std::vector<std::string> files;
+    /** \brief Index of each file. */
+    std::map<std::string, unsigned int> indices;
+    /** \brief Whether each image was handed out (or is being waited for). */
+    std::vector<bool> taken;
+    /** \brief Whether each image was read synchronously and is not decoded. */
+    std::vector<bool> skipped;
+    /** \brief Decoding threads. */
+    std::vector<std::thread> workers;
+    /** \brief Decoded images by index. */
+    std::map<unsigned int, cv::Mat> decoded;
+    /** \brief Maximum number of images decoded ahead. */
+    unsigned int queue_size;
+    /** \brief Flags passed to cv::imread. */
+    int flags;
+    /** \brief Index of the next image to decode. */
+    unsigned int next;
+    /** \brief Index of the first image not handed out. */
+    unsigned int current;
+    /** \brief Whether the threads should exit. */
+    bool stop;
+    /** \brief Guards decoded, taken, skipped, next, current and stop. */
+    std::mutex mutex;
+    /** \brief Signaled when an image was handed out or stop is set. */
+    std::condition_variable consumed;
+    /** \brief Signaled when an image was decoded. */
+    std::condition_variable ready;
+    
+};
+
+#endif	/* ASYNC_LOADER_H */
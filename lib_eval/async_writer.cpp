@@ -0,0 +1,183 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <glog/logging.h>
+#include "io_util.h"
+#include "visualization.h"
+#include "async_writer.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// AsyncWriter
+////////////////////////////////////////////////////////////////////////////////
+
+AsyncWriter::AsyncWriter(int threads, int queue_size_) 
+        : queue_size(std::max(1, queue_size_)), running(0), stop(false) {
+    
+    for (int t = 0; t < std::max(1, threads); ++t) {
+        workers.push_back(std::thread(&AsyncWriter::work, this));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ~AsyncWriter
+////////////////////////////////////////////////////////////////////////////////
+
+AsyncWriter::~AsyncWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    
+    queued.notify_all();
+    for (unsigned int t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// write
+////////////////////////////////////////////////////////////////////////////////
+
+void AsyncWriter::write(const Job &job) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return jobs.size() < queue_size; });
+        jobs.push_back(job);
+    }
+    
+    queued.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeImage
+////////////////////////////////////////////////////////////////////////////////
+
+void AsyncWriter::writeImage(const boost::filesystem::path &file, 
+        const cv::Mat &image) {
+    
+    cv::Mat image_copy = image.clone();
+    write([file, image_copy]() {
+        LOG_IF(WARNING, !cv::imwrite(file.string(), image_copy)) 
+                << "Could not write " << file.string() << ".";
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeCSV
+////////////////////////////////////////////////////////////////////////////////
+
+void AsyncWriter::writeCSV(const boost::filesystem::path &file, 
+        const cv::Mat &labels) {
+    
+    cv::Mat labels_copy = labels.clone();
+    write([file, labels_copy]() {
+        IOUtil::writeMatCSV<int>(file, labels_copy);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeContours
+////////////////////////////////////////////////////////////////////////////////
+
+void AsyncWriter::writeContours(const boost::filesystem::path &file, 
+        const cv::Mat &image, const cv::Mat &labels, bool eight_connected) {
+    
+    cv::Mat image_copy = image.clone();
+    cv::Mat labels_copy = labels.clone();
+    write([file, image_copy, labels_copy, eight_connected]() {
+        // The writer threads run next to the segmentation, so contours are
+        // drawn on a single thread.
+        cv::Mat image_contours;
+        Visualization::drawContours(image_copy, labels_copy, image_contours, 
+                eight_connected, 1);
+        LOG_IF(WARNING, !cv::imwrite(file.string(), image_contours)) 
+                << "Could not write " << file.string() << ".";
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// finish
+////////////////////////////////////////////////////////////////////////////////
+
+void AsyncWriter::finish() {
+    std::exception_ptr first_error;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return jobs.empty() && running == 0; });
+        std::swap(first_error, error);
+    }
+    
+    if (first_error) {
+        std::rethrow_exception(first_error);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// work
+////////////////////////////////////////////////////////////////////////////////
+
+void AsyncWriter::work() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queued.wait(lock, [this]() { return stop || !jobs.empty(); });
+            
+            if (jobs.empty()) {
+                return;
+            }
+            
+            job = jobs.front();
+            jobs.pop_front();
+            running++;
+        }
+        
+        done.notify_all();
+        
+        std::exception_ptr job_error;
+        try {
+            job();
+        }
+        catch (...) {
+            job_error = std::current_exception();
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+            if (job_error && !error) {
+                error = job_error;
+            }
+        }
+        
+        done.notify_all();
+    }
+}
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef ASYNC_WRITER_H
+#define	ASYNC_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+
+/** \brief Writes results and visualizations on background threads such that
+ * rendering, encoding and disk I/O overlap with the segmentation of the next
+ * image. Jobs are queued in a bounded queue; write blocks while the queue is
+ * full. Matrices are copied when queued, so callers may reuse them
+ * immediately.
+ * 
+ * Usage in the command line tools:
+ * \code{cpp}
+ *   AsyncWriter writer;
+ *   for (...) {
+ *       // segment image into labels ...
+ *       writer.writeCSV(csv_file, labels);
+ *       writer.writeContours(contours_file, image, labels);
+ *   }
+ *   writer.finish();
+ * \endcode
+ * \author David Stutz
+ */
+class AsyncWriter {
+public:
+    /** \brief A job run on one of the writer threads. */
+    typedef std::function<void()> Job;
+    
+    /** \brief Constructor.
+     * \param[in] threads number of writer threads, at least one
+     * \param[in] queue_size maximum number of pending jobs, at least one
+     */
+    AsyncWriter(int threads = 1, int queue_size = 4);
+    
+    /** \brief Destructor, waits for all pending jobs. */
+    ~AsyncWriter();
+    
+    /** \brief Queue a job; blocks while the queue is full.
+     * \param[in] job job to run
+     */
+    void write(const Job &job);
+    
+    /** \brief Queue writing an image, see cv::imwrite.
+     * \param[in] file file to write
+     * \param[in] image image to write
+     */
+    void writeImage(const boost::filesystem::path &file, const cv::Mat &image);
+    
+    /** \brief Queue writing superpixel labels as CSV, see IOUtil::writeMatCSV.
+     * \param[in] file file to write
+     * \param[in] labels superpixel labels
+     */
+    void writeCSV(const boost::filesystem::path &file, const cv::Mat &labels);
+    
+    /** \brief Queue drawing and writing contours, see Visualization::drawContours.
+     * \param[in] file file to write
+     * \param[in] image image to draw contours in
+     * \param[in] labels superpixel labels
+     * \param[in] eight_connected whether to use eight connected graph
+     */
+    void writeContours(const boost::filesystem::path &file, const cv::Mat &image, 
+            const cv::Mat &labels, bool eight_connected = false);
+    
+    /** \brief Wait until all queued jobs are done; rethrows the first 
+     * exception thrown by a job since the last call.
+     */
+    void finish();
+    
+private:
+    
+    /** \brief Main loop of the writer threads. */
+    void work();
+    
+    /** \brief Writer threads. */
+    std::vector<std::thread> workers;
+    /** \brief Pending jobs. */
+    std::deque<Job> jobs;
+    /** \brief Maximum number of pending jobs. */
+    unsigned int queue_size;
+    /** \brief Number of jobs currently running. */
+    int running;
+    /** \brief Whether the threads should exit once the queue is empty. */
+    bool stop;
+    /** \brief First exception thrown by a job. */
+    std::exception_ptr error;
+    /** \brief Guards jobs, running, stop and error. */
+    std::mutex mutex;
+    /** \brief Signaled when jobs are queued or stop is set. */
+    std::condition_variable queued;
+    /** \brief Signaled when a job is taken or done. */
+    std::condition_variable done;
+    
+};
+
+#endif	/* ASYNC_WRITER_H */
@@ -0,0 +1,688 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cerrno>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+#include <glog/logging.h>
+#include "batch_server.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <csignal>
+    #include <unistd.h>
+    #include <sys/stat.h>
+    #include <sys/wait.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+#endif
+
+int BatchServer::worker_pid = -1;
+int BatchServer::worker_input = -1;
+int BatchServer::worker_output = -1;
+bool BatchServer::caching = false;
+size_t BatchServer::cache_capacity = 1024*1024*1024;
+size_t BatchServer::cache_size = 0;
+std::list<BatchServer::CachedImage> BatchServer::cache;
+std::map<std::string, std::list<BatchServer::CachedImage>::iterator> BatchServer::cache_index;
+std::mutex BatchServer::cache_mutex;
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+////////////////////////////////////////////////////////////////////////////////
+
+int BatchServer::main(int argc, const char** argv, Job job) {
+    
+    std::string program = (argc > 0 ? argv[0] : "");
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--batch") == 0) {
+            return serve(program, job, std::cin, std::cout);
+        }
+        
+        if (std::strcmp(argv[i], "--socket") == 0) {
+            if (i + 1 >= argc) {
+                std::cout << "No socket path given." << std::endl;
+                return 1;
+            }
+            
+            return serveSocket(program, job, argv[i + 1]);
+        }
+    }
+    
+    return job(argc, argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// serve
+////////////////////////////////////////////////////////////////////////////////
+
+int BatchServer::serve(const std::string &program, Job job, std::istream &input, 
+        std::ostream &output) {
+    
+    caching = true;
+#if defined(__unix__) || defined(__APPLE__)
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.empty()) {
+            break;
+        }
+        
+        int status = runJobInWorker(program, job, line, std::vector<int>());
+        output << "#done " << status << std::endl;
+    }
+    
+    stopWorker();
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// serveSocket
+////////////////////////////////////////////////////////////////////////////////
+
+int BatchServer::serveSocket(const std::string &program, Job job, 
+        const std::string &socket_path) {
+    
+#if defined(__unix__) || defined(__APPLE__)
+    sockaddr_un address;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        LOG(ERROR) << "Socket path too long: " << socket_path << ".";
+        return 1;
+    }
+    
+    int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server < 0) {
+        LOG(ERROR) << "Could not create socket: " << std::strerror(errno) << ".";
+        return 1;
+    }
+    
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    
+    unlink(socket_path.c_str());
+    if (bind(server, (sockaddr*) &address, sizeof(address)) < 0 || listen(server, 8) < 0) {
+        LOG(ERROR) << "Could not listen on " << socket_path << ": " << std::strerror(errno) << ".";
+        close(server);
+        return 1;
+    }
+    
+    caching = true;
+    signal(SIGPIPE, SIG_IGN);
+    
+    // An empty job line shuts the server down, as with serve.
+    int result = 0;
+    bool running = true;
+    while (running) {
+        int connection = accept(server, NULL, NULL);
+        if (connection < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            
+            LOG(ERROR) << "Could not accept connection: " << std::strerror(errno) << ".";
+            result = 1;
+            break;
+        }
+        
+        // Read job lines from the connection until it is closed.
+        std::string buffer;
+        char chunk[4096];
+        ssize_t read_bytes = 0;
+        while (running && (read_bytes = read(connection, chunk, sizeof(chunk))) > 0) {
+            buffer.append(chunk, read_bytes);
+            
+            size_t end = buffer.find('\n');
+            while (end != std::string::npos) {
+                std::string line = buffer.substr(0, end);
+                buffer.erase(0, end + 1);
+                
+                if (line.empty()) {
+                    std::string response = "#done 0\n";
+                    if (write(connection, response.c_str(), response.size()) < 0) {
+                        LOG(ERROR) << "Could not respond: " << std::strerror(errno) << ".";
+                    }
+                    
+                    running = false;
+                    break;
+                }
+                
+                int status = runJobInWorker(program, job, line, std::vector<int>{server, connection});
+                std::string response = "#done " + std::to_string(status) + "\n";
+                if (write(connection, response.c_str(), response.size()) < 0) {
+                    LOG(ERROR) << "Could not respond: " << std::strerror(errno) << ".";
+                }
+                
+                end = buffer.find('\n');
+            }
+        }
+        
+        close(connection);
+    }
+    
+    stopWorker();
+    close(server);
+    unlink(socket_path.c_str());
+    return result;
+#else
+    LOG(ERROR) << "UNIX sockets are not supported on this platform.";
+    return 1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// submit
+////////////////////////////////////////////////////////////////////////////////
+
+int BatchServer::submit(const std::string &socket_path, const std::string &arguments) {
+    
+#if defined(__unix__) || defined(__APPLE__)
+    sockaddr_un address;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    
+    int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (connection < 0) {
+        return -1;
+    }
+    
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    
+    if (connect(connection, (sockaddr*) &address, sizeof(address)) < 0) {
+        close(connection);
+        return -1;
+    }
+    
+    std::string line = arguments + "\n";
+    size_t written = 0;
+    while (written < line.size()) {
+        ssize_t written_bytes = write(connection, line.c_str() + written, line.size() - written);
+        if (written_bytes <= 0) {
+            close(connection);
+            return -1;
+        }
+        
+        written += written_bytes;
+    }
+    
+    std::string response;
+    char chunk[256];
+    ssize_t read_bytes = 0;
+    while (response.find('\n') == std::string::npos
+            && (read_bytes = read(connection, chunk, sizeof(chunk))) > 0) {
+        response.append(chunk, read_bytes);
+    }
+    
+    close(connection);
+    
+    int status = -1;
+    if (std::sscanf(response.c_str(), "#done %d", &status) != 1) {
+        return -1;
+    }
+    
+    return status;
+#else
+    return -1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// execute
+////////////////////////////////////////////////////////////////////////////////
+
+int BatchServer::execute(const std::string &socket_path, const std::string &command_line) {
+    
+    if (socket_path.empty()) {
+        return system(command_line.c_str());
+    }
+    
+    // The executable is given by the serving tool.
+    size_t begin = command_line.find_first_not_of(" \t");
+    size_t end = command_line.find_first_of(" \t", begin);
+    std::string arguments = (end == std::string::npos ? "" : command_line.substr(end + 1));
+    
+    return submit(socket_path, arguments);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// runJob
+////////////////////////////////////////////////////////////////////////////////
+
+int BatchServer::runJob(const std::string &program, Job job, const std::string &line) {
+    
+    std::vector<std::string> arguments;
+    arguments.push_back(program);
+    tokenize(line, arguments);
+    
+    std::vector<const char*> argv;
+    for (unsigned int i = 0; i < arguments.size(); ++i) {
+        argv.push_back(arguments[i].c_str());
+    }
+    
+    try {
+        return job(argv.size(), argv.data());
+    }
+    catch (const std::exception &e) {
+        LOG(ERROR) << "Job failed (" << line << "): " << e.what();
+        return 1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// runJobInWorker
+////////////////////////////////////////////////////////////////////////////////
+
+int BatchServer::runJobInWorker(const std::string &program, Job job, 
+        const std::string &line, const std::vector<int> &server_fds) {
+    
+#if defined(__unix__) || defined(__APPLE__)
+    if (worker_pid < 0 && !startWorker(program, job, server_fds)) {
+        LOG(ERROR) << "Could not start worker: " << std::strerror(errno) << ".";
+        return 1;
+    }
+    
+    std::string request = line + "\n";
+    int status = 1;
+    if (writeFully(worker_input, request.c_str(), request.size())
+            && readFully(worker_output, (char*) &status, sizeof(status))) {
+        return status;
+    }
+    
+    // The worker died during the job, e.g. on LOG(FATAL); its cache is lost.
+    int worker_status = 0;
+    waitpid(worker_pid, &worker_status, 0);
+    worker_pid = -1;
+    stopWorker();
+    
+    if (WIFSIGNALED(worker_status)) {
+        LOG(ERROR) << "Job failed (" << line << "): worker terminated by signal " 
+                << WTERMSIG(worker_status) << ".";
+    }
+    else {
+        LOG(ERROR) << "Job failed (" << line << "): worker exited.";
+    }
+    
+    return 1;
+#else
+    return runJob(program, job, line);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// startWorker
+////////////////////////////////////////////////////////////////////////////////
+
+bool BatchServer::startWorker(const std::string &program, Job job, 
+        const std::vector<int> &server_fds) {
+    
+#if defined(__unix__) || defined(__APPLE__)
+    int input[2];
+    int output[2];
+    if (pipe(input) < 0) {
+        return false;
+    }
+    
+    if (pipe(output) < 0) {
+        close(input[0]);
+        close(input[1]);
+        return false;
+    }
+    
+    // Buffered output would be written by both processes otherwise.
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(NULL);
+    
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(input[0]);
+        close(input[1]);
+        close(output[0]);
+        close(output[1]);
+        return false;
+    }
+    
+    if (pid == 0) {
+        close(input[1]);
+        close(output[0]);
+        for (unsigned int i = 0; i < server_fds.size(); ++i) {
+            close(server_fds[i]);
+        }
+        
+        std::string buffer;
+        char chunk[4096];
+        while (true) {
+            ssize_t read_bytes = read(input[0], chunk, sizeof(chunk));
+            if (read_bytes < 0 && errno == EINTR) {
+                continue;
+            }
+            
+            if (read_bytes <= 0) {
+                break;
+            }
+            
+            buffer.append(chunk, read_bytes);
+            
+            size_t end = buffer.find('\n');
+            while (end != std::string::npos) {
+                std::string line = buffer.substr(0, end);
+                buffer.erase(0, end + 1);
+                
+                int status = runJob(program, job, line);
+                
+                // The job's output has to precede "#done".
+                std::cout.flush();
+                std::fflush(NULL);
+                
+                if (!writeFully(output[1], (const char*) &status, sizeof(status))) {
+                    _exit(1);
+                }
+                
+                end = buffer.find('\n');
+            }
+        }
+        
+        std::cout.flush();
+        std::fflush(NULL);
+        _exit(0);
+    }
+    
+    close(input[0]);
+    close(output[1]);
+    
+    worker_pid = pid;
+    worker_input = input[1];
+    worker_output = output[0];
+    return true;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// stopWorker
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchServer::stopWorker() {
+    
+#if defined(__unix__) || defined(__APPLE__)
+    // Closing the input lets the worker finish.
+    if (worker_input >= 0) {
+        close(worker_input);
+        worker_input = -1;
+    }
+    
+    if (worker_output >= 0) {
+        close(worker_output);
+        worker_output = -1;
+    }
+    
+    if (worker_pid >= 0) {
+        waitpid(worker_pid, NULL, 0);
+        worker_pid = -1;
+    }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readFully
+////////////////////////////////////////////////////////////////////////////////
+
+bool BatchServer::readFully(int fd, char* data, size_t size) {
+    
+#if defined(__unix__) || defined(__APPLE__)
+    size_t done = 0;
+    while (done < size) {
+        ssize_t read_bytes = read(fd, data + done, size - done);
+        if (read_bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if (read_bytes <= 0) {
+            return false;
+        }
+        
+        done += read_bytes;
+    }
+    
+    return true;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeFully
+////////////////////////////////////////////////////////////////////////////////
+
+bool BatchServer::writeFully(int fd, const char* data, size_t size) {
+    
+#if defined(__unix__) || defined(__APPLE__)
+    size_t done = 0;
+    while (done < size) {
+        ssize_t written_bytes = write(fd, data + done, size - done);
+        if (written_bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        
+        if (written_bytes <= 0) {
+            return false;
+        }
+        
+        done += written_bytes;
+    }
+    
+    return true;
+#else
+    return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// tokenize
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchServer::tokenize(const std::string &line, std::vector<std::string> &arguments) {
+    
+    std::string argument;
+    bool in_argument = false;
+    char quote = '\0';
+    
+    for (unsigned int i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        
+        if (quote != '\0') {
+            if (c == quote) {
+                quote = '\0';
+            }
+            else if (c == '\\' && quote == '"' && i + 1 < line.size()) {
+                argument += line[++i];
+            }
+            else {
+                argument += c;
+            }
+        }
+        else if (c == '"' || c == '\'') {
+            quote = c;
+            in_argument = true;
+        }
+        else if (c == '\\' && i + 1 < line.size()) {
+            argument += line[++i];
+            in_argument = true;
+        }
+        else if (std::isspace(c)) {
+            if (in_argument) {
+                arguments.push_back(argument);
+                argument.clear();
+                in_argument = false;
+            }
+        }
+        else {
+            argument += c;
+            in_argument = true;
+        }
+    }
+    
+    if (in_argument) {
+        arguments.push_back(argument);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readImage
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Mat BatchServer::readImage(const std::string &file, int flags) {
+    return readCached(file, std::to_string(flags), [flags](const std::string &path) {
+        return cv::imread(path, flags);
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readCached
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Mat BatchServer::readCached(const std::string &file, const std::string &tag,
+        const std::function<cv::Mat(const std::string&)> &read) {
+    
+    long long size = 0;
+    long long modified = 0;
+    if (!caching || cache_capacity == 0 || !getFileState(file, size, modified)) {
+        return read(file);
+    }
+    
+    std::string key = file + ":" + tag;
+    
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        
+        std::map<std::string, std::list<CachedImage>::iterator>::iterator it = cache_index.find(key);
+        if (it != cache_index.end()) {
+            if (it->second->size == size && it->second->modified == modified) {
+                cache.splice(cache.begin(), cache, it->second);
+                
+                // Tools may modify the image in place.
+                return cache.front().image.clone();
+            }
+            
+            cache_size -= it->second->image.total()*it->second->image.elemSize();
+            cache.erase(it->second);
+            cache_index.erase(it);
+        }
+    }
+    
+    cv::Mat image = read(file);
+    size_t bytes = image.total()*image.elemSize();
+    if (image.empty() || bytes > cache_capacity) {
+        return image;
+    }
+    
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (cache_index.find(key) != cache_index.end()) {
+        return image;
+    }
+    
+    CachedImage cached;
+    cached.key = key;
+    cached.image = image.clone();
+    cached.size = size;
+    cached.modified = modified;
+    
+    cache.push_front(cached);
+    cache_index[key] = cache.begin();
+    cache_size += bytes;
+    
+    while (cache_size > cache_capacity) {
+        cache_size -= cache.back().image.total()*cache.back().image.elemSize();
+        cache_index.erase(cache.back().key);
+        cache.pop_back();
+    }
+    
+    return image;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setCacheCapacity
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchServer::setCacheCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache_capacity = capacity;
+    
+    while (cache_size > cache_capacity && !cache.empty()) {
+        cache_size -= cache.back().image.total()*cache.back().image.elemSize();
+        cache_index.erase(cache.back().key);
+        cache.pop_back();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// clearCache
+////////////////////////////////////////////////////////////////////////////////
+
+void BatchServer::clearCache() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+    cache_index.clear();
+    cache_size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getFileState
+////////////////////////////////////////////////////////////////////////////////
+
+bool BatchServer::getFileState(const std::string &file, long long &size, long long &modified) {
+    
+#if defined(__unix__) || defined(__APPLE__)
+    struct stat status;
+    if (stat(file.c_str(), &status) != 0) {
+        return false;
+    }
+    
+    size = status.st_size;
+    #if defined(__APPLE__)
+        modified = status.st_mtimespec.tv_sec*1000000000LL + status.st_mtimespec.tv_nsec;
+    #else
+        modified = status.st_mtim.tv_sec*1000000000LL + status.st_mtim.tv_nsec;
+    #endif
+    
+    return true;
+#else
+    return false;
+#endif
+}
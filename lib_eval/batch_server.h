@@ -0,0 +1,255 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BATCH_SERVER_H
+#define	BATCH_SERVER_H
+
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+
+/** \brief Batch mode shared by the command line tools; keeps the tool
+ * resident and runs jobs read line by line from stdin or from a local UNIX
+ * socket. Each job line holds the arguments of a single invocation of the 
+ * tool (without the executable), e.g.
+ * \code{sh}
+ *   $ ../bin/slic_cli --batch
+ *   -i data/images -o output/400 --superpixels 400
+ *   #done 0
+ *   -i data/images -o output/800 --superpixels 800
+ *   #done 0
+ * \endcode
+ * After each job, "#done <status>" is written to stdout (or the socket), where
+ * status is the return value of the job. While serving, jobs run in a forked
+ * worker process: if a job aborts (e.g. on LOG(FATAL) for a missing directory)
+ * or crashes, it is reported as "#done 1" and a new worker is started for the
+ * next job. Images read through readImage (and
+ * data derived from files through readCached) are cached in the worker 
+ * between jobs such that repeated jobs on the same images do not decode them 
+ * again.
+ * 
+ * Usage in the command line tools:
+ * \code{cpp}
+ *   int run(int argc, const char** argv) {
+ *       // parse options and process images using BatchServer::readImage ...
+ *   }
+ *   
+ *   int main(int argc, const char** argv) {
+ *       return BatchServer::main(argc, argv, run);
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class BatchServer {
+public:
+    /** \brief A job, i.e. the main function of a command line tool. */
+    typedef int (*Job)(int argc, const char** argv);
+    
+    /** \brief Run the job once using the given arguments or, if --batch or
+     * --socket <path> is given, serve jobs from stdin or the given socket.
+     * \param[in] argc number of arguments
+     * \param[in] argv arguments
+     * \param[in] job job to run
+     * \return return value of the job, or 0 after serving all jobs
+     */
+    static int main(int argc, const char** argv, Job job);
+    
+    /** \brief Serve jobs read line by line from input until input ends or
+     * an empty line is read.
+     * \param[in] program name of the program, used as first argument of all jobs
+     * \param[in] job job to run
+     * \param[in] input stream to read job lines from
+     * \param[in] output stream to write "#done <status>" to
+     * \return 0
+     */
+    static int serve(const std::string &program, Job job, std::istream &input, 
+            std::ostream &output);
+    
+    /** \brief Serve jobs from a UNIX socket; connections are handled one after
+     * another, each connection may send several job lines. An empty job line
+     * shuts the server down.
+     * \param[in] program name of the program, used as first argument of all jobs
+     * \param[in] job job to run
+     * \param[in] socket_path path of the socket to create
+     * \return 0 if the server was shut down by an empty line, 1 on errors
+     */
+    static int serveSocket(const std::string &program, Job job, 
+            const std::string &socket_path);
+    
+    /** \brief Send a job to a tool serving jobs on the given socket and wait
+     * for it to finish.
+     * \param[in] socket_path path of the socket
+     * \param[in] arguments arguments of the job, i.e. the command line without executable
+     * \return status of the job, or -1 if the server could not be reached
+     */
+    static int submit(const std::string &socket_path, const std::string &arguments);
+    
+    /** \brief Run the given command line using system() or, if a socket is
+     * given, submit it (without the executable) to the tool serving jobs on
+     * that socket.
+     * \param[in] socket_path path of the socket, empty to use system()
+     * \param[in] command_line command line to run
+     * \return status of the command line, 0 on success
+     */
+    static int execute(const std::string &socket_path, const std::string &command_line);
+    
+    /** \brief Run a single job line.
+     * \param[in] program name of the program, used as first argument
+     * \param[in] job job to run
+     * \param[in] line job line
+     * \return return value of the job, 1 if the job threw an exception
+     */
+    static int runJob(const std::string &program, Job job, const std::string &line);
+    
+    /** \brief Split a line into arguments at whitespace; single and double
+     * quotes as well as backslashes can be used to escape whitespace.
+     * \param[in] line line to split
+     * \param[out] arguments arguments
+     */
+    static void tokenize(const std::string &line, std::vector<std::string> &arguments);
+    
+    /** \brief Read an image, see cv::imread; when serving jobs, decoded images
+     * are cached until the file changes.
+     * \param[in] file image file
+     * \param[in] flags flags passed to cv::imread
+     * \return image, empty if the image could not be read
+     */
+    static cv::Mat readImage(const std::string &file, int flags = CV_LOAD_IMAGE_COLOR);
+    
+    /** \brief Read data derived from a file, e.g. a point cloud computed from
+     * a depth image; when serving jobs, the result is cached alongside the 
+     * images until the file changes.
+     * \param[in] file file the data is derived from
+     * \param[in] tag identifies the derivation, e.g. its parameters
+     * \param[in] read reads and derives the data given the file
+     * \return data, empty if the file could not be read
+     */
+    static cv::Mat readCached(const std::string &file, const std::string &tag,
+            const std::function<cv::Mat(const std::string&)> &read);
+    
+    /** \brief Set the maximum size of the image cache.
+     * \param[in] capacity maximum size in bytes, 0 disables caching
+     */
+    static void setCacheCapacity(size_t capacity);
+    
+    /** \brief Remove all images from the cache. */
+    static void clearCache();
+    
+private:
+    
+    /** \brief A decoded image together with the file state it was read from. */
+    struct CachedImage {
+        /** \brief Cache key, i.e. file and flags or tag. */
+        std::string key;
+        /** \brief Decoded image. */
+        cv::Mat image;
+        /** \brief File size when the image was read. */
+        long long size;
+        /** \brief Modification time (in nanoseconds) when the image was read. */
+        long long modified;
+    };
+    
+    /** \brief Run a job line in the worker process, starting the worker if
+     * necessary; if the worker terminates during the job, the job fails and
+     * the next job starts a new worker.
+     * \param[in] program name of the program, used as first argument
+     * \param[in] job job to run
+     * \param[in] line job line
+     * \param[in] server_fds descriptors of the server the worker has to close
+     * \return return value of the job, 1 if the worker terminated
+     */
+    static int runJobInWorker(const std::string &program, Job job, 
+            const std::string &line, const std::vector<int> &server_fds);
+    
+    /** \brief Fork the worker process which runs the job lines written to
+     * worker_input and answers with their status on worker_output.
+     * \param[in] program name of the program, used as first argument
+     * \param[in] job job to run
+     * \param[in] server_fds descriptors of the server the worker has to close
+     * \return whether the worker was started
+     */
+    static bool startWorker(const std::string &program, Job job, 
+            const std::vector<int> &server_fds);
+    
+    /** \brief Let the worker process finish and wait for it. */
+    static void stopWorker();
+    
+    /** \brief Read exactly the given number of bytes.
+     * \param[in] fd descriptor to read from
+     * \param[out] data buffer to read to
+     * \param[in] size number of bytes to read
+     * \return whether all bytes were read
+     */
+    static bool readFully(int fd, char* data, size_t size);
+    
+    /** \brief Write exactly the given number of bytes.
+     * \param[in] fd descriptor to write to
+     * \param[in] data data to write
+     * \param[in] size number of bytes to write
+     * \return whether all bytes were written
+     */
+    static bool writeFully(int fd, const char* data, size_t size);
+    
+    /** \brief Get size and modification time of the file.
+     * \param[in] file file to check
+     * \param[out] size file size
+     * \param[out] modified modification time in nanoseconds
+     * \return whether the file exists
+     */
+    static bool getFileState(const std::string &file, long long &size, long long &modified);
+    
+    /** \brief Process id of the worker, -1 if not running. */
+    static int worker_pid;
+    /** \brief Pipe to write job lines to the worker. */
+    static int worker_input;
+    /** \brief Pipe to read job status from the worker. */
+    static int worker_output;
+    
+    /** \brief Whether images are cached. */
+    static bool caching;
+    /** \brief Maximum size of cached images in bytes. */
+    static size_t cache_capacity;
+    /** \brief Current size of cached images in bytes. */
+    static size_t cache_size;
+    /** \brief Cached images, most recently used first. */
+    static std::list<CachedImage> cache;
+    /** \brief Cached images by key. */
+    static std::map<std::string, std::list<CachedImage>::iterator> cache_index;
+    /** \brief Guards the cache. */
+    static std::mutex cache_mutex;
+};
+
+#endif	/* BATCH_SERVER_H */
@@ -0,0 +1,401 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <glog/logging.h>
+#include "benchmark.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/resource.h>
+    #include <time.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// Benchmark
+////////////////////////////////////////////////////////////////////////////////
+
+Benchmark::Benchmark(int warm_up_, int repeat_) 
+        : warm_up(std::max(0, warm_up_)), repeats(std::max(1, repeat_)),
+        image_running(false), phase_running(false), phase(LOAD), 
+        weight(1), thread_cpu(false), repeating(false), run(0) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// startImage
+////////////////////////////////////////////////////////////////////////////////
+
+void Benchmark::startImage(const std::string &name) {
+    if (image_running) {
+        stopImage();
+    }
+    
+    Record record;
+    record.name = name;
+    record.peak_rss = 0;
+    
+    for (int p = 0; p < NUM_PHASES; ++p) {
+        record.wall[p] = 0;
+        record.cpu[p] = 0;
+    }
+    
+    records.push_back(record);
+    image_running = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// startPhase
+////////////////////////////////////////////////////////////////////////////////
+
+void Benchmark::startPhase(Phase phase_) {
+    LOG_IF(FATAL, !image_running) << "startImage has to be called first.";
+    LOG_IF(FATAL, phase_ < 0 || phase_ >= NUM_PHASES) << "Invalid phase.";
+    
+    stopPhase();
+    
+    phase = phase_;
+    weight = 1;
+    repeating = false;
+    phase_running = true;
+    
+    cpu_start = getCurrentCPUTime();
+    wall_start = std::chrono::steady_clock::now();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// stopPhase
+////////////////////////////////////////////////////////////////////////////////
+
+void Benchmark::stopPhase() {
+    if (!phase_running) {
+        return;
+    }
+    
+    std::chrono::steady_clock::time_point wall_end = std::chrono::steady_clock::now();
+    double cpu_end = getCurrentCPUTime();
+    
+    Record &record = records.back();
+    record.wall[phase] += weight*std::chrono::duration<double>(wall_end - wall_start).count();
+    record.cpu[phase] += weight*(cpu_end - cpu_start);
+    
+    phase_running = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// repeat
+////////////////////////////////////////////////////////////////////////////////
+
+bool Benchmark::repeat(Phase phase_) {
+    if (phase_running && repeating && phase == phase_) {
+        stopPhase();
+        ++run;
+    }
+    else {
+        LOG_IF(FATAL, !image_running) << "startImage has to be called first.";
+        stopPhase();
+        run = 0;
+    }
+    
+    if (run >= warm_up + repeats) {
+        repeating = false;
+        return false;
+    }
+    
+    startPhase(phase_);
+    weight = (run < warm_up) ? 0 : 1./repeats;
+    repeating = true;
+    
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// stopImage
+////////////////////////////////////////////////////////////////////////////////
+
+void Benchmark::stopImage() {
+    if (!image_running) {
+        return;
+    }
+    
+    stopPhase();
+    records.back().peak_rss = getPeakRSS();
+    image_running = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// append
+////////////////////////////////////////////////////////////////////////////////
+
+void Benchmark::append(const Benchmark &other) {
+    LOG_IF(FATAL, image_running) << "stopImage has to be called first.";
+    records.insert(records.end(), other.records.begin(), other.records.end());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getWallTime
+////////////////////////////////////////////////////////////////////////////////
+
+double Benchmark::getWallTime(Phase phase) const {
+    LOG_IF(FATAL, records.empty()) << "No images benchmarked.";
+    return records.back().wall[phase];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCPUTime
+////////////////////////////////////////////////////////////////////////////////
+
+double Benchmark::getCPUTime(Phase phase) const {
+    LOG_IF(FATAL, records.empty()) << "No images benchmarked.";
+    return records.back().cpu[phase];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getAverageWallTime
+////////////////////////////////////////////////////////////////////////////////
+
+double Benchmark::getAverageWallTime(Phase phase) const {
+    if (records.empty()) {
+        return 0;
+    }
+    
+    double total = 0;
+    for (unsigned int i = 0; i < records.size(); ++i) {
+        total += records[i].wall[phase];
+    }
+    
+    return total/records.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getAverageCPUTime
+////////////////////////////////////////////////////////////////////////////////
+
+double Benchmark::getAverageCPUTime(Phase phase) const {
+    if (records.empty()) {
+        return 0;
+    }
+    
+    double total = 0;
+    for (unsigned int i = 0; i < records.size(); ++i) {
+        total += records[i].cpu[phase];
+    }
+    
+    return total/records.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getNumImages
+////////////////////////////////////////////////////////////////////////////////
+
+int Benchmark::getNumImages() const {
+    return records.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeCSV
+////////////////////////////////////////////////////////////////////////////////
+
+void Benchmark::writeCSV(boost::filesystem::path file) const {
+    std::ofstream file_stream(file.string().c_str());
+    LOG_IF(FATAL, !file_stream) << "Could not open " << file.string() << ".";
+    
+    file_stream << "image";
+    for (int p = 0; p < NUM_PHASES; ++p) {
+        file_stream << "," << getPhaseName((Phase) p) << "_wall," 
+                << getPhaseName((Phase) p) << "_cpu";
+    }
+    file_stream << ",total_wall,total_cpu,peak_rss_kb\n";
+    
+    file_stream << std::setprecision(6) << std::fixed;
+    for (unsigned int i = 0; i < records.size(); ++i) {
+        double total_wall = 0;
+        double total_cpu = 0;
+        
+        file_stream << escapeCSV(records[i].name);
+        for (int p = 0; p < NUM_PHASES; ++p) {
+            file_stream << "," << records[i].wall[p] << "," << records[i].cpu[p];
+            total_wall += records[i].wall[p];
+            total_cpu += records[i].cpu[p];
+        }
+        
+        file_stream << "," << total_wall << "," << total_cpu << "," 
+                << records[i].peak_rss << "\n";
+    }
+    
+    file_stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// escapeCSV
+////////////////////////////////////////////////////////////////////////////////
+
+std::string Benchmark::escapeCSV(const std::string &str) {
+    if (str.find_first_of(",\"\r\n") == std::string::npos) {
+        return str;
+    }
+    
+    std::string escaped = "\"";
+    for (unsigned int i = 0; i < str.size(); ++i) {
+        if (str[i] == '"') {
+            escaped += '"';
+        }
+        
+        escaped += str[i];
+    }
+    
+    return escaped + "\"";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// escapeJSON
+////////////////////////////////////////////////////////////////////////////////
+
+std::string Benchmark::escapeJSON(const std::string &str) {
+    std::string escaped = "\"";
+    for (unsigned int i = 0; i < str.size(); ++i) {
+        if (str[i] == '"' || str[i] == '\\') {
+            escaped += '\\';
+        }
+        
+        escaped += str[i];
+    }
+    
+    return escaped + "\"";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeJSON
+////////////////////////////////////////////////////////////////////////////////
+
+void Benchmark::writeJSON(boost::filesystem::path file) const {
+    std::ofstream file_stream(file.string().c_str());
+    LOG_IF(FATAL, !file_stream) << "Could not open " << file.string() << ".";
+    
+    long peak_rss = 0;
+    for (unsigned int i = 0; i < records.size(); ++i) {
+        peak_rss = std::max(peak_rss, records[i].peak_rss);
+    }
+    
+    file_stream << std::setprecision(6) << std::fixed;
+    file_stream << "{\n";
+    file_stream << "  \"warm_up\": " << warm_up << ",\n";
+    file_stream << "  \"repeat\": " << repeats << ",\n";
+    file_stream << "  \"cpu_clock\": \"" << (thread_cpu ? "thread" : "process") << "\",\n";
+    file_stream << "  \"images\": " << records.size() << ",\n";
+    file_stream << "  \"peak_rss_kb\": " << peak_rss << ",\n";
+    
+    file_stream << "  \"average\": {";
+    for (int p = 0; p < NUM_PHASES; ++p) {
+        file_stream << (p > 0 ? ", " : "") << "\"" << getPhaseName((Phase) p) 
+                << "\": {\"wall\": " << getAverageWallTime((Phase) p) 
+                << ", \"cpu\": " << getAverageCPUTime((Phase) p) << "}";
+    }
+    file_stream << "},\n";
+    
+    file_stream << "  \"per_image\": [";
+    for (unsigned int i = 0; i < records.size(); ++i) {
+        file_stream << (i > 0 ? "," : "") << "\n    {\"image\": " 
+                << escapeJSON(records[i].name);
+        
+        for (int p = 0; p < NUM_PHASES; ++p) {
+            file_stream << ", \"" << getPhaseName((Phase) p) << "\": {\"wall\": " 
+                    << records[i].wall[p] << ", \"cpu\": " << records[i].cpu[p] << "}";
+        }
+        
+        file_stream << ", \"peak_rss_kb\": " << records[i].peak_rss << "}";
+    }
+    file_stream << "\n  ]\n";
+    file_stream << "}\n";
+    
+    file_stream.close();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getPhaseName
+////////////////////////////////////////////////////////////////////////////////
+
+const char* Benchmark::getPhaseName(Phase phase) {
+    switch (phase) {
+        case LOAD:
+            return "load";
+        case CONVERSION:
+            return "conversion";
+        case SEGMENTATION:
+            return "segmentation";
+        case POST_PROCESSING:
+            return "post_processing";
+        case WRITE:
+            return "write";
+        default:
+            return "unknown";
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getPeakRSS
+////////////////////////////////////////////////////////////////////////////////
+
+long Benchmark::getPeakRSS() {
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    
+    #if defined(__APPLE__)
+        // ru_maxrss is given in bytes on OS X.
+        return usage.ru_maxrss/1024;
+    #else
+        return usage.ru_maxrss;
+    #endif
+#else
+    return 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCurrentCPUTime
+////////////////////////////////////////////////////////////////////////////////
+
+double Benchmark::getCurrentCPUTime() const {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    // std::clock measures the whole process, which would include concurrently
+    // processed images.
+    struct timespec time;
+    if (thread_cpu && clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0) {
+        return time.tv_sec + time.tv_nsec/1e9;
+    }
+#endif
+    
+    return ((double) std::clock())/CLOCKS_PER_SEC;
+}
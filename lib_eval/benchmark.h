@@ -0,0 +1,314 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BENCHMARK_H
+#define	BENCHMARK_H
+
+#include <ctime>
+#include <chrono>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "parallel_util.h"
+
+/** \brief Benchmark harness shared by the command line tools; records wall
+ * time, CPU time and peak resident set size per image, split into the
+ * phases of the tools (loading, color conversion, segmentation, 
+ * post-processing and writing).
+ * 
+ * The segmentation phase can be repeated: the first warm_up runs are 
+ * discarded and the time of the phase is the average over the following 
+ * repeat runs. The remaining phases are timed once and accumulate if
+ * started several times for the same image.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   Benchmark benchmark(warm_up, repeat);
+ *   benchmark.startImage(name);
+ *   benchmark.startPhase(Benchmark::LOAD);
+ *   cv::Mat image = cv::imread(file);
+ *   while (benchmark.repeat(Benchmark::SEGMENTATION)) {
+ *       // compute superpixels ...
+ *   }
+ *   benchmark.startPhase(Benchmark::WRITE);
+ *   // write labels ...
+ *   benchmark.stopImage();
+ *   benchmark.writeCSV(output_dir / "benchmark.csv");
+ * \endcode
+ * 
+ * To process several images concurrently, see forEachImage.
+ * \author David Stutz
+ */
+class Benchmark {
+public:
+    /** \brief Phases of the command line tools. */
+    enum Phase {
+        LOAD = 0,
+        CONVERSION,
+        SEGMENTATION,
+        POST_PROCESSING,
+        WRITE,
+        NUM_PHASES
+    };
+    
+    /** \brief Constructor.
+     * \param[in] warm_up number of discarded segmentation runs per image
+     * \param[in] repeat number of timed segmentation runs per image, at least one
+     */
+    Benchmark(int warm_up = 0, int repeat = 1);
+    
+    /** \brief Start benchmarking a new image; stops the previous image if 
+     * necessary.
+     * \param[in] name name of the image
+     */
+    void startImage(const std::string &name);
+    
+    /** \brief Start timing the given phase; stops the current phase.
+     * \param[in] phase phase to start
+     */
+    void startPhase(Phase phase);
+    
+    /** \brief Stop timing the current phase. */
+    void stopPhase();
+    
+    /** \brief Loop condition for timing warm_up + repeat runs of the given
+     * phase, i.e. while (benchmark.repeat(Benchmark::SEGMENTATION)) { ... }.
+     * \param[in] phase phase to repeat
+     * \return whether another run is to be done
+     */
+    bool repeat(Phase phase);
+    
+    /** \brief Stop benchmarking the current image and record peak resident
+     * set size.
+     */
+    void stopImage();
+    
+    /** \brief Call f(it, benchmark) for all images, processing up to jobs 
+     * images concurrently. For jobs > 1, every image is timed by its own
+     * Benchmark passed to f, and the records are appended in the order of 
+     * the images once all images are done; f then has to be thread safe and
+     * the first exception thrown by f is rethrown. For jobs > 1, CPU times
+     * are measured for the thread processing the image, so they are not 
+     * affected by the concurrently processed images but do not include
+     * threads started by the algorithm; otherwise, the CPU time of the process
+     * is used. The peak resident set size is always measured per process.
+     * \param[in] images images, e.g. as returned by IOUtil::readDirectory
+     * \param[in] jobs number of concurrent images, <= 0 for all hardware threads
+     * \param[in] f function to call for each image
+     */
+    template<typename F>
+    void forEachImage(const std::multimap<std::string, boost::filesystem::path> &images,
+            int jobs, F f);
+    
+    /** \brief Append the records of another benchmark, e.g. of a single image.
+     * \param[in] other benchmark to append
+     */
+    void append(const Benchmark &other);
+    
+    /** \brief Get the wall time of the given phase for the last image.
+     * \param[in] phase phase
+     * \return wall time in seconds
+     */
+    double getWallTime(Phase phase) const;
+    
+    /** \brief Get the CPU time of the given phase for the last image; this
+     * is the CPU time of the process, including threads started within the
+     * phase, or of the thread processing the image if images are processed
+     * concurrently, see forEachImage.
+     * \param[in] phase phase
+     * \return CPU time in seconds
+     */
+    double getCPUTime(Phase phase) const;
+    
+    /** \brief Get the average wall time of the given phase over all images.
+     * \param[in] phase phase
+     * \return average wall time in seconds
+     */
+    double getAverageWallTime(Phase phase) const;
+    
+    /** \brief Get the average CPU time of the given phase over all images.
+     * \param[in] phase phase
+     * \return average CPU time in seconds
+     */
+    double getAverageCPUTime(Phase phase) const;
+    
+    /** \brief Get the number of benchmarked images.
+     * \return number of images
+     */
+    int getNumImages() const;
+    
+    /** \brief Write one line per image with wall and CPU time per phase and
+     * peak resident set size.
+     * \param[in] file path to CSV file
+     */
+    void writeCSV(boost::filesystem::path file) const;
+    
+    /** \brief Write settings, per image measurements and averages as JSON.
+     * \param[in] file path to JSON file
+     */
+    void writeJSON(boost::filesystem::path file) const;
+    
+    /** \brief Get the name of a phase as used in CSV and JSON files.
+     * \param[in] phase phase
+     * \return name
+     */
+    static const char* getPhaseName(Phase phase);
+    
+    /** \brief Get the peak resident set size of the process so far.
+     * \return peak resident set size in kilobytes, 0 if not available
+     */
+    static long getPeakRSS();
+    
+private:
+    
+    /** \brief Get the current CPU time of the process or, if thread_cpu
+     * is set and available, of the calling thread.
+     * \return CPU time in seconds
+     */
+    double getCurrentCPUTime() const;
+    
+    /** \brief Escape a string for use in CSV, i.e. quote it if it contains
+     * commas, quotes or line breaks.
+     * \param[in] str string to escape
+     * \return escaped string
+     */
+    static std::string escapeCSV(const std::string &str);
+    
+    /** \brief Escape a string for use in JSON.
+     * \param[in] str string to escape
+     * \return escaped string including quotes
+     */
+    static std::string escapeJSON(const std::string &str);
+    
+    /** \brief Measurements of a single image. */
+    struct Record {
+        /** \brief Name of the image. */
+        std::string name;
+        /** \brief Wall time per phase in seconds. */
+        double wall[NUM_PHASES];
+        /** \brief CPU time per phase in seconds. */
+        double cpu[NUM_PHASES];
+        /** \brief Peak resident set size in kilobytes after the image. */
+        long peak_rss;
+    };
+    
+    /** \brief Number of discarded runs. */
+    int warm_up;
+    /** \brief Number of timed runs. */
+    int repeats;
+    /** \brief Measurements, the last one is the current image. */
+    std::vector<Record> records;
+    /** \brief Whether an image is being benchmarked. */
+    bool image_running;
+    /** \brief Whether a phase is being timed. */
+    bool phase_running;
+    /** \brief Current phase. */
+    Phase phase;
+    /** \brief Weight of the current measurement, 1 for single phases, 
+     * 1/repeat for timed runs and 0 for warm up runs. */
+    double weight;
+    /** \brief Whether CPU time is measured for the calling thread only. */
+    bool thread_cpu;
+    /** \brief Whether the current phase is repeated. */
+    bool repeating;
+    /** \brief Index of the current run. */
+    int run;
+    /** \brief Wall clock at start of the current phase. */
+    std::chrono::steady_clock::time_point wall_start;
+    /** \brief CPU time in seconds at start of the current phase. */
+    double cpu_start;
+    
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// forEachImage
+////////////////////////////////////////////////////////////////////////////////
+
+template<typename F>
+void Benchmark::forEachImage(const std::multimap<std::string, boost::filesystem::path> &images,
+        int jobs, F f) {
+    
+    typedef std::multimap<std::string, boost::filesystem::path>::const_iterator Iterator;
+    
+    jobs = ParallelUtil::getNumThreads(jobs);
+    if (jobs <= 1) {
+        for (Iterator it = images.begin(); it != images.end(); ++it) {
+            f(it, *this);
+        }
+        
+        return;
+    }
+    
+    std::vector<Iterator> iterators;
+    for (Iterator it = images.begin(); it != images.end(); ++it) {
+        iterators.push_back(it);
+    }
+    
+    // Images are processed concurrently, so only the CPU time of the thread
+    // processing an image can be attributed to it.
+    thread_cpu = true;
+    std::vector<Benchmark> benchmarks(iterators.size(), Benchmark(warm_up, repeats));
+    for (unsigned int i = 0; i < benchmarks.size(); ++i) {
+        benchmarks[i].thread_cpu = true;
+    }
+    
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    
+    ParallelUtil::parallelFor(0, static_cast<int>(iterators.size()), jobs, [&iterators, &benchmarks, 
+            &error, &error_mutex, &f](int i) {
+        
+        try {
+            f(iterators[i], benchmarks[i]);
+            benchmarks[i].stopImage();
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    });
+    
+    for (unsigned int i = 0; i < benchmarks.size(); ++i) {
+        append(benchmarks[i]);
+    }
+    
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif	/* BENCHMARK_H */
+
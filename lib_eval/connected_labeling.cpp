@@ -0,0 +1,267 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <glog/logging.h>
+#include "parallel_util.h"
+#include "connected_labeling.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// ConnectedLabeling
+////////////////////////////////////////////////////////////////////////////////
+
+ConnectedLabeling::ConnectedLabeling(bool eight_connected_, int threads_) 
+        : eight_connected(eight_connected_), 
+        threads(ParallelUtil::getNumThreads(threads_)),
+        ignore(false), ignore_value(0) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setIgnoreValue
+////////////////////////////////////////////////////////////////////////////////
+
+void ConnectedLabeling::setIgnoreValue(int value) {
+    ignore = true;
+    ignore_value = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getComponentValues
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<int>& ConnectedLabeling::getComponentValues() const {
+    return values;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// find
+////////////////////////////////////////////////////////////////////////////////
+
+int ConnectedLabeling::find(int p) {
+    int root = p;
+    while (parent[root] != root) {
+        root = parent[root];
+    }
+    
+    while (parent[p] != root) {
+        int next = parent[p];
+        parent[p] = root;
+        p = next;
+    }
+    
+    return root;
+}
+
+int ConnectedLabeling::findConst(int p) const {
+    while (parent[p] != p) {
+        p = parent[p];
+    }
+    
+    return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// merge
+////////////////////////////////////////////////////////////////////////////////
+
+void ConnectedLabeling::merge(int p, int q) {
+    p = find(p);
+    q = find(q);
+    
+    // Keeping the smaller index as root makes the root the first pixel of
+    // the component in raster order.
+    if (p < q) {
+        parent[q] = p;
+    }
+    else if (q < p) {
+        parent[p] = q;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// label
+////////////////////////////////////////////////////////////////////////////////
+
+int ConnectedLabeling::label(const cv::Mat &image, cv::Mat &components) {
+    LOG_IF(FATAL, image.type() != CV_32SC1) << "Invalid image type.";
+    
+    const int rows = image.rows;
+    const int cols = image.cols;
+    
+    components.create(rows, cols, CV_32SC1);
+    parent.resize(rows*cols);
+    values.clear();
+    
+    if (rows == 0 || cols == 0) {
+        return 0;
+    }
+    
+    // Strips should be large enough to make the border merging negligible.
+    const int strips = std::max(1, std::min(threads, rows/32));
+    
+    // All phases run on the same threads, separated by barriers.
+    ParallelUtil::Barrier barrier(strips);
+    std::vector<int> strip_roots(strips, 0);
+    
+    ParallelUtil::parallelStrips(rows, strips, [this, &image, &components, 
+            &strip_roots, &barrier, rows, cols, strips](int strip, int row_begin, 
+            int row_end) {
+        
+        // 1. Label each strip on its own; only parent entries within the 
+        // strip are touched, so strips do not interfere. Afterwards, each 
+        // pixel points directly to its strip-local root.
+        for (int i = row_begin; i < row_end; ++i) {
+            const int* row = image.ptr<int>(i);
+            const int* last_row = (i > row_begin ? image.ptr<int>(i - 1) : 0);
+            
+            for (int j = 0; j < cols; ++j) {
+                const int p = i*cols + j;
+                
+                if (ignore && row[j] == ignore_value) {
+                    parent[p] = -1;
+                    continue;
+                }
+                
+                parent[p] = p;
+                
+                if (j > 0 && row[j - 1] == row[j]) {
+                    merge(p, p - 1);
+                }
+                
+                if (last_row != 0) {
+                    if (last_row[j] == row[j]) {
+                        merge(p, p - cols);
+                    }
+                    
+                    if (eight_connected) {
+                        if (j > 0 && last_row[j - 1] == row[j]) {
+                            merge(p, p - cols - 1);
+                        }
+                        
+                        if (j + 1 < cols && last_row[j + 1] == row[j]) {
+                            merge(p, p - cols + 1);
+                        }
+                    }
+                }
+            }
+        }
+        
+        for (int p = row_begin*cols; p < row_end*cols; ++p) {
+            if (parent[p] >= 0) {
+                parent[p] = find(p);
+            }
+        }
+        
+        barrier.wait();
+        
+        // 2. Merge along the strip borders; the merges may touch any strip,
+        // so this is done by a single thread.
+        if (strip == 0) {
+            for (int s = 1; s < strips; ++s) {
+                const int i = ParallelUtil::getStripBegin(rows, strips, s);
+                const int* row = image.ptr<int>(i);
+                const int* last_row = image.ptr<int>(i - 1);
+
+                for (int j = 0; j < cols; ++j) {
+                    const int p = i*cols + j;
+                    if (parent[p] < 0) {
+                        continue;
+                    }
+
+                    if (last_row[j] == row[j]) {
+                        merge(p, p - cols);
+                    }
+
+                    if (eight_connected) {
+                        if (j > 0 && last_row[j - 1] == row[j]) {
+                            merge(p, p - cols - 1);
+                        }
+
+                        if (j + 1 < cols && last_row[j + 1] == row[j]) {
+                            merge(p, p - cols + 1);
+                        }
+                    }
+                }
+            }
+        }
+        
+        barrier.wait();
+        
+        // 3. Number the roots strip by strip, then let all other pixels look
+        // up the number of their root. The tree is not modified any more, so
+        // the lookups of different strips do not interfere.
+        int* components_ptr = components.ptr<int>(0);
+        for (int p = row_begin*cols; p < row_end*cols; ++p) {
+            if (parent[p] == p) {
+                strip_roots[strip]++;
+            }
+        }
+        
+        barrier.wait();
+        
+        int offset = 0;
+        for (int s = 0; s < strip; ++s) {
+            offset += strip_roots[s];
+        }
+        
+        if (strip == strips - 1) {
+            values.resize(offset + strip_roots[strip]);
+        }
+        
+        barrier.wait();
+        
+        for (int i = row_begin; i < row_end; ++i) {
+            const int* row = image.ptr<int>(i);
+            int* components_row = components.ptr<int>(i);
+            
+            for (int j = 0; j < cols; ++j) {
+                if (parent[i*cols + j] == i*cols + j) {
+                    components_row[j] = offset++;
+                    values[components_row[j]] = row[j];
+                }
+            }
+        }
+        
+        barrier.wait();
+        
+        for (int p = row_begin*cols; p < row_end*cols; ++p) {
+            if (parent[p] < 0) {
+                components_ptr[p] = -1;
+            }
+            else if (parent[p] != p) {
+                components_ptr[p] = components_ptr[findConst(p)];
+            }
+        }
+    });
+    
+    const int count = values.size();
+    return count;
+}
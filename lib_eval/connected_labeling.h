@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CONNECTED_LABELING_H
+#define	CONNECTED_LABELING_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Union-find connected component labeling of int images (pixels are
+ * connected if they have the same value), as done by ConnectedComponents,
+ * but with the image split into row strips which are labeled in parallel
+ * and merged along the strip borders afterwards. All phases run on the same
+ * threads.
+ * 
+ * Components are numbered 0, 1, ... in raster order of their first pixel,
+ * independent of the number of threads. The union-find buffer is kept
+ * between calls, so one instance should be reused for many images.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   ConnectedLabeling labeling;
+ *   cv::Mat components;
+ *   int count = labeling.label(labels, components);
+ * \endcode
+ * \author David Stutz
+ */
+class ConnectedLabeling {
+public:
+    /** \brief Constructor.
+     * \param[in] eight_connected whether to use 8-connectivity instead of 4-connectivity
+     * \param[in] threads number of strips/threads, <= 0 for all hardware threads
+     */
+    ConnectedLabeling(bool eight_connected = false, int threads = 1);
+    
+    /** \brief Pixels with the given value are not labeled and get label -1
+     * in the component image.
+     * \param[in] value value to ignore
+     */
+    void setIgnoreValue(int value);
+    
+    /** \brief Label connected components.
+     * \param[in] image image of type CV_32SC1
+     * \param[out] components component labels of type CV_32SC1
+     * \return number of components
+     */
+    int label(const cv::Mat &image, cv::Mat &components);
+    
+    /** \brief Get the image value of each component found by the last
+     * call of label.
+     * \return image value per component
+     */
+    const std::vector<int>& getComponentValues() const;
+    
+private:
+    
+    /** \brief Find root of the given pixel, compressing the path. */
+    int find(int p);
+    
+    /** \brief Find root of the given pixel without modifying the tree. */
+    int findConst(int p) const;
+    
+    /** \brief Union by linking the larger root to the smaller one. */
+    void merge(int p, int q);
+    
+    /** \brief Whether to use 8-connectivity. */
+    bool eight_connected;
+    /** \brief Number of strips. */
+    int threads;
+    /** \brief Whether to ignore a value. */
+    bool ignore;
+    /** \brief Value to ignore. */
+    int ignore_value;
+    /** \brief Parent of each pixel, -1 for ignored pixels. */
+    std::vector<int> parent;
+    /** \brief Image value per component of the last call. */
+    std::vector<int> values;
+    
+};
+
+#endif	/* CONNECTED_LABELING_H */
+
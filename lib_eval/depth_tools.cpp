@@ -29,7 +29,13 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstdio>
+#include <limits>
 #include <glog/logging.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "batch_server.h"
 #include "depth_tools.h"
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -80,6 +86,24 @@ int DepthTools::Camera::backprojectY(float y, float depth, float factor) const {
     return round(y*focal_y*factor/depth + principal_y - cropping_y);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// computeRays
+////////////////////////////////////////////////////////////////////////////////
+
+void DepthTools::Camera::computeRays(int height, int width, std::vector<float> &columns, 
+        std::vector<float> &rows) const {
+    
+    columns.resize(width);
+    for (int j = 0; j < width; ++j) {
+        columns[j] = ((float) j + cropping_x) - principal_x;
+    }
+    
+    rows.resize(height);
+    for (int i = 0; i < height; ++i) {
+        rows[i] = ((float) i + cropping_y) - principal_y;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // computeCloudFromDepth
 ////////////////////////////////////////////////////////////////////////////////
@@ -87,16 +111,97 @@ int DepthTools::Camera::backprojectY(float y, float depth, float factor) const {
 void DepthTools::computeCloudFromDepth(const cv::Mat &depth, const DepthTools::Camera &camera,
         cv::Mat &cloud) {
     
+    LOG_IF(FATAL, depth.channels() != 1) << "Depth needs to be single channel image!";
+    
+    cv::Mat depth_us = depth;
+    if (depth.depth() != CV_16U) {
+        depth.convertTo(depth_us, CV_16U);
+    }
+    
+    // Multiplying the ray offsets by the depth before dividing by the focal 
+    // length keeps the points identical to Camera::projectX and projectY.
+    std::vector<float> columns;
+    std::vector<float> rows;
+    camera.computeRays(depth.rows, depth.cols, columns, rows);
+    
+    const float factor = 1000.f;
+    const float infinity = std::numeric_limits<float>::infinity();
+    
     cloud.create(depth.rows, depth.cols, CV_32FC3);
     for (int i = 0; i < depth.rows; ++i) {
-        for (int j = 0; j < depth.cols; ++j) {
-            cloud.at<cv::Vec3f>(i, j)[0] = camera.projectX<int>(j, depth.at<unsigned short>(i, j));
-            cloud.at<cv::Vec3f>(i, j)[1] = camera.projectY<int>(i, depth.at<unsigned short>(i, j));
-            cloud.at<cv::Vec3f>(i, j)[2] = camera.projectZ(depth.at<unsigned short>(i, j));
+        const unsigned short* depth_row = depth_us.ptr<unsigned short>(i);
+        float* cloud_row = cloud.ptr<float>(i);
+        bool infinite = false;
+        
+        int j = 0;
+#if defined(__SSE2__)
+        const __m128 factor4 = _mm_set1_ps(factor);
+        const __m128 focal_x4 = _mm_set1_ps(camera.focal_x);
+        const __m128 focal_y4 = _mm_set1_ps(camera.focal_y);
+        const __m128 row4 = _mm_set1_ps(rows[i]);
+        const __m128 abs4 = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        const __m128 infinity4 = _mm_set1_ps(infinity);
+        __m128 infinite4 = _mm_setzero_ps();
+        
+        for (; j + 4 <= depth.cols; j += 4) {
+            __m128i d = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(depth_row + j));
+            __m128 z = _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(d, _mm_setzero_si128())), factor4);
+            __m128 x = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(&columns[j]), z), focal_x4);
+            __m128 y = _mm_div_ps(_mm_mul_ps(row4, z), focal_y4);
             
-            LOG_IF (FATAL, std::isinf(cloud.at<cv::Vec3f>(i, j)[0])) << "Infinite cloud value!";
-            LOG_IF (FATAL, std::isinf(cloud.at<cv::Vec3f>(i, j)[1])) << "Infinite cloud value!";
-            LOG_IF (FATAL, std::isinf(cloud.at<cv::Vec3f>(i, j)[2])) << "Infinite cloud value!";
+            infinite4 = _mm_or_ps(infinite4, _mm_cmpeq_ps(_mm_and_ps(x, abs4), infinity4));
+            infinite4 = _mm_or_ps(infinite4, _mm_cmpeq_ps(_mm_and_ps(y, abs4), infinity4));
+            infinite4 = _mm_or_ps(infinite4, _mm_cmpeq_ps(_mm_and_ps(z, abs4), infinity4));
+            
+            // Interleave to x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3.
+            __m128 xy_low = _mm_unpacklo_ps(x, y);
+            __m128 xy_high = _mm_unpackhi_ps(x, y);
+            __m128 z0x1 = _mm_shuffle_ps(z, xy_low, _MM_SHUFFLE(2, 2, 0, 0));
+            __m128 y1z1 = _mm_shuffle_ps(xy_low, z, _MM_SHUFFLE(1, 1, 3, 3));
+            __m128 z2x3 = _mm_shuffle_ps(z, xy_high, _MM_SHUFFLE(3, 2, 3, 2));
+            
+            _mm_storeu_ps(cloud_row + 3*j, _mm_shuffle_ps(xy_low, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));
+            _mm_storeu_ps(cloud_row + 3*j + 4, _mm_shuffle_ps(y1z1, xy_high, _MM_SHUFFLE(1, 0, 2, 0)));
+            _mm_storeu_ps(cloud_row + 3*j + 8, _mm_shuffle_ps(z2x3, z2x3, _MM_SHUFFLE(1, 3, 2, 0)));
+        }
+        
+        infinite = (_mm_movemask_ps(infinite4) != 0);
+#endif
+        for (; j < depth.cols; ++j) {
+            float z = camera.projectZ(depth_row[j], factor);
+            cloud_row[3*j] = columns[j]*z/camera.focal_x;
+            cloud_row[3*j + 1] = rows[i]*z/camera.focal_y;
+            cloud_row[3*j + 2] = z;
+            
+            infinite = infinite || std::isinf(cloud_row[3*j]) 
+                    || std::isinf(cloud_row[3*j + 1]) || std::isinf(cloud_row[3*j + 2]);
         }
+        
+        LOG_IF (FATAL, infinite) << "Infinite cloud value!";
     }
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// readCloudFromDepth
+////////////////////////////////////////////////////////////////////////////////
+
+void DepthTools::readCloudFromDepth(const std::string &depth_file, const DepthTools::Camera &camera,
+        cv::Mat &cloud) {
+    
+    // The camera is part of the key as intrinsics may change per image or job.
+    char tag[256];
+    snprintf(tag, sizeof(tag), "cloud:%a:%a:%a:%a:%a:%a", 
+            (double) camera.cropping_x, (double) camera.cropping_y,
+            (double) camera.principal_x, (double) camera.principal_y,
+            (double) camera.focal_x, (double) camera.focal_y);
+    
+    cloud = BatchServer::readCached(depth_file, tag, [&camera](const std::string &file) {
+        cv::Mat cloud;
+        cv::Mat depth = cv::imread(file, CV_LOAD_IMAGE_ANYDEPTH);
+        if (!depth.empty()) {
+            DepthTools::computeCloudFromDepth(depth, camera, cloud);
+        }
+        
+        return cloud;
+    });
+}
@@ -32,6 +32,8 @@
 #ifndef DEPTH_TOOLS_H
 #define	DEPTH_TOOLS_H
 
+#include <string>
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 /** \brief Tools for using depth information.
@@ -89,6 +91,17 @@ public:
          * \return y coordinate
          */
         int backprojectY(float y, float depth, float factor = 1000.f) const;
+        
+        /** \brief Precompute the per-column and per-row ray offsets used by
+         * projectX and projectY, i.e. the coordinates relative to the principal
+         * point; projectX(j, depth) equals columns[j]*projectZ(depth)/focal_x.
+         * \param[in] height number of rows
+         * \param[in] width number of columns
+         * \param[out] columns ray offsets in x for each column
+         * \param[out] rows ray offsets in y for each row
+         */
+        void computeRays(int height, int width, std::vector<float> &columns, 
+                std::vector<float> &rows) const;
 
         /** \brief If the image was cropped in x dimension by a specific number of pixels. */
         float cropping_x;
@@ -112,6 +125,17 @@ public:
      */
     static void computeCloudFromDepth(const cv::Mat &depth, const Camera &camera,
             cv::Mat &cloud);
+    
+    /** \brief Read the depth image and compute the point cloud, see computeCloudFromDepth;
+     * when serving jobs (see BatchServer), clouds are cached per depth file
+     * and camera such that repeated jobs on the same images reuse them.
+     * \param[in] depth_file depth image, read as unsigned short image
+     * \param[in] camera camera object allowing to project pixels, see above
+     * \param[out] cloud point cloud as three-channel image, empty if the depth
+     * image could not be read
+     */
+    static void readCloudFromDepth(const std::string &depth_file, const Camera &camera,
+            cv::Mat &cloud);
 };
 
 #endif	/* DEPTH_TOOLS_H */
@@ -32,6 +32,10 @@
 #include <sstream>
 #include <fstream>
 #include <limits>
+#include <cstdio>
+#include <iomanip>
+#include <set>
+#include <algorithm>
 #include <glog/logging.h>
 #include "visualization.h"
 #include "evaluation.h"
@@ -44,8 +48,8 @@
 
 EvaluationSummary::EvaluationSummary(boost::filesystem::path sp_directory, 
         boost::filesystem::path gt_directory, boost::filesystem::path img_directory)
-        : compute_correlation(false), sp_directory(sp_directory), gt_directory(gt_directory), 
-        img_directory(img_directory) {
+        : compute_correlation(false), shard(0), shards(1), sp_directory(sp_directory), 
+        gt_directory(gt_directory), img_directory(img_directory) {
     
     results_file = sp_directory / boost::filesystem::path("results.csv");
     correlation_file = sp_directory / boost::filesystem::path("correlation.csv");
@@ -62,8 +66,8 @@ EvaluationSummary::EvaluationSummary(boost::filesystem::path sp_directory,
         boost::filesystem::path gt_directory, boost::filesystem::path img_directory,
         EvaluationMetrics evaluation_metrics, EvaluationStatistics evaluation_statistics)
         : evaluation_metrics(evaluation_metrics), evaluation_statistics(evaluation_statistics), 
-        compute_correlation(false), sp_directory(sp_directory), gt_directory(gt_directory), 
-        img_directory(img_directory) {
+        compute_correlation(false), shard(0), shards(1), sp_directory(sp_directory), 
+        gt_directory(gt_directory), img_directory(img_directory) {
     
     results_file = sp_directory / boost::filesystem::path("results.csv");
     correlation_file = sp_directory / boost::filesystem::path("correlation.csv");
@@ -82,7 +86,8 @@ EvaluationSummary::EvaluationSummary(boost::filesystem::path sp_directory,
         SuperpixelVisualizations superpixel_visualizations)
         : evaluation_metrics(evaluation_metrics), evaluation_statistics(evaluation_statistics),
         superpixel_visualizations(superpixel_visualizations), compute_correlation(false),
-        sp_directory(sp_directory), gt_directory(gt_directory), img_directory(img_directory){
+        shard(0), shards(1), sp_directory(sp_directory), gt_directory(gt_directory), 
+        img_directory(img_directory){
     
     results_file = sp_directory / boost::filesystem::path("results.csv");
     correlation_file = sp_directory / boost::filesystem::path("correlation.csv");
@@ -162,7 +167,7 @@ int EvaluationSummary::countMetrics() {
 // evaluateHeader
 ////////////////////////////////////////////////////////////////////////////////
 
-void EvaluationSummary::evaluateHeader(std::stringstream &output, 
+void EvaluationSummary::evaluateHeader(std::ostream &output, 
         std::vector<std::string> &metric_order) {
     
     output << "image" << "," << "ground_truth"; 
@@ -245,7 +250,7 @@ void EvaluationSummary::evaluateHeader(std::stringstream &output,
 ////////////////////////////////////////////////////////////////////////////////
 
 void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &gt_segmentation, 
-        const cv::Mat &image, cv::Mat &data, std::stringstream &output) {
+        const cv::Mat &image, cv::Mat &results, std::ostream &output) {
     
     int i = 0;
     cv::Mat row(1, countMetrics(), CV_32FC1, cv::Scalar(0));
@@ -413,13 +418,199 @@ void EvaluationSummary::evaluate(const cv::Mat &sp_segmentation, const cv::Mat &
     }
     
     output << "\n";
-//    if (data.empty()) {
-//        data = row;
-//    }
-//    else {
-//        cv::vconcat(data, row, data);
-//    }
-    data.push_back(row);
+    results = row;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// accumulate
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::accumulate(const ImageResults &image_results, 
+        std::vector<MetricStatistics> &statistics, StreamingCovariance &covariance, 
+        int &gt_max) {
+    
+    const std::vector<int> &gt = image_results.gt;
+    const cv::Mat &results = image_results.results;
+    
+    LOG_IF(FATAL, gt.size() != results.rows) << "The ground truth indices do not match the number of results.";
+    
+    if (results.rows == 0) {
+        return;
+    }
+    
+    LOG_IF(FATAL, statistics.size() != results.cols) << "The number of statistics does not match the number of metrics.";
+    
+    for (int j = 0; j < results.cols; ++j) {
+        float min = results.at<float>(0, j);
+        float max = results.at<float>(0, j);
+        
+        for (int i = 0; i < results.rows; ++i) {
+            if (gt[i] >= (int) statistics[j].gt.size()) {
+                statistics[j].gt.resize(gt[i] + 1);
+            }
+            
+            statistics[j].gt[gt[i]].add(results.at<float>(i, j));
+            
+            min = std::min(min, results.at<float>(i, j));
+            max = std::max(max, results.at<float>(i, j));
+        }
+        
+        statistics[j].min.add(min);
+        statistics[j].max.add(max);
+    }
+    
+    if (compute_correlation) {
+        for (int i = 0; i < results.rows; ++i) {
+            covariance.add(std::vector<double>(results.ptr<float>(i), 
+                    results.ptr<float>(i) + results.cols));
+        }
+    }
+    
+    gt_max = std::max(gt_max, *std::max_element(gt.begin(), gt.end()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ResultsReader
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Remove the quotes added when writing paths to streams.
+ * \param[in] name possibly quoted name
+ * \return unquoted name
+ */
+std::string unquote(const std::string &name) {
+    if (name.size() >= 2 && name[0] == '"' && name[name.size() - 1] == '"') {
+        return name.substr(1, name.size() - 2);
+    }
+    
+    return name;
+}
+
+EvaluationSummary::ResultsReader::ResultsReader(const boost::filesystem::path &file_) 
+        : file(file_), stream(file_.string()), has_line(false) {
+    
+    LOG_IF(FATAL, !stream.is_open()) << "Could not open results file: " << file.string() << ".";
+    
+    std::string header_line;
+    std::getline(stream, header_line);
+    
+    std::vector<std::string> header;
+    std::stringstream header_stream(header_line);
+    std::string cell;
+    while (std::getline(header_stream, cell, ',')) {
+        header.push_back(cell);
+    }
+    
+    LOG_IF(FATAL, header.size() < 2 || header[0] != "image" || header[1] != "ground_truth")
+            << "Invalid results file: " << file.string() << ".";
+    metric_order.assign(header.begin() + 2, header.end());
+    
+    has_line = readLine();
+}
+
+const std::vector<std::string>& EvaluationSummary::ResultsReader::getMetricOrder() const {
+    return metric_order;
+}
+
+bool EvaluationSummary::ResultsReader::readLine() {
+    if (!std::getline(stream, line)) {
+        return false;
+    }
+    
+    // Lines are always terminated, so a line at the end of the file
+    // was only written partially, e.g. if evaluation was interrupted.
+    if (stream.eof()) {
+        LOG(WARNING) << "Ignoring incomplete line in " << file.string() << ".";
+        return false;
+    }
+    
+    return true;
+}
+
+bool EvaluationSummary::ResultsReader::next(ImageResults &image_results) {
+    image_results = ImageResults();
+    
+    while (has_line) {
+        std::vector<std::string> cells;
+        std::stringstream line_stream(line);
+        std::string cell;
+        while (std::getline(line_stream, cell, ',')) {
+            cells.push_back(cell);
+        }
+        
+        LOG_IF(FATAL, cells.size() != metric_order.size() + 2) << "Invalid line in results file: " 
+                << file.string() << ".";
+        
+        std::string name = unquote(cells[0]);
+        std::string gt_name = unquote(cells[1]);
+        
+        // The line belongs to the next image and is kept for the next call.
+        if (!image_results.name.empty() && name != image_results.name) {
+            break;
+        }
+        
+        // Ground truth files are named either as the image or by appending 
+        // "-t" for the t-th ground truth segmentation.
+        int t = 0;
+        if (gt_name != name) {
+            t = std::stoi(gt_name.substr(gt_name.rfind('-') + 1));
+        }
+        
+        cv::Mat row(1, metric_order.size(), CV_32FC1, cv::Scalar(0));
+        for (unsigned int j = 0; j < metric_order.size(); ++j) {
+            row.at<float>(0, j) = std::stof(cells[j + 2]);
+        }
+        
+        image_results.name = name;
+        image_results.gt_names.push_back(gt_name);
+        image_results.gt.push_back(t);
+        image_results.results.push_back(row);
+        
+        has_line = readLine();
+    }
+    
+    return !image_results.name.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// countGroundTruths
+////////////////////////////////////////////////////////////////////////////////
+
+int EvaluationSummary::countGroundTruths(const std::string &name) {
+    
+    // As in computeSummary, either a single ground truth named as the image
+    // or up to five ground truths with suffix "-t".
+    if (boost::filesystem::is_regular_file(gt_directory / boost::filesystem::path(name + ".csv"))) {
+        return 1;
+    }
+    
+    int count = 0;
+    for (int t = 0; t < 5; ++t) {
+        if (boost::filesystem::is_regular_file(gt_directory 
+                / boost::filesystem::path(name + "-" + std::to_string(t) + ".csv"))) {
+            ++count;
+        }
+    }
+    
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeResults
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::writeResults(const ImageResults &image_results, 
+        std::ostream &output) {
+    
+    for (int i = 0; i < image_results.results.rows; ++i) {
+        output << boost::filesystem::path(image_results.name) << ",";
+        output << boost::filesystem::path(image_results.gt_names[i]);
+        
+        for (int j = 0; j < image_results.results.cols; ++j) {
+            output << "," << image_results.results.at<float>(i, j);
+        }
+        
+        output << "\n";
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -475,58 +666,30 @@ void EvaluationSummary::visualize(const cv::Mat &sp_segmentation, const cv::Mat
 // correlate
 ////////////////////////////////////////////////////////////////////////////////
 
-void EvaluationSummary::correlate(const cv::Mat &mat_results, const std::vector<std::string> &metric_order,
+void EvaluationSummary::correlate(const StreamingCovariance &covariance, const std::vector<std::string> &metric_order,
         cv::Mat &mat_correlation, std::string &csv_correlation) {
     
-    LOG_IF(FATAL, mat_results.cols != (int) metric_order.size()) 
-            << "Invalid metric order:" << mat_results.cols << " != " << metric_order.size();
+    LOG_IF(FATAL, covariance.getDimension() != (int) metric_order.size()) 
+            << "Invalid metric order:" << covariance.getDimension() << " != " << metric_order.size();
     
-    std::vector<float> sums(mat_results.cols, 0);
-    std::vector< std::vector<float> > squared_sums(mat_results.cols);
-    for (int j = 0; j < mat_results.cols; j++) {
-        squared_sums[j].resize(mat_results.cols, 0);
-    }
-    
-    for (int i = 0; i < mat_results.rows; i++) {
-        for (int j = 0; j < mat_results.cols; j++) {
-            sums[j] += mat_results.at<float>(i, j);
-            
-            for (int jj = 0; jj < mat_results.cols; jj++) {
-                squared_sums[j][jj] += mat_results.at<float>(i, j)*mat_results.at<float>(i, jj);
-            }
-        }
-    }
-    
-    for (int j = 0; j < mat_results.cols; j++) {
-        sums[j] /= mat_results.rows;
-    }
-    
-    for (int j = 0; j < mat_results.cols; j++) {
-        for (int jj = 0; jj < mat_results.cols; jj++) {
-            squared_sums[j][jj] /= mat_results.rows;
-            squared_sums[j][jj] -= sums[j]*sums[jj];
-        }
-    }
-    
-    for (int j = 0; j < mat_results.cols; j++) {
-        for (int jj = 0; jj < mat_results.cols; jj++) {
-            LOG_IF(ERROR, squared_sums[j][jj] != squared_sums[jj][j] || std::isnan(squared_sums[j][jj])) << squared_sums[j][jj] << " != " << squared_sums[jj][j];
-        }
-    }
+    int metrics = covariance.getDimension();
     
     csv_correlation = "";
-    for (int j = 0; j < mat_results.cols; j++) {
+    for (int j = 0; j < metrics; j++) {
         csv_correlation += "," + metric_order[j];
     }
     
     csv_correlation += "\n";
     
-    mat_correlation.create(mat_results.cols, mat_results.cols, CV_32FC1);
-    for (int j = 0; j < mat_results.cols; j++) {
+    mat_correlation.create(metrics, metrics, CV_32FC1);
+    for (int j = 0; j < metrics; j++) {
         csv_correlation += metric_order[j];
         
-        for (int jj = 0; jj < mat_results.cols; jj++) {
-            mat_correlation.at<float>(j, jj) = squared_sums[j][jj] / (std::sqrt(squared_sums[j][j])*std::sqrt(squared_sums[jj][jj]));
+        for (int jj = 0; jj < metrics; jj++) {
+            mat_correlation.at<float>(j, jj) = covariance.getCorrelation(j, jj);
+            LOG_IF(ERROR, std::isnan(mat_correlation.at<float>(j, jj))) << "Correlation between " 
+                    << metric_order[j] << " and " << metric_order[jj] << " is not defined.";
+            
             csv_correlation += "," + std::to_string(mat_correlation.at<float>(j, jj));
         }
         
@@ -575,9 +738,9 @@ void EvaluationSummary::validateStatistics() {
 // summaryHeader
 ////////////////////////////////////////////////////////////////////////////////
 
-void EvaluationSummary::summaryHeader(const std::vector<int> &gt, std::stringstream &output) {
+void EvaluationSummary::summaryHeader(int gt_max, std::stringstream &output) {
     
-    int max = *std::max_element(gt.begin(), gt.end());
+    int max = gt_max;
     
     output << "metric";
     if (evaluation_statistics.mean) {
@@ -632,502 +795,77 @@ void EvaluationSummary::summaryHeader(const std::vector<int> &gt, std::stringstr
 // summarize
 ////////////////////////////////////////////////////////////////////////////////
 
-void EvaluationSummary::summarize(const std::vector<int> &gt, const cv::Mat &data, 
-        int j, cv::Mat &mat_summary, std::stringstream &output) {
+void EvaluationSummary::summarize(int gt_max, const MetricStatistics &statistics, 
+        cv::Mat &mat_summary, std::stringstream &output) {
     
-    LOG_IF(FATAL, gt.size() != data.rows) << "The ground truth indices do not match the number of values after evaluation.";
+    LOG_IF(FATAL, (int) statistics.gt.size() > gt_max + 1) << "The statistics do not match the maximum ground truth index.";
     
-    int k = 0;
-    int gt_max = *std::max_element(gt.begin(), gt.end());
-    cv::Mat row(1, countStatistics(gt_max + 1), CV_32FC1, cv::Scalar(0));
+    // Ground truth indices without any results are summarized as empty
+    // statistics, i.e. as zero.
+    StreamingStatistics empty;
+    std::vector<const StreamingStatistics*> gt(gt_max + 1, &empty);
+    for (unsigned int t = 0; t < statistics.gt.size(); ++t) {
+        gt[t] = &statistics.gt[t];
+    }
     
-    std::string separator = "";
+    std::vector<float> values;
     if (evaluation_statistics.mean) {
-//        LOG(INFO) << "... Computing mean.";
-        
-        std::vector<float> mean;
-        float mean_min;
-        float mean_max;
-        computeMean(gt, data, j, mean, mean_min, mean_max);
-        
-        for (unsigned int i = 0; i < mean.size(); ++i) {
-            output << separator << mean[i];
-            row.at<float>(0, k) = mean[i];
-            ++k;
-            
-            if (i == 0) {
-                separator = ",";
-            }
+        for (int t = 0; t <= gt_max; ++t) {
+            values.push_back(gt[t]->getMean());
         }
         
-        output << separator << mean_min;
-        output << separator << mean_max;
-        
-        row.at<float>(0, k) = mean_min;
-        ++k;
-        row.at<float>(0, k) = mean_max;
-        ++k;
+        values.push_back(statistics.min.getMean());
+        values.push_back(statistics.max.getMean());
         
         if (evaluation_statistics.std) {
-            std::vector<float> std;
-            float std_min;
-            float std_max;
-            computeStandardDeviation(gt, data, j, mean, std, std_min, std_max);
-
-            for (unsigned int i = 0; i < mean.size(); ++i) {
-                output << separator << std[i];
-                row.at<float>(0, k) = std[i];
-                ++k;
-
-                if (i == 0) {
-                    separator = ",";
-                }
+            for (int t = 0; t <= gt_max; ++t) {
+                values.push_back(gt[t]->getStandardDeviation());
             }
-
-            output << separator << std_min;
-            output << separator << std_max;
-
-            row.at<float>(0, k) = std_min;
-            ++k;
-            row.at<float>(0, k) = std_max;
-            ++k;
+            
+            values.push_back(statistics.min.getStandardDeviation());
+            values.push_back(statistics.max.getStandardDeviation());
         }
     }
     if (evaluation_statistics.median_and_quartiles) {
-//        LOG(INFO) << "... Computing median and quartiles.";
-        
-        std::vector<float> median;
-        std::vector<float> first_q;
-        std::vector<float> third_q;
-        float median_min;
-        float first_q_min;
-        float third_q_min;
-        float median_max;
-        float first_q_max;
-        float third_q_max;
-        
-        comuteMedianFirstAndThirdQuartile(gt, data, j, median, first_q, 
-                third_q, median_min, first_q_min, third_q_min, 
-                median_max, first_q_max, third_q_max);
-        
-        LOG_IF(FATAL, median.size() != first_q.size()) << "Computed #medians do not match the computed #first quartiles.";
-        LOG_IF(FATAL, median.size() != first_q.size()) << "Computed #medians do not match the computed #third quartiles.";
-        
-        for (unsigned int i = 0; i < median.size(); ++i) {
-            output << separator << median[i];
-            
-            if (i == 0) {
-                separator = ",";
-            }
-            
-            output << separator << first_q[i];
-            output << separator << third_q[i];
-            
-            row.at<float>(0, k) = median[i];
-            ++k;
-            row.at<float>(0, k) = first_q[i];
-            ++k;
-            row.at<float>(0, k) = third_q[i];
-            ++k;
+        for (int t = 0; t <= gt_max; ++t) {
+            values.push_back(gt[t]->getMedian());
+            values.push_back(gt[t]->getQuantile(0.25));
+            values.push_back(gt[t]->getQuantile(0.75));
         }
         
-        output << separator << median_min;
-        output << separator << first_q_min;
-        output << separator << third_q_min;
-        
-        row.at<float>(0, k) = median_min;
-        ++k;
-        row.at<float>(0, k) = first_q_min;
-        ++k;
-        row.at<float>(0, k) = third_q_min;
-        ++k;
+        values.push_back(statistics.min.getMedian());
+        values.push_back(statistics.min.getQuantile(0.25));
+        values.push_back(statistics.min.getQuantile(0.75));
         
-        output << separator << median_max;
-        output << separator << first_q_max;
-        output << separator << third_q_max;
-        
-        row.at<float>(0, k) = median_max;
-        ++k;
-        row.at<float>(0, k) = first_q_max;
-        ++k;
-        row.at<float>(0, k) = third_q_max;
-        ++k;
+        values.push_back(statistics.max.getMedian());
+        values.push_back(statistics.max.getQuantile(0.25));
+        values.push_back(statistics.max.getQuantile(0.75));
     }
     if (evaluation_statistics.min_and_max) {
-//        LOG(INFO) << "... Computing min and max.";
-        
-        std::vector<float> min;
-        std::vector<float> max;
-        float min_min;
-        float max_min;
-        float min_max;
-        float max_max;
-        comuteMinMax(gt, data, j, min, max, min_min, max_min, min_max, max_max);
-        
-        LOG_IF(FATAL, min.size() != max.size()) << "Computed #maxima do not match the computed #minima.";
-        
-        for (unsigned int i = 0; i < min.size(); ++i) {
-            output << separator << min[i];
-            
-            if (i == 0) {
-                separator = ",";
-            }
-            
-            output << separator << max[i];
-            
-            row.at<float>(0, k) = min[i];
-            ++k;
-            row.at<float>(0, k) = max[i];
-            ++k;
+        for (int t = 0; t <= gt_max; ++t) {
+            values.push_back(gt[t]->getMin());
+            values.push_back(gt[t]->getMax());
         }
         
-        output << separator << min_min;
-        output << separator << max_min;
-        
-        row.at<float>(0, k) = min_min;
-        ++k;
-        row.at<float>(0, k) = max_min;
-        ++k;
-        
-        output << separator << min_max;
-        output << separator << max_max;
+        // min_min, max_min, min_max, max_max: minimum/maximum over the
+        // per image minima and maxima.
+        values.push_back(statistics.min.getMin());
+        values.push_back(statistics.max.getMin());
         
-        row.at<float>(0, k) = min_max;
-        ++k;
-        row.at<float>(0, k) = max_max;
-        ++k;
+        values.push_back(statistics.min.getMax());
+        values.push_back(statistics.max.getMax());
     }
     
-    output << "\n";
-    mat_summary.push_back(row);
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// computeMean
-////////////////////////////////////////////////////////////////////////////////
-
-float EvaluationSummary::computeMean(const std::vector<int> gt, const cv::Mat &data, 
-        int j, std::vector<float> &mean, float &mean_min, float &mean_max) {
-    
-    LOG_IF(FATAL, gt.size() != data.rows) << "The ground truth indices do not match the number of values after evaluation.";
-    LOG_IF(FATAL, j < 0 || j >= data.cols) << "Cannot summarize invalid column.";
-    
-    int max_gt = *std::max_element(gt.begin(), gt.end());
-    std::vector<int> count(max_gt + 1, 0);
-    mean.resize(max_gt + 1, 0);
-    
-    for (int i = 0; i < data.rows; ++i) {
-        mean[gt[i]] += data.at<float>(i, j);
-        ++count[gt[i]];
-    }
+    LOG_IF(FATAL, (int) values.size() != countStatistics(gt_max + 1)) << "Invalid number of statistics.";
     
-    for (int i = 0; i < max_gt + 1; ++i) {
-        if (count[i] > 0) {
-            mean[i] /= count[i];
-        }
-    }
-    
-    mean_min = -1;
-    mean_max = -1;
-    
-    if (max_gt >= 0) {
-        
-        int count_0 = 0;
-        
-        mean_min = 0;
-        mean_max = 0;
-        
-        float min = std::numeric_limits<float>::max();
-        float max = std::numeric_limits<float>::min();
-        
-        for (int i = 0; i < data.rows; ++i) {
-            
-            // New data point, so reset min/max and save old ones.
-            if (gt[i] == 0 && i != 0) {
-                mean_min += min;
-                mean_max += max;
-                
-                min = std::numeric_limits<float>::max();
-                max = std::numeric_limits<float>::min();
-                
-                ++count_0;
-            }
-            
-            if (data.at<float>(i, j) < min) {
-                min = data.at<float>(i, j);
-            }
-            if (data.at<float>(i, j) > max) {
-                max = data.at<float>(i, j);
-            }
-        }
-        
-        mean_min /= count_0;
-        mean_max /= count_0;
+    cv::Mat row(1, values.size(), CV_32FC1, cv::Scalar(0));
+    for (unsigned int k = 0; k < values.size(); ++k) {
+        output << (k > 0 ? "," : "") << values[k];
+        row.at<float>(0, k) = values[k];
     }
     
-    return mean[0];
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// computeMedianFirstAndThirdQuantile
-////////////////////////////////////////////////////////////////////////////////
-
-float pQuartile(float p, const std::vector<float> data) {
-    LOG_IF(FATAL, p > 1 || p < 0) << "Cannot compute p-quartile for p > 1 or p < 0.";
-    
-    int size = data.size();
-    if (p == 0.5) {
-        if (size%2 == 0) {
-            return (data[size/2] + data[size/2 + 1])/2;
-        }
-        else {
-            return data[size/2];
-        }
-    }
-    else {
-        return (data[std::floor(p*size)] + data[std::ceil(p*size)])/2;
-    }
-}
-
-void EvaluationSummary::comuteMedianFirstAndThirdQuartile(const std::vector<int> gt, 
-        const cv::Mat &data, int j, std::vector<float> &median, std::vector<float> &first_q, 
-        std::vector<float> &third_q, float &median_min, float &first_q_min, float &third_q_min, 
-        float &median_max, float &first_q_max, float &third_q_max) {
-    
-    LOG_IF(FATAL, gt.size() != data.rows) << "The ground truth indices do not match the number of values after evaluation.";
-    LOG_IF(FATAL, j < 0 || j >= data.cols) << "Cannot summarize invalid column.";
-    
-    int max_gt = *std::max_element(gt.begin(), gt.end());
-
-    // Save per gt a sorted list of values.
-    // Last two elements store min and max respectively.
-    std::vector< std::vector<float> > gt_sorted(max_gt + 1);
-    for (int i = 0; i < data.rows; ++i) {
-        gt_sorted[gt[i]].push_back(data.at<float>(i, j));
-    }
-    
-    if (max_gt >= 0) {
-        std::vector<float> min_sorted;
-        std::vector<float> max_sorted;
-        
-        float min = std::numeric_limits<float>::max();
-        float max = std::numeric_limits<float>::min();
-        
-        for (int i = 0; i < data.rows; ++i) {
-            
-            // New data point, so reset min/max and save old ones.
-            if (gt[i] == 0 && i != 0) {
-                min_sorted.push_back(min);
-                max_sorted.push_back(max);
-                
-                min = std::numeric_limits<float>::max();
-                max = std::numeric_limits<float>::min();
-            }
-            
-            if (data.at<float>(i, j) < min) {
-                min = data.at<float>(i, j);
-            }
-            if (data.at<float>(i, j) > max) {
-                max = data.at<float>(i, j);
-            }
-        }
-        
-        gt_sorted.push_back(min_sorted);
-        gt_sorted.push_back(max_sorted);
-    }
-    
-    median.clear();
-    first_q.clear();
-    third_q.clear();
-    
-    median_min = -1;
-    first_q_min = -1;
-    third_q_min = -1;
-    median_max = -1;
-    first_q_max = -1;
-    third_q_max = -1;
-    
-    for (int i = 0; i < gt_sorted.size(); ++i) {
-        
-        // Sort all values belonging to the i-th ground truth.
-        std::sort(gt_sorted[i].begin(), gt_sorted[i].end());
-        
-        float median_i = pQuartile(0.5, gt_sorted[i]);
-        float first_q_i = pQuartile(0.25, gt_sorted[i]);
-        float third_q_i = pQuartile(0.75, gt_sorted[i]);
-        
-        if (i <= max_gt) {
-            median.push_back(median_i);
-            first_q.push_back(first_q_i);
-            third_q.push_back(third_q_i);
-        }
-        else if (i == max_gt + 1){
-            median_min = median_i;
-            first_q_min = first_q_i;
-            third_q_min = third_q_i;
-        }
-        else if (i == max_gt + 2) {
-            median_max = median_i;
-            first_q_max = first_q_i;
-            third_q_max = third_q_i;
-        }
-        else {
-            LOG(FATAL) << "This should not happen!";
-        }
-    }
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// computeMinMax
-////////////////////////////////////////////////////////////////////////////////
-
-void EvaluationSummary::comuteMinMax(const std::vector<int> gt, const cv::Mat &data, int j,
-        std::vector<float> &min, std::vector<float> &max, float &min_min,
-        float &max_min, float &min_max, float&max_max) {
-    
-    LOG_IF(FATAL, gt.size() != data.rows) << "The ground truth indices do not match the number of values after evaluation.";
-    LOG_IF(FATAL, j < 0 || j >= data.cols) << "Cannot summarize invalid column.";
-    
-    int max_gt = *std::max_element(gt.begin(), gt.end());
-    min.resize(max_gt + 1, std::numeric_limits<float>::max());
-    max.resize(max_gt + 1, std::numeric_limits<float>::min());
-    
-    for (int i = 0; i < data.rows; ++i) {
-        if (data.at<float>(i, j) > max[gt[i]]) {
-            max[gt[i]] = data.at<float>(i, j);
-        }
-        if (data.at<float>(i, j) < min[gt[i]]) {
-            min[gt[i]] = data.at<float>(i, j);
-        }
-    }
-    
-    min_min = -1;
-    max_min = -1;
-    min_max = -1;
-    max_max = -1;
-    
-    if (max_gt >= 0) {
-        float min = std::numeric_limits<float>::max();
-        float max = std::numeric_limits<float>::min();
-        
-        for (int i = 0; i < data.rows; ++i) {
-            
-            // New data point, so reset min/max and save old ones.
-            if (gt[i] == 0 && i != 0) {
-                if (min < min_min) {
-                    min_min = min;
-                }
-                
-                if (min > min_max) {
-                    min_max = min;
-                }
-                
-                if (max < max_min) {
-                    max_min = max;
-                }
-                
-                if (max > max_max) {
-                    max_max = max;
-                }
-                
-                min = std::numeric_limits<float>::max();
-                max = std::numeric_limits<float>::min();
-            }
-            
-            if (data.at<float>(i, j) < min) {
-                min = data.at<float>(i, j);
-            }
-            if (data.at<float>(i, j) > max) {
-                max = data.at<float>(i, j);
-            }
-        }
-    }
-}
-
-////////////////////////////////////////////////////////////////////////////////
-// computeStandardDeviation
-////////////////////////////////////////////////////////////////////////////////
-
-float EvaluationSummary::computeStandardDeviation(const std::vector<int> gt, const cv::Mat &data, int j,
-        const std::vector<float> &mean, std::vector<float> &std, float &std_min,
-        float &std_max) {
-    
-    LOG_IF(FATAL, gt.size() != data.rows) << "The ground truth indices do not match the number of values after evaluation.";
-    LOG_IF(FATAL, j < 0 || j >= data.cols) << "Cannot summarize invalid column.";
-    
-    int max_gt = *std::max_element(gt.begin(), gt.end());
-    LOG_IF(FATAL, max_gt + 1 != mean.size()) << "Invalid number of means given.";
-    
-    std::vector<int> count(max_gt + 1, 0);
-    std.resize(max_gt + 1, 0);
-    
-    for (int i = 0; i < data.rows; ++i) {
-        std[gt[i]] += data.at<float>(i, j)*data.at<float>(i, j);
-        ++count[gt[i]];
-    }
-    
-    for (int i = 0; i < max_gt + 1; ++i) {
-        if (count[i] > 0) {
-            std[i] /= count[i];
-            std[i] -= mean[i]*mean[i];
-            std[i] = std::sqrt(std[i]);
-        }
-    }
-    
-    std_min = -1;
-    std_max = -1;
-    
-    if (max_gt >= 0) {
-        
-        int count_0 = 0;
-        
-        std_min = 0;
-        std_max = 0;
-        
-        float mean_min = 0;
-        float mean_max = 0;
-        
-        float min = std::numeric_limits<float>::max();
-        float max = std::numeric_limits<float>::min();
-        
-        for (int i = 0; i < data.rows; ++i) {
-            
-            // New data point, so reset min/max and save old ones.
-            if (gt[i] == 0 && i != 0) {
-                std_min += min*min;
-                std_max += max*max;
-                
-                mean_min += min;
-                mean_max += max;
-                
-                min = std::numeric_limits<float>::max();
-                max = std::numeric_limits<float>::min();
-                
-                ++count_0;
-            }
-            
-            if (data.at<float>(i, j) < min) {
-                min = data.at<float>(i, j);
-            }
-            if (data.at<float>(i, j) > max) {
-                max = data.at<float>(i, j);
-            }
-        }
-        
-        std_min /= count_0;
-        std_max /= count_0;
-        
-        mean_min /= count_0;
-        mean_max /= count_0;
-        
-        std_min -= mean_min*mean_min;
-        std_max -= mean_max*mean_max;
-        
-        std_min = std::sqrt(std_min);
-        std_max = std::sqrt(std_max);
-    }
-    
-    return std[0];
+    output << "\n";
+    mat_summary.push_back(row);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1146,14 +884,64 @@ void EvaluationSummary::computeSummary(int &gt_max) {
     exclude.push_back("summary");
     IOUtil::readDirectory(sp_directory, csv_extensions, sp_files, "", "", exclude);
     
-    // Ground truth indices for statistic computation.
-    std::vector<int> gt;
-//    cv::Mat mat_results(1, countMetrics(), CV_32FC1, cv::Scalar(0));
-    cv::Mat mat_results;
-    
-    std::stringstream csv_results;
+    std::stringstream csv_header;
     std::vector<std::string> metric_order;
-    evaluateHeader(csv_results, metric_order);
+    evaluateHeader(csv_header, metric_order);
+    
+    std::vector<MetricStatistics> statistics(metric_order.size());
+    StreamingCovariance covariance(metric_order.size());
+    
+    gt_max = -1;
+    
+    // Resume from an existing results file: completely evaluated images 
+    // found there are accumulated from the file instead of being evaluated 
+    // again. The file is moved aside and copied image by image into the new
+    // results file, which also drops lines of an interrupted evaluation. If 
+    // a previous copy was interrupted, the file moved aside is still complete
+    // and is used instead.
+    boost::filesystem::path resume_file(results_file.string() + ".resume");
+    if (!boost::filesystem::is_regular_file(resume_file) 
+            && boost::filesystem::is_regular_file(results_file)) {
+        boost::filesystem::rename(results_file, resume_file);
+    }
+    
+    // Results are streamed to disk and accumulated per metric such that
+    // memory does not grow with the number of images. Precision is chosen 
+    // such that results read back from the file are exact.
+    std::ofstream csv_results(results_file.string());
+    csv_results << std::setprecision(std::numeric_limits<float>::max_digits10);
+    csv_results << csv_header.str();
+    
+    std::set<std::string> completed;
+    if (boost::filesystem::is_regular_file(resume_file)) {
+        ResultsReader reader(resume_file);
+        LOG_IF(FATAL, reader.getMetricOrder() != metric_order) << "Existing results file "
+                << results_file.string() << " was created using different metrics.";
+        
+        // The rows of an image are written at once, but an interrupted 
+        // evaluation may still cut them off at a line boundary; such images
+        // are evaluated again.
+        int incomplete = 0;
+        ImageResults image_results;
+        while (reader.next(image_results)) {
+            if ((int) image_results.gt.size() != countGroundTruths(image_results.name)) {
+                ++incomplete;
+                continue;
+            }
+            
+            writeResults(image_results, csv_results);
+            accumulate(image_results, statistics, covariance, gt_max);
+            completed.insert(image_results.name);
+        }
+        
+        csv_results.flush();
+        boost::filesystem::remove(resume_file);
+        
+        LOG_IF(INFO, !completed.empty()) << "Resuming evaluation, skipping " 
+                << completed.size() << " evaluated images.";
+        LOG_IF(WARNING, incomplete > 0) << "Evaluating " << incomplete 
+                << " incompletely evaluated images again.";
+    }
     
 //    LOG(INFO) << "Computing evaluation metrics.";
     
@@ -1167,6 +955,12 @@ void EvaluationSummary::computeSummary(int &gt_max) {
             continue;
         }
         
+        // Skip images of other shards and images already evaluated.
+        if (i % shards != shard || completed.find(it->second.stem().string()) != completed.end()) {
+            ++i;
+            continue;
+        }
+        
         boost::filesystem::path img_file = img_directory / 
                 boost::filesystem::path(it->second.stem().string() + ".png");
         if (!boost::filesystem::is_regular_file(img_file)) {
@@ -1203,7 +997,15 @@ void EvaluationSummary::computeSummary(int &gt_max) {
                 << "Superpixel segmentation does not match image size: (" 
                 << sp_segmentation.rows << "," << sp_segmentation.cols << ") != (" 
                 << image.rows << "," << image.cols << ").";
-
+        
+        // Results of the current image are collected and written at once,
+        // such that the results file only contains fully evaluated images.
+        ImageResults image_results;
+        image_results.name = it->second.stem().string();
+        
+        std::stringstream csv_image;
+        csv_image << std::setprecision(std::numeric_limits<float>::max_digits10);
+        
         // Find at least one ground truth file.
         boost::filesystem::path gt_file = gt_directory / it->second.filename();
         if (boost::filesystem::is_regular_file(gt_file)) {
@@ -1217,11 +1019,14 @@ void EvaluationSummary::computeSummary(int &gt_max) {
             LOG_IF(FATAL, gt_segmentation.rows != image.rows || gt_segmentation.cols != image.cols) 
                     << "Ground truth does not match image size.";
             
-            csv_results << it->second.stem() << ",";
-            csv_results << gt_file.stem() << ",";
+            csv_image << it->second.stem() << ",";
+            csv_image << gt_file.stem() << ",";
             
-            evaluate(sp_segmentation, gt_segmentation, image, mat_results, csv_results);
-            gt.push_back(0);
+            cv::Mat results;
+            evaluate(sp_segmentation, gt_segmentation, image, results, csv_image);
+            image_results.gt_names.push_back(gt_file.stem().string());
+            image_results.gt.push_back(0);
+            image_results.results.push_back(results);
             
             // Visualizations.
             visualize(sp_segmentation, gt_segmentation, image, it->second.stem().string());
@@ -1245,11 +1050,14 @@ void EvaluationSummary::computeSummary(int &gt_max) {
                     LOG_IF(FATAL, gt_segmentation.rows != image.rows || gt_segmentation.cols != image.cols) 
                             << "Ground truth does not match image size.";
 
-                    csv_results << it->second.stem() << ",";
-                    csv_results << gt_file_t.stem() << ",";
+                    csv_image << it->second.stem() << ",";
+                    csv_image << gt_file_t.stem() << ",";
 
-                    evaluate(sp_segmentation, gt_segmentation, image, mat_results, csv_results);
-                    gt.push_back(t);
+                    cv::Mat results;
+                    evaluate(sp_segmentation, gt_segmentation, image, results, csv_image);
+                    image_results.gt_names.push_back(gt_file_t.stem().string());
+                    image_results.gt.push_back(t);
+                    image_results.results.push_back(results);
                     
                     // Visualizations.
                     visualize(sp_segmentation, gt_segmentation, image, it->second.stem().string(), t);
@@ -1257,25 +1065,145 @@ void EvaluationSummary::computeSummary(int &gt_max) {
             }
         }
         
+        if (!image_results.gt.empty()) {
+            csv_results << csv_image.str() << std::flush;
+            accumulate(image_results, statistics, covariance, gt_max);
+        }
+        
         ++i;
     }
     
-    LOG_IF(FATAL, gt.size() == 0) << "No superpixel segmentation files found!";
-    gt_max = *std::max_element(gt.begin(), gt.end());
+    csv_results.close();
+    LOG_IF(FATAL, gt_max < 0) << "No superpixel segmentation files found!";
     
-    // Save output as CSV file, and save data as cv::Mat.
-    std::ofstream csv_results_file(results_file.string());
-    csv_results_file << csv_results.str();
-    csv_results_file.close();
+    if (shards > 1) {
+        LOG(INFO) << "Evaluated shard " << shard << " of " << shards 
+                << ", use mergeShards to summarize all shards.";
+        return;
+    }
     
-    boost::filesystem::path results_mat_file(results_file.string() + ".txt");
-    IOUtil::writeMat(results_mat_file, mat_results);
+    writeSummary(gt_max, metric_order, statistics, covariance);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mergeShards
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::mergeShards(int &gt_max) {
+    
+    std::multimap<std::string, boost::filesystem::path> shard_files;
+    std::vector<std::string> csv_extensions;
+    IOUtil::getCSVExtensions(csv_extensions);
+    IOUtil::readDirectory(sp_directory, csv_extensions, shard_files, "results-");
+    
+    LOG_IF(FATAL, shard_files.empty()) << "No shards found in " << sp_directory.string() << ".";
+    
+    std::vector<std::string> metric_order;
+    std::vector<boost::filesystem::path> shard_paths;
+    std::set<int> found_shards;
+    int found_shards_total = -1;
+    
+    for (std::multimap<std::string, boost::filesystem::path>::iterator it = shard_files.begin();
+            it != shard_files.end(); ++it) {
+        
+        int shard_i = -1;
+        int shards_i = -1;
+        char end = '\0';
+        int read = std::sscanf(it->second.stem().string().c_str(), "results-%d-of-%d%c", 
+                &shard_i, &shards_i, &end);
+        
+        if (read != 2) {
+            continue;
+        }
+        
+        LOG_IF(FATAL, found_shards_total >= 0 && shards_i != found_shards_total) 
+                << "Found shards of different evaluations in " << sp_directory.string() << ".";
+        found_shards_total = shards_i;
+        found_shards.insert(shard_i);
+        shard_paths.push_back(it->second);
+    }
+    
+    LOG_IF(FATAL, found_shards_total < 0 || (int) found_shards.size() != found_shards_total)
+            << "Found " << found_shards.size() << " of " << found_shards_total << " shards.";
+    
+    // Each shard lists its images in the order of the superpixel segmentation 
+    // files, so the shards are merged by repeatedly taking the next image with 
+    // the smallest file; images are then processed in the same order as by 
+    // computeSummary and the summary is the same. Only the current image of 
+    // each shard is kept in memory.
+    std::vector<ResultsReader*> readers;
+    std::vector<ImageResults> current(shard_paths.size());
+    std::vector<std::string> keys(shard_paths.size());
+    
+    for (unsigned int s = 0; s < shard_paths.size(); ++s) {
+        readers.push_back(new ResultsReader(shard_paths[s]));
+        
+        LOG_IF(FATAL, !metric_order.empty() && readers[s]->getMetricOrder() != metric_order)
+                << "Shard " << shard_paths[s].string() << " was created using different metrics.";
+        metric_order = readers[s]->getMetricOrder();
+        
+        if (readers[s]->next(current[s])) {
+            keys[s] = (sp_directory / boost::filesystem::path(current[s].name + ".csv")).string();
+        }
+    }
+    
+    std::vector<MetricStatistics> statistics(metric_order.size());
+    StreamingCovariance covariance(metric_order.size());
+    gt_max = -1;
+    
+    std::ofstream csv_results(results_file.string());
+    csv_results << std::setprecision(std::numeric_limits<float>::max_digits10);
+    csv_results << "image" << "," << "ground_truth";
+    for (unsigned int j = 0; j < metric_order.size(); ++j) {
+        csv_results << "," << metric_order[j];
+    }
+    csv_results << "\n";
+    
+    while (true) {
+        int next = -1;
+        for (unsigned int s = 0; s < readers.size(); ++s) {
+            if (!current[s].name.empty() && (next < 0 || keys[s] < keys[next])) {
+                next = s;
+            }
+        }
+        
+        if (next < 0) {
+            break;
+        }
+        
+        writeResults(current[next], csv_results);
+        accumulate(current[next], statistics, covariance, gt_max);
+        
+        if (readers[next]->next(current[next])) {
+            std::string key = (sp_directory / boost::filesystem::path(current[next].name + ".csv")).string();
+            LOG_IF(FATAL, key < keys[next]) << "Shard " << shard_paths[next].string() 
+                    << " is not ordered by image, evaluate the shard again.";
+            keys[next] = key;
+        }
+    }
+    
+    for (unsigned int s = 0; s < readers.size(); ++s) {
+        delete readers[s];
+    }
+    
+    csv_results.close();
+    LOG_IF(FATAL, gt_max < 0) << "No results found in shards.";
+    
+    writeSummary(gt_max, metric_order, statistics, covariance);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writeSummary
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::writeSummary(int gt_max, const std::vector<std::string> &metric_order,
+        const std::vector<MetricStatistics> &statistics, const StreamingCovariance &covariance) {
     
     // Compute correlation if requested.
     if (compute_correlation) {
         cv::Mat mat_correlation;
         std::string csv_correlation;
-        correlate(mat_results, metric_order, mat_correlation, 
+        correlate(covariance, metric_order, mat_correlation, 
                 csv_correlation);
         
         std::ofstream csv_correlation_file(correlation_file.string());
@@ -1288,17 +1216,17 @@ void EvaluationSummary::computeSummary(int &gt_max) {
     
     validateStatistics();
     std::stringstream csv_summary_header;
-    summaryHeader(gt, csv_summary_header);
+    summaryHeader(gt_max, csv_summary_header);
     
     cv::Mat mat_summary;
     
 //    LOG(INFO) << "Summarizing results.";
     std::stringstream csv_summary;
-    for (int j = 0; j < mat_results.cols; ++j) {
+    for (unsigned int j = 0; j < metric_order.size(); ++j) {
         csv_summary << metric_order[j] << ",";
         
-//        LOG(INFO) << "[" << j << "] Summarizing metric " << (j + 1) << "/" << mat_results.cols << ".";
-        summarize(gt, mat_results, j, mat_summary, csv_summary);
+//        LOG(INFO) << "[" << j << "] Summarizing metric " << (j + 1) << "/" << metric_order.size() << ".";
+        summarize(gt_max, statistics[j], mat_summary, csv_summary);
     }
     
     std::ofstream csv_summary_file(summary_file.string());
@@ -1325,6 +1253,26 @@ void EvaluationSummary::computeSummary(int &gt_max) {
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// setShard
+////////////////////////////////////////////////////////////////////////////////
+
+void EvaluationSummary::setShard(int shard_, int shards_) {
+    LOG_IF(FATAL, shards_ <= 0 || shard_ < 0 || shard_ >= shards_) << "Invalid shard: " 
+            << shard_ << " of " << shards_ << ".";
+    
+    shard = shard_;
+    shards = shards_;
+    
+    if (shards > 1) {
+        results_file = sp_directory / boost::filesystem::path("results-" 
+                + std::to_string(shard) + "-of-" + std::to_string(shards) + ".csv");
+    }
+    else {
+        results_file = sp_directory / boost::filesystem::path("results.csv");
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // setAppendFile
 ////////////////////////////////////////////////////////////////////////////////
@@ -33,12 +33,27 @@
 #define	EVALUATION_SUMMARY_H
 
 #include <vector>
+#include <string>
+#include <fstream>
 #include <boost/filesystem.hpp>
 #include <opencv2/opencv.hpp>
+#include "streaming_statistics.h"
 
 /** \brief Given a directory of superpixel segmentations and a directory of
  * ground truth segmentations, this class is used to generate a CSV file of 
  * statistics of different metrics.
+ * 
+ * Results are written to the results file while evaluating and statistics
+ * are accumulated online (see StreamingStatistics), such that memory does 
+ * not grow with the number of images.
+ * 
+ * The results file is written per image, such that an interrupted evaluation
+ * can be resumed by running computeSummary again: images found in the results
+ * file with a row for each of their ground truth segmentations are not 
+ * evaluated again. For large datasets, evaluation can be split into shards 
+ * (see setShard) which are later combined using mergeShards; the merged 
+ * summary is the same as for a single run. Both read the results files image
+ * by image, so memory does not grow with the number of images.
  * \author David Stutz
  */
 class EvaluationSummary {
@@ -181,6 +196,27 @@ public:
      */
     void computeSummary(int &gt_max);
     
+    /** \brief Merge the results of all shards found in the superpixel directory
+     * and summarize them as done by computeSummary for a single run.
+     * 
+     * Shards are expected as results-<shard>-of-<shards>.csv, see setShard,
+     * and need to be complete. The shards are merged in the order of the
+     * superpixel segmentations, as written by computeSummary.
+     * 
+     * \param[out] gt_max the maxmimum number of ground truth used, for BSDS 5 for all other 1
+     */
+    void mergeShards(int &gt_max);
+    
+    /** \brief Only evaluate every shards-th image starting at image shard.
+     * 
+     * Results are written to results-<shard>-of-<shards>.csv instead of 
+     * results.csv and no summary is computed; see mergeShards.
+     * 
+     * \param[in] shard index of the shard to evaluate, between 0 and shards - 1
+     * \param[in] shards total number of shards
+     */
+    void setShard(int shard, int shards);
+    
     /** \brief Add CSV file to append CSV output to.
      * \param[in] append_file path to CSV file to append to
      */
@@ -228,6 +264,72 @@ public:
     
 protected:
     
+    /** \brief Statistics of a single metric accumulated over all images.
+     */
+    struct MetricStatistics {
+        /** \brief Statistics per ground truth segmentation index. */
+        std::vector<StreamingStatistics> gt;
+        /** \brief Statistics of the per image minimum over all ground truth segmentations. */
+        StreamingStatistics min;
+        /** \brief Statistics of the per image maximum over all ground truth segmentations. */
+        StreamingStatistics max;
+    };
+    
+    /** \brief Results of a single image as read from or written to the results file.
+     */
+    struct ImageResults {
+        /** \brief Name of the superpixel segmentation, i.e. of the image. */
+        std::string name;
+        /** \brief Names of the used ground truth segmentations. */
+        std::vector<std::string> gt_names;
+        /** \brief Ground truth indices of the rows in results. */
+        std::vector<int> gt;
+        /** \brief Results, one row per ground truth segmentation. */
+        cv::Mat results;
+    };
+    
+    /** \brief Reads a results file as written by computeSummary image by 
+     * image, such that only the results of one image are kept in memory.
+     * 
+     * An incomplete last line, e.g. after an interrupted evaluation, is ignored.
+     */
+    class ResultsReader {
+    public:
+        /** \brief Constructor, opens the file and reads the header.
+         * \param[in] file results file to read
+         */
+        ResultsReader(const boost::filesystem::path &file);
+        
+        /** \brief Get the order of the metrics in the results file.
+         * \return the order of the metrics
+         */
+        const std::vector<std::string>& getMetricOrder() const;
+        
+        /** \brief Read the results of the next image; the rows of an image
+         * are expected to be consecutive.
+         * \param[out] image_results results of the image
+         * \return false if there are no more images
+         */
+        bool next(ImageResults &image_results);
+        
+    private:
+        /** \brief Read the next complete line.
+         * \return false at the end of the file
+         */
+        bool readLine();
+        
+        /** \brief Path to the results file. */
+        boost::filesystem::path file;
+        /** \brief Stream of the results file. */
+        std::ifstream stream;
+        /** \brief The order of the metrics. */
+        std::vector<std::string> metric_order;
+        /** \brief Line read but not yet returned. */
+        std::string line;
+        /** \brief Whether line holds a row not yet returned. */
+        bool has_line;
+    };
+    
     /** \brief Count number of metrics used.
      * \return number of metrics to compute
      */
@@ -237,17 +339,48 @@ protected:
      * \param[in] output the header of the CSV file to create
      * \param[out] metric_order the order of the metrics
      */
-    void evaluateHeader(std::stringstream &output, std::vector<std::string> &metric_order);
+    void evaluateHeader(std::ostream &output, std::vector<std::string> &metric_order);
     
     /** \brief Actually do the evaluation.
      * \param[in] sp_segmentation superpixel labels as int image
      * \param[in] gt_segmentation ground truth segmentation as int image
      * \param[in] image corresponding image
-     * \param[in] data data matrix to append results to
+     * \param[out] results results as 1 x number of metrics row
      * \param[in] output CSV file stream to append results to
      */
     void evaluate(const cv::Mat &sp_segmentation, const cv::Mat &gt_segmentation, 
-            const cv::Mat &image, cv::Mat &data, std::stringstream &output);
+            const cv::Mat &image, cv::Mat &results, std::ostream &output);
+    
+    /** \brief Add the results of a single image to the statistics.
+     * \param[in] image_results results of the image
+     * \param[in,out] statistics statistics per metric
+     * \param[in,out] covariance covariance between the metrics
+     * \param[in,out] gt_max maximum ground truth index seen so far
+     */
+    void accumulate(const ImageResults &image_results, std::vector<MetricStatistics> &statistics, 
+            StreamingCovariance &covariance, int &gt_max);
+    
+    /** \brief Count the ground truth segmentations of an image, i.e. the 
+     * number of rows a completely evaluated image has in the results file.
+     * \param[in] name name of the image
+     * \return number of ground truth segmentations
+     */
+    int countGroundTruths(const std::string &name);
+    
+    /** \brief Write the results of a single image in the results file format.
+     * \param[in] image_results results of the image
+     * \param[in] output stream to write to
+     */
+    void writeResults(const ImageResults &image_results, std::ostream &output);
+    
+    /** \brief Write correlation, summary and append file given the accumulated statistics.
+     * \param[in] gt_max maximum ground truth index
+     * \param[in] metric_order the order of the metrics
+     * \param[in] statistics statistics per metric
+     * \param[in] covariance covariance between the metrics
+     */
+    void writeSummary(int gt_max, const std::vector<std::string> &metric_order,
+            const std::vector<MetricStatistics> &statistics, const StreamingCovariance &covariance);
     
     /** \brief Visualize given segmentation.
      * \param[in] sp_segmentation superpixel labels as int image
@@ -260,12 +393,12 @@ protected:
             const cv::Mat &image, std::string name, int t = 0);
     
     /** \brief Compute correlation between all metrics.
-     * \param[in] mat_results matrix containing results in order to compute correlatiom
-     * \param[in] metric_order order of metrix used in mat_results
+     * \param[in] covariance covariance accumulated over all results
+     * \param[in] metric_order order of metrix used in covariance
      * \param[out] mat_correlation correlation matrix
      * \param[out] csv_correlation correlation matrix as CSV string
      */
-    void correlate(const cv::Mat &mat_results, const std::vector<std::string> &metric_order,
+    void correlate(const StreamingCovariance &covariance, const std::vector<std::string> &metric_order,
             cv::Mat &mat_correlation, std::string &csv_correlation);
     
     /** \brief Count the number of statistics to be used.
@@ -279,89 +412,19 @@ protected:
     void validateStatistics();
     
     /** \brief Add the summary header to output.
-     * \param[in] gt ground truth indices to determine the number of ground truth segmentations
+     * \param[in] gt_max maximum ground truth index to determine the number of ground truth segmentations
+     * \param[out] output stream to write header to
      */
-    void summaryHeader(const std::vector<int> &gt, std::stringstream &output);
+    void summaryHeader(int gt_max, std::stringstream &output);
     
-    /** \brief Summarize a specific column of the evaluation data (corresponding to a
-     * particular metric).
-     * \param[in] gt ground truth indices to determine the number of ground truth segmentations
-     * \param[in] data data to summarize
-     * \param[in] j the column
+    /** \brief Summarize the accumulated statistics of a particular metric.
+     * \param[in] gt_max maximum ground truth index to determine the number of ground truth segmentations
+     * \param[in] statistics statistics of the metric
      * \param[out] mat_sumamry summary as matrix
      * \param[out] output summary as CSV string
      */
-    void summarize(const std::vector<int> &gt, const cv::Mat &data, 
-            int j, cv::Mat &mat_summary, std::stringstream &output);
-    
-    /** \brief Compute mean statistic.
-     * \param[in] gt ground truth indices to determine the number of ground truth segmentations
-     * \param[in] data data to summarize
-     * \param[in] j the column
-     * \param[out] mean computed means as vector for each ground truth segmentation
-     * \param[out] mean_min minimum of means in case of multiple ground truth segmentations per image
-     * \param[out] mean_max maximum of means in case of multiple ground truth segmentations per image
-     */
-    float computeMean(const std::vector<int> gt, const cv::Mat &data, int j, 
-            std::vector<float> &mean, float &mean_min, float &mean_max);
-    
-    /** \brief Compute median statistic.
-     * \param[in] gt ground truth indices to determine the number of ground truth segmentations
-     * \param[in] data data to summarize
-     * \param[in] j the column
-     * \param[out] median computed medians as vector for each ground truth segmentation
-     * \param[out] median_min minimum of medians in case of multiple ground truth segmentations per image
-     * \param[out] median_max maximum of medians in case of multiple ground truth segmentations per image
-     */
-    float comuteMedian(const std::vector<int> gt, const cv::Mat &data, int j, 
-            std::vector<float> &median, float &median_min, float &median_max);
-    
-    /** \brief Compute median, first quartile and third quartile
-     * \param[in] gt ground truth indices to determine the number of ground truth segmentations
-     * \param[in] data data to summarize
-     * \param[in] j the column
-     * \param[out] median computed medians as vector for each ground truth segmentation
-     * \param[out] first_q computed first quantiles as vector for each ground truth segmentation
-     * \param[out] thrid_q computed third quantiles as vector for each ground truth segmentation
-     * \param[out] median_min minimum of medians in case of multiple ground truth segmentations per image
-     * \param[out] first_q_min minimum of first quantiles in case of multiple ground truth segmentations per image
-     * \param[out] third_q_min minimum of quantiles in case of multiple ground truth segmentations per image
-     * \param[out] median_max maximum of medians in case of multiple ground truth segmentations per image
-     * \param[out] first_q_max maximum of first quantiles in case of multiple ground truth segmentations per image
-     * \param[out] second_q_max maximum of quantiles in case of multiple ground truth segmentations per image
-     */
-    void comuteMedianFirstAndThirdQuartile(const std::vector<int> gt, const cv::Mat &data, int j, 
-            std::vector<float> &median, std::vector<float> &first_q, std::vector<float> &thrid_q, 
-            float &median_min, float &first_q_min, float &third_q_min, float &median_max,
-            float &first_q_max, float &second_q_max);
-    
-    /** \brief Compute min/max over all ground truth segmentations.
-     * \param[in] gt ground truth indices to determine the number of ground truth segmentations
-     * \param[in] data data to summarize
-     * \param[in] j the column
-     * \param[out] min minimum as vector for each ground truth segmentation
-     * \param[out] max maximum as vector for each ground truth segmentation
-     * \param[out] min_min minimum of minimum over all ground truth segmentations
-     * \param[out] max_min maximum of minimum over all ground truth segmentations
-     * \param[out] min_max minimum of maximum over all ground truth segmentations
-     * \param[out] max_max maximum of maximum over all ground truth segmentations
-     */
-    void comuteMinMax(const std::vector<int> gt, const cv::Mat &data, int j,
-            std::vector<float> &min, std::vector<float> &max, float &min_min,
-            float &max_min, float &min_max, float&max_max);
-    
-    /** \brief Compute standard deviation over all ground truth segmentations.
-     * \param[in] gt ground truth indices to determine the number of ground truth segmentations
-     * \param[in] data data to summarize
-     * \param[in] j the column
-     * \param[out] mean means as vector for each ground truth segmentation
-     * \param[out] std std as vector for each ground truth segmentation
-     * \param[out] std_min minimum of std over all ground truth segmentations
-     * \param[out] std_max maximum of std over all ground truth segmentations
-     */
-    float computeStandardDeviation(const std::vector<int> gt, const cv::Mat &data, int j,
-        const std::vector<float> &mean, std::vector<float> &std, float &std_min,
-        float &std_max);
+    void summarize(int gt_max, const MetricStatistics &statistics, 
+            cv::Mat &mat_summary, std::stringstream &output);
     
     /** \brief Evaluation metrics to use. */
     EvaluationMetrics evaluation_metrics;
@@ -372,6 +435,10 @@ protected:
     
     /** \brief Whether to compute correlation. */
     bool compute_correlation;
+    /** \brief Index of the shard to evaluate. */
+    int shard;
+    /** \brief Number of shards. */
+    int shards;
     
     /** \brief Directory of superpixel segmentations. */
     boost::filesystem::path sp_directory;
@@ -375,7 +375,7 @@ int IOUtil::readMatCSVFloat(boost::filesystem::path file, cv::Mat &result) {
         // Intialize output matrix.
         if (i == 0) {
             cols = data.size();
-            result.create(0, cols, CV_32SC1);
+            result.create(0, cols, CV_32FC1);
             
 //            LOG(INFO) << "Reading CSV file with " << cols << " columns (" 
 //                    << file.string() << ").";
@@ -384,7 +384,7 @@ int IOUtil::readMatCSVFloat(boost::filesystem::path file, cv::Mat &result) {
         LOG_IF (FATAL, data.size() != cols) << "Invalid CSV file: " << cols << "!=" 
                 << data.size() << " " << i << "(" << file.string() << ").";;
         
-        cv::Mat result_row(1, cols, CV_32SC1, cv::Scalar(0));
+        cv::Mat result_row(1, cols, CV_32FC1, cv::Scalar(0));
     
         for (int j = 0; j < cols; j++) {
             result_row.at<float>(0, j) = atof(data[j].c_str());
@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PARALLEL_UTIL_H
+#define	PARALLEL_UTIL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+/** \brief Threading utilities.
+ * \author David Stutz
+ */
+class ParallelUtil {
+public:
+    /** \brief Get the number of threads to use.
+     * \param[in] threads requested number of threads, <= 0 for all hardware threads
+     * \return number of threads, at least one
+     */
+    static int getNumThreads(int threads = 0) {
+        if (threads <= 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        
+        return std::max(1, threads);
+    }
+    
+    /** \brief Call f(i) for all i in [begin, end) using the given number of
+     * threads; indices are handed out one by one, so this is suited for 
+     * tasks of varying cost (e.g. images in a directory).
+     * 
+     * f is called concurrently and must be thread safe.
+     * 
+     * \param[in] begin first index
+     * \param[in] end one past last index
+     * \param[in] threads number of threads, <= 0 for all hardware threads
+     * \param[in] f function to call for each index
+     */
+    template<typename F>
+    static void parallelFor(int begin, int end, int threads, F f) {
+        threads = std::min(getNumThreads(threads), end - begin);
+        if (threads <= 1) {
+            for (int i = begin; i < end; ++i) {
+                f(i);
+            }
+            
+            return;
+        }
+        
+        std::atomic<int> next(begin);
+        std::vector<std::thread> workers;
+        
+        for (int t = 0; t < threads; ++t) {
+            workers.push_back(std::thread([&next, end, &f]() {
+                for (int i = next++; i < end; i = next++) {
+                    f(i);
+                }
+            }));
+        }
+        
+        for (unsigned int t = 0; t < workers.size(); ++t) {
+            workers[t].join();
+        }
+    }
+    
+    /** \brief Split the rows [0, rows) into the given number of contiguous
+     * strips and call f(strip, row_begin, row_end) for each strip on its
+     * own thread.
+     * \param[in] rows number of rows
+     * \param[in] strips number of strips, at most rows
+     * \param[in] f function to call for each strip
+     */
+    template<typename F>
+    static void parallelStrips(int rows, int strips, F f) {
+        strips = std::max(1, std::min(strips, rows));
+        if (strips == 1) {
+            f(0, 0, rows);
+            return;
+        }
+        
+        std::vector<std::thread> workers;
+        for (int s = 0; s < strips; ++s) {
+            workers.push_back(std::thread(f, s, getStripBegin(rows, strips, s), 
+                    getStripBegin(rows, strips, s + 1)));
+        }
+        
+        for (unsigned int s = 0; s < workers.size(); ++s) {
+            workers[s].join();
+        }
+    }
+    
+    /** \brief Barrier for the threads of one parallelStrips call, allowing
+     * to run several phases without starting new threads per phase.
+     */
+    class Barrier {
+    public:
+        /** \brief Constructor.
+         * \param[in] threads number of threads waiting at the barrier
+         */
+        Barrier(int threads_) : threads(threads_), waiting(0), generation(0) {
+            
+        }
+        
+        /** \brief Block until all threads reached the barrier. */
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            const int current = generation;
+            
+            if (++waiting == threads) {
+                waiting = 0;
+                generation++;
+                condition.notify_all();
+            }
+            else {
+                condition.wait(lock, [this, current]() { 
+                    return generation != current; 
+                });
+            }
+        }
+        
+    private:
+        /** \brief Number of threads. */
+        int threads;
+        /** \brief Number of threads currently waiting. */
+        int waiting;
+        /** \brief Incremented whenever all threads reached the barrier. */
+        int generation;
+        /** \brief Mutex protecting the counters. */
+        std::mutex mutex;
+        /** \brief Signaled when all threads reached the barrier. */
+        std::condition_variable condition;
+    };
+    
+    /** \brief First row of the given strip as used by parallelStrips.
+     * \param[in] rows number of rows
+     * \param[in] strips number of strips
+     * \param[in] strip strip index, strip == strips gives rows
+     * \return first row of strip
+     */
+    static int getStripBegin(int rows, int strips, int strip) {
+        return (int) (((long long) rows*strip)/strips);
+    }
+};
+
+#endif	/* PARALLEL_UTIL_H */
+
@@ -36,6 +36,7 @@
 #include <glog/logging.h>
 #include <sys/time.h>
 #include "io_util.h"
+#include "batch_server.h"
 #include "evaluation_summary.h"
 #include "parameter_optimization_tool.h"
 
@@ -88,6 +89,14 @@ void ParameterOptimizationTool::addPostProcessingCommandLine(std::string command
     post_processing_command_line = command_line;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// setBatchSocket
+////////////////////////////////////////////////////////////////////////////////
+
+void ParameterOptimizationTool::setBatchSocket(std::string socket_path) {
+    batch_socket = socket_path;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // addSuperpixelTolerance
 ////////////////////////////////////////////////////////////////////////////////
@@ -348,7 +357,7 @@ void ParameterOptimizationTool::optimize(float weight, float weight_ue, float we
 //        LOG(INFO) << "[" << k << "] " << command_line_k;
         
         // Run.
-        int status = system(command_line_k.c_str());
+        int status = BatchServer::execute(batch_socket, command_line_k);
         
         if (status != 0) {
             LOG(FATAL) << "Command line was not successful: " << command_line_k;
@@ -68,6 +68,13 @@ public:
      */
     void addPostProcessingCommandLine(std::string command_line);
     
+    /** \brief Submit the command lines to an algorithm serving jobs on the given
+     * socket (i.e. started with --socket) instead of starting a new process 
+     * per configuration, see BatchServer.
+     * \param[in] socket_path path of the socket, empty to start a process per configuration
+     */
+    void setBatchSocket(std::string socket_path);
+    
     /** \brief Some algorithms do not allow to control superpixels, therefore,
      * optimization may aim for a specific range of superpixel numbers.
      * \param[in] superpixels desired number of superpixels
@@ -132,6 +139,8 @@ protected:
     std::string command_line_parameters;
     /** \brief Command to use for post-processing. */
     std::string post_processing_command_line;
+    /** \brief Socket of the algorithm serving jobs, if any. */
+    std::string batch_socket;
     
     /** \brief Directory containing the images. */
     boost::filesystem::path img_directory;
@@ -0,0 +1,494 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <glog/logging.h>
+#include "region_adjacency_graph.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// RegionAdjacencyGraph
+////////////////////////////////////////////////////////////////////////////////
+
+RegionAdjacencyGraph::RegionAdjacencyGraph(const cv::Mat &image, const cv::Mat &labels, 
+        const cv::Mat &boundaries) : pixels(labels.rows*labels.cols), regions(0) {
+    
+    LOG_IF(FATAL, image.type() != CV_8UC3) << "Image has to be of type CV_8UC3.";
+    LOG_IF(FATAL, labels.type() != CV_32SC1) << "Labels have to be of type CV_32SC1.";
+    LOG_IF(FATAL, image.rows != labels.rows || image.cols != labels.cols) 
+            << "Image and labels have to be of the same size.";
+    LOG_IF(FATAL, !boundaries.empty() && boundaries.type() != CV_32FC1) 
+            << "Boundaries have to be of type CV_32FC1.";
+    LOG_IF(FATAL, !boundaries.empty() && (boundaries.rows != labels.rows 
+            || boundaries.cols != labels.cols)) 
+            << "Boundaries and labels have to be of the same size.";
+    
+    int max_label = -1;
+    for (int i = 0; i < labels.rows; i++) {
+        const int* labels_i = labels.ptr<int>(i);
+        for (int j = 0; j < labels.cols; j++) {
+            LOG_IF(FATAL, labels_i[j] < 0) << "Labels have to be non-negative.";
+            max_label = std::max(max_label, labels_i[j]);
+        }
+    }
+    
+    parents.resize(max_label + 1);
+    sizes.assign(max_label + 1, 0);
+    sums.assign(max_label + 1, cv::Vec3d(0, 0, 0));
+    adjacency.assign(max_label + 1, std::vector<int>());
+    lookup.assign(max_label + 1, -1);
+    
+    // Single pass collecting sizes, color sums and, for each pair of pixels
+    // across right and bottom edges, the edge value and boundary colors.
+    std::unordered_map<long long, int> indices;
+    for (int i = 0; i < labels.rows; i++) {
+        const int* labels_i = labels.ptr<int>(i);
+        const cv::Vec3b* image_i = image.ptr<cv::Vec3b>(i);
+        const float* boundaries_i = (boundaries.empty() ? 0 : boundaries.ptr<float>(i));
+        
+        for (int j = 0; j < labels.cols; j++) {
+            int label = labels_i[j];
+            
+            sizes[label]++;
+            sums[label][0] += image_i[j][0];
+            sums[label][1] += image_i[j][1];
+            sums[label][2] += image_i[j][2];
+            
+            for (int k = 0; k < 2; k++) {
+                const int ii = i + k;
+                const int jj = j + 1 - k;
+                if (ii >= labels.rows || jj >= labels.cols) {
+                    continue;
+                }
+                
+                const int neighbor = labels.ptr<int>(ii)[jj];
+                if (neighbor == label) {
+                    continue;
+                }
+                
+                const int first = std::min(label, neighbor);
+                const int second = std::max(label, neighbor);
+                const long long key = (long long) first*(max_label + 1) + second;
+                
+                std::unordered_map<long long, int>::iterator it = indices.find(key);
+                if (it == indices.end()) {
+                    Edge edge;
+                    edge.labels[0] = first;
+                    edge.labels[1] = second;
+                    edge.value = 0;
+                    edge.sums[0] = cv::Vec3d(0, 0, 0);
+                    edge.sums[1] = cv::Vec3d(0, 0, 0);
+                    edge.counts[0] = 0;
+                    edge.counts[1] = 0;
+                    edge.stamp = 0;
+                    
+                    it = indices.insert(std::make_pair(key, (int) edges.size())).first;
+                    adjacency[first].push_back(edges.size());
+                    adjacency[second].push_back(edges.size());
+                    edges.push_back(edge);
+                }
+                
+                Edge &edge = edges[it->second];
+                if (boundaries_i) {
+                    edge.value = std::max(edge.value, 
+                            std::abs(boundaries_i[j] - boundaries.ptr<float>(ii)[jj]));
+                }
+                
+                const cv::Vec3b &color = image_i[j];
+                const cv::Vec3b &neighbor_color = image.ptr<cv::Vec3b>(ii)[jj];
+                const int side = (label == first ? 0 : 1);
+                
+                edge.sums[side] += cv::Vec3d(color[0], color[1], color[2]);
+                edge.sums[1 - side] += cv::Vec3d(neighbor_color[0], neighbor_color[1], 
+                        neighbor_color[2]);
+                edge.counts[side]++;
+                edge.counts[1 - side]++;
+            }
+        }
+    }
+    
+    for (unsigned int k = 0; k < parents.size(); k++) {
+        parents[k] = k;
+        if (sizes[k] > 0) {
+            regions++;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getNumRegions
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::getNumRegions() const {
+    return regions;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getNumLabels
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::getNumLabels() const {
+    return parents.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getNumPixels
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::getNumPixels() const {
+    return pixels;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// find
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::find(int label) {
+    int root = label;
+    while (parents[root] != root) {
+        root = parents[root];
+    }
+    
+    while (parents[label] != root) {
+        int parent = parents[label];
+        parents[label] = root;
+        label = parent;
+    }
+    
+    return root;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getSize
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::getSize(int label) const {
+    return sizes[label];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMeanColor
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Vec3d RegionAdjacencyGraph::getMeanColor(int label) const {
+    return sums[label]/sizes[label];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getEdges
+////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<int>& RegionAdjacencyGraph::getEdges(int label) const {
+    return adjacency[label];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getEdge
+////////////////////////////////////////////////////////////////////////////////
+
+const RegionAdjacencyGraph::Edge& RegionAdjacencyGraph::getEdge(int e) const {
+    return edges[e];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// setEdgeValue
+////////////////////////////////////////////////////////////////////////////////
+
+bool RegionAdjacencyGraph::setEdgeValue(int label_1, int label_2, float value) {
+    const int e = findEdge(find(label_1), find(label_2));
+    if (e < 0) {
+        return false;
+    }
+    
+    edges[e].value = value;
+    edges[e].stamp++;
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mergeEdge
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::mergeEdge(int e) {
+    
+    // Merge the superpixel with fewer edges into the other one.
+    int from = edges[e].labels[0];
+    int to = edges[e].labels[1];
+    if (adjacency[from].size() > adjacency[to].size()) {
+        std::swap(from, to);
+    }
+    
+    std::vector<int> &to_edges = adjacency[to];
+    unsigned int live = 0;
+    for (unsigned int k = 0; k < to_edges.size(); k++) {
+        const Edge &edge = edges[to_edges[k]];
+        if (edge.stamp >= 0) {
+            lookup[edge.labels[0] == to ? edge.labels[1] : edge.labels[0]] = to_edges[k];
+            to_edges[live++] = to_edges[k];
+        }
+    }
+    to_edges.resize(live);
+    
+    std::vector<int> &from_edges = adjacency[from];
+    for (unsigned int k = 0; k < from_edges.size(); k++) {
+        Edge &edge = edges[from_edges[k]];
+        if (edge.stamp < 0) {
+            continue;
+        }
+        
+        const int side = (edge.labels[0] == from ? 0 : 1);
+        const int neighbor = edge.labels[1 - side];
+        
+        if (neighbor == to) {
+            edge.stamp = -1;
+        }
+        else if (lookup[neighbor] >= 0) {
+            
+            // Both superpixels are adjacent to the neighbor; combine the edges.
+            Edge &other = edges[lookup[neighbor]];
+            const int other_side = (other.labels[0] == to ? 0 : 1);
+            
+            other.value = std::max(other.value, edge.value);
+            other.sums[other_side] += edge.sums[side];
+            other.sums[1 - other_side] += edge.sums[1 - side];
+            other.counts[other_side] += edge.counts[side];
+            other.counts[1 - other_side] += edge.counts[1 - side];
+            edge.stamp = -1;
+        }
+        else {
+            edge.labels[side] = to;
+            lookup[neighbor] = from_edges[k];
+            to_edges.push_back(from_edges[k]);
+        }
+    }
+    std::vector<int>().swap(from_edges);
+    
+    live = 0;
+    for (unsigned int k = 0; k < to_edges.size(); k++) {
+        Edge &edge = edges[to_edges[k]];
+        lookup[edge.labels[0] == to ? edge.labels[1] : edge.labels[0]] = -1;
+        
+        // The cost of all remaining edges of the merged superpixel changes.
+        if (edge.stamp >= 0) {
+            edge.stamp++;
+            to_edges[live++] = to_edges[k];
+        }
+    }
+    to_edges.resize(live);
+    
+    parents[from] = to;
+    sizes[to] += sizes[from];
+    sums[to] += sums[from];
+    
+    regions--;
+    return to;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mergeIntoClosestNeighbor
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::mergeIntoClosestNeighbor(int label) {
+    LOG_IF(FATAL, parents[label] != label) << "Label " << label << " has already been merged.";
+    
+    int closest = -1;
+    double min_distance = std::numeric_limits<double>::max();
+    for (unsigned int k = 0; k < adjacency[label].size(); k++) {
+        const Edge &edge = edges[adjacency[label][k]];
+        if (edge.stamp < 0) {
+            continue;
+        }
+        
+        double distance = getColorDistance(edge.labels[0], edge.labels[1]);
+        if (distance < min_distance) {
+            min_distance = distance;
+            closest = adjacency[label][k];
+        }
+    }
+    
+    if (closest < 0) {
+        return -1;
+    }
+    
+    return mergeEdge(closest);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mergeSmallerThan
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::mergeSmallerThan(int size) {
+    typedef std::pair<int, int> Entry;
+    
+    // Min-heap of (size, label); entries are invalidated lazily when the
+    // label was merged or its size changed.
+    std::vector<Entry> entries;
+    for (unsigned int k = 0; k < parents.size(); k++) {
+        if (parents[k] == (int) k && sizes[k] > 0 && sizes[k] < size) {
+            entries.push_back(Entry(sizes[k], k));
+        }
+    }
+    
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > heap(
+            std::greater<Entry>(), entries);
+    
+    int count = 0;
+    while (!heap.empty()) {
+        Entry entry = heap.top();
+        heap.pop();
+        
+        int label = entry.second;
+        if (parents[label] != label || sizes[label] != entry.first) {
+            continue;
+        }
+        
+        int merged = mergeIntoClosestNeighbor(label);
+        if (merged < 0) {
+            continue;
+        }
+        
+        count++;
+        if (sizes[merged] < size) {
+            heap.push(Entry(sizes[merged], merged));
+        }
+    }
+    
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mergeSmallest
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::mergeSmallest(int number) {
+    std::vector<int> ids;
+    for (unsigned int k = 0; k < parents.size(); k++) {
+        if (parents[k] == (int) k && sizes[k] > 0) {
+            ids.push_back(k);
+        }
+    }
+    
+    std::stable_sort(ids.begin(), ids.end(), [this](int i, int j) {
+        return sizes[i] < sizes[j];
+    });
+    
+    if ((int) ids.size() > number) {
+        ids.resize(std::max(0, number));
+    }
+    
+    // Choose all targets before merging, so that colors and adjacency are
+    // those of the superpixels before this pass.
+    std::vector<bool> merged(parents.size(), false);
+    std::vector<std::pair<int, int> > merges;
+    for (unsigned int k = 0; k < ids.size(); k++) {
+        int label = ids[k];
+        
+        int closest = -1;
+        double min_distance = std::numeric_limits<double>::max();
+        for (unsigned int kk = 0; kk < adjacency[label].size(); kk++) {
+            const Edge &edge = edges[adjacency[label][kk]];
+            const int neighbor = (edge.labels[0] == label ? edge.labels[1] : edge.labels[0]);
+            if (edge.stamp < 0 || merged[neighbor]) {
+                continue;
+            }
+            
+            double distance = getColorDistance(label, neighbor);
+            if (distance < min_distance) {
+                min_distance = distance;
+                closest = neighbor;
+            }
+        }
+        
+        if (closest >= 0) {
+            merged[label] = true;
+            merges.push_back(std::pair<int, int>(label, closest));
+        }
+    }
+    
+    // The merges form a forest, so the two superpixels of each merge are
+    // still different and adjacent when it is applied.
+    for (unsigned int k = 0; k < merges.size(); k++) {
+        mergeEdge(findEdge(find(merges[k].first), find(merges[k].second)));
+    }
+    
+    return merges.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// findEdge
+////////////////////////////////////////////////////////////////////////////////
+
+int RegionAdjacencyGraph::findEdge(int label_1, int label_2) const {
+    const std::vector<int> &label_edges = adjacency[label_1];
+    for (unsigned int k = 0; k < label_edges.size(); k++) {
+        const Edge &edge = edges[label_edges[k]];
+        if (edge.stamp >= 0 && (edge.labels[0] == label_2 || edge.labels[1] == label_2)) {
+            return label_edges[k];
+        }
+    }
+    
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getColorDistance
+////////////////////////////////////////////////////////////////////////////////
+
+double RegionAdjacencyGraph::getColorDistance(int label, int other_label) const {
+    double distance = 0;
+    for (int c = 0; c < 3; c++) {
+        double difference = sums[label][c]/sizes[label] - sums[other_label][c]/sizes[other_label];
+        distance += difference*difference;
+    }
+    
+    return distance;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// relabel
+////////////////////////////////////////////////////////////////////////////////
+
+void RegionAdjacencyGraph::relabel(cv::Mat &labels) {
+    std::vector<int> roots(parents.size());
+    for (unsigned int k = 0; k < parents.size(); k++) {
+        roots[k] = find(k);
+    }
+    
+    for (int i = 0; i < labels.rows; i++) {
+        int* labels_i = labels.ptr<int>(i);
+        for (int j = 0; j < labels.cols; j++) {
+            labels_i[j] = roots[labels_i[j]];
+        }
+    }
+}
@@ -0,0 +1,205 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef REGION_ADJACENCY_GRAPH_H
+#define	REGION_ADJACENCY_GRAPH_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Region adjacency graph over superpixels with mean colors, sizes,
+ * edge statistics and union-find merging, used to remove small superpixels
+ * and as basis of SuperpixelMerger.
+ * 
+ * The graph is built in a single pass over the labels. Merged superpixels
+ * are represented by their union-find root, so merging does not require
+ * relabeling the image; the labels are only rewritten once by relabel.
+ * For each pair of adjacent superpixels, an edge keeps an edge value and the
+ * colors of the boundary pixels on either side; edges are combined when
+ * superpixels are merged.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   RegionAdjacencyGraph graph(image, labels);
+ *   int merged = graph.mergeSmallerThan(size);
+ *   graph.relabel(labels);
+ * \endcode
+ * \author David Stutz
+ */
+class RegionAdjacencyGraph {
+public:
+    
+    /** \brief Adjacency between two current superpixels. */
+    struct Edge {
+        /** \brief Current superpixels. */
+        int labels[2];
+        /** \brief Edge value. */
+        float value;
+        /** \brief Color sums of the boundary pixels on either side. */
+        cv::Vec3d sums[2];
+        /** \brief Number of boundary pixels on either side. */
+        int counts[2];
+        /** \brief Incremented whenever the edge or one of its superpixels
+         * changes; -1 once the edge was merged or combined. */
+        int stamp;
+    };
+    
+    /** \brief Constructor, builds the graph.
+     * \param[in] image image of type CV_8UC3 used for the colors
+     * \param[in] labels non-negative superpixel labels of type CV_32SC1
+     * \param[in] boundaries optional boundary map of type CV_32FC1, the edge
+     * value is the maximum absolute difference across the common boundary
+     */
+    RegionAdjacencyGraph(const cv::Mat &image, const cv::Mat &labels, 
+            const cv::Mat &boundaries = cv::Mat());
+    
+    /** \brief Get the number of non-empty superpixels not yet merged.
+     * \return number of superpixels
+     */
+    int getNumRegions() const;
+    
+    /** \brief Get the number of labels, i.e. the largest label plus one.
+     * \return number of labels
+     */
+    int getNumLabels() const;
+    
+    /** \brief Get the number of pixels.
+     * \return number of pixels
+     */
+    int getNumPixels() const;
+    
+    /** \brief Get the superpixel a label has been merged into.
+     * \param[in] label original label
+     * \return current label
+     */
+    int find(int label);
+    
+    /** \brief Get the size of a superpixel.
+     * \param[in] label current label
+     * \return size
+     */
+    int getSize(int label) const;
+    
+    /** \brief Get the mean color of a superpixel.
+     * \param[in] label current label
+     * \return mean color
+     */
+    cv::Vec3d getMeanColor(int label) const;
+    
+    /** \brief Get the edges of a superpixel.
+     * \param[in] label current label
+     * \return edge indices, possibly including edges with negative stamp
+     */
+    const std::vector<int>& getEdges(int label) const;
+    
+    /** \brief Get an edge.
+     * \param[in] e edge index
+     * \return edge
+     */
+    const Edge& getEdge(int e) const;
+    
+    /** \brief Set the edge value between two adjacent superpixels.
+     * \param[in] label_1 first superpixel
+     * \param[in] label_2 second superpixel
+     * \param[in] value edge value
+     * \return whether the superpixels are adjacent
+     */
+    bool setEdgeValue(int label_1, int label_2, float value);
+    
+    /** \brief Merge the two superpixels of an edge.
+     * \param[in] e index of an edge with non-negative stamp
+     * \return current label of the merged superpixel
+     */
+    int mergeEdge(int e);
+    
+    /** \brief Merge a superpixel into the neighbor with the closest mean color.
+     * \param[in] label superpixel to merge, has to be a current label
+     * \return current label of the merged superpixel or -1 if the superpixel
+     * has no neighbors
+     */
+    int mergeIntoClosestNeighbor(int label);
+    
+    /** \brief Repeatedly merge the smallest superpixel below the given size
+     * until all superpixels have at least the given size.
+     * \param[in] size minimum superpixel size
+     * \return number of merges
+     */
+    int mergeSmallerThan(int size);
+    
+    /** \brief Merge the given number of smallest superpixels in a single pass.
+     * 
+     * The superpixels to merge are selected by their size before merging.
+     * Each selected superpixel, from smallest to largest, is merged into the
+     * neighbor with the closest mean color among the neighbors not merged
+     * in this pass; colors and adjacency are those before the pass.
+     * \param[in] number number of superpixels to merge
+     * \return number of merges actually done
+     */
+    int mergeSmallest(int number);
+    
+    /** \brief Write the current labels to the label image.
+     * \param[in,out] labels labels the graph was built from
+     */
+    void relabel(cv::Mat &labels);
+    
+private:
+    
+    /** \brief Find the edge between two current superpixels.
+     * \param[in] label_1 first superpixel
+     * \param[in] label_2 second superpixel
+     * \return edge index or -1 if not adjacent
+     */
+    int findEdge(int label_1, int label_2) const;
+    
+    /** \brief Squared distance between the mean colors of two labels. */
+    double getColorDistance(int label, int other_label) const;
+    
+    /** \brief Union-find parent per label. */
+    std::vector<int> parents;
+    /** \brief Size per label. */
+    std::vector<int> sizes;
+    /** \brief Color sum per label. */
+    std::vector<cv::Vec3d> sums;
+    /** \brief Edge indices per label, possibly including merged edges. */
+    std::vector< std::vector<int> > adjacency;
+    /** \brief All edges. */
+    std::vector<Edge> edges;
+    /** \brief Edge index per neighbor, -1 if not adjacent; used while merging. */
+    std::vector<int> lookup;
+    /** \brief Number of pixels. */
+    int pixels;
+    /** \brief Number of current superpixels. */
+    int regions;
+    
+};
+
+#endif	/* REGION_ADJACENCY_GRAPH_H */
+
@@ -33,6 +33,7 @@
 #include <glog/logging.h>
 #include "transformation.h"
 #include "io_util.h"
+#include "batch_server.h"
 #include "evaluation_summary.h"
 #include "robustness_tool.h"
 
@@ -55,6 +56,14 @@ void RobustnessTool::setFilesToKeep(const std::vector<std::string> &files_) {
     files = files_;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// RobustnessTool::setBatchSocket
+////////////////////////////////////////////////////////////////////////////////
+
+void RobustnessTool::setBatchSocket(const std::string &socket_path) {
+    batch_socket = socket_path;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // RobustnessTool::evaluate
 ////////////////////////////////////////////////////////////////////////////////
@@ -164,7 +173,7 @@ void RobustnessTool::evaluate() {
                 + " -i " + current_image_directory.string() 
                 + " -o " + current_superpixel_directory.string();
         
-        int status = system(current_command_line.c_str());
+        int status = BatchServer::execute(batch_socket, current_command_line);
         
         if (status != 0) {
             LOG(FATAL) << "Command line was not successful: " << current_command_line;
@@ -228,8 +237,8 @@ void RobustnessTool::cleanDirectory(boost::filesystem::path directory) {
 // GaussianNoiseDriver::GaussianNoiseDriver
 ////////////////////////////////////////////////////////////////////////////////
 
-GaussianNoiseDriver::GaussianNoiseDriver(std::string type_, const std::vector<float> &variances_)
-        : type(type_), variances(variances_), current(0) {
+GaussianNoiseDriver::GaussianNoiseDriver(std::string type_, const std::vector<float> &variances_,
+        unsigned int seed_) : type(type_), variances(variances_), current(0), seed(seed_) {
     
     if (type != "additive" && type != "sampling") {
         LOG(FATAL) << "Only 'additive' or 'sampling' type supported.";
@@ -244,10 +253,10 @@ GaussianNoiseDriver::GaussianNoiseDriver(std::string type_, const std::vector<fl
 
 void GaussianNoiseDriver::computeImage(const cv::Mat& image, cv::Mat& computed_image) {
     if (type == "additive") {
-        Transformation::applyGaussianAdditiveNoise(image, variances[current], computed_image);
+        Transformation::applyGaussianAdditiveNoise(image, variances[current], computed_image, seed);
     }
     else if (type == "sampling") {
-        Transformation::applyGaussianSamplingErrors(image, variances[current], computed_image);
+        Transformation::applyGaussianSamplingErrors(image, variances[current], computed_image, seed);
     }
 }
 
@@ -282,7 +291,7 @@ std::string GaussianNoiseDriver::identify() {
 // PoissonNoiseDriver::PoissonNoiseDriver
 ////////////////////////////////////////////////////////////////////////////////
 
-PoissonNoiseDriver::PoissonNoiseDriver() {
+PoissonNoiseDriver::PoissonNoiseDriver(unsigned int seed_) : seed(seed_) {
     
 }
 
@@ -291,7 +300,7 @@ PoissonNoiseDriver::PoissonNoiseDriver() {
 ////////////////////////////////////////////////////////////////////////////////
 
 void PoissonNoiseDriver::computeImage(const cv::Mat& image, cv::Mat& computed_image) {
-    Transformation::applyPoissonNoise(image, computed_image);
+    Transformation::applyPoissonNoise(image, computed_image, seed);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -324,7 +333,8 @@ std::string PoissonNoiseDriver::identify() {
 // SaltAndPepperNoiseDriver::SaltAndPepperNoiseDriver
 ////////////////////////////////////////////////////////////////////////////////
 
-SaltAndPepperNoiseDriver::SaltAndPepperNoiseDriver(const std::vector<float> &probabilities_) : probabilities(probabilities_), current(0) {
+SaltAndPepperNoiseDriver::SaltAndPepperNoiseDriver(const std::vector<float> &probabilities_, 
+        unsigned int seed_) : probabilities(probabilities_), current(0), seed(seed_) {
     LOG_IF(FATAL, probabilities.size() <= 0) << "Empty vector given.";
 }
 
@@ -333,7 +343,7 @@ SaltAndPepperNoiseDriver::SaltAndPepperNoiseDriver(const std::vector<float> &pro
 ////////////////////////////////////////////////////////////////////////////////
 
 void SaltAndPepperNoiseDriver::computeImage(const cv::Mat& image, cv::Mat& computed_image) {
-    Transformation::applySaltAndPepperNoise(image, probabilities[current], computed_image);
+    Transformation::applySaltAndPepperNoise(image, probabilities[current], computed_image, seed);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -85,6 +85,13 @@ public:
      */
     void setFilesToKeep(const std::vector<std::string> &files);
     
+    /** \brief Submit the command lines to an algorithm serving jobs on the given
+     * socket (i.e. started with --socket) instead of starting a new process 
+     * per transformation, see BatchServer.
+     * \param[in] socket_path path of the socket, empty to start a process per transformation
+     */
+    void setBatchSocket(const std::string &socket_path);
+    
     /** \brief Evaluate.
      */
     void evaluate();
@@ -105,6 +112,8 @@ private:
     
     /** \brief Command line to use for algorithm. */
     std::string command_line;
+    /** \brief Socket of the algorithm serving jobs, if any. */
+    std::string batch_socket;
     
     /** \brief Driver to use to transform images and transformations. */
     RobustnessToolDriver* driver;    
@@ -122,8 +131,11 @@ public:
     /** \brief Constructor.
      * @param type noise or sampling error
      * @param variances variances of the Gaussian distribution to try
+     * @param seed seed of the noise, 0 for a random seed per image; with a fixed
+     * seed all variances perturb an image with the same random numbers
      */
-    GaussianNoiseDriver(std::string type, const std::vector<float> &variances);
+    GaussianNoiseDriver(std::string type, const std::vector<float> &variances, 
+            unsigned int seed = 0);
     
     /** \brief Apply the transformation with the current parameters.
      * \param[in] image input image to apply transformation on
@@ -157,6 +169,9 @@ private:
     
     /** \brief Index of current variance. */
     int current;
+    
+    /** \brief Seed of the noise. */
+    unsigned int seed;
 };
 
 /** \brief Poisson noise driver.
@@ -165,8 +180,9 @@ class PoissonNoiseDriver : public RobustnessToolDriver {
 public:
     
     /** \brief Constructor.
+     * \param[in] seed seed of the noise, 0 for a random seed per image
      */
-    PoissonNoiseDriver();
+    PoissonNoiseDriver(unsigned int seed = 0);
     
     /** \brief Apply the transformation with the current parameters.
      * \param[in] image input image to apply transformation on
@@ -190,6 +206,11 @@ public:
      */
     std::string identify();
     
+private:
+    
+    /** \brief Seed of the noise. */
+    unsigned int seed;
+    
 };
 
 /** \brief Salt and pepper noise driver. 
@@ -199,8 +220,10 @@ public:
     
     /** \brief Constructor.
      * \param[in] probabilities probabilities of salt or pepper to evaluate
+     * \param[in] seed seed of the noise, 0 for a random seed per image
      */
-    SaltAndPepperNoiseDriver(const std::vector<float> &probabilities);
+    SaltAndPepperNoiseDriver(const std::vector<float> &probabilities, 
+            unsigned int seed = 0);
     
     /** \brief Apply the transformation with the current parameters.
      * \param[in] image input image to apply transformation on
@@ -232,6 +255,9 @@ private:
     /** \brief Current probability index. */
     int current;
     
+    /** \brief Seed of the noise. */
+    unsigned int seed;
+    
 };
 
 /** \brief Blur driver.
@@ -0,0 +1,293 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <glog/logging.h>
+#include "streaming_statistics.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// StreamingStatistics
+////////////////////////////////////////////////////////////////////////////////
+
+StreamingStatistics::StreamingStatistics(int capacity_) 
+        : capacity(std::max(2, capacity_)), count(0), mean(0), m2(0), 
+        min(0), max(0), levels(1), compactions(0) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// add
+////////////////////////////////////////////////////////////////////////////////
+
+void StreamingStatistics::add(double value) {
+    if (count == 0) {
+        min = value;
+        max = value;
+    }
+    else {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    
+    ++count;
+    double delta = value - mean;
+    mean += delta/count;
+    m2 += delta*(value - mean);
+    
+    levels[0].push_back(value);
+    if ((int) levels[0].size() > capacity) {
+        compact(0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// compact
+////////////////////////////////////////////////////////////////////////////////
+
+void StreamingStatistics::compact(int level) {
+    for (unsigned int h = level; h < levels.size(); ++h) {
+        if ((int) levels[h].size() <= capacity) {
+            continue;
+        }
+        
+        if (h + 1 == levels.size()) {
+            levels.push_back(std::vector<double>());
+        }
+        
+        std::vector<double> &values = levels[h];
+        std::sort(values.begin(), values.end());
+        
+        // Each pair of neighboring values is replaced by one of them with
+        // twice the weight; alternating between the smaller and the larger
+        // one avoids a systematic bias.
+        int offset = compactions%2;
+        int pairs = values.size()/2;
+        for (int i = 0; i < pairs; ++i) {
+            levels[h + 1].push_back(values[2*i + offset]);
+        }
+        
+        if (values.size()%2 == 1) {
+            double last = values.back();
+            values.clear();
+            values.push_back(last);
+        }
+        else {
+            values.clear();
+        }
+        
+        ++compactions;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCount
+////////////////////////////////////////////////////////////////////////////////
+
+long StreamingStatistics::getCount() const {
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMean
+////////////////////////////////////////////////////////////////////////////////
+
+double StreamingStatistics::getMean() const {
+    return mean;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getVariance
+////////////////////////////////////////////////////////////////////////////////
+
+double StreamingStatistics::getVariance() const {
+    if (count == 0) {
+        return 0;
+    }
+    
+    return std::max(0., m2/count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getStandardDeviation
+////////////////////////////////////////////////////////////////////////////////
+
+double StreamingStatistics::getStandardDeviation() const {
+    return std::sqrt(getVariance());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMin
+////////////////////////////////////////////////////////////////////////////////
+
+double StreamingStatistics::getMin() const {
+    return min;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMax
+////////////////////////////////////////////////////////////////////////////////
+
+double StreamingStatistics::getMax() const {
+    return max;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getQuantile
+////////////////////////////////////////////////////////////////////////////////
+
+double StreamingStatistics::getValueAtRank(const std::vector< std::pair<double, long> > &items, 
+        long rank) {
+    
+    long total = 0;
+    for (unsigned int i = 0; i < items.size(); ++i) {
+        total += items[i].second;
+        
+        if (total > rank) {
+            return items[i].first;
+        }
+    }
+    
+    return items.back().first;
+}
+
+double StreamingStatistics::getQuantile(double p) const {
+    LOG_IF(FATAL, p > 1 || p < 0) << "Cannot compute p-quantile for p > 1 or p < 0.";
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    std::vector< std::pair<double, long> > items;
+    for (unsigned int h = 0; h < levels.size(); ++h) {
+        for (unsigned int i = 0; i < levels[h].size(); ++i) {
+            items.push_back(std::pair<double, long>(levels[h][i], 1L << h));
+        }
+    }
+    
+    std::sort(items.begin(), items.end());
+    
+    if (p == 0.5) {
+        if (count%2 == 0) {
+            return (getValueAtRank(items, count/2) + getValueAtRank(items, count/2 + 1))/2;
+        }
+        else {
+            return getValueAtRank(items, count/2);
+        }
+    }
+    
+    return (getValueAtRank(items, std::floor(p*count)) 
+            + getValueAtRank(items, std::ceil(p*count)))/2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getMedian
+////////////////////////////////////////////////////////////////////////////////
+
+double StreamingStatistics::getMedian() const {
+    return getQuantile(0.5);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// StreamingCovariance
+////////////////////////////////////////////////////////////////////////////////
+
+StreamingCovariance::StreamingCovariance(int dimension_) 
+        : dimension(dimension_), count(0), means(dimension_, 0), 
+        comoments(dimension_*dimension_, 0) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// add
+////////////////////////////////////////////////////////////////////////////////
+
+void StreamingCovariance::add(const std::vector<double> &sample) {
+    LOG_IF(FATAL, (int) sample.size() != dimension) << "Invalid sample dimension: "
+            << sample.size() << " != " << dimension << ".";
+    
+    ++count;
+    
+    std::vector<double> deltas(dimension);
+    for (int i = 0; i < dimension; ++i) {
+        deltas[i] = sample[i] - means[i];
+        means[i] += deltas[i]/count;
+    }
+    
+    for (int i = 0; i < dimension; ++i) {
+        for (int j = 0; j < dimension; ++j) {
+            comoments[i*dimension + j] += deltas[i]*(sample[j] - means[j]);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCount
+////////////////////////////////////////////////////////////////////////////////
+
+long StreamingCovariance::getCount() const {
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getDimension
+////////////////////////////////////////////////////////////////////////////////
+
+int StreamingCovariance::getDimension() const {
+    return dimension;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCovariance
+////////////////////////////////////////////////////////////////////////////////
+
+double StreamingCovariance::getCovariance(int i, int j) const {
+    LOG_IF(FATAL, i < 0 || i >= dimension || j < 0 || j >= dimension) 
+            << "Invalid variable index.";
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    return comoments[i*dimension + j]/count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getCorrelation
+////////////////////////////////////////////////////////////////////////////////
+
+double StreamingCovariance::getCorrelation(int i, int j) const {
+    LOG_IF(FATAL, i < 0 || i >= dimension || j < 0 || j >= dimension) 
+            << "Invalid variable index.";
+    
+    return comoments[i*dimension + j]/(std::sqrt(comoments[i*dimension + i])
+            *std::sqrt(comoments[j*dimension + j]));
+}
@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STREAMING_STATISTICS_H
+#define	STREAMING_STATISTICS_H
+
+#include <vector>
+
+/** \brief Online statistics of a stream of values in bounded memory: count,
+ * mean and variance (Welford), minimum and maximum as well as a
+ * quantile sketch for median and quartiles.
+ * 
+ * The sketch keeps a hierarchy of buffers where values in level h carry
+ * weight 2^h; a level holding more than capacity values is sorted and every
+ * second value is promoted to the next level (as in the KLL sketch). As long
+ * as no more than capacity values were added, quantiles are exact; afterwards,
+ * the rank error is roughly proportional to log(count/capacity)/capacity.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   StreamingStatistics statistics;
+ *   for (int i = 0; i < n; ++i) {
+ *       statistics.add(values[i]);
+ *   }
+ *   double median = statistics.getMedian();
+ * \endcode
+ * \author David Stutz
+ */
+class StreamingStatistics {
+public:
+    /** \brief Constructor.
+     * \param[in] capacity size of a sketch level, at least 2
+     */
+    StreamingStatistics(int capacity = 1024);
+    
+    /** \brief Add a value.
+     * \param[in] value value to add
+     */
+    void add(double value);
+    
+    /** \brief Get the number of values added.
+     * \return number of values
+     */
+    long getCount() const;
+    
+    /** \brief Get the mean, 0 if no values were added.
+     * \return mean
+     */
+    double getMean() const;
+    
+    /** \brief Get the (population) variance, 0 if no values were added.
+     * \return variance
+     */
+    double getVariance() const;
+    
+    /** \brief Get the (population) standard deviation.
+     * \return standard deviation
+     */
+    double getStandardDeviation() const;
+    
+    /** \brief Get the minimum, 0 if no values were added.
+     * \return minimum
+     */
+    double getMin() const;
+    
+    /** \brief Get the maximum, 0 if no values were added.
+     * \return maximum
+     */
+    double getMax() const;
+    
+    /** \brief Get the p-quantile; the median averages the values at ranks
+     * count/2 and count/2 + 1 for even counts, all other quantiles average
+     * the values at ranks floor(p*count) and ceil(p*count).
+     * \param[in] p in [0, 1]
+     * \return p-quantile, 0 if no values were added
+     */
+    double getQuantile(double p) const;
+    
+    /** \brief Get the median.
+     * \return median
+     */
+    double getMedian() const;
+    
+private:
+    
+    /** \brief Compact all full levels starting with the given one.
+     * \param[in] level level to start with
+     */
+    void compact(int level);
+    
+    /** \brief Get the value at the given rank of the (weighted) sorted values.
+     * \param[in] items sorted values with weights
+     * \param[in] rank rank, clamped to [0, count - 1]
+     * \return value
+     */
+    static double getValueAtRank(const std::vector< std::pair<double, long> > &items, long rank);
+    
+    /** \brief Size of a sketch level. */
+    int capacity;
+    /** \brief Number of values. */
+    long count;
+    /** \brief Running mean. */
+    double mean;
+    /** \brief Running sum of squared differences to the mean. */
+    double m2;
+    /** \brief Minimum. */
+    double min;
+    /** \brief Maximum. */
+    double max;
+    /** \brief Sketch levels, values in level h have weight 2^h. */
+    std::vector< std::vector<double> > levels;
+    /** \brief Number of compactions, used to alternate the offset of the 
+     * promoted values. */
+    long compactions;
+    
+};
+
+/** \brief Online covariance and correlation between several variables, 
+ * e.g. metrics, in memory independent of the number of samples.
+ * \author David Stutz
+ */
+class StreamingCovariance {
+public:
+    /** \brief Constructor.
+     * \param[in] dimension number of variables
+     */
+    StreamingCovariance(int dimension = 0);
+    
+    /** \brief Add a sample.
+     * \param[in] sample sample of size dimension
+     */
+    void add(const std::vector<double> &sample);
+    
+    /** \brief Get the number of samples.
+     * \return number of samples
+     */
+    long getCount() const;
+    
+    /** \brief Get the number of variables.
+     * \return dimension
+     */
+    int getDimension() const;
+    
+    /** \brief Get the (population) covariance between two variables.
+     * \param[in] i first variable
+     * \param[in] j second variable
+     * \return covariance
+     */
+    double getCovariance(int i, int j) const;
+    
+    /** \brief Get the correlation coefficient between two variables.
+     * \param[in] i first variable
+     * \param[in] j second variable
+     * \return correlation
+     */
+    double getCorrelation(int i, int j) const;
+    
+private:
+    
+    /** \brief Number of variables. */
+    int dimension;
+    /** \brief Number of samples. */
+    long count;
+    /** \brief Running means. */
+    std::vector<double> means;
+    /** \brief Running co-moments, row major. */
+    std::vector<double> comoments;
+    
+};
+
+#endif	/* STREAMING_STATISTICS_H */
+
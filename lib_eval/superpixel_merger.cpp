@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <glog/logging.h>
+#include "superpixel_merger.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// SuperpixelMerger
+////////////////////////////////////////////////////////////////////////////////
+
+SuperpixelMerger::SuperpixelMerger(const cv::Mat &image, const cv::Mat &labels, 
+        const cv::Mat &boundaries) : RegionAdjacencyGraph(image, labels, boundaries) {
+    
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeCost
+////////////////////////////////////////////////////////////////////////////////
+
+double SuperpixelMerger::computeCost(const Edge &edge, const double* parameters) const {
+    const int size_0 = getSize(edge.labels[0]);
+    const int size_1 = getSize(edge.labels[1]);
+    const int min_size = std::min(size_0, size_1);
+    const int max_size = std::max(size_0, size_1);
+    
+    const int small = (size_0 < size_1 ? 0 : 1);
+    const int large = 1 - small;
+    
+    cv::Vec3d small_color = getMeanColor(edge.labels[small]);
+    cv::Vec3d large_color = getMeanColor(edge.labels[large]);
+    if (max_size > 5*min_size) {
+        large_color = edge.sums[large]/edge.counts[large];
+    }
+    
+    const double color_distance = cv::norm(small_color - large_color)/255.;
+    
+    // Step of the thresholds per iteration, see merge_sups.
+    const double step = 0.04*std::exp(-(parameters[2]*min_size)/parameters[5]);
+    const double edge_iterations = (edge.value - parameters[0])/(parameters[3]*step);
+    const double color_iterations = (color_distance - parameters[1])/(parameters[4]*step);
+    
+    return std::max(edge_iterations, color_iterations);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// merge
+////////////////////////////////////////////////////////////////////////////////
+
+int SuperpixelMerger::merge(int superpixels, double threshold, double color_threshold,
+        double sigma, double edge_modifier, double color_modifier) {
+    
+    LOG_IF(FATAL, superpixels <= 0) << "Number of superpixels has to be positive.";
+    LOG_IF(FATAL, edge_modifier <= 0 || color_modifier <= 0) 
+            << "Edge and color modifiers have to be positive.";
+    
+    if (getNumRegions() <= superpixels) {
+        return 0;
+    }
+    
+    // Desired size as in compute_desired_size: superpixels larger than the
+    // desired size are excluded until the size does not change anymore.
+    const int pixels = getNumPixels();
+    std::vector<bool> excluded(getNumLabels(), false);
+    int remaining_pixels = pixels;
+    int remaining_superpixels = superpixels;
+    double desired = remaining_pixels/(double) remaining_superpixels;
+    double previous_desired = desired + 1;
+    
+    while (previous_desired != desired) {
+        previous_desired = desired;
+        for (int k = 0; k < getNumLabels(); k++) {
+            if (find(k) == k && getSize(k) > desired && !excluded[k]) {
+                remaining_pixels -= getSize(k);
+                remaining_superpixels--;
+                excluded[k] = true;
+            }
+        }
+        
+        if (remaining_superpixels <= 0 || remaining_pixels <= 0) {
+            desired = pixels/(double) superpixels;
+            break;
+        }
+        
+        desired = remaining_pixels/(double) remaining_superpixels;
+    }
+    
+    const double parameters[6] = {threshold, color_threshold, sigma, 
+        edge_modifier, color_modifier, desired};
+    
+    // Min-heap of (cost, (stamp, edge)); entries are invalidated lazily when
+    // the stamp of the edge changed.
+    typedef std::pair<double, std::pair<int, int> > Entry;
+    std::vector<Entry> entries;
+    for (int k = 0; k < getNumLabels(); k++) {
+        const std::vector<int> &label_edges = getEdges(k);
+        for (unsigned int kk = 0; kk < label_edges.size(); kk++) {
+            const Edge &edge = getEdge(label_edges[kk]);
+            if (edge.stamp >= 0 && edge.labels[0] == k) {
+                entries.push_back(Entry(computeCost(edge, parameters), 
+                        std::make_pair(edge.stamp, label_edges[kk])));
+            }
+        }
+    }
+    
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > heap(
+            std::greater<Entry>(), entries);
+    
+    int count = 0;
+    while (!heap.empty() && getNumRegions() > superpixels) {
+        Entry entry = heap.top();
+        heap.pop();
+        
+        const int e = entry.second.second;
+        if (getEdge(e).stamp != entry.second.first) {
+            continue;
+        }
+        
+        const int to = mergeEdge(e);
+        count++;
+        
+        const std::vector<int> &to_edges = getEdges(to);
+        for (unsigned int k = 0; k < to_edges.size(); k++) {
+            const Edge &edge = getEdge(to_edges[k]);
+            heap.push(Entry(computeCost(edge, parameters), 
+                    std::make_pair(edge.stamp, to_edges[k])));
+        }
+    }
+    
+    return count;
+}
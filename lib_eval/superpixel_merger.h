@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SUPERPIXEL_MERGER_H
+#define	SUPERPIXEL_MERGER_H
+
+#include <opencv2/opencv.hpp>
+#include "region_adjacency_graph.h"
+
+/** \brief Hierarchical merging of superpixels approximating the merging stage
+ * of POISE (SuperPixelMerger in lib_poise/merge_superpixels2.cpp), usable on
+ * the output of any algorithm.
+ * 
+ * POISE merges two adjacent superpixels in iteration t if the edge value
+ * between them is below threshold + 0.04*(t - 1)*exp(-sigma*s/d)*edge_modifier
+ * and their color distance is below color_threshold 
+ * + 0.04*(t - 1)*exp(-sigma*s/d)*color_modifier, where s is the size of the
+ * smaller superpixel and d the desired superpixel size. 
+ * 
+ * This is an approximation, not a port: POISE merges all mergeable cliques
+ * found by find_merge_cliques per iteration with fixed thresholds, while here
+ * the (fractional) iteration in which a pair becomes mergeable is used as its
+ * cost and the cheapest pair is merged one at a time, updating the costs of 
+ * the merged superpixel. The merge order, and therefore the result, generally
+ * differs from POISE.
+ * 
+ * The edge value of two superpixels is taken from the RegionAdjacencyGraph,
+ * i.e. the maximum absolute difference of the boundary map across their 
+ * common boundary (zero without boundary map) unless set explicitly. 
+ * If one superpixel is more than five times larger than the other, the color
+ * of the larger one is taken along the common boundary instead of its mean,
+ * corresponding to the small superpixel merging of POISE.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   SuperpixelMerger merger(image, labels);
+ *   merger.merge(superpixels);
+ *   merger.relabel(labels);
+ * \endcode
+ * \author David Stutz
+ */
+class SuperpixelMerger : public RegionAdjacencyGraph {
+public:
+    /** \brief Constructor, builds the graph.
+     * \param[in] image image of type CV_8UC3 used for the colors
+     * \param[in] labels non-negative superpixel labels of type CV_32SC1
+     * \param[in] boundaries optional boundary map of type CV_32FC1, usually in [0,1]
+     */
+    SuperpixelMerger(const cv::Mat &image, const cv::Mat &labels, 
+            const cv::Mat &boundaries = cv::Mat());
+    
+    /** \brief Merge superpixels until at most the given number remains; can
+     * be called repeatedly with decreasing numbers to obtain a hierarchy.
+     * \param[in] superpixels number of superpixels to merge down to
+     * \param[in] threshold starting threshold on the edge values
+     * \param[in] color_threshold starting threshold on the color distances
+     * \param[in] sigma the larger sigma, the smaller the superpixels
+     * \param[in] edge_modifier step size on the edge threshold
+     * \param[in] color_modifier step size on the color threshold
+     * \return number of merges
+     */
+    int merge(int superpixels, double threshold = 0.03, double color_threshold = 0.03,
+            double sigma = 1.5, double edge_modifier = 0.8, double color_modifier = 0.6);
+    
+private:
+    
+    /** \brief Cost of merging along an edge, see the class description.
+     * \param[in] edge edge
+     * \param[in] parameters threshold, color_threshold, sigma, edge_modifier,
+     * color_modifier and desired size
+     * \return cost
+     */
+    double computeCost(const Edge &edge, const double* parameters) const;
+    
+};
+
+#endif	/* SUPERPIXEL_MERGER_H */
+
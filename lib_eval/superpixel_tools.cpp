@@ -30,7 +30,9 @@
  */
 
 #include <glog/logging.h>
-#include "connected_components.h"
+#include "connected_labeling.h"
+#include "region_adjacency_graph.h"
+#include "superpixel_merger.h"
 #include "superpixel_tools.h"
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -169,13 +171,19 @@ float computeDistance(const cv::Vec3b &x, const cv::Vec3b &y) {
             + (x[2] - y[2])*(x[2] - y[2]);
 }
 
+float computeDistance(const cv::Vec3b &x, const cv::Vec3f &y) {
+    return (x[0] - y[0])*(x[0] - y[0])
+            + (x[1] - y[1])*(x[1] - y[1])
+            + (x[2] - y[2])*(x[2] - y[2]);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // computeLabelsFromBoundaries
 ////////////////////////////////////////////////////////////////////////////////
 
 void SuperpixelTools::computeLabelsFromBoundaries(const cv::Mat &image, 
         const cv::Mat &boundaries, cv::Mat &labels, int BOUNDARY_VALUE,
-        int INNER_VALUE) {
+        int INNER_VALUE, int threads) {
     
     LOG_IF(FATAL, image.rows != boundaries.rows) 
             << "Image size does not match boundaries size: " 
@@ -184,46 +192,45 @@ void SuperpixelTools::computeLabelsFromBoundaries(const cv::Mat &image,
             << "Image size does not match boundaries size: " 
             << image.rows << "," << image.cols << " != " << boundaries.rows << "," << boundaries.cols;
     LOG_IF(FATAL, boundaries.type() != CV_32S) << "Invalid boundaries type!";
+    LOG_IF(FATAL, BOUNDARY_VALUE == INNER_VALUE) << "Boundary and inner value need to differ!";
     
-    cv::Mat tmp_labels(boundaries.rows, boundaries.cols, CV_32FC1, cv::Scalar(0));
-    for (int i = 0; i < tmp_labels.rows; i++) {
-        for (int j = 0; j < tmp_labels.cols; j++) {
-            if (boundaries.at<int>(i, j) > 0) {
-                tmp_labels.at<float>(i,j) = BOUNDARY_VALUE;
-            }
-            else {
-                tmp_labels.at<float>(i,j) = INNER_VALUE;
-            }
+    cv::Mat inner(boundaries.rows, boundaries.cols, CV_32SC1);
+    for (int i = 0; i < boundaries.rows; i++) {
+        const int* boundaries_row = boundaries.ptr<int>(i);
+        int* inner_row = inner.ptr<int>(i);
+        
+        for (int j = 0; j < boundaries.cols; j++) {
+            inner_row[j] = (boundaries_row[j] > 0 ? BOUNDARY_VALUE : INNER_VALUE);
         }
     }
     
-    int label = 1;
-    for (int i = 0; i < tmp_labels.rows; i++) {
-        for (int j = 0; j < tmp_labels.cols; j++) {
-            if (tmp_labels.at<float>(i, j) == INNER_VALUE) {
-                cv::floodFill(tmp_labels, cv::Point(j, i), cv::Scalar(label), 
-                        0, cv::Scalar(0), cv::Scalar(0));
-                label++;
-            }
-        }
-    }
+    // Inner regions are numbered 0, 1, ... in raster order of their first
+    // pixel (as flooding them in raster order would do), boundary pixels get -1.
+    ConnectedLabeling labeling(false, threads);
+    labeling.setIgnoreValue(BOUNDARY_VALUE);
     
-    tmp_labels.convertTo(tmp_labels, CV_32SC1);
-    std::vector<cv::Vec3b> means(label + 1, cv::Vec3b(0, 0, 0));
-    std::vector<int> counts(label + 1, 0);
+    cv::Mat components;
+    int count = labeling.label(inner, components);
+    
+    std::vector<cv::Vec3f> means(count, cv::Vec3f(0, 0, 0));
+    std::vector<int> counts(count, 0);
     
-    for (int i = 0; i < tmp_labels.rows; i++) {
-        for (int j = 0; j < tmp_labels.cols; j++) {
-            if (tmp_labels.at<int>(i, j) != BOUNDARY_VALUE) {
-                means[tmp_labels.at<int>(i, j) - 1][0] += image.at<cv::Vec3b>(i, j)[0];
-                means[tmp_labels.at<int>(i, j) - 1][1] += image.at<cv::Vec3b>(i, j)[1];
-                means[tmp_labels.at<int>(i, j) - 1][2] += image.at<cv::Vec3b>(i, j)[2];
-                counts[tmp_labels.at<int>(i, j) - 1]++;
+    for (int i = 0; i < components.rows; i++) {
+        const int* components_row = components.ptr<int>(i);
+        const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+        
+        for (int j = 0; j < components.cols; j++) {
+            const int label = components_row[j];
+            if (label >= 0) {
+                means[label][0] += image_row[j][0];
+                means[label][1] += image_row[j][1];
+                means[label][2] += image_row[j][2];
+                counts[label]++;
             }
         }
     }
     
-    for (int k = 0; k < label + 1; k++) {
+    for (int k = 0; k < count; k++) {
         if (counts[k] > 0) {
             means[k][0] /= counts[k];
             means[k][1] /= counts[k];
@@ -231,110 +238,61 @@ void SuperpixelTools::computeLabelsFromBoundaries(const cv::Mat &image,
         }
     }
     
+    // Assign each boundary pixel to the 4-neighbor superpixel with the closest
+    // mean; the first pass only considers inner pixels, the second pass also
+    // considers boundary pixels assigned in the first pass (diagonal issues).
     labels.create(image.rows, image.cols, CV_32SC1);
-    for (int i = 0; i < tmp_labels.rows; i++) {
-        for (int j = 0; j < tmp_labels.cols; j++) {
-            if (tmp_labels.at<int>(i, j) == BOUNDARY_VALUE) {
-
-                int min_label = BOUNDARY_VALUE;
-                float min_distance = std::numeric_limits<float>::max();
-
-                if (i + 1 < image.rows && tmp_labels.at<int>(i + 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[tmp_labels.at<int>(i + 1, j) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = tmp_labels.at<int>(i + 1, j);
-                    }
-                }
-
-                if (j + 1 < image.cols && tmp_labels.at<int>(i, j + 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[tmp_labels.at<int>(i, j + 1) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = tmp_labels.at<int>(i, j + 1);
-                    }
-                }
-
-                if (i > 0 && tmp_labels.at<int>(i - 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[tmp_labels.at<int>(i - 1, j) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = tmp_labels.at<int>(i - 1, j);
-                    }
-                }
-
-                if (j > 0 && tmp_labels.at<int>(i, j - 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[tmp_labels.at<int>(i, j - 1) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = tmp_labels.at<int>(i, j - 1);
-                    }
-                }
-
-                labels.at<int>(i, j) = min_label;
-            }
-            else {
-                labels.at<int>(i, j) = tmp_labels.at<int>(i, j);
-            }
-        }
-    }
+    components.copyTo(labels);
     
-    // Second pass to resolve diagonal issues.
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            if (labels.at<int>(i, j) == BOUNDARY_VALUE) {
-
-                int min_label = BOUNDARY_VALUE;
-                float min_distance = std::numeric_limits<float>::max();
-
-                if (i + 1 < image.rows && labels.at<int>(i + 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i + 1, j) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i + 1, j);
-                    }
+    for (int pass = 0; pass < 2; pass++) {
+        const cv::Mat &source = (pass == 0 ? components : labels);
+        
+        for (int i = 0; i < labels.rows; i++) {
+            const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+            int* labels_row = labels.ptr<int>(i);
+            
+            for (int j = 0; j < labels.cols; j++) {
+                if (labels_row[j] >= 0) {
+                    continue;
                 }
-
-                if (j + 1 < image.cols && labels.at<int>(i, j + 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i, j + 1) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i, j + 1);
+                
+                const int neighbors[4][2] = {{i + 1, j}, {i, j + 1}, {i - 1, j}, {i, j - 1}};
+                
+                int min_label = -1;
+                float min_distance = std::numeric_limits<float>::max();
+                
+                for (int n = 0; n < 4; n++) {
+                    const int ii = neighbors[n][0];
+                    const int jj = neighbors[n][1];
+                    
+                    if (ii < 0 || ii >= labels.rows || jj < 0 || jj >= labels.cols) {
+                        continue;
                     }
-                }
-
-                if (i > 0 && labels.at<int>(i - 1, j) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i - 1, j) - 1]);
-
-                    if (distance < min_distance) {
-                        min_distance = distance;
-                        min_label = labels.at<int>(i - 1, j);
+                    
+                    const int label = source.at<int>(ii, jj);
+                    if (label < 0) {
+                        continue;
                     }
-                }
-
-                if (j > 0 && labels.at<int>(i, j - 1) != BOUNDARY_VALUE) {
-                    float distance = computeDistance(image.at<cv::Vec3b>(i, j), means[labels.at<int>(i, j - 1) - 1]);
-
+                    
+                    float distance = computeDistance(image_row[j], means[label]);
                     if (distance < min_distance) {
                         min_distance = distance;
-                        min_label = labels.at<int>(i, j - 1);
+                        min_label = label;
                     }
                 }
-
-                labels.at<int>(i, j) = min_label;
+                
+                labels_row[j] = min_label;
             }
         }
     }
     
+    // Pixels which could not be assigned keep the (shifted) boundary value.
     for (int i = 0; i < labels.rows; i++) {
+        int* labels_row = labels.ptr<int>(i);
         for (int j = 0; j < labels.cols; j++) {
-            labels.at<int>(i, j)--;
+            if (labels_row[j] < 0) {
+                labels_row[j] = BOUNDARY_VALUE - 1;
+            }
         }
     }
 }
@@ -514,34 +472,21 @@ int SuperpixelTools::countSuperpixels(const cv::Mat &labels) {
 // relabelConnectedSuperpixels
 ////////////////////////////////////////////////////////////////////////////////
 
-int SuperpixelTools::relabelConnectedSuperpixels(cv::Mat &labels) {
+int SuperpixelTools::relabelConnectedSuperpixels(cv::Mat &labels, int threads) {
     LOG_IF(FATAL, labels.type() != CV_32SC1) << "Invalid label type.";
     
-    SuperpixelTools::relabelSuperpixels(labels);
+    ConnectedLabeling labeling(false, threads);
     
-    int max = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > max) {
-                max = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    ConnectedComponents cc(2*max);
-            
-    cv::Mat components(labels.rows, labels.cols, CV_32SC1, cv::Scalar(0));
-    int component_count = cc.connected<int, int, std::equal_to<int>, bool>((int*) labels.data, (int*) components.data, labels.cols, 
-            labels.rows, std::equal_to<int>(), false);
+    cv::Mat components;
+    int component_count = labeling.label(labels, components);
+    components.copyTo(labels);
     
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            labels.at<int>(i, j) = components.at<int>(i, j);
-        }
-    }
+    // Each original label corresponds to at least one component.
+    std::vector<int> values = labeling.getComponentValues();
+    std::sort(values.begin(), values.end());
+    int label_count = std::unique(values.begin(), values.end()) - values.begin();
     
-    // component_count would be the NEXT label index, max is the current highest!
-    return component_count - max - 1;
+    return component_count - label_count;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -549,107 +494,9 @@ int SuperpixelTools::relabelConnectedSuperpixels(cv::Mat &labels) {
 ////////////////////////////////////////////////////////////////////////////////
 
 int SuperpixelTools::enforceMinimumSuperpixelSize(const cv::Mat &image, cv::Mat &labels, int size) {
-    int max_label = 0;
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            if (labels.at<int>(i, j) > max_label) {
-                max_label = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    std::vector<cv::Vec3b> means(max_label + 1, cv::Vec3b(0, 0, 0));
-    std::vector<int> counts(max_label + 1, 0);
-    
-    std::vector< std::vector<int> > neighbors(max_label + 1);
-    for (unsigned int k = 0; k < neighbors.size(); k++) {
-        neighbors[k] = std::vector<int>(0);
-    }
-    
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
-            
-            means[label][0] += image.at<cv::Vec3b>(i, j)[0];
-            means[label][1] += image.at<cv::Vec3b>(i, j)[1];
-            means[label][2] += image.at<cv::Vec3b>(i, j)[2];
-            counts[label]++;
-            
-            int neighbor_label = labels.at<int>(std::min(i + 1, labels.rows - 1), j);
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-            
-            neighbor_label = labels.at<int>(std::max(0, i - 1), j);
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-            
-            neighbor_label = labels.at<int>(i, std::min(j + 1, labels.cols - 1));
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-            
-            neighbor_label = labels.at<int>(i, std::max(0, j - 1));
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-        }
-    }
-    
-    for (unsigned int k = 0; k < counts.size(); k++) {
-        if (counts[k] > 0) {
-            means[k][0] /= counts[k];
-            means[k][1] /= counts[k];
-            means[k][2] /= counts[k];
-        }
-    }
-    
-    int count = 0;
-    std::vector<int> new_labels(max_label + 1, -1);
-    
-    for (unsigned int k = 0; k < counts.size(); k++) {
-        if (counts[k] < size) {
-            
-            float min_distance = std::numeric_limits<float>::max();
-            for (unsigned int kk = 0; kk < neighbors[k].size(); kk++) {
-                float distance = (means[k][0] - means[neighbors[k][kk]][0])*(means[k][0] - means[neighbors[k][kk]][0])
-                        + (means[k][1] - means[neighbors[k][kk]][1])*(means[k][1] - means[neighbors[k][kk]][1])
-                        + (means[k][2] - means[neighbors[k][kk]][2])*(means[k][2] - means[neighbors[k][kk]][2]);
-                
-                if (distance < min_distance && new_labels[neighbors[k][kk]] < 0) {
-                    min_distance = distance;
-                    new_labels[k] = neighbors[k][kk];
-                }
-            }
-            
-            count++;
-        }
-    }
-    
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            
-            int label = labels.at<int>(i, j);
-            if (new_labels[label] >= 0) {
-                
-                int new_label = new_labels[label];
-                while (new_labels[new_label] >= 0) {
-                    new_label = new_labels[new_label];
-                }
-                
-                labels.at<int>(i, j) = new_labels[label];
-            }
-        }
-    }
+    RegionAdjacencyGraph graph(image, labels);
+    int count = graph.mergeSmallerThan(size);
+    graph.relabel(labels);
     
     return count;
 }
@@ -659,119 +506,22 @@ int SuperpixelTools::enforceMinimumSuperpixelSize(const cv::Mat &image, cv::Mat
 ////////////////////////////////////////////////////////////////////////////////
 
 int SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(const cv::Mat &image, cv::Mat &labels, int number) {
-    int max_label = 0;
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            if (labels.at<int>(i, j) > max_label) {
-                max_label = labels.at<int>(i, j);
-            }
-        }
-    }
+    RegionAdjacencyGraph graph(image, labels);
+    int count = graph.mergeSmallest(number);
+    graph.relabel(labels);
     
-    std::vector<cv::Vec3b> means(max_label + 1, cv::Vec3b(0, 0, 0));
-    std::vector<int> counts(max_label + 1, 0);
-    
-    std::vector< std::vector<int> > neighbors(max_label + 1);
-    for (unsigned int k = 0; k < neighbors.size(); k++) {
-        neighbors[k] = std::vector<int>(0);
-    }
-    
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            int label = labels.at<int>(i, j);
-            
-            means[label][0] += image.at<cv::Vec3b>(i, j)[0];
-            means[label][1] += image.at<cv::Vec3b>(i, j)[1];
-            means[label][2] += image.at<cv::Vec3b>(i, j)[2];
-            counts[label]++;
-            
-            int neighbor_label = labels.at<int>(std::min(i + 1, labels.rows - 1), j);
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-            
-            neighbor_label = labels.at<int>(std::max(0, i - 1), j);
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-            
-            neighbor_label = labels.at<int>(i, std::min(j + 1, labels.cols - 1));
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-            
-            neighbor_label = labels.at<int>(i, std::max(0, j - 1));
-            if (neighbor_label != label) {
-                if (std::find(neighbors[label].begin(), neighbors[label].end(), neighbor_label) == std::end(neighbors[label])) {
-                    neighbors[label].push_back(neighbor_label);
-                }
-            }
-        }
-    }
-    
-    for (unsigned int k = 0; k < counts.size(); k++) {
-        if (counts[k] > 0) {
-            means[k][0] /= counts[k];
-            means[k][1] /= counts[k];
-            means[k][2] /= counts[k];
-        }
-    }
-    
-    std::vector<int> ids(max_label + 1, 0);
-    for (unsigned int k = 0; k < ids.size(); k++) {
-        ids[k] = k;
-    }
-    
-    std::sort(ids.begin(), ids.end(), [&counts](int i, int j) {
-        return counts[i] < counts[j];
-    });
-    
-//    for (unsigned int k = 0; k < counts.size(); k++) {
-//        std::cout << ids[k] << ": " << counts[ids[k]] << std::endl;
-//    }
-    
-    int count = 0;
-    std::vector<int> new_labels(max_label + 1, -1);
-    
-    for (unsigned int k = 0; k < std::min((int) counts.size(), number); k++) {
-        int label = ids[k];
-        
-        float min_distance = std::numeric_limits<float>::max();
-        for (unsigned int kk = 0; kk < neighbors[label].size(); kk++) {
-            float distance = (means[label][0] - means[neighbors[label][kk]][0])*(means[label][0] - means[neighbors[label][kk]][0])
-                    + (means[label][1] - means[neighbors[label][kk]][1])*(means[label][1] - means[neighbors[label][kk]][1])
-                    + (means[label][2] - means[neighbors[label][kk]][2])*(means[label][2] - means[neighbors[label][kk]][2]);
-
-            if (distance < min_distance && new_labels[neighbors[label][kk]] < 0) {
-                min_distance = distance;
-                new_labels[label] = neighbors[label][kk];
-            }
-        }
-        
-        count++;
-    }
-    
-    for (int i = 0; i < labels.rows; i++) {
-        for (int j = 0; j < labels.cols; j++) {
-            
-            int label = labels.at<int>(i, j);
-            if (new_labels[label] >= 0) {
-                
-                int new_label = new_labels[label];
-                while (new_labels[new_label] >= 0) {
-                    new_label = new_labels[new_label];
-                }
-                
-                labels.at<int>(i, j) = new_labels[label];
-            }
-        }
-    }
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// mergeSuperpixels
+////////////////////////////////////////////////////////////////////////////////
+
+int SuperpixelTools::mergeSuperpixels(const cv::Mat &image, cv::Mat &labels, 
+        int superpixels, const cv::Mat &boundaries) {
+    SuperpixelMerger merger(image, labels, boundaries);
+    int count = merger.merge(superpixels);
+    merger.relabel(labels);
     
     return count;
-}
\ No newline at end of file
+}
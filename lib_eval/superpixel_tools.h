@@ -86,9 +86,11 @@ public:
      * \param[out] labels computed superpixel labels
      * \param[in] BOUDNARY_VALUE the value a boundary pixel takes
      * \param[in] INNER_VALUE the value an inner pixel takes
+     * \param[in] threads number of threads used for labeling, <= 0 for all hardware threads
      */
     static void computeLabelsFromBoundaries(const cv::Mat &image, const cv::Mat &boundaries, 
-            cv::Mat &labels, int BOUNDARY_VALUE = -1, int INNER_VALUE = -2);
+            cv::Mat &labels, int BOUNDARY_VALUE = -1, int INNER_VALUE = -2, 
+            int threads = 1);
     
     /** \brief Assigns boundary pixels (indicated by -1) to the nearest superpixel 
      * (indicated by labels >= 0).
@@ -107,28 +109,43 @@ public:
     
     /** \brief Relabel superpixels based on connected components.
      * \param[in] labels superpixel labels to relabel as connected
+     * \param[in] threads number of threads used for labeling, <= 0 for all hardware threads
+     * \return number of components in addition to the original superpixels
      */
-    static int relabelConnectedSuperpixels(cv::Mat &labels);
+    static int relabelConnectedSuperpixels(cv::Mat &labels, int threads = 1);
     
-    /** \brief Enforce the minimum segment size by merging small superpixels
-     * with similar neighboring superpixels.
+    /** \brief Enforce the minimum segment size by repeatedly merging the
+     * smallest superpixel into the neighbor with the closest mean color,
+     * see RegionAdjacencyGraph.
      * \param[in] image image to enforce minimum superpixel size for
      * \param[in] labels superpixel labels
      * \param[in] size minimum superpixel size
-     * \return new number of superpixels
+     * \return number of merged superpixels
      */
     static int enforceMinimumSuperpixelSize(const cv::Mat &image, cv::Mat &labels, 
             int size);
     
-    /** \brief Enforce the minimum segment size by merging small superpixels
-     * with similar neighboring superpixels such that the given number of
-     * superpixels is merged.
+    /** \brief Enforce the minimum segment size by merging the given number of
+     * smallest superpixels, each into the neighbor with the closest mean color
+     * that is not merged itself.
      * \param[in] image image to enforce minimum superpixels on
      * \param[in] labels superpixel labels
-     * \param[in] number number of desired superpixels after enforcing minimum size
+     * \param[in] number number of superpixels to merge
+     * \return number of merged superpixels
      */
     static int enforceMinimumSuperpixelSizeUpTo(const cv::Mat &image, cv::Mat &labels, 
             int number);
+    
+    /** \brief Merge superpixels down to the given number using the merging
+     * stage of POISE, see SuperpixelMerger.
+     * \param[in] image image the superpixels were computed on
+     * \param[in] labels superpixel labels
+     * \param[in] superpixels number of superpixels to merge down to
+     * \param[in] boundaries optional boundary map of type CV_32FC1
+     * \return number of merged superpixels
+     */
+    static int mergeSuperpixels(const cv::Mat &image, cv::Mat &labels, 
+            int superpixels, const cv::Mat &boundaries = cv::Mat());
 
 };
 
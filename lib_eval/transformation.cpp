@@ -29,37 +29,128 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstdint>
 #include <random>
 #include <glog/logging.h>
+#include "parallel_util.h"
 #include "transformation.h"
 
+/** \brief Counter-based random engine: the n-th number of a stream is a hash
+ * (SplitMix64 finalizer) of the stream key and n. Streams are keyed by seed and
+ * row, so rows can be processed in any order and on any thread while the
+ * result only depends on the seed.
+ */
+class CounterRandomStream {
+public:
+    typedef uint64_t result_type;
+    
+    /** \brief Constructor.
+     * \param[in] seed seed
+     * \param[in] stream stream index, e.g. the row
+     */
+    CounterRandomStream(unsigned int seed, uint64_t stream) 
+            : key(mix(((uint64_t) seed << 32) ^ mix(stream))), counter(0) {
+        
+    }
+    
+    static constexpr result_type min() {
+        return 0;
+    }
+    
+    static constexpr result_type max() {
+        return UINT64_MAX;
+    }
+    
+    result_type operator()() {
+        counter++;
+        return mix(key + counter*0x9E3779B97F4A7C15ULL);
+    }
+    
+private:
+    /** \brief SplitMix64 finalizer.
+     * \param[in] z value to mix
+     * \return mixed value
+     */
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    
+    /** \brief Key of the stream. */
+    uint64_t key;
+    /** \brief Number of values drawn. */
+    uint64_t counter;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Transformation::getSeed
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int Transformation::getSeed(unsigned int seed) {
+    if (seed == 0) {
+        std::random_device random;
+        while (seed == 0) {
+            seed = random();
+        }
+    }
+    
+    return seed;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Transformation::applyGaussianAdditiveNoise
 ////////////////////////////////////////////////////////////////////////////////
 
 void Transformation::applyGaussianAdditiveNoise(const cv::Mat &image, float variance, 
-        cv::Mat &noisy_image) {
+        cv::Mat &noisy_image, unsigned int seed, int threads) {
+    
+    std::vector<cv::Mat> noisy_images(1, noisy_image);
+    applyGaussianAdditiveNoise(image, std::vector<float>(1, variance), noisy_images, 
+            seed, threads);
+    
+    noisy_image = noisy_images[0];
+}
+
+void Transformation::applyGaussianAdditiveNoise(const cv::Mat &image, 
+        const std::vector<float> &variances, std::vector<cv::Mat> &noisy_images,
+        unsigned int seed, int threads) {
     
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only color images are supported.";
-    LOG_IF(FATAL, variance <= 0) << "Invalid variance.";
+    for (unsigned int k = 0; k < variances.size(); k++) {
+        LOG_IF(FATAL, variances[k] <= 0) << "Invalid variance.";
+    }
     
-    std::random_device random;
-    std::mt19937 gen(random());
-    std::normal_distribution<float> g(0, variance);
+    seed = getSeed(seed);
     
-    noisy_image.create(image.rows, image.cols, image.type());
-    for (int i = 0; i < image.rows; i++) {
-        for (int j = 0; j < image.cols; j++) {
-            
-            cv::Vec3b noisy_color = image.at<cv::Vec3b>(i, j);
-            noisy_color[0] = std::max(0, std::min(255, (int) (noisy_color[0] + g(gen))));
-            noisy_color[1] = std::max(0, std::min(255, (int) (noisy_color[1] + g(gen))));
-            noisy_color[2] = std::max(0, std::min(255, (int) (noisy_color[2] + g(gen))));
+    noisy_images.resize(variances.size());
+    for (unsigned int k = 0; k < variances.size(); k++) {
+        noisy_images[k].create(image.rows, image.cols, image.type());
+    }
+    
+    ParallelUtil::parallelStrips(image.rows, ParallelUtil::getNumThreads(threads),
+            [&image, &variances, &noisy_images, seed](int strip, int row_begin, int row_end) {
+        
+        for (int i = row_begin; i < row_end; i++) {
+            CounterRandomStream stream(seed, i);
+            std::normal_distribution<float> g(0, 1);
             
-            noisy_image.at<cv::Vec3b>(i, j) = noisy_color;
+            const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+            for (int j = 0; j < image.cols; j++) {
+                
+                const cv::Vec3b color = image_row[j];
+                const float r[3] = {g(stream), g(stream), g(stream)};
+                
+                for (unsigned int k = 0; k < variances.size(); k++) {
+                    cv::Vec3b &noisy_color = noisy_images[k].ptr<cv::Vec3b>(i)[j];
+                    noisy_color[0] = std::max(0, std::min(255, (int) (color[0] + variances[k]*r[0])));
+                    noisy_color[1] = std::max(0, std::min(255, (int) (color[1] + variances[k]*r[1])));
+                    noisy_color[2] = std::max(0, std::min(255, (int) (color[2] + variances[k]*r[2])));
+                }
+            }
         }
-    }
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -67,15 +158,26 @@ void Transformation::applyGaussianAdditiveNoise(const cv::Mat &image, float vari
 ////////////////////////////////////////////////////////////////////////////////
 
 void Transformation::applyGaussianSamplingErrors(const cv::Mat &image, float variance, 
-        cv::Mat &noisy_image) {
+        cv::Mat &noisy_image, unsigned int seed, int threads) {
+    
+    std::vector<cv::Mat> noisy_images(1, noisy_image);
+    applyGaussianSamplingErrors(image, std::vector<float>(1, variance), noisy_images, 
+            seed, threads);
+    
+    noisy_image = noisy_images[0];
+}
+
+void Transformation::applyGaussianSamplingErrors(const cv::Mat &image, 
+        const std::vector<float> &variances, std::vector<cv::Mat> &noisy_images,
+        unsigned int seed, int threads) {
     
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only color images are supported.";
-    LOG_IF(FATAL, variance <= 0) << "Invalid variance.";
+    for (unsigned int k = 0; k < variances.size(); k++) {
+        LOG_IF(FATAL, variances[k] <= 0) << "Invalid variance.";
+    }
     
-    std::random_device random;
-    std::mt19937 gen(random());
-    std::normal_distribution<float> g(0, variance);
+    seed = getSeed(seed);
     
     cv::Mat image_gray;
     cv::cvtColor(image, image_gray, CV_BGR2GRAY);
@@ -90,20 +192,34 @@ void Transformation::applyGaussianSamplingErrors(const cv::Mat &image, float var
     cv::convertScaleAbs(grad_y, grad_y);
     cv::addWeighted(grad_x, 0.5, grad_y, 0.5, 0, magnitude);
     
-    noisy_image.create(image.rows, image.cols, image.type());
-    for (int i = 0; i < image.rows; i++) {
-        for (int j = 0; j < image.cols; j++) {
-            
-            cv::Vec3b noisy_color = image.at<cv::Vec3b>(i, j);
-            float r = g(gen);
-            
-            noisy_color[0] = std::max(0, std::min(255, (int) (noisy_color[0] + r*magnitude.at<unsigned char>(i, j))));
-            noisy_color[1] = std::max(0, std::min(255, (int) (noisy_color[1] + r*magnitude.at<unsigned char>(i, j))));
-            noisy_color[2] = std::max(0, std::min(255, (int) (noisy_color[2] + r*magnitude.at<unsigned char>(i, j))));
+    noisy_images.resize(variances.size());
+    for (unsigned int k = 0; k < variances.size(); k++) {
+        noisy_images[k].create(image.rows, image.cols, image.type());
+    }
+    
+    ParallelUtil::parallelStrips(image.rows, ParallelUtil::getNumThreads(threads),
+            [&image, &magnitude, &variances, &noisy_images, seed](int strip, int row_begin, int row_end) {
+        
+        for (int i = row_begin; i < row_end; i++) {
+            CounterRandomStream stream(seed, i);
+            std::normal_distribution<float> g(0, 1);
             
-            noisy_image.at<cv::Vec3b>(i, j) = noisy_color;
+            const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+            const unsigned char* magnitude_row = magnitude.ptr<unsigned char>(i);
+            for (int j = 0; j < image.cols; j++) {
+                
+                const cv::Vec3b color = image_row[j];
+                const float r = g(stream)*magnitude_row[j];
+                
+                for (unsigned int k = 0; k < variances.size(); k++) {
+                    cv::Vec3b &noisy_color = noisy_images[k].ptr<cv::Vec3b>(i)[j];
+                    noisy_color[0] = std::max(0, std::min(255, (int) (color[0] + variances[k]*r)));
+                    noisy_color[1] = std::max(0, std::min(255, (int) (color[1] + variances[k]*r)));
+                    noisy_color[2] = std::max(0, std::min(255, (int) (color[2] + variances[k]*r)));
+                }
+            }
         }
-    }
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -111,66 +227,99 @@ void Transformation::applyGaussianSamplingErrors(const cv::Mat &image, float var
 ////////////////////////////////////////////////////////////////////////////////
 
 void Transformation::applySaltAndPepperNoise(const cv::Mat &image, float p,
-        cv::Mat &noisy_image) {
+        cv::Mat &noisy_image, unsigned int seed, int threads) {
+    
+    std::vector<cv::Mat> noisy_images(1, noisy_image);
+    applySaltAndPepperNoise(image, std::vector<float>(1, p), noisy_images, 
+            seed, threads);
+    
+    noisy_image = noisy_images[0];
+}
+
+void Transformation::applySaltAndPepperNoise(const cv::Mat &image, 
+        const std::vector<float> &probabilities, std::vector<cv::Mat> &noisy_images,
+        unsigned int seed, int threads) {
     
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only color images are supported.";
     
-    noisy_image.create(image.rows, image.cols, image.type());
-    for (int i = 0; i < image.rows; i++) {
-        for (int j = 0; j < image.cols; j++) {
-            
-            cv::Vec3b noisy_color = image.at<cv::Vec3b>(i, j);
+    seed = getSeed(seed);
+    
+    noisy_images.resize(probabilities.size());
+    for (unsigned int k = 0; k < probabilities.size(); k++) {
+        noisy_images[k].create(image.rows, image.cols, image.type());
+    }
+    
+    ParallelUtil::parallelStrips(image.rows, ParallelUtil::getNumThreads(threads),
+            [&image, &probabilities, &noisy_images, seed](int strip, int row_begin, int row_end) {
+        
+        for (int i = row_begin; i < row_end; i++) {
+            CounterRandomStream stream(seed, i);
+            std::uniform_real_distribution<float> u(0, 1);
             
-            float r = (float) std::rand() / RAND_MAX;
-            if (r <= p) {
+            const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+            for (int j = 0; j < image.cols; j++) {
                 
-                r = (float) std::rand() / RAND_MAX;
-                if (r <= 0.5) {
-                    noisy_color[0] = 0;
-                    noisy_color[1] = 0;
-                    noisy_color[2] = 0;
-                }
-                else {
-                    noisy_color[0] = 255;
-                    noisy_color[1] = 255;
-                    noisy_color[2] = 255;
+                const cv::Vec3b color = image_row[j];
+                const float r = u(stream);
+                const unsigned char salt_or_pepper = (u(stream) <= 0.5) ? 0 : 255;
+                
+                for (unsigned int k = 0; k < probabilities.size(); k++) {
+                    cv::Vec3b &noisy_color = noisy_images[k].ptr<cv::Vec3b>(i)[j];
+                    if (r <= probabilities[k]) {
+                        noisy_color[0] = salt_or_pepper;
+                        noisy_color[1] = salt_or_pepper;
+                        noisy_color[2] = salt_or_pepper;
+                    }
+                    else {
+                        noisy_color = color;
+                    }
                 }
             }
-            
-            noisy_image.at<cv::Vec3b>(i, j) = noisy_color;
         }
-    }
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Transformation::applyPoissonNoise
 ////////////////////////////////////////////////////////////////////////////////
 
-void Transformation::applyPoissonNoise(const cv::Mat &image, cv::Mat &noisy_image) {
+void Transformation::applyPoissonNoise(const cv::Mat &image, cv::Mat &noisy_image,
+        unsigned int seed, int threads) {
     
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only color images are supported.";
     
-    std::random_device random;
-    std::mt19937 gen(random());
+    seed = getSeed(seed);
     
     noisy_image.create(image.rows, image.cols, image.type());
-    for (int i = 0; i < image.rows; i++) {
-        for (int j = 0; j < image.cols; j++) {
-            
-            cv::Vec3b noisy_color = image.at<cv::Vec3b>(i, j);
-            std::poisson_distribution<unsigned char> p0(noisy_color[0]);
-            std::poisson_distribution<unsigned char> p1(noisy_color[1]);
-            std::poisson_distribution<unsigned char> p2(noisy_color[2]);
-            
-            noisy_color[0] = p0(gen);
-            noisy_color[1] = p1(gen);
-            noisy_color[2] = p2(gen);
+    ParallelUtil::parallelStrips(image.rows, ParallelUtil::getNumThreads(threads),
+            [&image, &noisy_image, seed](int strip, int row_begin, int row_end) {
+        
+        // One distribution per intensity, constructed once per strip; 
+        // reset for every row to keep the rows independent.
+        std::vector<std::poisson_distribution<int>> p(256);
+        for (int v = 1; v < 256; v++) {
+            p[v] = std::poisson_distribution<int>(v);
+        }
+        
+        for (int i = row_begin; i < row_end; i++) {
+            CounterRandomStream stream(seed, i);
+            for (int v = 1; v < 256; v++) {
+                p[v].reset();
+            }
             
-            noisy_image.at<cv::Vec3b>(i, j) = noisy_color;
+            const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+            cv::Vec3b* noisy_row = noisy_image.ptr<cv::Vec3b>(i);
+            for (int j = 0; j < image.cols; j++) {
+                
+                const cv::Vec3b color = image_row[j];
+                for (int c = 0; c < 3; c++) {
+                    noisy_row[j][c] = (color[c] == 0) ? 0 : std::min(255, p[color[c]](stream));
+                }
+            }
         }
-    }
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////////
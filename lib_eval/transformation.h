@@ -32,6 +32,7 @@
 #ifndef TRANSFORMATIONS_H
 #define	TRANSFORMATIONS_H
 
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 /** \brief Utility class for image and ground truth transofmrations.
@@ -40,33 +41,85 @@
 class Transformation {
 public:
     /** \brief Add Gaussian additive noise to image with the given variance on all channels.
+     * 
+     * Rows are processed in parallel, each row draws from its own counter-based
+     * random stream, so the result only depends on the seed and not on the
+     * number of threads.
+     * 
      * \param[in] image image to add Gaussian additive noise to
      * \param[in] variance variance of the Gaussian
      * \param[out] noisy_image noisy image
+     * \param[in] seed seed of the random streams, 0 to draw a random seed
+     * \param[in] threads number of threads, <= 0 for all hardware threads
      */
     static void applyGaussianAdditiveNoise(const cv::Mat &image, float variance, 
-            cv::Mat &noisy_image);
+            cv::Mat &noisy_image, unsigned int seed = 0, int threads = 0);
+    
+    /** \brief Add Gaussian additive noise for several variances in one pass.
+     * 
+     * All levels share the random numbers drawn for a pixel, i.e. noisy_images[k]
+     * equals the result of applyGaussianAdditiveNoise with variances[k] and the same seed.
+     * 
+     * \param[in] image image to add Gaussian additive noise to
+     * \param[in] variances variances of the Gaussian
+     * \param[out] noisy_images noisy image for each variance
+     * \param[in] seed seed of the random streams, 0 to draw a random seed
+     * \param[in] threads number of threads, <= 0 for all hardware threads
+     */
+    static void applyGaussianAdditiveNoise(const cv::Mat &image, const std::vector<float> &variances, 
+            std::vector<cv::Mat> &noisy_images, unsigned int seed = 0, int threads = 0);
     
     /** \brief Add Gaussian sampling errors with given variance.
      * \param[in] image image to add Gaussian sampling errors to
      * \param[in] variance variance of the Gaussian
      * \param[out] noisy_image
+     * \param[in] seed seed of the random streams, 0 to draw a random seed
+     * \param[in] threads number of threads, <= 0 for all hardware threads
      */
     static void applyGaussianSamplingErrors(const cv::Mat &image, float variance, 
-            cv::Mat &noisy_image);
+            cv::Mat &noisy_image, unsigned int seed = 0, int threads = 0);
+    
+    /** \brief Add Gaussian sampling errors for several variances in one pass;
+     * the gradient magnitude and the random numbers are shared by all levels.
+     * \param[in] image image to add Gaussian sampling errors to
+     * \param[in] variances variances of the Gaussian
+     * \param[out] noisy_images noisy image for each variance
+     * \param[in] seed seed of the random streams, 0 to draw a random seed
+     * \param[in] threads number of threads, <= 0 for all hardware threads
+     */
+    static void applyGaussianSamplingErrors(const cv::Mat &image, const std::vector<float> &variances, 
+            std::vector<cv::Mat> &noisy_images, unsigned int seed = 0, int threads = 0);
     
     /** \brief Add salt and pepper noise.
      * \param[in] image image to add salt and pepper noise to
      * \param[in] p probability of salt or pepper
      * \param[out] noisy_image noisy image
+     * \param[in] seed seed of the random streams, 0 to draw a random seed
+     * \param[in] threads number of threads, <= 0 for all hardware threads
      */
-    static void applySaltAndPepperNoise(const cv::Mat &image, float p, cv::Mat &noisy_image);
+    static void applySaltAndPepperNoise(const cv::Mat &image, float p, cv::Mat &noisy_image,
+            unsigned int seed = 0, int threads = 0);
+    
+    /** \brief Add salt and pepper noise for several probabilities in one pass;
+     * with shared random numbers the corrupted pixels of a lower probability
+     * are a subset of those of a higher one.
+     * \param[in] image image to add salt and pepper noise to
+     * \param[in] probabilities probabilities of salt or pepper
+     * \param[out] noisy_images noisy image for each probability
+     * \param[in] seed seed of the random streams, 0 to draw a random seed
+     * \param[in] threads number of threads, <= 0 for all hardware threads
+     */
+    static void applySaltAndPepperNoise(const cv::Mat &image, const std::vector<float> &probabilities, 
+            std::vector<cv::Mat> &noisy_images, unsigned int seed = 0, int threads = 0);
     
     /** \brief Add poisson noise.
      * \param[in] image image to add Poisson noise to
      * \param[out] noisy_image noisy image
+     * \param[in] seed seed of the random streams, 0 to draw a random seed
+     * \param[in] threads number of threads, <= 0 for all hardware threads
      */
-    static void applyPoissonNoise(const cv::Mat &image, cv::Mat &noisy_image);
+    static void applyPoissonNoise(const cv::Mat &image, cv::Mat &noisy_image, 
+            unsigned int seed = 0, int threads = 0);
     
     /** \brief Apply blur (box filter).
      * \param[in] image image to apply blur filter to
@@ -152,6 +205,13 @@ public:
     template<typename T>
     static void applyTranslation(const cv::Mat &image, int crop, 
             int translation_x, int translation_y, cv::Mat &translated_image);
+    
+private:
+    /** \brief Seed to use for the random streams.
+     * \param[in] seed given seed, 0 to draw a random seed
+     * \return seed
+     */
+    static unsigned int getSeed(unsigned int seed);
 };
 
 #endif	/* TRANSFORMATIONS_H */
@@ -32,10 +32,11 @@
 #include <glog/logging.h>
 #include <random>
 #include "evaluation.h"
+#include "parallel_util.h"
 #include "visualization.h"
 
 void Visualization::drawContours(const cv::Mat &image, const cv::Mat &labels, cv::Mat &contours,
-            bool eight_connected) {
+            bool eight_connected, int threads) {
     
     LOG_IF(FATAL, image.rows != labels.rows || image.cols != labels.cols) 
             << "Image size and superpixel segmentation size do not match: " 
@@ -44,20 +45,42 @@ void Visualization::drawContours(const cv::Mat &image, const cv::Mat &labels, cv
     LOG_IF(FATAL, image.channels() != 3) << "Currently only three-channel images are supported.";
     
     contours.create(image.rows, image.cols, CV_8UC3);
-    cv::Vec3b color(0, 0, 0);
+    const cv::Vec3b color(0, 0, 0);
+    const int rows = labels.rows;
+    const int cols = labels.cols;
     
-    for (int i = 0; i < contours.rows; ++i) {
-        for (int j = 0; j < contours.cols; ++j) {
-            if (Evaluation::is4ConnectedBoundaryPixel(labels, i, j) 
-                    || (eight_connected && Evaluation::is8Minus4ConnectedBoundaryPixel(labels, i, j))) {
+    // Same boundary pixels as Evaluation::is4ConnectedBoundaryPixel and
+    // Evaluation::is8Minus4ConnectedBoundaryPixel, but comparing the adjacent
+    // label rows directly.
+    ParallelUtil::parallelStrips(rows, ParallelUtil::getNumThreads(threads),
+            [&image, &labels, &contours, &color, rows, cols, eight_connected]
+            (int strip, int row_begin, int row_end) {
+        
+        for (int i = row_begin; i < row_end; ++i) {
+            const int* labels_row = labels.ptr<int>(i);
+            const int* labels_above = (i > 0 ? labels.ptr<int>(i - 1) : 0);
+            const int* labels_below = (i < rows - 1 ? labels.ptr<int>(i + 1) : 0);
+            const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+            cv::Vec3b* contours_row = contours.ptr<cv::Vec3b>(i);
+            
+            for (int j = 0; j < cols; ++j) {
+                const int label = labels_row[j];
+                bool boundary = (j > 0 && labels_row[j - 1] != label)
+                        || (j < cols - 1 && labels_row[j + 1] != label)
+                        || (labels_above && labels_above[j] != label)
+                        || (labels_below && labels_below[j] != label);
                 
-                contours.at<cv::Vec3b>(i, j) = color;
-            }
-            else {
-                contours.at<cv::Vec3b>(i, j) = image.at<cv::Vec3b>(i, j);
+                if (!boundary && eight_connected) {
+                    boundary = (labels_above && j > 0 && labels_above[j - 1] != label)
+                            || (labels_above && j < cols - 1 && labels_above[j + 1] != label)
+                            || (labels_below && j > 0 && labels_below[j - 1] != label)
+                            || (labels_below && j < cols - 1 && labels_below[j + 1] != label);
+                }
+                
+                contours_row[j] = (boundary ? color : image_row[j]);
             }
         }
-    }
+    });
 }
 
 cv::Vec3b getRandomColor(int label, int discretization) {
@@ -76,18 +99,120 @@ cv::Vec3b getRandomColor(int label, int discretization) {
     return color;
 }
 
-void Visualization::drawRandom(const cv::Mat &labels, cv::Mat &random) {
+/** \brief Compute the mean color of all superpixels in a single pass; every
+ * strip accumulates color sums and pixel counts, grown on demand up to the 
+ * largest label seen, which are merged afterwards.
+ * \param[in] image image
+ * \param[in] labels superpixel labels
+ * \param[in] threads number of threads, <= 0 for all hardware threads
+ * \param[out] means mean color per label
+ * \param[out] counts number of pixels per label
+ */
+void computeMeans(const cv::Mat &image, const cv::Mat &labels, int threads, 
+        std::vector<cv::Vec3f> &means, std::vector<int> &counts) {
     
-    LOG_IF(FATAL, labels.empty()) << "Given labels are empty.";
+    const int strips = ParallelUtil::getNumThreads(threads);
+    std::vector<std::vector<long long> > strip_sums(strips);
+    std::vector<std::vector<int> > strip_counts(strips);
     
-    int max_label = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > max_label) {
-                max_label = labels.at<int>(i, j);
+    ParallelUtil::parallelStrips(image.rows, strips, [&image, &labels, &strip_sums, 
+            &strip_counts](int strip, int row_begin, int row_end) {
+        
+        std::vector<long long> &sums = strip_sums[strip];
+        std::vector<int> &pixels = strip_counts[strip];
+        
+        for (int i = row_begin; i < row_end; ++i) {
+            const int* labels_row = labels.ptr<int>(i);
+            const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+            
+            for (int j = 0; j < labels.cols; ++j) {
+                const int label = labels_row[j];
+                if (label >= static_cast<int>(pixels.size())) {
+                    pixels.resize(label + 1, 0);
+                    sums.resize(3*(label + 1), 0);
+                }
+                
+                sums[3*label + 0] += image_row[j][0];
+                sums[3*label + 1] += image_row[j][1];
+                sums[3*label + 2] += image_row[j][2];
+                pixels[label]++;
+            }
+        }
+    });
+    
+    int superpixels = 0;
+    for (int s = 0; s < strips; ++s) {
+        superpixels = std::max(superpixels, static_cast<int>(strip_counts[s].size()));
+    }
+    
+    means.assign(superpixels, cv::Vec3f(0, 0, 0));
+    counts.assign(superpixels, 0);
+    
+    for (int k = 0; k < superpixels; ++k) {
+        long long sum[3] = {0, 0, 0};
+        for (int s = 0; s < strips; ++s) {
+            if (k < static_cast<int>(strip_counts[s].size())) {
+                sum[0] += strip_sums[s][3*k + 0];
+                sum[1] += strip_sums[s][3*k + 1];
+                sum[2] += strip_sums[s][3*k + 2];
+                counts[k] += strip_counts[s][k];
             }
         }
+        
+        if (counts[k] > 0) {
+            means[k][0] = static_cast<float>(sum[0]/static_cast<double>(counts[k]));
+            means[k][1] = static_cast<float>(sum[1]/static_cast<double>(counts[k]));
+            means[k][2] = static_cast<float>(sum[2]/static_cast<double>(counts[k]));
+        }
     }
+}
+
+/** \brief Paint every pixel with the color of its label.
+ * \param[in] labels superpixel labels
+ * \param[in] colors color per label
+ * \param[in] threads number of threads, <= 0 for all hardware threads
+ * \param[out] image colored image
+ */
+void drawLabelColors(const cv::Mat &labels, const std::vector<cv::Vec3b> &colors, 
+        int threads, cv::Mat &image) {
+    
+    image.create(labels.rows, labels.cols, CV_8UC3);
+    ParallelUtil::parallelStrips(labels.rows, ParallelUtil::getNumThreads(threads),
+            [&labels, &colors, &image](int strip, int row_begin, int row_end) {
+        
+        for (int i = row_begin; i < row_end; ++i) {
+            const int* labels_row = labels.ptr<int>(i);
+            cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+            
+            for (int j = 0; j < labels.cols; ++j) {
+                image_row[j] = colors[labels_row[j]];
+            }
+        }
+    });
+}
+
+void Visualization::drawRandom(const cv::Mat &labels, cv::Mat &random, int threads) {
+    
+    LOG_IF(FATAL, labels.empty()) << "Given labels are empty.";
+    
+    const int strips = ParallelUtil::getNumThreads(threads);
+    std::vector<int> strip_max_labels(strips, 0);
+    
+    ParallelUtil::parallelStrips(labels.rows, strips, [&labels, &strip_max_labels]
+            (int strip, int row_begin, int row_end) {
+        
+        int max_label = 0;
+        for (int i = row_begin; i < row_end; ++i) {
+            const int* labels_row = labels.ptr<int>(i);
+            for (int j = 0; j < labels.cols; ++j) {
+                max_label = std::max(max_label, labels_row[j]);
+            }
+        }
+        
+        strip_max_labels[strip] = max_label;
+    });
+    
+    int max_label = *std::max_element(strip_max_labels.begin(), strip_max_labels.end());
     
     int discretization = 1;
     int number = std::pow(256/discretization, 3);
@@ -97,17 +222,32 @@ void Visualization::drawRandom(const cv::Mat &labels, cv::Mat &random) {
         number = std::pow(256/discretization, 3);
     }
     
+    // Colors are hashed once per run of equal labels along a row.
     random.create(labels.rows, labels.cols, CV_8UC3);
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            random.at<cv::Vec3b>(i, j) = getRandomColor(labels.at<int>(i, j), 
-                    discretization);
+    ParallelUtil::parallelStrips(labels.rows, strips, [&labels, &random, discretization]
+            (int strip, int row_begin, int row_end) {
+        
+        for (int i = row_begin; i < row_end; ++i) {
+            const int* labels_row = labels.ptr<int>(i);
+            cv::Vec3b* random_row = random.ptr<cv::Vec3b>(i);
+            
+            int label = labels_row[0];
+            cv::Vec3b color = getRandomColor(label, discretization);
+            
+            for (int j = 0; j < labels.cols; ++j) {
+                if (labels_row[j] != label) {
+                    label = labels_row[j];
+                    color = getRandomColor(label, discretization);
+                }
+                
+                random_row[j] = color;
+            }
         }
-    }
+    });
 }
 
 void Visualization::drawPerturbedMeans(const cv::Mat &image, const cv::Mat &labels, 
-            cv::Mat &mean_image) {
+            cv::Mat &mean_image, int threads) {
     
     LOG_IF(FATAL, image.rows != labels.rows || image.cols != labels.cols) 
             << "Image size and superpixel segmentation size do not match: " 
@@ -115,64 +255,40 @@ void Visualization::drawPerturbedMeans(const cv::Mat &image, const cv::Mat &labe
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only three-channel images are supported.";
     
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
-    
-    std::vector<cv::Vec3f> means(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<cv::Vec3f> perturbation(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> counts(superpixels, 0);
+    std::vector<cv::Vec3f> means;
+    std::vector<int> counts;
+    computeMeans(image, labels, threads, means, counts);
     
     std::random_device rd;
     std::mt19937 gen(rd());
     std::normal_distribution<> gaussian(0, 8);
     
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            means[labels.at<int>(i, j)][0] += image.at<cv::Vec3b>(i, j)[0];
-            means[labels.at<int>(i, j)][1] += image.at<cv::Vec3b>(i, j)[1];
-            means[labels.at<int>(i, j)][2] += image.at<cv::Vec3b>(i, j)[2];
-            
-            while (perturbation[labels.at<int>(i, j)][0] == 0
-                    && perturbation[labels.at<int>(i, j)][1] == 0
-                    && perturbation[labels.at<int>(i, j)][2] == 0) {
-                
-                perturbation[labels.at<int>(i, j)][0] += gaussian(gen);
-                perturbation[labels.at<int>(i, j)][1] += gaussian(gen);
-                perturbation[labels.at<int>(i, j)][2] += gaussian(gen);
-            }
-            
-            counts[labels.at<int>(i, j)]++;
+    std::vector<cv::Vec3b> colors(means.size(), cv::Vec3b(0, 0, 0));
+    for (unsigned int k = 0; k < means.size(); ++k) {
+        if (counts[k] == 0) {
+            continue;
         }
-    }
-    
-    for (int k = 0; k < superpixels; ++k) {
-        means[k] /= counts[k];
-    }
-    
-    mean_image.create(image.rows, image.cols, CV_8UC3);
-    for (int i = 0; i < mean_image.rows; ++i) {
-        for (int j = 0; j < mean_image.cols; ++j) {
-            
-            cv::Vec3f color = means[labels.at<int>(i, j)] + perturbation[labels.at<int>(i, j)];
-            color[0] = std::max(0.f, std::min(255.f, color[0]));
-            color[1] = std::max(0.f, std::min(255.f, color[1]));
-            color[2] = std::max(0.f, std::min(255.f, color[2]));
-            
-            mean_image.at<cv::Vec3b>(i, j) = color;
+        
+        cv::Vec3f perturbation(0, 0, 0);
+        while (perturbation[0] == 0 && perturbation[1] == 0 && perturbation[2] == 0) {
+            perturbation[0] += gaussian(gen);
+            perturbation[1] += gaussian(gen);
+            perturbation[2] += gaussian(gen);
         }
+        
+        cv::Vec3f color = means[k] + perturbation;
+        color[0] = std::max(0.f, std::min(255.f, color[0]));
+        color[1] = std::max(0.f, std::min(255.f, color[1]));
+        color[2] = std::max(0.f, std::min(255.f, color[2]));
+        
+        colors[k] = color;
     }
+    
+    drawLabelColors(labels, colors, threads, mean_image);
 }
 
 void Visualization::drawMeans(const cv::Mat &image, const cv::Mat &labels, 
-        cv::Mat &mean_image) {
+        cv::Mat &mean_image, int threads) {
     
     LOG_IF(FATAL, image.rows != labels.rows || image.cols != labels.cols) 
             << "Image size and superpixel segmentation size do not match: " 
@@ -180,40 +296,16 @@ void Visualization::drawMeans(const cv::Mat &image, const cv::Mat &labels,
     LOG_IF(FATAL, image.empty()) << "Given image is empty.";
     LOG_IF(FATAL, image.channels() != 3) << "Currently only three-channel images are supported.";
     
-    int superpixels = 0;
-    for (int i = 0; i < labels.rows; ++i) {
-        for (int j = 0; j < labels.cols; ++j) {
-            if (labels.at<int>(i, j) > superpixels) {
-                superpixels = labels.at<int>(i, j);
-            }
-        }
-    }
-    
-    superpixels++;
-    
-    std::vector<cv::Vec3f> means(superpixels, cv::Vec3f(0, 0, 0));
-    std::vector<int> counts(superpixels, 0);
-    
-    for (int i = 0; i < image.rows; ++i) {
-        for (int j = 0; j < image.cols; ++j) {
-            means[labels.at<int>(i, j)][0] += image.at<cv::Vec3b>(i, j)[0];
-            means[labels.at<int>(i, j)][1] += image.at<cv::Vec3b>(i, j)[1];
-            means[labels.at<int>(i, j)][2] += image.at<cv::Vec3b>(i, j)[2];
-            
-            counts[labels.at<int>(i, j)]++;
-        }
-    }
+    std::vector<cv::Vec3f> means;
+    std::vector<int> counts;
+    computeMeans(image, labels, threads, means, counts);
     
-    for (int k = 0; k < superpixels; ++k) {
-        means[k] /= counts[k];
+    std::vector<cv::Vec3b> colors(means.size(), cv::Vec3b(0, 0, 0));
+    for (unsigned int k = 0; k < means.size(); ++k) {
+        colors[k] = means[k];
     }
     
-    mean_image.create(image.rows, image.cols, CV_8UC3);
-    for (int i = 0; i < mean_image.rows; ++i) {
-        for (int j = 0; j < mean_image.cols; ++j) {
-            mean_image.at<cv::Vec3b>(i, j) = means[labels.at<int>(i, j)];
-        }
-    }
+    drawLabelColors(labels, colors, threads, mean_image);
 }
 
 void Visualization::drawPrecisionRecall(const cv::Mat &image, const cv::Mat &labels, 
@@ -35,6 +35,10 @@
 #include <opencv2/opencv.hpp>
 
 /** \brief Some basic visualizations of superpixel segmentations.
+ * 
+ * drawContours, drawRandom, drawMeans and drawPerturbedMeans work on row 
+ * strips in parallel; see AsyncWriter for rendering and writing visualizations 
+ * on a background thread.
  * \author David Stutz
  */
 class Visualization {
@@ -44,32 +48,36 @@ public:
      * \param[in] labels superpixel labels
      * \param[out] contours copy of the images with painted contours
      * \param[in] eight_connected whether to use eight connected graph
+     * \param[in] threads number of threads, <= 0 for all hardware threads
      */
     static void drawContours(const cv::Mat &image, const cv::Mat &labels, 
-            cv::Mat &contours, bool eight_connected = false);
+            cv::Mat &contours, bool eight_connected = false, int threads = 0);
     
     /** \brief Color superpixels randomly.
      * \param[in] image image to draw contours in
      * \param[in] labels superpixel labels
      * \param[out] random image with randomly colored superpixels
+     * \param[in] threads number of threads, <= 0 for all hardware threads
      */
-    static void drawRandom(const cv::Mat &labels, cv::Mat &random);
+    static void drawRandom(const cv::Mat &labels, cv::Mat &random, int threads = 0);
     
     /** \brief Draw mean colored superpixels.
      * \param[in] image image to draw contours in
      * \param[in] labels superpixel labels
      * \param[out] means image with superpixels colored by the mean color
+     * \param[in] threads number of threads, <= 0 for all hardware threads
      */
     static void drawMeans(const cv::Mat &image, const cv::Mat &labels, 
-            cv::Mat &means);
+            cv::Mat &means, int threads = 0);
     
     /** \brief Draw perturbed mean colored superpixels.
      * \param[in] image image to draw contours in
      * \param[in] labels superpixel labels
      * \param[out] means image with superpixels colored by the mean color plus a small noise term
+     * \param[in] threads number of threads, <= 0 for all hardware threads
      */
     static void drawPerturbedMeans(const cv::Mat &image, const cv::Mat &labels, 
-            cv::Mat &means);
+            cv::Mat &means, int threads = 0);
     
     /** \brief Indicate false negatives and false positives.
      * \param[in] image image to draw contours in
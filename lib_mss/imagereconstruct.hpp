@@ -2,130 +2,166 @@
 #define _IMAGERECONSTRUCTION_H_
 
 #include <opencv2/opencv.hpp>
-#include <queue>
-
-struct Pixel {
-	int row;
-	int col;
-};
+#include <algorithm>
+#include <vector>
 
 using namespace cv;
 using namespace std;
 
-template<typename T> void PropagationStep(Mat& marker, Mat& mask ,int x, int y, int offsetX, int offsetY, queue<Pixel>& queue)
+// Growable FIFO of pixel offsets on a preallocated ring buffer
+class PixelQueue {
+public:
+	PixelQueue(size_t capacity) : buffer(1), head(0), tail(0), size(0)
+	{
+		while(buffer.size() < capacity)
+			buffer.resize(2 * buffer.size());
+	}
+
+	bool empty() const { return size == 0; }
+
+	void push(int pixel)
+	{
+		if(size == buffer.size())
+			grow();
+
+		buffer[tail] = pixel;
+		tail = (tail + 1) & (buffer.size() - 1);
+		size++;
+	}
+
+	int pop()
+	{
+		int pixel = buffer[head];
+		head = (head + 1) & (buffer.size() - 1);
+		size--;
+		return pixel;
+	}
+
+private:
+	void grow()
+	{
+		vector<int> larger(2 * buffer.size());
+		for(size_t i = 0; i < size; i++)
+			larger[i] = buffer[(head + i) & (buffer.size() - 1)];
+
+		buffer.swap(larger);
+		head = 0;
+		tail = size;
+	}
+
+	vector<int> buffer;  // capacity is a power of two
+	size_t head;
+	size_t tail;
+	size_t size;
+};
+
+// Maximum of the pixel and its three neighbours in the previous row (or the next row for the
+// anti-raster scan); independent of the current row, so the loop over the interior is vectorized
+template<typename T> void MaxOfRow(const T* pixels, const T* neighbours, int cols, T* result)
 {
-	if(marker.at<T>(x+offsetX, y+offsetY) < marker.at<T>(x, y)) {
-		if(mask.at<T>(x+offsetX, y+offsetY) != marker.at<T>(x+offsetX, y+offsetY)) {
-			
-			Pixel pixel = { x+offsetX, y+offsetY };
-			queue.push(pixel);
-
-			if(mask.at<T>(x+offsetX, y+offsetY) < marker.at<T>(x, y)) {
-				marker.at<T>(x+offsetX, y+offsetY) = mask.at<T>(x+offsetX, y+offsetY);
-			} else {
-				marker.at<T>(x+offsetX, y+offsetY) = marker.at<T>(x, y);
-			}
-		}
+	if(cols == 1) {
+		result[0] = std::max(pixels[0], neighbours[0]);
+		return;
 	}
+
+	result[0] = std::max(std::max(pixels[0], neighbours[0]), neighbours[1]);
+	for(int col = 1; col < cols - 1; col++)
+		result[col] = std::max(std::max(pixels[col], neighbours[col - 1]), std::max(neighbours[col], neighbours[col + 1]));
+	result[cols - 1] = std::max(std::max(pixels[cols - 1], neighbours[cols - 2]), neighbours[cols - 1]);
 }
 
+// Morphological reconstruction by dilation of marker under mask (8-connected, marker <= mask),
+// using the hybrid algorithm of L. Vincent: a raster and an anti-raster scan followed by FIFO
+// propagation from the pixels that can still change. Works on row pointers without padding.
 template<typename T> void ImageReconstruct(Mat& marker, Mat& mask)
 {
-	queue<Pixel> queue;
-
-	int offset = 4;
-	Scalar scalar = Scalar(0);
-
-	Mat tempMarkerImage = Mat(marker.rows + 2 * offset, marker.cols + 2 * offset, marker.depth());
-	copyMakeBorder(marker, tempMarkerImage, offset, offset, offset, offset, BORDER_CONSTANT, scalar);
-
-	Mat tempMaskImage = Mat(mask.rows + 2 * offset, mask.cols + 2 * offset, mask.depth());
-	copyMakeBorder(mask, tempMaskImage, offset, offset, offset, offset, BORDER_CONSTANT, scalar);
-
-	for(int row = offset; row < tempMarkerImage.rows - offset; row++) {
-		for(int col = offset; col < tempMarkerImage.cols - offset; col++) {
-			T currentPixel = tempMarkerImage.at<T>(row, col);
-
-			if(currentPixel < tempMarkerImage.at<T>(row, col-1))
-				currentPixel = tempMarkerImage.at<T>(row, col-1);
-			if(currentPixel < tempMarkerImage.at<T>(row-1, col-1))
-				currentPixel = tempMarkerImage.at<T>(row-1, col-1);
-			if(currentPixel < tempMarkerImage.at<T>(row-1, col))
-				currentPixel = tempMarkerImage.at<T>(row-1, col);
-			if(currentPixel < tempMarkerImage.at<T>(row-1, col+1))
-				currentPixel = tempMarkerImage.at<T>(row-1, col+1);
-
-			if(currentPixel > tempMaskImage.at<T>(row, col))
-				tempMarkerImage.at<T>(row, col) = tempMaskImage.at<T>(row, col);
-			else
-				tempMarkerImage.at<T>(row, col) = currentPixel;
+	CV_Assert(marker.type() == mask.type() && marker.size() == mask.size());
+	CV_Assert(marker.channels() == 1);
+
+	const int rows = marker.rows;
+	const int cols = marker.cols;
+	if(rows == 0 || cols == 0)
+		return;
+
+	vector<T> rowMax(cols);
+
+	// Raster scan over the causal neighbourhood (left, upper left, upper, upper right)
+	for(int row = 0; row < rows; row++) {
+		T* markerRow = marker.ptr<T>(row);
+		const T* maskRow = mask.ptr<T>(row);
+
+		if(row > 0)
+			MaxOfRow<T>(markerRow, marker.ptr<T>(row - 1), cols, &rowMax[0]);
+		else
+			std::copy(markerRow, markerRow + cols, rowMax.begin());
+
+		T left = rowMax[0];
+		markerRow[0] = std::min(left, maskRow[0]);
+		for(int col = 1; col < cols; col++) {
+			left = std::min(std::max(rowMax[col], markerRow[col - 1]), maskRow[col]);
+			markerRow[col] = left;
 		}
 	}
 
-	for(int row = tempMarkerImage.rows - offset - 1; row > offset - 1; row--) {
-		for(int col = tempMarkerImage.cols - offset - 1; col > offset - 1; col--) {
-			T currentPixel = tempMarkerImage.at<T>(row, col);
-
-			if(currentPixel < tempMarkerImage.at<T>(row, col+1))
-				currentPixel = tempMarkerImage.at<T>(row, col+1);
-			if(currentPixel < tempMarkerImage.at<T>(row+1, col+1))
-				currentPixel = tempMarkerImage.at<T>(row+1, col+1);
-			if(currentPixel < tempMarkerImage.at<T>(row+1, col))
-				currentPixel = tempMarkerImage.at<T>(row+1, col);
-			if(currentPixel < tempMarkerImage.at<T>(row+1, col-1))
-				currentPixel = tempMarkerImage.at<T>(row+1, col-1);
-
-			if(currentPixel > tempMaskImage.at<T>(row, col))
-				tempMarkerImage.at<T>(row, col) = tempMaskImage.at<T>(row, col);
-			else
-				tempMarkerImage.at<T>(row, col) = currentPixel;
-
-			currentPixel = tempMarkerImage.at<T>(row, col);
-			if(tempMarkerImage.at<T>(row, col+1) < currentPixel &&
-			   tempMarkerImage.at<T>(row, col+1) < tempMaskImage.at<T>(row, col+1))
-			{
-				Pixel pixel = { row, col };
-				queue.push(pixel);
-			}
-			else if(tempMarkerImage.at<T>(row+1, col+1) < currentPixel &&
-			   tempMarkerImage.at<T>(row+1, col+1) < tempMaskImage.at<T>(row+1, col+1))
-			{
-				Pixel pixel = { row, col };
-				queue.push(pixel);
-			}
-			else if(tempMarkerImage.at<T>(row+1, col) < currentPixel &&
-			   tempMarkerImage.at<T>(row+1, col) < tempMaskImage.at<T>(row+1, col))
-			{
-				Pixel pixel = { row, col };
-				queue.push(pixel);
-			}
-			else if(tempMarkerImage.at<T>(row+1, col-1) < currentPixel &&
-			   tempMarkerImage.at<T>(row+1, col-1) < tempMaskImage.at<T>(row+1, col-1))
-			{
-				Pixel pixel = { row, col };
-				queue.push(pixel);
+	PixelQueue queue(static_cast<size_t>(rows) * cols / 4 + 1);
+
+	// Anti-raster scan over the anti-causal neighbourhood (right, lower right, lower, lower left);
+	// pixels which can still increase one of these neighbours start the propagation
+	for(int row = rows - 1; row >= 0; row--) {
+		T* markerRow = marker.ptr<T>(row);
+		const T* maskRow = mask.ptr<T>(row);
+		const T* markerBelow = (row < rows - 1) ? marker.ptr<T>(row + 1) : 0;
+		const T* maskBelow = (row < rows - 1) ? mask.ptr<T>(row + 1) : 0;
+
+		if(markerBelow)
+			MaxOfRow<T>(markerRow, markerBelow, cols, &rowMax[0]);
+		else
+			std::copy(markerRow, markerRow + cols, rowMax.begin());
+
+		for(int col = cols - 1; col >= 0; col--) {
+			T current = rowMax[col];
+			if(col < cols - 1)
+				current = std::max(current, markerRow[col + 1]);
+			current = std::min(current, maskRow[col]);
+			markerRow[col] = current;
+
+			bool propagate = (col < cols - 1 && markerRow[col + 1] < current && markerRow[col + 1] < maskRow[col + 1]);
+			if(!propagate && markerBelow) {
+				const int first = std::max(col - 1, 0);
+				const int last = std::min(col + 1, cols - 1);
+				for(int k = first; k <= last && !propagate; k++)
+					propagate = (markerBelow[k] < current && markerBelow[k] < maskBelow[k]);
 			}
+
+			if(propagate)
+				queue.push(row * cols + col);
 		}
 	}
 
+	// FIFO propagation
 	while(!queue.empty()) {
-		Pixel pixel = queue.front(); queue.pop();
-
-		for(int i = -1; i <= 1; i++) {
-			for(int k = -1; k <= 1; k++) {
-				if(i == 0 && k == 0)
-					continue;
-
-				PropagationStep<T>(tempMarkerImage, tempMaskImage, pixel.row, pixel.col, i, k, queue);
+		const int pixel = queue.pop();
+		const int row = pixel / cols;
+		const int col = pixel - row * cols;
+		const T current = marker.ptr<T>(row)[col];
+
+		const int firstRow = std::max(row - 1, 0);
+		const int lastRow = std::min(row + 1, rows - 1);
+		const int firstCol = std::max(col - 1, 0);
+		const int lastCol = std::min(col + 1, cols - 1);
+
+		for(int r = firstRow; r <= lastRow; r++) {
+			T* markerRow = marker.ptr<T>(r);
+			const T* maskRow = mask.ptr<T>(r);
+
+			for(int c = firstCol; c <= lastCol; c++) {
+				if(markerRow[c] < current && maskRow[c] != markerRow[c]) {
+					markerRow[c] = std::min(current, maskRow[c]);
+					queue.push(r * cols + c);
+				}
 			}
 		}
 	}
-
-	tempMarkerImage.adjustROI(-offset, -offset, -offset, -offset);
-	tempMarkerImage.copyTo(marker);
-
-	tempMarkerImage.release();
-	tempMaskImage.release();
 }
 
 #endif
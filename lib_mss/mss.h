@@ -32,8 +32,30 @@
 #ifndef MSS_H
 #define	MSS_H
 
+#include <thread>
+#include <functional>
 #include "imagereconstruct.hpp"
 
+/** \brief Filter a single channel by closing and opening by reconstruction.
+ * \param[in,out] channel channel to filter
+ * \param[in] StructElem structuring element
+ */
+inline void MSPFilterChannel(cv::Mat& channel, const cv::Mat& StructElem) {
+    cv::Mat sourceReconstr;
+    
+    cv::bitwise_not(channel,channel);
+    cv::erode(channel, sourceReconstr,StructElem);
+
+    ImageReconstruct < unsigned char > ( sourceReconstr, channel);
+    sourceReconstr.copyTo(channel);
+
+    cv::bitwise_not(channel,channel);
+    cv::erode(channel, sourceReconstr,StructElem);
+
+    ImageReconstruct < unsigned char > ( sourceReconstr, channel);
+    sourceReconstr.copyTo(channel);
+}
+
 int MSP(const cv::Mat& InpImg3C, cv::Mat& ImgMarker, int SizeStructElem = 7, 
         double Noise = 3.0f, double TolerRange = 7.0f, 
         int SPsizeX = 30, int SPsizeY = 30, int maxNoOfIter = 3) {
@@ -48,25 +70,22 @@ int MSP(const cv::Mat& InpImg3C, cv::Mat& ImgMarker, int SizeStructElem = 7,
     /////////////////////////////////////////////////////////////////////////////////
 
     std::vector<cv::Mat> channels;
-    cv::split(InpImg3Ccopy,channels);
-
-    cv::Mat sourceReconstr = cv::Mat(InpImg3C.size(), CV_8U) ;
     cv::Mat FilterInpIm;
     //cvtColor(InpImg3Ccopy,FilterInpIm,cv::COLOR_BGR2Lab);
     cv::split(InpImg3Ccopy,channels);
-    for(int ch = 0; ch < 3; ch++) {
-        cv::bitwise_not(channels[ch],channels[ch]);
-        cv::erode(channels[ch], sourceReconstr,StructElem);
-
-        ImageReconstruct < unsigned char > ( sourceReconstr, channels[ch]);
-        sourceReconstr.copyTo(channels[ch]);
-
-        cv::bitwise_not(channels[ch],channels[ch]);
-        cv::erode(channels[ch], sourceReconstr,StructElem);
-
-        ImageReconstruct < unsigned char > ( sourceReconstr, channels[ch]);
-        sourceReconstr.copyTo(channels[ch]);
+    
+    // The channels are independent, so they are filtered concurrently.
+    std::vector<std::thread> workers;
+    for(int ch = 1; ch < 3; ch++) {
+        workers.push_back(std::thread(MSPFilterChannel, std::ref(channels[ch]), 
+                std::cref(StructElem)));
+    }
+    
+    MSPFilterChannel(channels[0], StructElem);
+    for(unsigned int t = 0; t < workers.size(); t++) {
+        workers[t].join();
     }
+    
     cv::merge(channels, InpImg3Ccopy);
     //cvtColor(InpImg3Ccopy,FilterInpIm,cv::COLOR_Lab2BGR);
 
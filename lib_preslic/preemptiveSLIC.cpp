@@ -38,6 +38,8 @@
 #include <cmath>
 #include <iostream>
 #include <fstream>
+#include <thread>
+#include <atomic>
 #include "preemptiveSLIC.h"
 
 
@@ -53,6 +55,7 @@ PreemptiveSLIC::PreemptiveSLIC()
 	m_lvec = NULL;
 	m_avec = NULL;
 	m_bvec = NULL;
+	m_threads = 1;
 }
 
 PreemptiveSLIC::~PreemptiveSLIC()
@@ -389,160 +392,154 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
     int sz = m_width*m_height;
     const int numk = kseedsl.size();
     
-    vector<double> clustersize(numk, 0);
-    vector<double> inv(numk, 0);//to store 1/clustersize[k] values
-
-    vector<double> sigmal(numk, 0);
-    vector<double> sigmaa(numk, 0);
-    vector<double> sigmab(numk, 0);
-    vector<double> sigmax(numk, 0);
-    vector<double> sigmay(numk, 0);
-    vector<double> distvec(sz, DBL_MAX);
-    vector<unsigned int> changes(numk, 0);
+    // change counters are indexed by cluster and by seed grid cell, the grid cell of the
+    // last pixels may lie outside the m_nx x m_ny grid
+    const int x_seed_max = max(int(m_width-1-m_pixel_offset)/int(m_sx + 1), m_nx - 1);
+    const int y_seed_max = max(int(m_height-1-m_pixel_offset)/int(m_sy + 1), m_ny - 1);
+    const int numc = max(numk, (y_seed_max + 1)*m_nx + x_seed_max + 1);
     
-    double invwt = 1.0/((m_sx/M)*(m_sy/M));
+    const float invwt = 1.0/((m_sx/M)*(m_sy/M));
     
-    int x1, y1, x2, y2;
-    double l, a, b;
-    double dist;
-    double distxy;
-    double dl, da, db, dx, dy;
-    unsigned int callCount=0;
+    // single precision copies of the image and the per pixel state; the buffers
+    // are members and keep their memory across calls
+    m_lvecf.assign(m_lvec, m_lvec + sz);
+    m_avecf.assign(m_avec, m_avec + sz);
+    m_bvecf.assign(m_bvec, m_bvec + sz);
+    m_distvec.assign(sz, FLT_MAX);
+    m_klabels_new.assign(sz, 1);
+    m_nChangesVec.assign(numc, sz);
     
-    std::vector<int> klabels_new(sz, 1);
-    
-    // assign each pixel to the nearest cluster
     for( int s = 0; s < sz; s++ )
     {
       klabels[s] = 0;
-      klabels_new[s] = 1;
     }
     
-    vector<unsigned int> nChangesVec(sz, sz);
+    // the image is split into row strips which the threads take from a shared
+    // counter; within a strip the clusters are processed in increasing order,
+    // so the labels do not depend on the number of threads
+    const int threads = max(1, min(m_threads, m_height));
+    const int strips = (threads > 1) ? min(m_height, 4*threads) : 1;
+    if( (int) m_scratch.size() < threads )
+      m_scratch.resize(threads);
+    
+    vector<int> active;
+    vector<int> windows;
+    active.reserve(numk);
+    windows.reserve(4*numk);
     
     int nChanges = sz;
-    int nSkippedClusters;
 
     // main iteration loop 
-    vector<double> dist_n((2*m_sx+1)*(2*m_sy+1));
     for( int itr = 0; itr < maxIter; itr++ )
     {      
       
         if(nChanges<preemptive_thresh_iteration*sz)
           break;
 
-        nChanges=0;
-        nSkippedClusters = 0;
-//         distvec.assign(sz, DBL_MAX); // TODO CHANGED: uncommented
-                
-        // for each cluster
+        //-----------------------------------------------------------------
+        // Schedule the clusters with enough changes in their area
+        //-----------------------------------------------------------------
+        active.clear();
+        windows.clear();
         for( int n = 0; n < numk; n++ )
         {
-          // skip if there are too few changes in the area of this cluster
-          if(nChangesVec[n]<minChanges)
-          {
-            nSkippedClusters++;
+          if(m_nChangesVec[n]<minChanges)
             continue;
-          }
-          nChangesVec[n]=0;
+          m_nChangesVec[n]=0;
           
+          active.push_back(n);
+          windows.push_back(max(0.0,               kseedsy[n]-m_sy));
+          windows.push_back(min((double)m_height,  kseedsy[n]+m_sy));
+          windows.push_back(max(0.0,               kseedsx[n]-m_sx));
+          windows.push_back(min((double)m_width,   kseedsx[n]+m_sx));
+        }
+        
+        for( int t = 0; t < threads; t++ )
+        {
+          ThreadScratch& scratch = m_scratch[t];
+          scratch.sigmal.assign(numk, 0);
+          scratch.sigmaa.assign(numk, 0);
+          scratch.sigmab.assign(numk, 0);
+          scratch.sigmax.assign(numk, 0);
+          scratch.sigmay.assign(numk, 0);
+          scratch.clustersize.assign(numk, 0);
+          scratch.nChangesVec.assign(numc, 0);
+          scratch.nChanges = 0;
+        }
+        
+        ProcessStrips(threads, strips, [&](int thread, int strip)
+        {
+          const int r1 = (long long) m_height*strip/strips;
+          const int r2 = (long long) m_height*(strip + 1)/strips;
+          ThreadScratch& scratch = m_scratch[thread];
           
-          y1 = max(0.0,           kseedsy[n]-m_sy);
-          y2 = min((double)m_height,  kseedsy[n]+m_sy);
-          x1 = max(0.0,           kseedsx[n]-m_sx);
-          x2 = min((double)m_width,   kseedsx[n]+m_sx);
-
-          // for each pixel in the area of the cluster, update label and distance
-          int i=0;          
-          
-          double kseedsl_n = kseedsl[n];
-          double kseedsa_n = kseedsa[n];
-          double kseedsb_n = kseedsb[n];
-          
-          double kseedsy_n = kseedsy[n];
-          double kseedsx_n = kseedsx[n];          
-          
-          int dist_n_idx=0;
-          
-          // compute distance for each near pixel
-          for( int y = y1; y < y2; y++ )
+          //-----------------------------------------------------------------
+          // Update label and distance of each pixel in the area of an active cluster
+          //-----------------------------------------------------------------
+          for( size_t a = 0; a < active.size(); a++ )
           {
-            i = y*m_width + x1;
+            const int n = active[a];
+            const int y1 = max(windows[4*a], r1);
+            const int y2 = min(windows[4*a + 1], r2);
+            const int x1 = windows[4*a + 2];
+            const int x2 = windows[4*a + 3];
             
-            dy = y-kseedsy_n;
+            const float kseedsl_n = kseedsl[n];
+            const float kseedsa_n = kseedsa[n];
+            const float kseedsb_n = kseedsb[n];
+            const float kseedsy_n = kseedsy[n];
+            const float kseedsx_n = kseedsx[n];
             
-            for( int x = x1; x < x2; x++ )
+            for( int y = y1; y < y2; y++ )
             {
-                callCount++;                
-                
-                dl = m_lvec[i]-kseedsl_n;
-                da = m_avec[i]-kseedsa_n;
-                db = m_bvec[i]-kseedsb_n;
-                dx = x-kseedsx_n;
-                                    
-                dist = dl*dl + da*da + db*db;
-                distxy = dx*dx + dy*dy;
+              int i = y*m_width + x1;
+              const float dy = y-kseedsy_n;
+              
+              for( int x = x1; x < x2; x++ )
+              {
+                const float dl = m_lvecf[i]-kseedsl_n;
+                const float da = m_avecf[i]-kseedsa_n;
+                const float db = m_bvecf[i]-kseedsb_n;
+                const float dx = x-kseedsx_n;
                 
-                //------------------------------------------------------------------------
-                dist += distxy*invwt;//dist = sqrt(dist) + sqrt(distxy*invwt);//this is more exact
+                float dist = dl*dl + da*da + db*db;
+                const float distxy = dx*dx + dy*dy;
+                dist += distxy*invwt;
                 
-                dist_n[dist_n_idx] = dist;
-                dist_n_idx++;
-                //------------------------------------------------------------------------
+                if( dist < m_distvec[i] )
+                {
+                  m_distvec[i] = dist;
+                  m_klabels_new[i] = n;
+                }
                 i++;
+              }
             }
           }
           
-          // check for each near pixel, if distance is smaller than the prior best
-          dist_n_idx=0;
-          for( int y = y1; y < y2; y++ )
+          //-----------------------------------------------------------------
+          // Collect number of changes per cluster and the centroid sums
+          //-----------------------------------------------------------------
+          for( int r = r1; r < r2; r++ )
           {
-            i = y*m_width + x1;
-            for( int x = x1; x < x2; x++ )
-            {
-              if( dist_n[dist_n_idx] < distvec[i] ) 
-              {
-                distvec[i] = dist_n[dist_n_idx];
-                klabels_new[i]  = n;
-              }
-              dist_n_idx++;
-              i++;
-            }
-          }
-        }  // for each cluster
-        
- 
-
-
-        //-----------------------------------------------------------------
-        // Collect number of changes per cluster
-        //-----------------------------------------------------------------
-        int ind(0);
-
-        // for each pixel
-        int x_seed, y_seed;
-        for( int r = 0; r < m_height; r++ )
-        {
+            int ind = r*m_width;
             for( int c = 0; c < m_width; c++ )
             {
-              
               // if the label has changed
-              if(klabels_new[ind]!=klabels[ind])
+              if(m_klabels_new[ind]!=klabels[ind])
               {
-                
                   // update label
-                  klabels[ind] = klabels_new[ind];
+                  klabels[ind] = m_klabels_new[ind];
                   
                   // increase change counter
-                  nChanges++;
-  
-                  nChangesVec[ klabels[ind] ]++;
+                  scratch.nChanges++;
+                  scratch.nChangesVec[ klabels[ind] ]++;
                   
                   // TODO This will potentially not work for non grid like seeds
                   // Dirty fix for allowing integer valued m_sx and m_sy
                   // David Stutz <david.stutz@rwth-aachen.de>
-                  x_seed = int(c-m_pixel_offset)/int(m_sx + 1);
-                  y_seed = int(r-m_pixel_offset)/int(m_sy + 1);
+                  const int x_seed = int(c-m_pixel_offset)/int(m_sx + 1);
+                  const int y_seed = int(r-m_pixel_offset)/int(m_sy + 1);
+                  unsigned int* nChangesVec = &scratch.nChangesVec[0];
                   
                   // center
                   nChangesVec[ y_seed*m_nx + x_seed ]++; // center
@@ -558,70 +555,96 @@ void PreemptiveSLIC::PerformSuperpixelSLIC_preemptive(
                   if(x_seed<m_nx-1 &&  y_seed<m_ny-1)  nChangesVec[ (y_seed+1)*m_nx + x_seed + 1]++; // 
                   if(x_seed>0 && y_seed>0)             nChangesVec[ (y_seed-1)*m_nx + x_seed - 1]++; // 
                   if(x_seed>0 && y_seed<m_ny-1)        nChangesVec[ (y_seed+1)*m_nx + x_seed - 1]++; // 
-                    
               }
+              
+              // the sums are integer valued, so their order does not matter
+              const int k = klabels[ind];
+              scratch.sigmal[k] += m_lvec[ind];
+              scratch.sigmaa[k] += m_avec[ind];
+              scratch.sigmab[k] += m_bvec[ind];
+              scratch.sigmax[k] += c;
+              scratch.sigmay[k] += r;
+              scratch.clustersize[k] += 1.0;
+              
               ind++;
             }
+          }
+        });
+        
+        //-----------------------------------------------------------------
+        // Merge the per thread counters and sums
+        //-----------------------------------------------------------------
+        ThreadScratch& total = m_scratch[0];
+        nChanges = total.nChanges;
+        for( int t = 1; t < threads; t++ )
+        {
+          const ThreadScratch& scratch = m_scratch[t];
+          nChanges += scratch.nChanges;
+          for( int k = 0; k < numk; k++ )
+          {
+            total.sigmal[k] += scratch.sigmal[k];
+            total.sigmaa[k] += scratch.sigmaa[k];
+            total.sigmab[k] += scratch.sigmab[k];
+            total.sigmax[k] += scratch.sigmax[k];
+            total.sigmay[k] += scratch.sigmay[k];
+            total.clustersize[k] += scratch.clustersize[k];
+          }
+          for( int k = 0; k < numc; k++ )
+            total.nChangesVec[k] += scratch.nChangesVec[k];
         }
+        for( int k = 0; k < numc; k++ )
+          m_nChangesVec[k] += total.nChangesVec[k];
          
         //-----------------------------------------------------------------
         // Recalculate the centroid and store in the seed values
         //-----------------------------------------------------------------
-        //instead of reassigning memory on each iteration, just reset.
-    
-        sigmal.assign(numk, 0);
-        sigmaa.assign(numk, 0);
-        sigmab.assign(numk, 0);
-        sigmax.assign(numk, 0);
-        sigmay.assign(numk, 0);
-        clustersize.assign(numk, 0);
-        //------------------------------------
-        //edgesum.assign(numk, 0);
-        //------------------------------------
-        
-        ind=0;
-        for( int r = 0; r < m_height; r++ )
+        for( int k = 0; k < numk; k++ )
         {
-          for( int c = 0; c < m_width; c++ )
-          {
-              sigmal[klabels[ind]] += m_lvec[ind];
-              sigmaa[klabels[ind]] += m_avec[ind];
-              sigmab[klabels[ind]] += m_bvec[ind];
-              sigmax[klabels[ind]] += c;
-              sigmay[klabels[ind]] += r;
-              //------------------------------------
-              //edgesum[klabels[ind]] += edgemag[ind];
-              //------------------------------------
-              clustersize[klabels[ind]] += 1.0;                 
-
-           
-            ind++;
-          }            
+            if( total.clustersize[k] <= 0 ) total.clustersize[k] = 1;
+            const double inv = 1.0/total.clustersize[k];//computing inverse now to multiply, than divide later
+            
+            kseedsl[k] = total.sigmal[k]*inv;
+            kseedsa[k] = total.sigmaa[k]*inv;
+            kseedsb[k] = total.sigmab[k]*inv;
+            kseedsx[k] = total.sigmax[k]*inv;
+            kseedsy[k] = total.sigmay[k]*inv;
         }
         
-        // iterate over cluster and compute inverse of size
-        {for( int k = 0; k < numk; k++ )
-        {
-            if( clustersize[k] <= 0 ) clustersize[k] = 1;
-            inv[k] = 1.0/clustersize[k];//computing inverse now to multiply, than divide later
-        }}      
-
-        // iterate over cluster and update
-        {for( int k = 0; k < numk; k++ )
-        {
-            kseedsl[k] = sigmal[k]*inv[k];
-            kseedsa[k] = sigmaa[k]*inv[k];
-            kseedsb[k] = sigmab[k]*inv[k];
-            kseedsx[k] = sigmax[k]*inv[k];
-            kseedsy[k] = sigmay[k]*inv[k];
-            //------------------------------------
-            //edgesum[k] *= inv[k];
-            //------------------------------------
-        }}      
-        
     } // main loop
 }
 
+//===========================================================================
+///	ProcessStrips
+///
+/// Calls body(thread, strip) for all strips; each thread takes the next
+/// strip from a shared counter, the calling thread is thread 0.
+//===========================================================================
+void PreemptiveSLIC::ProcessStrips(
+    const int                               threads,
+    const int                               strips,
+    const std::function<void(int, int)>&    body)
+{
+    std::atomic<int> next(0);
+    auto worker = [&](int thread)
+    {
+      for( int strip = next++; strip < strips; strip = next++ )
+        body(thread, strip);
+    };
+    
+    std::vector<std::thread> workers;
+    for( int t = 1; t < threads; t++ )
+      workers.push_back(std::thread(worker, t));
+    
+    worker(0);
+    for( size_t t = 0; t < workers.size(); t++ )
+      workers[t].join();
+}
+
+void PreemptiveSLIC::setThreads(const int threads)
+{
+    m_threads = threads > 0 ? threads : max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+}
+
 //===========================================================================
 ///	EnforceLabelConnectivity
 ///
@@ -985,6 +1008,9 @@ void PreemptiveSLIC::preemptiveSLIC(const Mat& I_rgb, const int k, const double
   cvtColor(I_rgb, I_lab, CV_BGR2Lab); // I_lab is CV_8UC3
   
   // fill lab vectors
+  if(m_lvec) delete [] m_lvec;
+  if(m_avec) delete [] m_avec;
+  if(m_bvec) delete [] m_bvec;
   m_lvec = new double[sz];
   m_avec = new double[sz];
   m_bvec = new double[sz];
@@ -1054,6 +1080,9 @@ void PreemptiveSLIC::preemptiveSLIC(const Mat& I_rgb, const int region_size, con
    // I_lab is CV_8UC3
   
   // fill lab vectors
+  if(m_lvec) delete [] m_lvec;
+  if(m_avec) delete [] m_avec;
+  if(m_bvec) delete [] m_bvec;
   m_lvec = new double[sz];
   m_avec = new double[sz];
   m_bvec = new double[sz];
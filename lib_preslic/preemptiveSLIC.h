@@ -43,6 +43,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <functional>
 #include "opencv2/opencv.hpp"
 
 using namespace std;
@@ -70,6 +71,10 @@ public:
     void initSeeds(const cv::Mat& I,const int n, std::vector<double>& kseedsx, std::vector<double>& kseedsy, std::vector<double>& kseedsl, std::vector<double>& kseedsa,  std::vector<double>& kseedsb, int* klabels, bool init_labels_flag, cv::Mat& seeds);
     void initSeedsStep(const cv::Mat& I,const int region_size, std::vector<double>& kseedsx, std::vector<double>& kseedsy, std::vector<double>& kseedsl, std::vector<double>& kseedsa,  std::vector<double>& kseedsb, int* klabels, bool init_labels_flag, cv::Mat& seeds);
     
+    // number of threads used by the preemptive iterations (0 uses all hardware threads);
+    // the segmentation does not depend on it
+    void setThreads(const int threads);
+    
 	int m_nx;
     int m_ny;
     double m_sx;
@@ -107,6 +112,13 @@ private:
         int*&                       klabels,
         const double&               m = 10.0,
         const int&                  maxIter = 10);
+    //============================================================================
+    // Run body(thread, strip) for all strips on the given number of threads.
+    //============================================================================
+    static void ProcessStrips(
+        const int                               threads,
+        const int                               strips,
+        const std::function<void(int, int)>&    body);
 	//============================================================================
 	// Pick seeds for superpixels when step size of superpixels is given.
 	//============================================================================
@@ -174,6 +186,30 @@ private:
     
     int m_w_seed;
     int m_h_seed;
+    
+    int m_threads;
+    
+    // Per thread change counters and centroid sums of the preemptive iterations
+    struct ThreadScratch
+    {
+        vector<double> sigmal;
+        vector<double> sigmaa;
+        vector<double> sigmab;
+        vector<double> sigmax;
+        vector<double> sigmay;
+        vector<double> clustersize;
+        vector<unsigned int> nChangesVec;
+        int nChanges;
+    };
+    
+    // Buffers of the preemptive iterations, kept across calls
+    vector<float> m_lvecf;
+    vector<float> m_avecf;
+    vector<float> m_bvecf;
+    vector<float> m_distvec;
+    vector<int> m_klabels_new;
+    vector<unsigned int> m_nChangesVec;
+    vector<ThreadScratch> m_scratch;
 };
 
 #endif // !defined(_SLIC_H_INCLUDED_)
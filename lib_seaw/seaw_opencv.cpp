@@ -0,0 +1,565 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <thread>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "seaw_opencv.h"
+
+/** \brief Length of the distance table, see eaw_imp.h. */
+#define SEAW_TABLE_LEN 1024
+
+/** \brief Normalization of the update weights, see eaw_imp.h. */
+#define SEAW_UPDT 0.5
+
+/** \brief Look up the distance of two values as dist in eaw_imp.h.
+ * \param[in] table distance table
+ * \param[in] v difference
+ * \return distance
+ */
+static inline double seawDistance(const double* table, double v) {
+    if (v > 2 || v < -2) {
+        return table[0];
+    }
+    
+    int i = (int) ((v + 2) * 0.25 * SEAW_TABLE_LEN);
+    return table[std::min(i, SEAW_TABLE_LEN - 1)];
+}
+
+/** \brief Number of threads to use.
+ * \param[in] threads requested threads, <= 0 for all hardware threads
+ * \param[in] work number of independent work items
+ * \return number of threads
+ */
+static int seawThreads(int threads, int work) {
+    if (threads <= 0) {
+        threads = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    
+    return std::max(1, std::min(threads, work));
+}
+
+/** \brief Run f(t, r0, r1) on contiguous bands of rows, t being the index of
+ * the band.
+ * \param[in] rows number of rows
+ * \param[in] threads number of threads
+ * \param[in] f function on a band of rows
+ */
+template<typename F>
+static void seawParallelRows(int rows, int threads, const F &f) {
+    threads = seawThreads(threads, rows);
+    if (threads == 1) {
+        f(0, 0, rows);
+        return;
+    }
+    
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        int r0 = (int) ((long) rows*t/threads);
+        int r1 = (int) ((long) rows*(t + 1)/threads);
+        workers.push_back(std::thread(f, t, r0, r1));
+    }
+    
+    for (unsigned int t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+/** \brief Lifting step of the red-black transform on a band of rows, 
+ * following WRB in eaw_imp.h; the pixels touched by one step only read 
+ * pixels not touched by it, so bands can be processed independently.
+ * \param[in] OA original level
+ * \param[in,out] A transformed level
+ * \param[in] r0 first row
+ * \param[in] r1 last row (exclusive)
+ * \param[in] diagonal whether this is the second (diagonal) step
+ * \param[in] update whether this is the update instead of the prediction
+ * \param[in] table distance table
+ * \param[out] weights planes to store the prediction weights in
+ */
+static void seawLift(const cv::Mat &OA, cv::Mat &A, int r0, int r1, bool diagonal, 
+        bool update, const double* table, SEAW_OpenCV::Level &weights) {
+    
+    static const int STRAIGHT[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    static const int DIAGONAL[4][2] = {{-1, 1}, {-1, -1}, {1, 1}, {1, -1}};
+    const int (*offsets)[2] = (diagonal ? DIAGONAL : STRAIGHT);
+    
+    const int rows = A.rows;
+    const int cols = A.cols;
+    
+    // Weights are computed on the original level for the updates and on 
+    // the current state for the predictions.
+    const cv::Mat &S = (update ? OA : A);
+    const double normalization = (update ? SEAW_UPDT : 1.0);
+    const double sign = (update ? 1.0 : -1.0);
+    
+    for (int x = r0; x < r1; x++) {
+        
+        // The first steps touch pixels with odd (prediction) or even (update)
+        // x + y, the diagonal ones (odd, odd) or (even, even) pixels.
+        int y0 = 0;
+        if (diagonal) {
+            if (x%2 != (update ? 0 : 1)) {
+                continue;
+            }
+            
+            y0 = x%2;
+        }
+        else {
+            y0 = (update ? x%2 : (x + 1)%2);
+        }
+        
+        cv::Mat* planes = weights.oo;
+        if (!diagonal) {
+            planes = (x%2 == 0 ? weights.eo : weights.oe);
+        }
+        
+        for (int y = y0; y < cols; y += 2) {
+            
+            bool valid[4];
+            double w[4];
+            double a[4] = {0, 0, 0, 0};
+            double sum = 0;
+            
+            const double Sxy = S.at<double>(x, y);
+            for (int d = 0; d < 4; d++) {
+                const int nx = x + offsets[d][0];
+                const int ny = y + offsets[d][1];
+                
+                valid[d] = (nx >= 0 && ny >= 0 && nx < rows && ny < cols);
+                w[d] = 0;
+                
+                if (valid[d]) {
+                    w[d] = seawDistance(table, S.at<double>(nx, ny) - Sxy);
+                    a[d] = A.at<double>(nx, ny);
+                }
+                
+                sum += w[d];
+            }
+            
+            const double sw = normalization/sum;
+            for (int d = 0; d < 4; d++) {
+                w[d] *= sw;
+            }
+            
+            double &Axy = A.at<double>(x, y);
+            if (valid[0] && valid[1] && valid[2] && valid[3]) {
+                Axy += sign*(w[0]*a[0] + w[1]*a[1] + w[2]*a[2] + w[3]*a[3]);
+            }
+            else {
+                for (int d = 0; d < 4; d++) {
+                    if (valid[d]) {
+                        Axy += sign*(w[d]*a[d]);
+                    }
+                }
+            }
+            
+            if (!update) {
+                for (int d = 0; d < 4; d++) {
+                    planes[d].at<float>(x/2 + 1, y/2 + 1) = (float) w[d];
+                }
+            }
+        }
+    }
+}
+
+/** \brief out = w0*a0 + w1*a1 + w2*a2 + w3*a3 on n consecutive values.
+ * \param[in] w weights
+ * \param[in] a values
+ * \param[out] out result
+ * \param[in] n number of values
+ */
+static inline void seawLift4(const float* const* w, const float* const* a, float* out, int n) {
+    int j = 0;
+#if defined(__SSE2__)
+    for (; j + 4 <= n; j += 4) {
+        __m128 sum = _mm_mul_ps(_mm_loadu_ps(w[0] + j), _mm_loadu_ps(a[0] + j));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(w[1] + j), _mm_loadu_ps(a[1] + j)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(w[2] + j), _mm_loadu_ps(a[2] + j)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(w[3] + j), _mm_loadu_ps(a[3] + j)));
+        _mm_storeu_ps(out + j, sum);
+    }
+#endif
+    for (; j < n; j++) {
+        out[j] = w[0][j]*a[0][j] + w[1][j]*a[1][j] + w[2][j]*a[2][j] + w[3][j]*a[3][j];
+    }
+}
+
+/** \brief Interleave n even and n odd values.
+ * \param[in] even values at even positions
+ * \param[in] odd values at odd positions
+ * \param[out] out 2*n interleaved values
+ * \param[in] n number of pairs
+ */
+static inline void seawInterleave(const float* even, const float* odd, float* out, int n) {
+    int j = 0;
+#if defined(__SSE2__)
+    for (; j + 4 <= n; j += 4) {
+        __m128 e = _mm_loadu_ps(even + j);
+        __m128 o = _mm_loadu_ps(odd + j);
+        _mm_storeu_ps(out + 2*j, _mm_unpacklo_ps(e, o));
+        _mm_storeu_ps(out + 2*j + 4, _mm_unpackhi_ps(e, o));
+    }
+#endif
+    for (; j < n; j++) {
+        out[2*j] = even[j];
+        out[2*j + 1] = odd[j];
+    }
+}
+
+/** \brief Keep the maximum of n values and the corresponding label; only
+ * strictly larger values replace the current maximum.
+ * \param[in] values values
+ * \param[in] label label of the values
+ * \param[in,out] best current maxima
+ * \param[in,out] labels current labels
+ * \param[in] n number of values
+ */
+static inline void seawArgmax(const float* values, int label, float* best, int* labels, int n) {
+    int j = 0;
+#if defined(__SSE2__)
+    const __m128i label4 = _mm_set1_epi32(label);
+    for (; j + 4 <= n; j += 4) {
+        __m128 v = _mm_loadu_ps(values + j);
+        __m128 b = _mm_loadu_ps(best + j);
+        __m128 mask = _mm_cmpgt_ps(v, b);
+        _mm_storeu_ps(best + j, _mm_or_ps(_mm_and_ps(mask, v), _mm_andnot_ps(mask, b)));
+        
+        __m128i imask = _mm_castps_si128(mask);
+        __m128i l = _mm_loadu_si128((const __m128i*) (labels + j));
+        l = _mm_or_si128(_mm_and_si128(imask, label4), _mm_andnot_si128(imask, l));
+        _mm_storeu_si128((__m128i*) (labels + j), l);
+    }
+#endif
+    for (; j < n; j++) {
+        if (values[j] > best[j]) {
+            best[j] = values[j];
+            labels[j] = label;
+        }
+    }
+}
+
+/** \brief Set a window of a padded plane to zero.
+ * \param[in,out] plane padded plane
+ * \param[in] r0 first row
+ * \param[in] r1 last row (exclusive)
+ * \param[in] c0 first column
+ * \param[in] c1 last column (exclusive)
+ */
+static inline void seawZero(cv::Mat &plane, int r0, int r1, int c0, int c1) {
+    for (int i = r0; i < r1; i++) {
+        float* row = plane.ptr<float>(i + 1) + 1;
+        std::fill(row + c0, row + c1, 0.f);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SEAW_OpenCV
+////////////////////////////////////////////////////////////////////////////////
+
+void SEAW_OpenCV::initTable(int dist_func, double sigma, std::vector<double> &table) {
+    table.resize(SEAW_TABLE_LEN);
+    for (int i = 0; i < SEAW_TABLE_LEN; i++) {
+        double v = 4.0*(((double) i + 0.5)/SEAW_TABLE_LEN - 0.5);
+        
+        if (dist_func) {
+            table[i] = std::pow(std::fabs(v) + 0.0001, -sigma);
+        }
+        else {
+            v *= sigma;
+            table[i] = std::exp(-(v*v));
+        }
+    }
+}
+
+void SEAW_OpenCV::allocatePlanes(int rows, int cols, cv::Mat* planes, int count) {
+    for (int d = 0; d < count; d++) {
+        planes[d].create(rows + 2, cols + 2, CV_32FC1);
+        planes[d].setTo(cv::Scalar(0));
+    }
+}
+
+void SEAW_OpenCV::analyze(const cv::Mat &grid, int dist_func, double sigma, 
+        cv::Mat &coarse, Level &weights, int threads) {
+    
+    CV_Assert(grid.type() == CV_64FC1);
+    CV_Assert(grid.rows >= 2 && grid.cols >= 2);
+    
+    std::vector<double> table;
+    initTable(dist_func, sigma, table);
+    
+    const int rows = grid.rows;
+    const int cols = grid.cols;
+    
+    weights.rows = rows;
+    weights.cols = cols;
+    allocatePlanes((rows + 1)/2, (cols + 1)/2, weights.oo, 4);
+    allocatePlanes((rows + 1)/2, (cols + 1)/2, weights.eo, 4);
+    allocatePlanes((rows + 1)/2, (cols + 1)/2, weights.oe, 4);
+    
+    cv::Mat A = grid.clone();
+    
+    // PREDICT I, UPDATE I, PREDICT II, UPDATE II.
+    for (int step = 0; step < 4; step++) {
+        const bool diagonal = (step >= 2);
+        const bool update = (step%2 == 1);
+        
+        seawParallelRows(rows, threads, [&](int t, int r0, int r1) {
+            seawLift(grid, A, r0, r1, diagonal, update, &table[0], weights);
+        });
+    }
+    
+    coarse.create((rows + 1)/2, (cols + 1)/2, CV_64FC1);
+    for (int i = 0; i < coarse.rows; i++) {
+        for (int j = 0; j < coarse.cols; j++) {
+            coarse.at<double>(i, j) = A.at<double>(2*i, 2*j);
+        }
+    }
+}
+
+SEAW_OpenCV::Window SEAW_OpenCV::synthesizeWindow(const Level &weights, 
+        const cv::Mat &coarse, const Window &window, cv::Mat &oo, cv::Mat &eo, 
+        cv::Mat &oe, cv::Mat &fine) {
+    
+    const int rows = weights.rows;
+    const int cols = weights.cols;
+    const int coarse_rows = (rows + 1)/2;
+    const int coarse_cols = (cols + 1)/2;
+    
+    // Planes influenced by the window of the coarse level.
+    const int i0 = std::max(0, window.r0 - 1);
+    const int i1 = std::min(coarse_rows, window.r1 + 1);
+    const int j0 = std::max(0, window.c0 - 1);
+    const int j1 = std::min(coarse_cols, window.c1 + 1);
+    const int n = j1 - j0;
+    
+    #define SEAW_ROW(plane, i) (plane.ptr<float>((i) + 1) + 1 + j0)
+    
+    // PREDICT II on the (odd, odd) pixels.
+    for (int i = i0; i < i1; i++) {
+        const float* w[4] = {SEAW_ROW(weights.oo[0], i), SEAW_ROW(weights.oo[1], i),
+            SEAW_ROW(weights.oo[2], i), SEAW_ROW(weights.oo[3], i)};
+        const float* a[4] = {SEAW_ROW(coarse, i) + 1, SEAW_ROW(coarse, i), 
+            SEAW_ROW(coarse, i + 1) + 1, SEAW_ROW(coarse, i + 1)};
+        
+        seawLift4(w, a, SEAW_ROW(oo, i), n);
+    }
+    
+    // PREDICT I on the (even, odd) and (odd, even) pixels.
+    for (int i = i0; i < i1; i++) {
+        const float* weo[4] = {SEAW_ROW(weights.eo[0], i), SEAW_ROW(weights.eo[1], i),
+            SEAW_ROW(weights.eo[2], i), SEAW_ROW(weights.eo[3], i)};
+        const float* aeo[4] = {SEAW_ROW(oo, i), SEAW_ROW(oo, i - 1), 
+            SEAW_ROW(coarse, i) + 1, SEAW_ROW(coarse, i)};
+        
+        seawLift4(weo, aeo, SEAW_ROW(eo, i), n);
+        
+        const float* woe[4] = {SEAW_ROW(weights.oe[0], i), SEAW_ROW(weights.oe[1], i),
+            SEAW_ROW(weights.oe[2], i), SEAW_ROW(weights.oe[3], i)};
+        const float* aoe[4] = {SEAW_ROW(coarse, i + 1), SEAW_ROW(coarse, i), 
+            SEAW_ROW(oo, i), SEAW_ROW(oo, i) - 1};
+        
+        seawLift4(woe, aoe, SEAW_ROW(oe, i), n);
+    }
+    
+    // Pixels which do not exist have zero weights, so interleaving may 
+    // safely write zeros into the padding.
+    for (int i = i0; i < i1; i++) {
+        seawInterleave(SEAW_ROW(coarse, i), SEAW_ROW(eo, i), 
+                fine.ptr<float>(2*i + 1) + 1 + 2*j0, n);
+        seawInterleave(SEAW_ROW(oe, i), SEAW_ROW(oo, i), 
+                fine.ptr<float>(2*i + 2) + 1 + 2*j0, n);
+    }
+    
+    #undef SEAW_ROW
+    
+    Window result;
+    result.r0 = 2*i0;
+    result.r1 = std::min(rows, 2*i1);
+    result.c0 = 2*j0;
+    result.c1 = std::min(cols, 2*j1);
+    return result;
+}
+
+void SEAW_OpenCV::synthesize(const cv::Mat &coarse, const Level &weights, cv::Mat &fine) {
+    
+    CV_Assert(coarse.type() == CV_32FC1);
+    CV_Assert(coarse.rows == (weights.rows + 1)/2 && coarse.cols == (weights.cols + 1)/2);
+    
+    cv::Mat padded_coarse(coarse.rows + 2, coarse.cols + 2, CV_32FC1, cv::Scalar(0));
+    for (int i = 0; i < coarse.rows; i++) {
+        std::copy(coarse.ptr<float>(i), coarse.ptr<float>(i) + coarse.cols, 
+                padded_coarse.ptr<float>(i + 1) + 1);
+    }
+    
+    cv::Mat planes[3];
+    allocatePlanes(coarse.rows, coarse.cols, planes, 3);
+    
+    cv::Mat padded_fine(weights.rows + 2, weights.cols + 2, CV_32FC1, cv::Scalar(0));
+    
+    Window window;
+    window.r0 = 0;
+    window.r1 = coarse.rows;
+    window.c0 = 0;
+    window.c1 = coarse.cols;
+    synthesizeWindow(weights, padded_coarse, window, planes[0], planes[1], 
+            planes[2], padded_fine);
+    
+    fine.create(weights.rows, weights.cols, CV_32FC1);
+    for (int i = 0; i < fine.rows; i++) {
+        std::copy(padded_fine.ptr<float>(i + 1) + 1, padded_fine.ptr<float>(i + 1) + 1 + fine.cols,
+                fine.ptr<float>(i));
+    }
+}
+
+void SEAW_OpenCV::computeSuperpixels(const cv::Mat &image, int level, int dist_func, 
+        double sigma, cv::Mat &labels, int threads) {
+    
+    CV_Assert(image.type() == CV_8UC3 || image.type() == CV_8UC1);
+    CV_Assert(level >= 1);
+    
+    const int rows = image.rows;
+    const int cols = image.cols;
+    
+    // As in seaw_cli.m, at most floor(log2(min(rows, cols))) levels.
+    int levels = 0;
+    while ((2 << levels) <= std::min(rows, cols)) {
+        levels++;
+    }
+    level = std::min(level, levels);
+    CV_Assert(level >= 1);
+    
+    // The first channel in MATLAB is red.
+    const int channel = (image.channels() == 3 ? 2 : 0);
+    cv::Mat grid(rows, cols, CV_64FC1);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            grid.at<double>(i, j) = image.ptr<uchar>(i)[image.channels()*j + channel]/255.;
+        }
+    }
+    
+    std::vector<Level> weights(level);
+    for (int l = 0; l < level; l++) {
+        cv::Mat coarse;
+        analyze(grid, dist_func, sigma, coarse, weights[l], threads);
+        grid = coarse;
+    }
+    
+    // Coefficients are numbered in MATLAB's column-major order; each
+    // pixel is assigned to the scaling function with maximum value, ties
+    // going to the lower number as with max.
+    const int coarse_rows = grid.rows;
+    const int coarse_cols = grid.cols;
+    threads = seawThreads(threads, coarse_rows);
+    
+    std::vector<cv::Mat> best(threads);
+    std::vector<cv::Mat> best_labels(threads);
+    
+    seawParallelRows(coarse_rows, threads, [&](int t, int r0, int r1) {
+        best[t].create(rows, cols, CV_32FC1);
+        best[t].setTo(cv::Scalar(0));
+        best_labels[t].create(rows, cols, CV_32SC1);
+        best_labels[t].setTo(cv::Scalar(INT_MAX));
+        
+        Workspace workspace;
+        workspace.grids.resize(level + 1);
+        workspace.oo.resize(level);
+        workspace.eo.resize(level);
+        workspace.oe.resize(level);
+        
+        for (int l = 0; l < level; l++) {
+            allocatePlanes(weights[l].rows, weights[l].cols, &workspace.grids[l], 1);
+            allocatePlanes((weights[l].rows + 1)/2, (weights[l].cols + 1)/2, &workspace.oo[l], 1);
+            allocatePlanes((weights[l].rows + 1)/2, (weights[l].cols + 1)/2, &workspace.eo[l], 1);
+            allocatePlanes((weights[l].rows + 1)/2, (weights[l].cols + 1)/2, &workspace.oe[l], 1);
+        }
+        allocatePlanes(coarse_rows, coarse_cols, &workspace.grids[level], 1);
+        
+        std::vector<Window> windows(level + 1);
+        for (int j = 0; j < coarse_cols; j++) {
+            for (int i = r0; i < r1; i++) {
+                windows[level].r0 = i;
+                windows[level].r1 = i + 1;
+                windows[level].c0 = j;
+                windows[level].c1 = j + 1;
+                workspace.grids[level].at<float>(i + 1, j + 1) = 1;
+                
+                for (int l = level - 1; l >= 0; l--) {
+                    windows[l] = synthesizeWindow(weights[l], workspace.grids[l + 1], 
+                            windows[l + 1], workspace.oo[l], workspace.eo[l], 
+                            workspace.oe[l], workspace.grids[l]);
+                }
+                
+                const int label = i + j*coarse_rows;
+                const int c0 = windows[0].c0;
+                for (int r = windows[0].r0; r < windows[0].r1; r++) {
+                    seawArgmax(workspace.grids[0].ptr<float>(r + 1) + 1 + c0, label,
+                            best[t].ptr<float>(r) + c0, best_labels[t].ptr<int>(r) + c0,
+                            windows[0].c1 - c0);
+                }
+                
+                // Reset all buffers touched by this scaling function.
+                workspace.grids[level].at<float>(i + 1, j + 1) = 0;
+                for (int l = 0; l < level; l++) {
+                    const Window &w = windows[l];
+                    seawZero(workspace.grids[l], w.r0, w.r1, w.c0, w.c1);
+                    seawZero(workspace.oo[l], w.r0/2, (w.r1 + 1)/2, w.c0/2, (w.c1 + 1)/2);
+                    seawZero(workspace.eo[l], w.r0/2, (w.r1 + 1)/2, w.c0/2, (w.c1 + 1)/2);
+                    seawZero(workspace.oe[l], w.r0/2, (w.r1 + 1)/2, w.c0/2, (w.c1 + 1)/2);
+                }
+            }
+        }
+    });
+    
+    labels.create(rows, cols, CV_32SC1);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            float value = best[0].at<float>(i, j);
+            int label = best_labels[0].at<int>(i, j);
+            
+            for (int t = 1; t < threads; t++) {
+                const float other_value = best[t].at<float>(i, j);
+                const int other_label = best_labels[t].at<int>(i, j);
+                
+                if (other_value > value || (other_value == value && other_label < label)) {
+                    value = other_value;
+                    label = other_label;
+                }
+            }
+            
+            labels.at<int>(i, j) = (label == INT_MAX ? 0 : label);
+        }
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SEAW_OPENCV_H
+#define	SEAW_OPENCV_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Native implementation of SEAW, i.e. superpixels from the scaling 
+ * functions of the edge-avoiding red-black wavelets of R. Fattal, see 
+ * eaw_superpixels.m and seaw_cli.m.
+ * 
+ * The forward transform (WRB in eaw_imp.h) is run in double precision on the
+ * first (red) channel and only the prediction weights are kept, as these are 
+ * all that is needed for the guided inverse transform (iWRBg). The weights are
+ * stored in float as polyphase planes, i.e. separately for the pixels with 
+ * (even, odd), (odd, even) and (odd, odd) coordinates, such that each 
+ * prediction step of the inverse transform is a sum of four shifted rows and 
+ * is computed with SSE. The scaling function of a coefficient is only 
+ * non-zero in a window growing by a factor of two per level, and only this 
+ * window is computed.
+ * \author David Stutz
+ */
+class SEAW_OpenCV {
+public:
+    /** \brief Prediction weights of one level of the red-black transform. 
+     * Planes are indexed by coarse coordinates (i, j), padded by one on each
+     * side and zero for missing neighbors and pixels. For pixel (r, c) of the
+     * level, the weights of the neighbors are ordered (r + 1, c), (r - 1, c),
+     * (r, c + 1), (r, c - 1) for the first prediction and (r - 1, c + 1), 
+     * (r - 1, c - 1), (r + 1, c + 1), (r + 1, c - 1) for the second one. */
+    struct Level {
+        /** \brief Size of the level. */
+        int rows;
+        int cols;
+        /** \brief Weights of the pixels (2i + 1, 2j + 1), second prediction. */
+        cv::Mat oo[4];
+        /** \brief Weights of the pixels (2i, 2j + 1), first prediction. */
+        cv::Mat eo[4];
+        /** \brief Weights of the pixels (2i + 1, 2j), first prediction. */
+        cv::Mat oe[4];
+    };
+    
+    /** \brief Compute superpixels using SEAW.
+     * \param[in] image image to compute superpixels on
+     * \param[in] level level of the scaling functions, implicitly defining the
+     * number of superpixels
+     * \param[in] dist_func distance function, 0 for exp(-(sigma*d)^2), 
+     * 1 for 1/(|d| + eps)^sigma
+     * \param[in] sigma sigma parameter of the distance function
+     * \param[out] labels superpixel labels
+     * \param[in] threads number of threads, <= 0 for all hardware threads
+     */
+    static void computeSuperpixels(const cv::Mat &image, int level, int dist_func,
+            double sigma, cv::Mat &labels, int threads = 1);
+    
+    /** \brief Forward red-black transform of one level (WRB).
+     * \param[in] grid level as CV_64FC1
+     * \param[in] dist_func distance function, see computeSuperpixels
+     * \param[in] sigma sigma parameter of the distance function
+     * \param[out] coarse approximation coefficients of the next level, CV_64FC1
+     * \param[out] weights prediction weights of the level
+     * \param[in] threads number of threads, <= 0 for all hardware threads
+     */
+    static void analyze(const cv::Mat &grid, int dist_func, double sigma, 
+            cv::Mat &coarse, Level &weights, int threads = 1);
+    
+    /** \brief Guided inverse red-black transform of one level (iWRBg) without
+     * detail coefficients, i.e. edge-avoiding interpolation of the coarse
+     * coefficients.
+     * \param[in] coarse coefficients of the next level, CV_32FC1
+     * \param[in] weights prediction weights of the level
+     * \param[out] fine interpolated level, CV_32FC1
+     */
+    static void synthesize(const cv::Mat &coarse, const Level &weights, cv::Mat &fine);
+    
+private:
+    /** \brief Buffers for computing scaling functions within windows. */
+    struct Workspace {
+        /** \brief Per level, padded by one. */
+        std::vector<cv::Mat> grids;
+        std::vector<cv::Mat> oo;
+        std::vector<cv::Mat> eo;
+        std::vector<cv::Mat> oe;
+    };
+    
+    /** \brief Window, rows [r0, r1) and columns [c0, c1). */
+    struct Window {
+        int r0;
+        int r1;
+        int c0;
+        int c1;
+    };
+    
+    /** \brief Build the distance table as in init or init_exp. 
+     * \param[in] dist_func distance function
+     * \param[in] sigma sigma parameter
+     * \param[out] table distance table
+     */
+    static void initTable(int dist_func, double sigma, std::vector<double> &table);
+    
+    /** \brief Allocate padded planes of size rows x cols.
+     * \param[in] rows rows
+     * \param[in] cols columns
+     * \param[out] planes planes to allocate
+     * \param[in] count number of planes
+     */
+    static void allocatePlanes(int rows, int cols, cv::Mat* planes, int count);
+    
+    /** \brief Interpolate one level within a window of the coarse grid; all
+     * values of the coarse grid outside the window are expected to be zero.
+     * \param[in] weights prediction weights of the level
+     * \param[in] coarse padded coarse grid
+     * \param[in] window window in the coarse grid
+     * \param[in] oo padded scratch plane
+     * \param[in] eo padded scratch plane
+     * \param[in] oe padded scratch plane
+     * \param[out] fine padded fine grid, written within the returned window
+     * \return window in the fine grid
+     */
+    static Window synthesizeWindow(const Level &weights, const cv::Mat &coarse, 
+            const Window &window, cv::Mat &oo, cv::Mat &eo, cv::Mat &oe, cv::Mat &fine);
+};
+
+#endif	/* SEAW_OPENCV_H */
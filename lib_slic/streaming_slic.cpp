@@ -0,0 +1,381 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cfloat>
+#include "streaming_slic.h"
+
+StreamingSLIC::StreamingSLIC(int region_size, int temporal_step, int window, 
+        double compactness, int iterations, bool perturb_seeds) 
+        : region_size(region_size), temporal_step(temporal_step), 
+        window(window > 0 ? window : 2*temporal_step), iterations(iterations), 
+        perturb_seeds(perturb_seeds), first_frame(0), next_layer(temporal_step/2),
+        supervoxels(0) {
+    
+    CV_Assert(region_size > 0 && temporal_step > 0);
+    CV_Assert(compactness > 0 && iterations > 0);
+    
+    weight = 1.0/((region_size/compactness)*(region_size/compactness));
+}
+
+bool StreamingSLIC::push(const cv::Mat &frame, cv::Mat &labels) {
+    CV_Assert(!frame.empty() && frame.type() == CV_8UC3);
+    if (!frames.empty()) {
+        CV_Assert(frame.rows == frames.back().lab.rows 
+                && frame.cols == frames.back().lab.cols);
+    }
+    
+    Frame current;
+    cv::Mat frame_float;
+    frame.convertTo(frame_float, CV_32FC3, 1./255.);
+    cv::cvtColor(frame_float, current.lab, CV_BGR2Lab);
+    current.labels.create(frame.rows, frame.cols, CV_32SC1);
+    frames.push_back(current);
+    
+    if (getFrames() - 1 == next_layer) {
+        placeSeeds();
+        next_layer += temporal_step;
+    }
+    
+    if (static_cast<int>(frames.size()) < window) {
+        return false;
+    }
+    
+    iterate();
+    finalize(labels);
+    return true;
+}
+
+bool StreamingSLIC::flush(cv::Mat &labels) {
+    if (frames.empty()) {
+        return false;
+    }
+    
+    iterate();
+    finalize(labels);
+    return true;
+}
+
+int StreamingSLIC::getFrames() const {
+    return first_frame + static_cast<int>(frames.size());
+}
+
+int StreamingSLIC::getFinalizedFrames() const {
+    return first_frame;
+}
+
+int StreamingSLIC::getSupervoxels() const {
+    return supervoxels;
+}
+
+void StreamingSLIC::placeSeeds() {
+    const cv::Mat &lab = frames.back().lab;
+    const int width = lab.cols;
+    const int height = lab.rows;
+    
+    // Same grid as SLIC::GetLABXYSeeds_ForGivenStepSize.
+    int xstrips = 0.5 + float(width)/float(region_size);
+    int ystrips = 0.5 + float(height)/float(region_size);
+    
+    int xerr = width - region_size*xstrips;
+    if (xerr < 0) {
+        xstrips--;
+        xerr = width - region_size*xstrips;
+    }
+    
+    int yerr = height - region_size*ystrips;
+    if (yerr < 0) {
+        ystrips--;
+        yerr = height - region_size*ystrips;
+    }
+    
+    xstrips = std::max(xstrips, 1);
+    ystrips = std::max(ystrips, 1);
+    float xerrperstrip = float(std::max(xerr, 0))/float(xstrips);
+    float yerrperstrip = float(std::max(yerr, 0))/float(ystrips);
+    
+    // Squared Lab gradient as in SLIC::DetectLabEdges, zero at the border.
+    auto edge = [&lab, width, height](int x, int y) -> float {
+        if (x < 1 || x >= width - 1 || y < 1 || y >= height - 1) {
+            return 0;
+        }
+        
+        const cv::Vec3f &left = lab.at<cv::Vec3f>(y, x - 1);
+        const cv::Vec3f &right = lab.at<cv::Vec3f>(y, x + 1);
+        const cv::Vec3f &top = lab.at<cv::Vec3f>(y - 1, x);
+        const cv::Vec3f &bottom = lab.at<cv::Vec3f>(y + 1, x);
+        
+        float dx = 0;
+        float dy = 0;
+        for (int c = 0; c < 3; c++) {
+            dx += (left[c] - right[c])*(left[c] - right[c]);
+            dy += (top[c] - bottom[c])*(top[c] - bottom[c]);
+        }
+        
+        return dx*dx + dy*dy;
+    };
+    
+    const int dx8[8] = {-1, -1,  0,  1, 1, 1, 0, -1};
+    const int dy8[8] = { 0, -1, -1, -1, 0, 1, 1,  1};
+    
+    for (int j = 0; j < ystrips; j++) {
+        int ye = j*yerrperstrip;
+        for (int i = 0; i < xstrips; i++) {
+            int xe = i*xerrperstrip;
+            int x = std::min(i*region_size + region_size/2 + xe, width - 1);
+            int y = std::min(j*region_size + region_size/2 + ye, height - 1);
+            
+            if (perturb_seeds) {
+                int ox = x;
+                int oy = y;
+                float min_edge = edge(ox, oy);
+                
+                for (int k = 0; k < 8; k++) {
+                    int nx = ox + dx8[k];
+                    int ny = oy + dy8[k];
+                    
+                    if (nx >= 0 && nx < width && ny >= 0 && ny < height) {
+                        float e = edge(nx, ny);
+                        if (e < min_edge) {
+                            min_edge = e;
+                            x = nx;
+                            y = ny;
+                        }
+                    }
+                }
+            }
+            
+            const cv::Vec3f &color = lab.at<cv::Vec3f>(y, x);
+            
+            Seed seed;
+            seed.label = supervoxels++;
+            seed.l = color[0];
+            seed.a = color[1];
+            seed.b = color[2];
+            seed.x = x;
+            seed.y = y;
+            seed.t = getFrames() - 1;
+            std::fill(seed.finalized, seed.finalized + 6, 0.);
+            seed.finalized_size = 0;
+            
+            seeds.push_back(seed);
+        }
+    }
+}
+
+void StreamingSLIC::iterate() {
+    if (seeds.empty()) {
+        // The stream ended or the window is full before the first layer.
+        placeSeeds();
+    }
+    
+    const int width = frames.front().lab.cols;
+    const int height = frames.front().lab.rows;
+    const int depth = frames.size();
+    const int numk = seeds.size();
+    const float offset = region_size;
+    const float temporal_offset = temporal_step;
+    
+    distances.create(height, width, CV_32FC1);
+    std::vector<double> sigma(6*numk);
+    std::vector<double> clustersize(numk);
+    
+    for (int itr = 0; itr < iterations; itr++) {
+        
+        // Assign frame by frame such that a single distance buffer suffices;
+        // seeds are visited in the same order for every pixel.
+        for (int d = 0; d < depth; d++) {
+            const int z = first_frame + d;
+            const cv::Mat &lab = frames[d].lab;
+            cv::Mat &labels = frames[d].labels;
+            
+            distances.setTo(FLT_MAX);
+            labels.setTo(-1);
+            
+            for (int n = 0; n < numk; n++) {
+                const Seed &seed = seeds[n];
+                
+                int z1 = std::max(float(first_frame), seed.t - temporal_offset);
+                int z2 = std::min(float(first_frame + depth), seed.t + temporal_offset);
+                if (z < z1 || z >= z2) {
+                    continue;
+                }
+                
+                int y1 = std::max(0.0f, seed.y - offset);
+                int y2 = std::min(float(height), seed.y + offset);
+                int x1 = std::max(0.0f, seed.x - offset);
+                int x2 = std::min(float(width), seed.x + offset);
+                
+                const float distz = (z - seed.t)*(z - seed.t);
+                for (int y = y1; y < y2; y++) {
+                    const cv::Vec3f* lab_row = lab.ptr<cv::Vec3f>(y);
+                    float* distances_row = distances.ptr<float>(y);
+                    int* labels_row = labels.ptr<int>(y);
+                    
+                    const float distyz = (y - seed.y)*(y - seed.y) + distz;
+                    for (int x = x1; x < x2; x++) {
+                        const cv::Vec3f &color = lab_row[x];
+                        
+                        float dist = (color[0] - seed.l)*(color[0] - seed.l)
+                                + (color[1] - seed.a)*(color[1] - seed.a)
+                                + (color[2] - seed.b)*(color[2] - seed.b);
+                        dist += ((x - seed.x)*(x - seed.x) + distyz)*weight;
+                        
+                        if (dist < distances_row[x]) {
+                            distances_row[x] = dist;
+                            labels_row[x] = n;
+                        }
+                    }
+                }
+            }
+        }
+        
+        // Recompute the centers from the window and the finalized pixels.
+        std::fill(sigma.begin(), sigma.end(), 0.);
+        std::fill(clustersize.begin(), clustersize.end(), 0.);
+        
+        for (int d = 0; d < depth; d++) {
+            const int z = first_frame + d;
+            for (int y = 0; y < height; y++) {
+                const cv::Vec3f* lab_row = frames[d].lab.ptr<cv::Vec3f>(y);
+                const int* labels_row = frames[d].labels.ptr<int>(y);
+                
+                for (int x = 0; x < width; x++) {
+                    const int n = labels_row[x];
+                    if (n < 0) {
+                        continue;
+                    }
+                    
+                    double* sigma_n = &sigma[6*n];
+                    sigma_n[0] += lab_row[x][0];
+                    sigma_n[1] += lab_row[x][1];
+                    sigma_n[2] += lab_row[x][2];
+                    sigma_n[3] += x;
+                    sigma_n[4] += y;
+                    sigma_n[5] += z;
+                    clustersize[n] += 1;
+                }
+            }
+        }
+        
+        for (int n = 0; n < numk; n++) {
+            Seed &seed = seeds[n];
+            const double size = clustersize[n] + seed.finalized_size;
+            if (size <= 0) {
+                continue;
+            }
+            
+            const double* sigma_n = &sigma[6*n];
+            seed.l = (sigma_n[0] + seed.finalized[0])/size;
+            seed.a = (sigma_n[1] + seed.finalized[1])/size;
+            seed.b = (sigma_n[2] + seed.finalized[2])/size;
+            seed.x = (sigma_n[3] + seed.finalized[3])/size;
+            seed.y = (sigma_n[4] + seed.finalized[4])/size;
+            seed.t = (sigma_n[5] + seed.finalized[5])/size;
+        }
+    }
+}
+
+void StreamingSLIC::finalize(cv::Mat &labels) {
+    Frame &frame = frames.front();
+    const int width = frame.labels.cols;
+    const int height = frame.labels.rows;
+    
+    // Pixels not reached by any seed take the label of a reached neighbor.
+    for (int y = 0; y < height; y++) {
+        int* labels_row = frame.labels.ptr<int>(y);
+        for (int x = 0; x < width; x++) {
+            if (labels_row[x] < 0) {
+                if (x > 0) {
+                    labels_row[x] = labels_row[x - 1];
+                }
+                else if (y > 0) {
+                    labels_row[x] = frame.labels.at<int>(y - 1, x);
+                }
+            }
+        }
+    }
+    
+    for (int y = height - 1; y >= 0; y--) {
+        int* labels_row = frame.labels.ptr<int>(y);
+        for (int x = width - 1; x >= 0; x--) {
+            if (labels_row[x] < 0) {
+                if (x < width - 1) {
+                    labels_row[x] = labels_row[x + 1];
+                }
+                else if (y < height - 1) {
+                    labels_row[x] = frame.labels.at<int>(y + 1, x);
+                }
+            }
+        }
+    }
+    
+    labels.create(height, width, CV_32SC1);
+    for (int y = 0; y < height; y++) {
+        const cv::Vec3f* lab_row = frame.lab.ptr<cv::Vec3f>(y);
+        const int* frame_labels_row = frame.labels.ptr<int>(y);
+        int* labels_row = labels.ptr<int>(y);
+        
+        for (int x = 0; x < width; x++) {
+            const int n = frame_labels_row[x];
+            if (n < 0) {
+                labels_row[x] = -1;
+                continue;
+            }
+            
+            Seed &seed = seeds[n];
+            seed.finalized[0] += lab_row[x][0];
+            seed.finalized[1] += lab_row[x][1];
+            seed.finalized[2] += lab_row[x][2];
+            seed.finalized[3] += x;
+            seed.finalized[4] += y;
+            seed.finalized[5] += first_frame;
+            seed.finalized_size += 1;
+            
+            labels_row[x] = seed.label;
+        }
+    }
+    
+    frames.pop_front();
+    first_frame++;
+    
+    // Seeds are only searched within temporal_step frames of their center;
+    // the labels in the window are recomputed before the next frame is finalized.
+    std::vector<Seed> active;
+    active.reserve(seeds.size());
+    for (unsigned int n = 0; n < seeds.size(); n++) {
+        if (seeds[n].t + temporal_step > first_frame) {
+            active.push_back(seeds[n]);
+        }
+    }
+    
+    seeds.swap(active);
+}
@@ -0,0 +1,171 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef STREAMING_SLIC_H
+#define	STREAMING_SLIC_H
+
+#include <deque>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Supervoxel SLIC on a stream of frames. In contrast to
+ * SLIC::Do3DSupervoxelSegmentation_ForGivenSupervoxelSize, which clusters
+ * the whole video at once, frames are added one at a time and only a sliding
+ * window of the most recent frames is kept in memory (as Lab images). 
+ * 
+ * Every temporal_step frames, a new layer of seeds is placed on a regular
+ * grid in the current frame. Whenever the window is full, the k-means
+ * iterations are run over all frames in the window and the labels of the
+ * oldest frame are finalized and handed out, i.e. labels are delayed by
+ * window - 1 frames. Supervoxels keep the statistics of their finalized
+ * pixels, such that their centers are computed over their whole extent, and
+ * are retired once they cannot reach the window anymore. Labels are 
+ * consistent over time, i.e. a supervoxel has the same label in all frames.
+ * 
+ * Usage:
+ * \code{cpp}
+ *   StreamingSLIC slic(region_size, temporal_step, window, compactness, 
+ *           iterations, perturb_seeds);
+ *   cv::Mat labels;
+ *   while (capture.read(frame)) {
+ *       if (slic.push(frame, labels)) {
+ *           // labels of frame slic.getFinalizedFrames() - 1 ...
+ *       }
+ *   }
+ *   while (slic.flush(labels)) {
+ *       // labels of frame slic.getFinalizedFrames() - 1 ...
+ *   }
+ * \endcode
+ * \author David Stutz
+ */
+class StreamingSLIC {
+public:
+    /** \brief Constructor.
+     * \param[in] region_size spatial step between seeds in pixels
+     * \param[in] temporal_step temporal step between seed layers in frames
+     * \param[in] window number of frames kept, at least 1; defaults to
+     * 2*temporal_step if <= 0
+     * \param[in] compactness compactness parameter
+     * \param[in] iterations number of iterations per frame added
+     * \param[in] perturb_seeds whether to move seeds to low gradient positions
+     */
+    StreamingSLIC(int region_size, int temporal_step, int window = 0, 
+            double compactness = 40, int iterations = 3, bool perturb_seeds = true);
+    
+    /** \brief Add the next frame; if the window is full, cluster and finalize
+     * the oldest frame in the window.
+     * \param[in] frame color image, CV_8UC3 in BGR, all frames of the same size
+     * \param[out] labels labels of the finalized frame as CV_32SC1, if any
+     * \return whether a frame was finalized
+     */
+    bool push(const cv::Mat &frame, cv::Mat &labels);
+    
+    /** \brief After the last frame, finalize the remaining frames one by one.
+     * \param[out] labels labels of the finalized frame as CV_32SC1, if any
+     * \return whether a frame was finalized, false if all frames are done
+     */
+    bool flush(cv::Mat &labels);
+    
+    /** \brief Get the number of frames added so far.
+     * \return number of frames
+     */
+    int getFrames() const;
+    
+    /** \brief Get the number of frames finalized so far.
+     * \return number of finalized frames
+     */
+    int getFinalizedFrames() const;
+    
+    /** \brief Get the number of supervoxels created so far, labels are in
+     * [0, getSupervoxels()).
+     * \return number of supervoxels
+     */
+    int getSupervoxels() const;
+    
+private:
+    /** \brief Frame within the window. */
+    struct Frame {
+        /** \brief Lab image, CV_32FC3. */
+        cv::Mat lab;
+        /** \brief Index into seeds per pixel, -1 if not reached, CV_32SC1. */
+        cv::Mat labels;
+    };
+    
+    /** \brief Supervoxel center with the statistics of its finalized pixels. */
+    struct Seed {
+        int label;
+        float l, a, b, x, y, t;
+        /** \brief Sums of l, a, b, x, y, t over finalized pixels. */
+        double finalized[6];
+        double finalized_size;
+    };
+    
+    /** \brief Place a layer of seeds on the newest frame. */
+    void placeSeeds();
+    
+    /** \brief Run the k-means iterations over the window. */
+    void iterate();
+    
+    /** \brief Finalize and remove the oldest frame and retire seeds which
+     * cannot reach the remaining frames.
+     * \param[out] labels labels of the oldest frame
+     */
+    void finalize(cv::Mat &labels);
+    
+    /** \brief Spatial step between seeds. */
+    int region_size;
+    /** \brief Temporal step between seed layers. */
+    int temporal_step;
+    /** \brief Maximum number of frames in the window. */
+    int window;
+    /** \brief Weight of the squared spatial distance. */
+    float weight;
+    /** \brief Iterations per frame. */
+    int iterations;
+    /** \brief Whether to perturb seeds. */
+    bool perturb_seeds;
+    
+    /** \brief Frames in the window, oldest first. */
+    std::deque<Frame> frames;
+    /** \brief Index of the oldest frame in the window. */
+    int first_frame;
+    /** \brief Index of the frame where the next seed layer is placed. */
+    int next_layer;
+    /** \brief Active seeds. */
+    std::vector<Seed> seeds;
+    /** \brief Distance to the assigned seed, CV_32FC1, shared by all frames
+     * as the frames are assigned one after another. */
+    cv::Mat distances;
+    /** \brief Number of supervoxels created so far. */
+    int supervoxels;
+};
+
+#endif	/* STREAMING_SLIC_H */
@@ -11,7 +11,11 @@
 #include <math.h>
 #include <float.h>
 #include <deque>
+#ifdef MATLAB_MEX_FILE
 #include "mex.h"
+#else
+#define mexPrintf printf
+#endif
 #include "FMM_Core.h"
 #include "FMM_Heap.h"
 #include "lsm_fast_marching_method.h"
@@ -0,0 +1,969 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <vector>
+#include "lsmlib/lsm_fast_marching_method.h"
+#include "tp_opencv.h"
+
+/** \brief Upsampling and convolution from convolve.c as used by upConv.c.
+ */
+extern "C" int internal_expand(double* image, double* filt, double* temp, 
+        int x_fdim, int y_fdim, int x_start, int x_step, int x_stop, 
+        int y_start, int y_step, int y_stop, double* result, int x_dim, 
+        int y_dim, char* edges);
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSuperpixels
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::computeSuperpixels(const cv::Mat &image, int superpixels, 
+        double time_step, int max_iterations, double sigma_factor, 
+        cv::Mat &boundaries) {
+    
+    CV_Assert(image.type() == CV_8UC3 || image.type() == CV_8UC1);
+    CV_Assert(image.rows > 2 && image.cols > 2 && superpixels > 0);
+    
+    // im2double followed by rgb2gray; the coefficients are those of rgb2gray.
+    cv::Mat gray(image.rows, image.cols, CV_64FC1);
+    for (int i = 0; i < image.rows; i++) {
+        double* gray_row = gray.ptr<double>(i);
+        
+        if (image.channels() == 3) {
+            const cv::Vec3b* image_row = image.ptr<cv::Vec3b>(i);
+            for (int j = 0; j < image.cols; j++) {
+                gray_row[j] = 0.298936021293775*(image_row[j][2]/255.) 
+                        + 0.587043074451121*(image_row[j][1]/255.) 
+                        + 0.114020904255103*(image_row[j][0]/255.);
+            }
+        }
+        else {
+            const unsigned char* image_row = image.ptr<unsigned char>(i);
+            for (int j = 0; j < image.cols; j++) {
+                gray_row[j] = image_row[j]/255.;
+            }
+        }
+    }
+    
+    cv::Mat smooth;
+    cv::transpose(gray, smooth);
+    smoothCurvatureFlow(smooth, 0.1, 10);
+    
+    cv::Mat phi;
+    evolveHeightFunction(smooth, superpixels, time_step, max_iterations, 
+            sigma_factor, phi);
+    
+    cv::Mat dx, dy, dxx, dyy, dxy;
+    heightFunctionDer(255*smooth, dx, dy, dxx, dyy, dxy);
+    
+    cv::Mat speed(smooth.rows, smooth.cols, CV_64FC1);
+    for (int i = 0; i < speed.rows; i++) {
+        for (int j = 0; j < speed.cols; j++) {
+            double mag = std::sqrt(dx.at<double>(i, j)*dx.at<double>(i, j) 
+                    + dy.at<double>(i, j)*dy.at<double>(i, j));
+            speed.at<double>(i, j) = std::exp(-mag/5);
+        }
+    }
+    
+    cv::Mat boundaries_transposed;
+    getSuperpixelBoundaries(phi, speed, boundaries_transposed);
+    
+    boundaries.create(image.rows, image.cols, CV_32SC1);
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            boundaries.at<int>(i, j) = (boundaries_transposed.at<unsigned char>(j, i) > 0 ? 1 : 0);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// evolveHeightFunction
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::evolveHeightFunction(const cv::Mat &smooth, int superpixels,
+        double time_step, int max_iterations, double sigma_factor, cv::Mat &phi) {
+    
+    const double MAX_BAND_SIZE = 5;
+    const int BOUNDARY_SPEED_INTERVAL = 6;
+    const int M = smooth.cols;
+    const int N = smooth.rows;
+    
+    double expected_distance = std::sqrt(M*N/((double) superpixels));
+    double sigma = std::floor(expected_distance/sigma_factor);
+    if (sigma <= 0) {
+        sigma = 1;
+    }
+    
+    cv::Mat speed_grad, speed_grad_x, speed_grad_y;
+    getSpeedBasedOnGradient(smooth, sigma, speed_grad, speed_grad_x, speed_grad_y);
+    
+    cv::Mat seeds;
+    getInitialSeeds(speed_grad, superpixels, seeds);
+    
+    cv::Mat background_init = (seeds == 0);
+    cv::Mat input(N, M, CV_64FC1, cv::Scalar(1));
+    input.setTo(999999, seeds);
+    
+    cv::Mat distance;
+    distanceTransform(input, distance);
+    imfilter(distance, fspecialGaussian(3, 3, 0.5), phi);
+    
+    // Empty band and boundary speed correspond to the scalar initial values
+    // in evolve_height_function_N.m.
+    cv::Mat band, band_ind, boundary_speed;
+    cv::Mat speed_grad_extended, speed_grad_x_extended, speed_grad_y_extended;
+    cv::Mat contour, speed, delta;
+    
+    int old_covered_area = 0;
+    for (int i = 1; i <= max_iterations; i++) {
+        
+        bool recompute_band = band.empty();
+        if (!recompute_band) {
+            zeroCrossing(phi, contour);
+            for (int k = 0; k < N && !recompute_band; k++) {
+                for (int l = 0; l < M; l++) {
+                    if (contour.at<unsigned char>(k, l) > 0 
+                            && band.at<double>(k, l) > MAX_BAND_SIZE - 2) {
+                        recompute_band = true;
+                        break;
+                    }
+                }
+            }
+        }
+        
+        if (recompute_band) {
+            cv::Mat fm_phi(N, M, CV_64FC1);
+            speed_grad_extended.create(N, M, CV_64FC1);
+            speed_grad_x_extended.create(N, M, CV_64FC1);
+            speed_grad_y_extended.create(N, M, CV_64FC1);
+            
+            double* source_fields[3] = {speed_grad.ptr<double>(0), 
+                speed_grad_x.ptr<double>(0), speed_grad_y.ptr<double>(0)};
+            double* extension_fields[3] = {speed_grad_extended.ptr<double>(0), 
+                speed_grad_x_extended.ptr<double>(0), speed_grad_y_extended.ptr<double>(0)};
+            int grid_dims[2] = {M, N};
+            double dX[2] = {1, 1};
+            
+            int error = computeExtensionFields2d_WithMaxVal(fm_phi.ptr<double>(0), 
+                    extension_fields, phi.ptr<double>(0), NULL, source_fields, 
+                    3, 1, grid_dims, dX, MAX_BAND_SIZE);
+            CV_Assert(error == 0);
+            
+            band_ind = cv::Mat::zeros(N, M, CV_8UC1);
+            band = cv::Mat::zeros(N, M, CV_64FC1);
+            for (int k = 0; k < N; k++) {
+                for (int l = 0; l < M; l++) {
+                    if (speed_grad_extended.at<double>(k, l) > 0) {
+                        double fm = fm_phi.at<double>(k, l);
+                        if (std::abs(fm) < MAX_BAND_SIZE - 1) {
+                            band_ind.at<unsigned char>(k, l) = 255;
+                        }
+                        
+                        band.at<double>(k, l) = std::abs(fm);
+                        
+                        // Points stopped by the boundary speed keep their value.
+                        if (boundary_speed.empty() || boundary_speed.at<double>(k, l) != 0) {
+                            phi.at<double>(k, l) = fm;
+                        }
+                    }
+                }
+            }
+        }
+        
+        if (i < 20) {
+            speed = speed_grad_extended;
+        }
+        else {
+            getFullSpeed(phi, speed_grad_extended, speed_grad_x_extended, 
+                    speed_grad_y_extended, 1, speed);
+        }
+        
+        if (i % BOUNDARY_SPEED_INTERVAL == 1) {
+            getSpeedBasedOnBoundaries(phi, background_init, boundary_speed);
+        }
+        
+        heightFunctionGrad(phi, speed.mul(boundary_speed), delta);
+        for (int k = 0; k < N; k++) {
+            for (int l = 0; l < M; l++) {
+                if (band_ind.at<unsigned char>(k, l) > 0) {
+                    phi.at<double>(k, l) -= time_step*delta.at<double>(k, l);
+                }
+            }
+        }
+        
+        replicateBorder(phi);
+        
+        int covered_area = cv::countNonZero(phi < 0);
+        double relative_area_increase = (covered_area - old_covered_area)/((double) M*N);
+        old_covered_area = covered_area;
+        
+        if (relative_area_increase < 1e-4 && covered_area/((double) M*N) > 0.5) {
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// smoothCurvatureFlow
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::smoothCurvatureFlow(cv::Mat &image, double time_step, int iterations) {
+    CV_Assert(image.type() == CV_64FC1);
+    
+    cv::Mat dx, dy, dxx, dyy, dxy;
+    for (int t = 0; t < iterations; t++) {
+        heightFunctionDer(image, dx, dy, dxx, dyy, dxy);
+        
+        for (int i = 0; i < image.rows; i++) {
+            for (int j = 0; j < image.cols; j++) {
+                double dx_ij = dx.at<double>(i, j);
+                double dy_ij = dy.at<double>(i, j);
+                double delta = -(dxx.at<double>(i, j)*dy_ij*dy_ij 
+                        - 2*dx_ij*dy_ij*dxy.at<double>(i, j) 
+                        + dyy.at<double>(i, j)*dx_ij*dx_ij)
+                        /(DBL_EPSILON + dx_ij*dx_ij + dy_ij*dy_ij);
+                
+                image.at<double>(i, j) -= time_step*delta;
+            }
+        }
+        
+        replicateBorder(image);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getSpeedBasedOnGradient
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::getSpeedBasedOnGradient(const cv::Mat &smooth, double sigma, 
+        cv::Mat &speed, cv::Mat &speed_x, cv::Mat &speed_y) {
+    
+    const int M = smooth.cols;
+    const int N = smooth.rows;
+    
+    cv::Mat gx, gy, gxx, gyy, gxy;
+    heightFunctionDer(255*smooth, gx, gy, gxx, gyy, gxy);
+    
+    cv::Mat mag(N, M, CV_64FC1);
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < M; j++) {
+            mag.at<double>(i, j) = std::sqrt(gx.at<double>(i, j)*gx.at<double>(i, j) 
+                    + gy.at<double>(i, j)*gy.at<double>(i, j));
+        }
+    }
+    
+    // corrDn(mag, [1], 'repeat', [2 2]), i.e. every second pixel.
+    cv::Mat subsampled((N + 1)/2, (M + 1)/2, CV_64FC1);
+    for (int i = 0; i < subsampled.rows; i++) {
+        for (int j = 0; j < subsampled.cols; j++) {
+            subsampled.at<double>(i, j) = mag.at<double>(2*i, 2*j);
+        }
+    }
+    
+    int taps = ((int) std::floor(3*sigma + 0.5))*2 + 1;
+    cv::Mat kernel = fspecialGaussian(1, taps, sigma);
+    double max_kernel = 0;
+    cv::minMaxLoc(kernel, 0, &max_kernel);
+    kernel /= max_kernel;
+    
+    cv::Mat smooth_subsampled_tmp, smooth_subsampled;
+    imfilter(subsampled, kernel, smooth_subsampled_tmp);
+    imfilter(smooth_subsampled_tmp, kernel.t(), smooth_subsampled);
+    
+    // upConv with [0.5 1.0 0.5]' and [0.5 1.0 0.5], 'reflect1' and steps
+    // [2 1] and [1 2]; X is the inner index, i.e. the MatLab rows.
+    double filter[3] = {0.5, 1.0, 0.5};
+    double temp[3];
+    char edges[] = "reflect1";
+    
+    int x_dim = smooth_subsampled.cols;
+    int y_dim = smooth_subsampled.rows;
+    cv::Mat upsampled_tmp = cv::Mat::zeros(y_dim, 2*x_dim, CV_64FC1);
+    internal_expand(smooth_subsampled.ptr<double>(0), filter, temp, 3, 1, 
+            0, 2, 2*x_dim, 0, 1, y_dim, upsampled_tmp.ptr<double>(0), 
+            2*x_dim, y_dim, edges);
+    
+    cv::Mat upsampled = cv::Mat::zeros(2*y_dim, 2*x_dim, CV_64FC1);
+    internal_expand(upsampled_tmp.ptr<double>(0), filter, temp, 1, 3, 
+            0, 1, 2*x_dim, 0, 2, 2*y_dim, upsampled.ptr<double>(0), 
+            2*x_dim, 2*y_dim, edges);
+    
+    cv::Mat smooth_mag = upsampled(cv::Rect(0, 0, M, N))/(std::sqrt(2*M_PI)*sigma);
+    
+    speed.create(N, M, CV_64FC1);
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < M; j++) {
+            double normalized = 127*(mag.at<double>(i, j)/(10 + smooth_mag.at<double>(i, j)));
+            speed.at<double>(i, j) = std::exp(-normalized/10);
+        }
+    }
+    
+    cv::Mat speed_xx, speed_yy, speed_xy;
+    heightFunctionDer(speed, speed_x, speed_y, speed_xx, speed_yy, speed_xy);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getSpeedBasedOnBoundaries
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::getSpeedBasedOnBoundaries(const cv::Mat &phi, 
+        const cv::Mat &background_init, cv::Mat &speed) {
+    
+    cv::Mat contour;
+    zeroCrossing(phi, contour);
+    
+    cv::Mat background = ((phi >= 0) | contour) & background_init;
+    cv::Mat mask(phi.rows, phi.cols, CV_64FC1, cv::Scalar(-0.5));
+    mask.setTo(0.5, background);
+    
+    cv::Mat distance;
+    computeDistanceFunction(phi, mask, distance);
+    
+    cv::Mat skeleton;
+    doHomotopicThinning(distance, mask, skeleton);
+    
+    speed = cv::Mat::ones(phi.rows, phi.cols, CV_64FC1);
+    speed.setTo(0, skeleton);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getInitialSeeds
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::getInitialSeeds(const cv::Mat &speed, int superpixels, cv::Mat &seeds) {
+    
+    const int M = speed.cols;
+    const int N = speed.rows;
+    
+    double size_grid = std::floor(0.5 + std::sqrt(M*N/((double) superpixels)));
+    double rows = M/size_grid;
+    double cols = N/size_grid;
+    double size_grid_row = M/std::ceil(rows);
+    double size_grid_col = N/std::ceil(cols);
+    
+    cv::Mat mag = 1 - speed;
+    
+    double min_distance = std::min(size_grid_row, size_grid_col);
+    double max_shift = std::floor((min_distance - 2)/2) - 1;
+    
+    cv::Mat min_rows, min_cols;
+    localMin(mag, (int) std::ceil(max_shift/2), min_rows, min_cols);
+    
+    seeds = cv::Mat::zeros(N, M, CV_8UC1);
+    for (int r = 0; r <= std::ceil(rows - 1); r++) {
+        for (int c = 0; c <= std::ceil(cols - 1); c++) {
+            int y = (int) std::floor(r*size_grid_row + size_grid_row/2 + 0.5);
+            int x = (int) std::floor(c*size_grid_col + size_grid_col/2 + 0.5);
+            
+            int new_y = min_rows.at<int>(x - 1, y - 1);
+            int new_x = min_cols.at<int>(x - 1, y - 1);
+            
+            new_x = std::max(3, std::min(new_x, N - 2));
+            new_y = std::max(3, std::min(new_y, M - 2));
+            
+            seeds.at<unsigned char>(new_x - 1, new_y - 1) = 255;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getSuperpixelBoundaries
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::getSuperpixelBoundaries(const cv::Mat &phi, const cv::Mat &speed,
+        cv::Mat &boundaries) {
+    
+    const double SMALL_AREA_THRESHOLD = 2e-5;
+    
+    cv::Mat contour;
+    zeroCrossing(phi, contour);
+    
+    cv::Mat background_clean = (phi >= 0) | contour;
+    bwmorphClean(background_clean);
+    bwmorphSpur(background_clean);
+    
+    cv::Mat mask(phi.rows, phi.cols, CV_64FC1, cv::Scalar(-0.5));
+    mask.setTo(0.5, background_clean);
+    
+    cv::Mat distance;
+    computeDistanceFunction(phi, mask, distance);
+    
+    cv::Mat skeleton;
+    doHomotopicThinning(distance, mask, skeleton);
+    
+    cv::Mat inside = (background_clean == 0) | (contour == 0);
+    
+    cv::Mat near_background, near_skeleton;
+    cv::dilate(inside == 0, near_background, cv::Mat());
+    cv::dilate(skeleton, near_skeleton, cv::Mat());
+    inside.setTo(0, near_skeleton & near_background);
+    
+    removeSmallComponents(inside, SMALL_AREA_THRESHOLD*phi.rows*phi.cols);
+    
+    cv::Mat outside(phi.rows, phi.cols, CV_64FC1, cv::Scalar(0.5));
+    outside.setTo(-0.5, inside);
+    computeDistanceFunction(outside, cv::Mat(), distance);
+    
+    double max_distance = 0;
+    cv::minMaxLoc(distance, 0, &max_distance);
+    
+    cv::Mat ordering(phi.rows, phi.cols, CV_64FC1);
+    for (int i = 0; i < phi.rows; i++) {
+        for (int j = 0; j < phi.cols; j++) {
+            double s = speed.at<double>(i, j);
+            double s_root = std::pow(s, 0.25);
+            ordering.at<double>(i, j) = (1 - s_root)*(1 - s) 
+                    + s_root*(distance.at<double>(i, j)/max_distance);
+        }
+    }
+    
+    zeroCrossing(distance, contour);
+    cv::Mat background = (distance >= 0) | contour;
+    mask.setTo(-0.5);
+    mask.setTo(0.5, background);
+    
+    doHomotopicThinning(ordering, mask, boundaries);
+    bwmorphClean(boundaries);
+    
+    // Image border: erode with the 4-neighborhood, excluding the center.
+    cv::Mat kernel = (cv::Mat_<unsigned char>(3, 3) << 0, 1, 0, 1, 0, 1, 0, 1, 0);
+    cv::Mat eroded;
+    cv::erode(boundaries, eroded, kernel);
+    
+    eroded.row(0).copyTo(boundaries.row(0));
+    eroded.row(boundaries.rows - 1).copyTo(boundaries.row(boundaries.rows - 1));
+    eroded.col(0).copyTo(boundaries.col(0));
+    eroded.col(boundaries.cols - 1).copyTo(boundaries.col(boundaries.cols - 1));
+    
+    bwmorphClean(boundaries);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// heightFunctionDer
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::heightFunctionDer(const cv::Mat &phi, cv::Mat &dx, cv::Mat &dy, 
+        cv::Mat &dxx, cv::Mat &dyy, cv::Mat &dxy) {
+    
+    CV_Assert(phi.type() == CV_64FC1 && phi.isContinuous());
+    
+    dx = cv::Mat::zeros(phi.rows, phi.cols, CV_64FC1);
+    dy = cv::Mat::zeros(phi.rows, phi.cols, CV_64FC1);
+    dxx = cv::Mat::zeros(phi.rows, phi.cols, CV_64FC1);
+    dyy = cv::Mat::zeros(phi.rows, phi.cols, CV_64FC1);
+    dxy = cv::Mat::zeros(phi.rows, phi.cols, CV_64FC1);
+    
+    for (int i = 1; i < phi.rows - 1; i++) {
+        const double* phi_prev = phi.ptr<double>(i - 1);
+        const double* phi_row = phi.ptr<double>(i);
+        const double* phi_next = phi.ptr<double>(i + 1);
+        
+        double* dx_row = dx.ptr<double>(i);
+        double* dy_row = dy.ptr<double>(i);
+        double* dxx_row = dxx.ptr<double>(i);
+        double* dyy_row = dyy.ptr<double>(i);
+        double* dxy_row = dxy.ptr<double>(i);
+        
+        for (int j = 1; j < phi.cols - 1; j++) {
+            dx_row[j] = (phi_next[j] - phi_prev[j])/2;
+            dy_row[j] = (phi_row[j + 1] - phi_row[j - 1])/2;
+            dxx_row[j] = phi_next[j] - 2*phi_row[j] + phi_prev[j];
+            dyy_row[j] = phi_row[j + 1] - 2*phi_row[j] + phi_row[j - 1];
+            dxy_row[j] = (phi_next[j + 1] + phi_prev[j - 1] 
+                    - phi_prev[j + 1] - phi_next[j - 1])/4;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// heightFunctionGrad
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::heightFunctionGrad(const cv::Mat &phi, const cv::Mat &speed, 
+        cv::Mat &grad) {
+    
+    CV_Assert(phi.type() == CV_64FC1 && speed.type() == CV_64FC1);
+    
+    grad = cv::Mat::zeros(phi.rows, phi.cols, CV_64FC1);
+    for (int i = 1; i < phi.rows - 1; i++) {
+        const double* phi_prev = phi.ptr<double>(i - 1);
+        const double* phi_row = phi.ptr<double>(i);
+        const double* phi_next = phi.ptr<double>(i + 1);
+        const double* speed_row = speed.ptr<double>(i);
+        double* grad_row = grad.ptr<double>(i);
+        
+        for (int j = 1; j < phi.cols - 1; j++) {
+            double dx_plus = phi_row[j + 1] - phi_row[j];
+            double dy_plus = phi_next[j] - phi_row[j];
+            double dx_minus = phi_row[j] - phi_row[j - 1];
+            double dy_minus = phi_row[j] - phi_prev[j];
+            
+            // height_function_grad.c defines min as max and vice versa;
+            // the swapped version is kept to obtain the same evolution.
+            double grad_plus = std::sqrt(
+                    std::min(dx_minus, 0.)*std::min(dx_minus, 0.) 
+                    + std::max(dx_plus, 0.)*std::max(dx_plus, 0.) 
+                    + std::min(dy_minus, 0.)*std::min(dy_minus, 0.) 
+                    + std::max(dy_plus, 0.)*std::max(dy_plus, 0.));
+            double grad_minus = std::sqrt(
+                    std::max(dx_minus, 0.)*std::max(dx_minus, 0.) 
+                    + std::min(dx_plus, 0.)*std::min(dx_plus, 0.) 
+                    + std::max(dy_minus, 0.)*std::max(dy_minus, 0.) 
+                    + std::min(dy_plus, 0.)*std::min(dy_plus, 0.));
+            
+            grad_row[j] = std::min(speed_row[j], 0.)*grad_plus 
+                    + std::max(speed_row[j], 0.)*grad_minus;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// getFullSpeed
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::getFullSpeed(const cv::Mat &phi, const cv::Mat &speed, 
+        const cv::Mat &speed_x, const cv::Mat &speed_y, double doublet_weight,
+        cv::Mat &full_speed) {
+    
+    const double eps = 1e-16;
+    
+    cv::Mat dx, dy, dxx, dyy, dxy;
+    heightFunctionDer(phi, dx, dy, dxx, dyy, dxy);
+    
+    full_speed = cv::Mat::zeros(phi.rows, phi.cols, CV_64FC1);
+    for (int i = 1; i < phi.rows - 1; i++) {
+        for (int j = 1; j < phi.cols - 1; j++) {
+            double dx_ij = dx.at<double>(i, j);
+            double dy_ij = dy.at<double>(i, j);
+            double dx_2 = dx_ij*dx_ij;
+            double dy_2 = dy_ij*dy_ij;
+            double mag = std::sqrt(dx_2 + dy_2);
+            double dx_norm = dx_ij/(mag + eps);
+            double dy_norm = dy_ij/(mag + eps);
+            
+            double curvature = (dxx.at<double>(i, j)*dy_2 
+                    - 2*dx_ij*dy_ij*dxy.at<double>(i, j) 
+                    + dyy.at<double>(i, j)*dx_2)/((dx_2 + dy_2)*mag + eps);
+            curvature = std::max(-1., std::min(curvature, 1.));
+            
+            double doublet = std::max(0., dx_norm*speed_x.at<double>(i, j) 
+                    + dy_norm*speed_y.at<double>(i, j));
+            double s = speed.at<double>(i, j)*(1 - 0.3*curvature) - doublet_weight*doublet;
+            full_speed.at<double>(i, j) = std::max(-1., std::min(1., s));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// zeroCrossing
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::zeroCrossing(const cv::Mat &phi, cv::Mat &contour) {
+    
+    contour = cv::Mat::zeros(phi.rows, phi.cols, CV_8UC1);
+    for (int i = 0; i < phi.rows; i++) {
+        for (int j = 0; j < phi.cols; j++) {
+            double phi_ij = phi.at<double>(i, j);
+            if (phi_ij >= 0) {
+                for (int k = -1; k <= 1; k++) {
+                    for (int l = -1; l <= 1; l++) {
+                        if (i + k >= 0 && i + k < phi.rows 
+                                && j + l >= 0 && j + l < phi.cols 
+                                && phi.at<double>(i + k, j + l) < 0) {
+                            
+                            if (-phi.at<double>(i + k, j + l) < phi_ij) {
+                                contour.at<unsigned char>(i + k, j + l) = 255;
+                            }
+                            else {
+                                contour.at<unsigned char>(i, j) = 255;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// distanceTransform
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::distanceTransform(const cv::Mat &input, cv::Mat &distance) {
+    
+    const double INF = 999999;
+    const double d1 = 1;
+    const double d2 = 1.351;
+    const int rows = input.rows;
+    const int cols = input.cols;
+    
+    // Pixels next to the seeds are the sources, see EdgeDetect in DT.c.
+    distance.create(rows, cols, CV_64FC1);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if (i == 0 || j == 0 || i == rows - 1 || j == cols - 1) {
+                distance.at<double>(i, j) = INF;
+            }
+            else if (input.at<double>(i, j) != INF 
+                    && (input.at<double>(i - 1, j) == INF 
+                        || input.at<double>(i + 1, j) == INF
+                        || input.at<double>(i, j + 1) == INF
+                        || input.at<double>(i, j - 1) == INF)) {
+                distance.at<double>(i, j) = 0;
+            }
+            else {
+                distance.at<double>(i, j) = INF;
+            }
+        }
+    }
+    
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            double minimum = distance.at<double>(i, j);
+            if (i > 0 && j > 0) {
+                minimum = std::min(minimum, distance.at<double>(i - 1, j - 1) + d2);
+            }
+            if (i > 0) {
+                minimum = std::min(minimum, distance.at<double>(i - 1, j) + d1);
+            }
+            if (i > 0 && j < cols - 1) {
+                minimum = std::min(minimum, distance.at<double>(i - 1, j + 1) + d2);
+            }
+            if (j > 0) {
+                minimum = std::min(minimum, distance.at<double>(i, j - 1) + d1);
+            }
+            
+            distance.at<double>(i, j) = std::min(minimum, INF);
+        }
+    }
+    
+    for (int i = rows - 1; i >= 0; i--) {
+        for (int j = cols - 1; j >= 0; j--) {
+            double minimum = distance.at<double>(i, j);
+            if (j < cols - 1) {
+                minimum = std::min(minimum, distance.at<double>(i, j + 1) + d1);
+            }
+            if (i < rows - 1 && j < cols - 1) {
+                minimum = std::min(minimum, distance.at<double>(i + 1, j + 1) + d2);
+            }
+            if (i < rows - 1) {
+                minimum = std::min(minimum, distance.at<double>(i + 1, j) + d1);
+            }
+            if (i < rows - 1 && j > 0) {
+                minimum = std::min(minimum, distance.at<double>(i + 1, j - 1) + d2);
+            }
+            
+            distance.at<double>(i, j) = std::min(minimum, INF);
+        }
+    }
+    
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if (input.at<double>(i, j) == INF) {
+                distance.at<double>(i, j) = -distance.at<double>(i, j);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// localMin
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::localMin(const cv::Mat &image, int size, cv::Mat &rows, cv::Mat &cols) {
+    
+    rows = cv::Mat::zeros(image.rows, image.cols, CV_32SC1);
+    cols = cv::Mat::zeros(image.rows, image.cols, CV_32SC1);
+    
+    for (int j = size; j < image.rows - size; j++) {
+        for (int i = size; i < image.cols - size; i++) {
+            double minimum = INT_MAX;
+            for (int k = -size; k <= size; k++) {
+                for (int l = -size; l <= size; l++) {
+                    if (image.at<double>(j + k, i + l) < minimum) {
+                        minimum = image.at<double>(j + k, i + l);
+                        rows.at<int>(j, i) = i + l + 1;
+                        cols.at<int>(j, i) = j + k + 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeDistanceFunction
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::computeDistanceFunction(const cv::Mat &phi, const cv::Mat &mask, 
+        cv::Mat &distance) {
+    
+    CV_Assert(phi.type() == CV_64FC1 && phi.isContinuous());
+    CV_Assert(mask.empty() || (mask.type() == CV_64FC1 && mask.isContinuous()));
+    
+    distance.create(phi.rows, phi.cols, CV_64FC1);
+    
+    int grid_dims[2] = {phi.cols, phi.rows};
+    double dX[2] = {1, 1};
+    
+    // LSMLIB does not modify phi and mask.
+    int error = computeDistanceFunction2d(distance.ptr<double>(0), 
+            const_cast<double*>(phi.ptr<double>(0)), 
+            mask.empty() ? NULL : const_cast<double*>(mask.ptr<double>(0)), 
+            1, grid_dims, dX);
+    CV_Assert(error == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// doHomotopicThinning
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::doHomotopicThinning(const cv::Mat &phi, const cv::Mat &background, 
+        cv::Mat &skeleton) {
+    
+    CV_Assert(phi.type() == CV_64FC1 && background.type() == CV_64FC1);
+    
+    // The border of phi and background is overwritten by LSMLIB.
+    cv::Mat phi_copy = phi.clone();
+    cv::Mat background_copy = background.clone();
+    cv::Mat thinned(phi.rows, phi.cols, CV_64FC1);
+    
+    int grid_dims[2] = {phi.cols, phi.rows};
+    ::doHomotopicThinning(thinned.ptr<double>(0), phi_copy.ptr<double>(0), 
+            background_copy.ptr<double>(0), grid_dims);
+    
+    skeleton = (thinned >= 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// imfilter
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::imfilter(const cv::Mat &image, const cv::Mat &kernel, cv::Mat &filtered) {
+    
+    CV_Assert(kernel.rows%2 == 1 && kernel.cols%2 == 1);
+    
+    const int center_rows = kernel.rows/2;
+    const int center_cols = kernel.cols/2;
+    
+    filtered = cv::Mat::zeros(image.rows, image.cols, CV_64FC1);
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            double sum = 0;
+            for (int k = 0; k < kernel.rows; k++) {
+                int ii = i + k - center_rows;
+                if (ii < 0 || ii >= image.rows) {
+                    continue;
+                }
+                
+                for (int l = 0; l < kernel.cols; l++) {
+                    int jj = j + l - center_cols;
+                    if (jj >= 0 && jj < image.cols) {
+                        sum += kernel.at<double>(k, l)*image.at<double>(ii, jj);
+                    }
+                }
+            }
+            
+            filtered.at<double>(i, j) = sum;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// fspecialGaussian
+////////////////////////////////////////////////////////////////////////////////
+
+cv::Mat TP_OpenCV::fspecialGaussian(int rows, int cols, double sigma) {
+    
+    cv::Mat kernel(cols, rows, CV_64FC1);
+    double max_value = 0;
+    
+    for (int i = 0; i < cols; i++) {
+        for (int j = 0; j < rows; j++) {
+            double x = i - (cols - 1)/2.;
+            double y = j - (rows - 1)/2.;
+            kernel.at<double>(i, j) = std::exp(-(x*x + y*y)/(2*sigma*sigma));
+            max_value = std::max(max_value, kernel.at<double>(i, j));
+        }
+    }
+    
+    double sum = 0;
+    for (int i = 0; i < cols; i++) {
+        for (int j = 0; j < rows; j++) {
+            if (kernel.at<double>(i, j) < DBL_EPSILON*max_value) {
+                kernel.at<double>(i, j) = 0;
+            }
+            
+            sum += kernel.at<double>(i, j);
+        }
+    }
+    
+    if (sum != 0) {
+        kernel /= sum;
+    }
+    
+    return kernel;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// bwmorphClean
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::bwmorphClean(cv::Mat &image) {
+    
+    cv::Mat cleaned = image.clone();
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            if (image.at<unsigned char>(i, j) == 0) {
+                continue;
+            }
+            
+            bool isolated = true;
+            for (int k = std::max(0, i - 1); k <= std::min(i + 1, image.rows - 1) && isolated; k++) {
+                for (int l = std::max(0, j - 1); l <= std::min(j + 1, image.cols - 1); l++) {
+                    if ((k != i || l != j) && image.at<unsigned char>(k, l) > 0) {
+                        isolated = false;
+                        break;
+                    }
+                }
+            }
+            
+            if (isolated) {
+                cleaned.at<unsigned char>(i, j) = 0;
+            }
+        }
+    }
+    
+    image = cleaned;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// bwmorphSpur
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::bwmorphSpur(cv::Mat &image) {
+    
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        
+        cv::Mat spurred = image.clone();
+        for (int i = 0; i < image.rows; i++) {
+            for (int j = 0; j < image.cols; j++) {
+                if (image.at<unsigned char>(i, j) == 0) {
+                    continue;
+                }
+                
+                int neighbors = 0;
+                for (int k = std::max(0, i - 1); k <= std::min(i + 1, image.rows - 1); k++) {
+                    for (int l = std::max(0, j - 1); l <= std::min(j + 1, image.cols - 1); l++) {
+                        if ((k != i || l != j) && image.at<unsigned char>(k, l) > 0) {
+                            neighbors++;
+                        }
+                    }
+                }
+                
+                if (neighbors == 1) {
+                    spurred.at<unsigned char>(i, j) = 0;
+                    changed = true;
+                }
+            }
+        }
+        
+        image = spurred;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// removeSmallComponents
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::removeSmallComponents(cv::Mat &image, double min_area) {
+    
+    cv::Mat visited = cv::Mat::zeros(image.rows, image.cols, CV_8UC1);
+    std::vector<cv::Point> component;
+    std::vector<cv::Point> stack;
+    
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols; j++) {
+            if (image.at<unsigned char>(i, j) == 0 || visited.at<unsigned char>(i, j) > 0) {
+                continue;
+            }
+            
+            component.clear();
+            stack.push_back(cv::Point(j, i));
+            visited.at<unsigned char>(i, j) = 1;
+            
+            while (!stack.empty()) {
+                cv::Point p = stack.back();
+                stack.pop_back();
+                component.push_back(p);
+                
+                const int dx[4] = {1, -1, 0, 0};
+                const int dy[4] = {0, 0, 1, -1};
+                for (int n = 0; n < 4; n++) {
+                    int x = p.x + dx[n];
+                    int y = p.y + dy[n];
+                    
+                    if (x >= 0 && x < image.cols && y >= 0 && y < image.rows
+                            && image.at<unsigned char>(y, x) > 0
+                            && visited.at<unsigned char>(y, x) == 0) {
+                        visited.at<unsigned char>(y, x) = 1;
+                        stack.push_back(cv::Point(x, y));
+                    }
+                }
+            }
+            
+            if (component.size() < min_area) {
+                for (unsigned int k = 0; k < component.size(); k++) {
+                    image.at<unsigned char>(component[k].y, component[k].x) = 0;
+                }
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// replicateBorder
+////////////////////////////////////////////////////////////////////////////////
+
+void TP_OpenCV::replicateBorder(cv::Mat &image) {
+    
+    for (int i = 1; i < image.rows - 1; i++) {
+        image.at<double>(i, 0) = image.at<double>(i, 1);
+        image.at<double>(i, image.cols - 1) = image.at<double>(i, image.cols - 2);
+    }
+    
+    image.row(1).copyTo(image.row(0));
+    image.row(image.rows - 2).copyTo(image.row(image.rows - 1));
+}
@@ -0,0 +1,241 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TP_OPENCV_H
+#define	TP_OPENCV_H
+
+#include <opencv2/opencv.hpp>
+
+/** \brief Native implementation of TurboPixels (TP) following superpixels.m and
+ * evolve_height_function_N.m, so TP can be run without MatLab.
+ * 
+ * The level set evolution, including the curvature and doublet terms, the
+ * boundary speed and the narrow band, is ported from the MatLab code; the
+ * fast marching, extension fields and homotopic thinning are computed by the
+ * LSMLIB sources in lib_tp/lsmlib and the upsampling by upConv's convolve.c.
+ * The mex helpers (DT.c, height_function_der.c, height_function_grad.c,
+ * get_full_speed.c, local_min.c and zero_crossing.c) are ported as private
+ * methods.
+ * 
+ * All intermediate matrices are stored transposed, i.e. row j of a cv::Mat
+ * holds column j of the corresponding MatLab array, so that the memory layout
+ * is MatLab's column-major layout and the ported loops as well as LSMLIB
+ * visit the pixels in the same order as in MatLab.
+ * \author David Stutz
+ */
+class TP_OpenCV {
+public:
+    /** \brief Compute superpixels using TP, see superpixels.m.
+     * \param[in] image image to compute superpixels on
+     * \param[in] superpixels number of superpixels
+     * \param[in] time_step time step of the evolution
+     * \param[in] max_iterations maximum number of iterations
+     * \param[in] sigma_factor determines the sigma used to normalize the
+     *  gradient magnitude
+     * \param[out] boundaries superpixel boundaries of type CV_32SC1, 1 for
+     *  boundary pixels and 0 otherwise
+     */
+    static void computeSuperpixels(const cv::Mat &image, int superpixels, 
+            double time_step, int max_iterations, double sigma_factor, 
+            cv::Mat &boundaries);
+    
+private:
+    
+    /** \brief Evolve the height function from the initial seeds, see the
+     * 'superpixels' case of evolve_height_function_N.m.
+     * \param[in] smooth smoothed gray image
+     * \param[in] superpixels number of superpixels
+     * \param[in] time_step time step
+     * \param[in] max_iterations maximum number of iterations
+     * \param[in] sigma_factor determines the sigma used to normalize the gradient
+     * \param[out] phi evolved height function
+     */
+    static void evolveHeightFunction(const cv::Mat &smooth, int superpixels,
+            double time_step, int max_iterations, double sigma_factor, cv::Mat &phi);
+    
+    /** \brief Smooth by curvature flow, see the 'curvature' case of 
+     * evolve_height_function_N.m and height_function_change_rate.m.
+     * \param[in,out] image image to smooth
+     * \param[in] time_step time step
+     * \param[in] iterations number of iterations
+     */
+    static void smoothCurvatureFlow(cv::Mat &image, double time_step, int iterations);
+    
+    /** \brief Speed based on the normalized gradient magnitude, see 
+     * get_speed_based_on_gradient.m.
+     * \param[in] smooth smoothed gray image
+     * \param[in] sigma sigma used for normalization
+     * \param[out] speed speed
+     * \param[out] speed_x derivative of the speed in x
+     * \param[out] speed_y derivative of the speed in y
+     */
+    static void getSpeedBasedOnGradient(const cv::Mat &smooth, double sigma, 
+            cv::Mat &speed, cv::Mat &speed_x, cv::Mat &speed_y);
+    
+    /** \brief Speed which stops the evolution at the skeleton of the 
+     * background, see get_speed_based_on_boundaries.m.
+     * \param[in] phi height function
+     * \param[in] background_init background of the initial seeds, type CV_8UC1
+     * \param[out] speed speed, 0 on the skeleton and 1 otherwise
+     */
+    static void getSpeedBasedOnBoundaries(const cv::Mat &phi, 
+            const cv::Mat &background_init, cv::Mat &speed);
+    
+    /** \brief Seeds on a regular grid moved to local minima of 1 - speed, see
+     * get_initial_seeds.m and get_binary_img_from_seeds.m.
+     * \param[in] speed speed
+     * \param[in] superpixels number of superpixels
+     * \param[out] seeds 1 at seeds and 0 otherwise, type CV_8UC1
+     */
+    static void getInitialSeeds(const cv::Mat &speed, int superpixels, cv::Mat &seeds);
+    
+    /** \brief Thinned superpixel boundaries, see get_superpixel_boundaries.m.
+     * \param[in] phi evolved height function
+     * \param[in] speed speed used to order the thinning
+     * \param[out] boundaries boundaries, type CV_8UC1
+     */
+    static void getSuperpixelBoundaries(const cv::Mat &phi, const cv::Mat &speed,
+            cv::Mat &boundaries);
+    
+    /** \brief Central differences in the interior, 0 at the border, see
+     * height_function_der.c.
+     * \param[in] phi height function
+     * \param[out] dx first derivative in x
+     * \param[out] dy first derivative in y
+     * \param[out] dxx second derivative in x
+     * \param[out] dyy second derivative in y
+     * \param[out] dxy mixed derivative
+     */
+    static void heightFunctionDer(const cv::Mat &phi, cv::Mat &dx, cv::Mat &dy, 
+            cv::Mat &dxx, cv::Mat &dyy, cv::Mat &dxy);
+    
+    /** \brief Upwind approximation of speed times the gradient magnitude, see
+     * height_function_grad.c.
+     * \param[in] phi height function
+     * \param[in] speed speed
+     * \param[out] grad result
+     */
+    static void heightFunctionGrad(const cv::Mat &phi, const cv::Mat &speed, 
+            cv::Mat &grad);
+    
+    /** \brief Speed including curvature and doublet terms, see get_full_speed.c.
+     * \param[in] phi height function
+     * \param[in] speed gradient based speed
+     * \param[in] speed_x derivative of the speed in x
+     * \param[in] speed_y derivative of the speed in y
+     * \param[in] doublet_weight weight of the doublet term
+     * \param[out] full_speed result
+     */
+    static void getFullSpeed(const cv::Mat &phi, const cv::Mat &speed, 
+            const cv::Mat &speed_x, const cv::Mat &speed_y, double doublet_weight,
+            cv::Mat &full_speed);
+    
+    /** \brief Pixels next to the zero level set, see zero_crossing.c.
+     * \param[in] phi height function
+     * \param[out] contour contour, type CV_8UC1
+     */
+    static void zeroCrossing(const cv::Mat &phi, cv::Mat &contour);
+    
+    /** \brief Signed chamfer distance transform, see DT.c.
+     * \param[in] input 999999 inside the seeds
+     * \param[out] distance signed distance
+     */
+    static void distanceTransform(const cv::Mat &input, cv::Mat &distance);
+    
+    /** \brief Position of the minimum within a window around each pixel, see
+     * local_min.c; the positions are 1-based as in MatLab and 0 within size
+     * pixels of the border.
+     * \param[in] image image
+     * \param[in] size half window size
+     * \param[out] rows row of the minimum, type CV_32SC1
+     * \param[out] cols column of the minimum, type CV_32SC1
+     */
+    static void localMin(const cv::Mat &image, int size, cv::Mat &rows, cv::Mat &cols);
+    
+    /** \brief Distance function using LSMLIB, see computeDistanceFunction2d.m.
+     * \param[in] phi level set function
+     * \param[in] mask points with negative mask are outside the domain,
+     *  may be empty
+     * \param[out] distance distance function
+     */
+    static void computeDistanceFunction(const cv::Mat &phi, const cv::Mat &mask, 
+            cv::Mat &distance);
+    
+    /** \brief Homotopic thinning using LSMLIB, see doHomotopicThinning.c.
+     * \param[in] phi distance used to order the thinning
+     * \param[in] background positive for points that may be thinned
+     * \param[out] skeleton skeleton, type CV_8UC1
+     */
+    static void doHomotopicThinning(const cv::Mat &phi, const cv::Mat &background, 
+            cv::Mat &skeleton);
+    
+    /** \brief Correlation with zero padding and output of the same size, as
+     * MatLab's imfilter.
+     * \param[in] image image
+     * \param[in] kernel kernel with odd size
+     * \param[out] filtered result
+     */
+    static void imfilter(const cv::Mat &image, const cv::Mat &kernel, cv::Mat &filtered);
+    
+    /** \brief Gaussian kernel, as MatLab's fspecial('gaussian', ...).
+     * \param[in] rows number of rows of the MatLab kernel
+     * \param[in] cols number of columns of the MatLab kernel
+     * \param[in] sigma standard deviation
+     * \return kernel, stored transposed
+     */
+    static cv::Mat fspecialGaussian(int rows, int cols, double sigma);
+    
+    /** \brief Remove isolated pixels, as bwmorph(..., 'clean').
+     * \param[in,out] image binary image of type CV_8UC1
+     */
+    static void bwmorphClean(cv::Mat &image);
+    
+    /** \brief Repeatedly remove end points, as bwmorph(..., 'spur', Inf).
+     * \param[in,out] image binary image of type CV_8UC1
+     */
+    static void bwmorphSpur(cv::Mat &image);
+    
+    /** \brief Remove 4-connected components smaller than the given area, as
+     * done using bwlabel and regionprops in get_superpixel_boundaries.m.
+     * \param[in,out] image binary image of type CV_8UC1
+     * \param[in] min_area minimum area
+     */
+    static void removeSmallComponents(cv::Mat &image, double min_area);
+    
+    /** \brief Replace the border by the adjacent interior pixels, as
+     * padarray(phi(2:end-1,2:end-1), [1,1], 'replicate').
+     * \param[in,out] image image
+     */
+    static void replicateBorder(cv::Mat &image);
+    
+};
+
+#endif	/* TP_OPENCV_H */
@@ -0,0 +1,292 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include "tps_opencv.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSuperpixelsFromEdges
+////////////////////////////////////////////////////////////////////////////////
+
+void TPS_OpenCV::computeSuperpixelsFromEdges(const cv::Mat &edges, int region_height, 
+        int region_width, double gamma, double sigma, cv::Mat &labels) {
+    
+    CV_Assert(edges.type() == CV_32FC1);
+    
+    const int rows = edges.rows;
+    const int cols = edges.cols;
+    
+    const int grid_rows = std::max(1, (int) std::ceil(rows/((double) region_height)));
+    const int grid_cols = std::max(1, (int) std::ceil(cols/((double) region_width)));
+    
+    const double cell_height = rows/((double) grid_rows);
+    const double cell_width = cols/((double) grid_cols);
+    const int r = std::max(1, (int) std::floor(gamma*std::min(std::floor(cell_width + 0.5), 
+            std::floor(cell_height + 0.5)) - 1 + 0.5));
+    const double alpha = r/2.;
+    const double deta = std::max(sigma*r, 1e-6);
+    
+    // Edge map value with zero padding, + 0.01 as in Refined_seed.m.
+    #define TPS_EDGE(i, j) ((i) >= 0 && (i) < rows && (j) >= 0 && (j) < cols \
+            ? edges.at<float>((i), (j)) : 0.f)
+    
+    // Grid seeds, seeds(i, j) for i = 0..grid_rows, j = 0..grid_cols.
+    std::vector< std::vector<cv::Point> > seeds(grid_rows + 1, 
+            std::vector<cv::Point>(grid_cols + 1));
+    for (int i = 0; i <= grid_rows; i++) {
+        for (int j = 0; j <= grid_cols; j++) {
+            seeds[i][j].y = std::min(rows - 1, (int) std::floor(cell_height*i + 0.5));
+            seeds[i][j].x = std::min(cols - 1, (int) std::floor(cell_width*j + 0.5));
+        }
+    }
+    
+    std::vector< std::vector<cv::Point> > refined = seeds;
+    
+    // Relocate inner seeds to the strongest edge, weighted by a Gaussian.
+    for (int i = 1; i < grid_rows; i++) {
+        for (int j = 1; j < grid_cols; j++) {
+            const cv::Point &seed = seeds[i][j];
+            double max_value = -1;
+            
+            for (int l = 1 - r; l <= r; l++) {
+                for (int k = 1 - r; k <= r; k++) {
+                    double g = std::exp(-(k*k + l*l)/(2*deta*deta));
+                    double value = (TPS_EDGE(seed.y + k, seed.x + l) + 0.01)*g;
+                    
+                    if (value > max_value) {
+                        max_value = value;
+                        refined[i][j] = cv::Point(std::max(0, std::min(cols - 1, seed.x + l)), 
+                                std::max(0, std::min(rows - 1, seed.y + k)));
+                    }
+                }
+            }
+        }
+    }
+    
+    // Relocate seeds on the image border along the border.
+    std::vector<double> gauss(2*r);
+    for (int t = 1 - r; t <= r; t++) {
+        gauss[t + r - 1] = std::exp(-t*t/(deta*deta));
+    }
+    
+    for (int i = 1; i < grid_rows; i++) {
+        for (int side = 0; side < 2; side++) {
+            int j = (side == 0 ? 0 : grid_cols);
+            int column = (side == 0 ? std::min(cols - 1, 2) : std::max(0, cols - 3));
+            const cv::Point &seed = seeds[i][j];
+            
+            double max_value = -1;
+            for (int t = 1 - r; t <= r; t++) {
+                double value = (TPS_EDGE(seed.y + t, column) + 0.1)*gauss[t + r - 1];
+                if (value > max_value) {
+                    max_value = value;
+                    refined[i][j].y = std::max(0, std::min(rows - 1, seed.y + t));
+                }
+            }
+        }
+    }
+    
+    for (int j = 1; j < grid_cols; j++) {
+        for (int side = 0; side < 2; side++) {
+            int i = (side == 0 ? 0 : grid_rows);
+            int row = (side == 0 ? std::min(rows - 1, 2) : std::max(0, rows - 3));
+            const cv::Point &seed = seeds[i][j];
+            
+            double max_value = -1;
+            for (int t = 1 - r; t <= r; t++) {
+                double value = (TPS_EDGE(row, seed.x + t) + 0.1)*gauss[t + r - 1];
+                if (value > max_value) {
+                    max_value = value;
+                    refined[i][j].x = std::max(0, std::min(cols - 1, seed.x + t));
+                }
+            }
+        }
+    }
+    
+    #undef TPS_EDGE
+    
+    // Vertical boundaries connect seeds(i, j) and seeds(i + 1, j), horizontal
+    // boundaries connect seeds(i, j) and seeds(i, j + 1); each boundary pixel
+    // remembers the first boundary passing through it.
+    cv::Mat vertical(rows, cols, CV_32SC1, cv::Scalar(0));
+    cv::Mat horizontal(rows, cols, CV_32SC1, cv::Scalar(0));
+    std::vector<cv::Point> path;
+    
+    for (int i = 0; i < grid_rows; i++) {
+        for (int j = 1; j < grid_cols; j++) {
+            const cv::Point &a = refined[i][j];
+            const cv::Point &b = refined[i + 1][j];
+            
+            int top = std::max(0.0, std::floor(a.y - alpha + 0.5));
+            int bottom = std::min(rows - 1.0, std::floor(b.y + alpha + 0.5));
+            int left = std::max(0.0, std::floor(std::min(a.x, b.x) - alpha + 0.5));
+            int right = std::min(cols - 1.0, std::floor(std::max(a.x, b.x) + alpha + 0.5));
+            
+            top = std::min(top, std::min(a.y, b.y));
+            bottom = std::max(bottom, std::max(a.y, b.y));
+            
+            computePath(edges, cv::Rect(left, top, right - left + 1, bottom - top + 1), 
+                    a, b, path);
+            for (unsigned int p = 0; p < path.size(); p++) {
+                if (vertical.at<int>(path[p].y, path[p].x) == 0) {
+                    vertical.at<int>(path[p].y, path[p].x) = j;
+                }
+            }
+        }
+    }
+    
+    for (int i = 1; i < grid_rows; i++) {
+        for (int j = 0; j < grid_cols; j++) {
+            const cv::Point &a = refined[i][j];
+            const cv::Point &b = refined[i][j + 1];
+            
+            int top = std::max(0.0, std::floor(std::min(a.y, b.y) - alpha + 0.5));
+            int bottom = std::min(rows - 1.0, std::floor(std::max(a.y, b.y) + alpha + 0.5));
+            int left = std::max(0.0, std::floor(a.x - alpha + 0.5));
+            int right = std::min(cols - 1.0, std::floor(b.x + alpha + 0.5));
+            
+            left = std::min(left, std::min(a.x, b.x));
+            right = std::max(right, std::max(a.x, b.x));
+            
+            computePath(edges, cv::Rect(left, top, right - left + 1, bottom - top + 1), 
+                    a, b, path);
+            for (unsigned int p = 0; p < path.size(); p++) {
+                if (horizontal.at<int>(path[p].y, path[p].x) == 0) {
+                    horizontal.at<int>(path[p].y, path[p].x) = i;
+                }
+            }
+        }
+    }
+    
+    // The column of a pixel is given by the first vertical boundary to its
+    // right, the row by the first horizontal boundary below, as in
+    // Get_region_label.m.
+    for (int i = 0; i < rows; i++) {
+        vertical.at<int>(i, cols - 1) = grid_cols;
+    }
+    for (int j = 0; j < cols; j++) {
+        horizontal.at<int>(rows - 1, j) = grid_rows;
+    }
+    
+    const int none = std::numeric_limits<int>::max();
+    labels.create(rows, cols, CV_32SC1);
+    
+    for (int i = 0; i < rows; i++) {
+        int column = none;
+        for (int j = cols - 1; j >= 0; j--) {
+            int boundary = vertical.at<int>(i, j);
+            if (boundary > 0) {
+                column = std::min(column, boundary);
+            }
+            labels.at<int>(i, j) = column - 1;
+        }
+    }
+    
+    for (int j = 0; j < cols; j++) {
+        int row = none;
+        for (int i = rows - 1; i >= 0; i--) {
+            int boundary = horizontal.at<int>(i, j);
+            if (boundary > 0) {
+                row = std::min(row, boundary);
+            }
+            labels.at<int>(i, j) += (row - 1)*grid_cols;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computePath
+////////////////////////////////////////////////////////////////////////////////
+
+void TPS_OpenCV::computePath(const cv::Mat &edges, const cv::Rect &window, 
+        const cv::Point &start, const cv::Point &end, std::vector<cv::Point> &path) {
+    
+    const int width = window.width;
+    const int N = window.width*window.height;
+    const int source = (start.y - window.y)*width + start.x - window.x;
+    const int target = (end.y - window.y)*width + end.x - window.x;
+    
+    std::vector<double> distances(N, std::numeric_limits<double>::max());
+    std::vector<int> previous(N, -1);
+    
+    typedef std::pair<double, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > heap;
+    
+    distances[source] = 0;
+    heap.push(Entry(0, source));
+    
+    while (!heap.empty()) {
+        Entry entry = heap.top();
+        heap.pop();
+        
+        int p = entry.second;
+        if (entry.first > distances[p]) {
+            continue;
+        }
+        
+        if (p == target) {
+            break;
+        }
+        
+        int i = p/width;
+        int j = p%width;
+        float edge = edges.at<float>(window.y + i, window.x + j);
+        
+        const int di[4] = {-1, 0, 0, 1};
+        const int dj[4] = {0, -1, 1, 0};
+        for (int n = 0; n < 4; n++) {
+            int ii = i + di[n];
+            int jj = j + dj[n];
+            if (ii < 0 || ii >= window.height || jj < 0 || jj >= width) {
+                continue;
+            }
+            
+            int q = ii*width + jj;
+            double distance = entry.first 
+                    + 1/(edge + edges.at<float>(window.y + ii, window.x + jj) + 1);
+            
+            if (distance < distances[q]) {
+                distances[q] = distance;
+                previous[q] = p;
+                heap.push(Entry(distance, q));
+            }
+        }
+    }
+    
+    path.clear();
+    for (int p = target; p >= 0; p = previous[p]) {
+        path.push_back(cv::Point(window.x + p%width, window.y + p/width));
+    }
+}
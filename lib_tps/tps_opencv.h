@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TPS_OPENCV_H
+#define	TPS_OPENCV_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Native implementation of TPS following Get_Regular_SP_alt.m, so TPS
+ * can be run without MatLab.
+ * 
+ * Seeds on a regular grid are relocated to strong edges, and neighboring seeds
+ * are connected by shortest paths on the edge map; the paths form the
+ * superpixel boundaries. As in the MatLab implementation, the edge map is
+ * expected to be computed using structured forest edges (edgesDetect from
+ * lib_sfedges), which are not available in C++.
+ * \author David Stutz
+ */
+class TPS_OpenCV {
+public:
+    /** \brief Compute superpixels using TPS on the given edge map.
+     * \param[in] edges edge map of type CV_32FC1 in [0,1]
+     * \param[in] region_height height of superpixels
+     * \param[in] region_width width of superpixels
+     * \param[in] gamma relative size of the seed relocation window
+     * \param[in] sigma relative standard deviation of the relocation weighting
+     * \param[out] labels superpixel labels
+     */
+    static void computeSuperpixelsFromEdges(const cv::Mat &edges, int region_height, 
+            int region_width, double gamma, double sigma, cv::Mat &labels);
+    
+private:
+    
+    /** \brief Shortest path between two pixels within a window of the edge
+     * map using Dijkstra; the weight between 4-neighbors a and b is
+     * 1/(e(a) + e(b) + 1).
+     * \param[in] edges edge map
+     * \param[in] window window to search within, containing both pixels
+     * \param[in] start first pixel
+     * \param[in] end second pixel
+     * \param[out] path pixels on the path
+     */
+    static void computePath(const cv::Mat &edges, const cv::Rect &window, 
+            const cv::Point &start, const cv::Point &end, std::vector<cv::Point> &path);
+    
+};
+
+#endif	/* TPS_OPENCV_H */
+
@@ -35,6 +35,7 @@
 #include<iostream>
 #include<fstream>
 #include<sstream>
+#include<vector>
 
 #define MAX_RADIUS 9 // 3; the radius of neighborhood when calculating the length energy
 #define MAX_NUM_NEI_CLUSTER 400 // 200; the number of neighbor clusters
@@ -71,6 +72,13 @@ struct centroid {
     double color[3];
 };
 
+struct cvtStatistics {
+    int classicPasses; // number of passes of the classic CVT
+    int classicTransfers; // number of pixels transferred to another cluster by the classic CVT
+    int EWPasses; // number of passes of the EWCVT
+    int EWTransfers; // number of pixels transferred to another cluster by the EWCVT
+};
+
 class VCells {
 public:
 //    int CIELab = 1; // if "1", make use of the Lab color metric; otherwise, use RGB color space 
@@ -81,6 +89,8 @@ public:
     int NUM_NEI_CLUSTER;
     int NUM_DIRECT_NEI;
     int THRESHOLD;
+    bool RESTRICTED; // if true, a pass only revisits the pixels whose neighborhood changed, see restrictedCVT
+    struct cvtStatistics statistics; // number of passes and transfers of the last classicCVT and EWCVT
     
 //    unsigned char *pBmpBuf; // pointer to the readin bmp file
     int bmpWidth; // the width of the image (count in pixel)
@@ -91,26 +101,33 @@ public:
     
     VCells() : 
             NUM_CLUSTER(400), WEIGHT_LENGTH(5.0), RADIUS(3), 
-            NUM_NEI_CLUSTER(200), NUM_DIRECT_NEI(4), THRESHOLD(10) {
-        
+            NUM_NEI_CLUSTER(200), NUM_DIRECT_NEI(4), THRESHOLD(10), RESTRICTED(false) {
+        resetStatistics();
     }
     
     VCells(int num_cluster, double weight_length) : 
             NUM_CLUSTER(num_cluster), WEIGHT_LENGTH(weight_length), RADIUS(3), 
-            NUM_NEI_CLUSTER(200), NUM_DIRECT_NEI(4), THRESHOLD(10) {
-        
+            NUM_NEI_CLUSTER(200), NUM_DIRECT_NEI(4), THRESHOLD(10), RESTRICTED(false) {
+        resetStatistics();
     }
     
     VCells(int num_cluster, double weight_length, int radius, int num_nei_cluster, int num_direct_nei, int threshold) : 
             NUM_CLUSTER(num_cluster), WEIGHT_LENGTH(weight_length), RADIUS(radius), 
-            NUM_NEI_CLUSTER(num_nei_cluster), NUM_DIRECT_NEI(num_direct_nei), THRESHOLD(threshold) {
-        
+            NUM_NEI_CLUSTER(num_nei_cluster), NUM_DIRECT_NEI(num_direct_nei), THRESHOLD(threshold), RESTRICTED(false) {
+        resetStatistics();
     }
     
     ~VCells() {
         
     }
     
+    void resetStatistics(){
+            statistics.classicPasses = 0;
+            statistics.classicTransfers = 0;
+            statistics.EWPasses = 0;
+            statistics.EWTransfers = 0;
+    }
+    
     /************************************************************************
     *Name of the function:  
     *						int getIndexFromRC(int row, int column)
@@ -722,6 +739,12 @@ public:
 
             VoronoiRegion(generators,pixelArray);
             searchNei(pixelArray);
+            if(RESTRICTED){
+                    restrictedCVT(pixelArray, generators, false, &statistics.classicPasses, &statistics.classicTransfers);
+                    return true;
+            }
+            statistics.classicPasses = 0;
+            statistics.classicTransfers = 0;
             int i = 0;
             int numTransfer = bmpHeight * bmpWidth;
             int newNearestGenerator;
@@ -742,6 +765,8 @@ public:
                             }
                     }
                     step++;
+                    statistics.classicPasses++;
+                    statistics.classicTransfers += numTransfer;
                     //printf("step %d    %d\n", step, numTransfer);
             }
 
@@ -823,6 +848,12 @@ public:
     bool EWCVT(struct centroid* generators, struct pixel* pixelArray){
 
             //printf("generating the EWCVT......\n");
+            if(RESTRICTED){
+                    restrictedCVT(pixelArray, generators, true, &statistics.EWPasses, &statistics.EWTransfers);
+                    return true;
+            }
+            statistics.EWPasses = 0;
+            statistics.EWTransfers = 0;
             int i = 0;
             int numTransfer = bmpHeight * bmpWidth;
             int newNearestGenerator;
@@ -843,12 +874,192 @@ public:
                             }
                     }
                     step++;
+                    statistics.EWPasses++;
+                    statistics.EWTransfers += numTransfer;
                     //printf("step %d    %d\n", step, numTransfer);
 
             }
 
             return true;
     }
+
+    /************************************************************************
+    *Name of the function:  
+    *				void restrictedCVT(struct pixel* pixelArray, struct centroid* generators,
+    *				                   bool EW, int* numPasses, int* numTransfers)
+    *Parameter of the function:
+    *				pixelArray --- the array of pixels
+    *				generators --- the array of generators
+    *				EW --- 1 for the EWCVT distance, 0 for the classic CVT distance
+    *				numPasses --- the number of passes
+    *				numTransfers --- the total number of transferred pixels
+    *Return Value: 
+    *				none
+    *Comment: 
+    *		the passes of classicCVT and EWCVT restricted to the pixels whose
+    *		neighborhood changed: the first pass visits all pixels, later passes
+    *		only the pixels inside the neighborhood of a pixel transferred in the
+    *		previous pass (or before in the same pass). Positions and colors of
+    *		pixels and generators are copied into separate arrays, the generators
+    *		are written back at the end. The EW distances are compared squared.
+    ************************************************************************/
+    void restrictedCVT(struct pixel* pixelArray, struct centroid* generators, bool EW, int* numPasses, int* numTransfers){
+            int numPixel = bmpWidth * bmpHeight;
+            int i, j, k;
+
+            std::vector<double> pixelRow(numPixel), pixelColumn(numPixel);
+            std::vector<double> pixelColor[3];
+            for(k = 0; k < 3; k++){
+                    pixelColor[k].resize(numPixel);
+            }
+            for(i = 0; i < numPixel; i++){
+                    pixelRow[i] = pixelArray[i].row;
+                    pixelColumn[i] = pixelArray[i].column;
+                    for(k = 0; k < 3; k++){
+                            pixelColor[k][i] = pixelArray[i].color[k];
+                    }
+            }
+
+            std::vector<double> generatorRow(NUM_CLUSTER), generatorColumn(NUM_CLUSTER);
+            std::vector<double> generatorColor[3];
+            std::vector<int> generatorNumPixels(NUM_CLUSTER);
+            for(k = 0; k < 3; k++){
+                    generatorColor[k].resize(NUM_CLUSTER);
+            }
+            for(j = 0; j < NUM_CLUSTER; j++){
+                    generatorRow[j] = generators[j].row;
+                    generatorColumn[j] = generators[j].column;
+                    generatorNumPixels[j] = generators[j].numPixels;
+                    for(k = 0; k < 3; k++){
+                            generatorColor[k][j] = generators[j].color[k];
+                    }
+            }
+
+            std::vector<char> visit(numPixel, 1);
+            std::vector<char> visitNext(numPixel, 0);
+
+            int numTransfer = numPixel;
+            *numPasses = 0;
+            *numTransfers = 0;
+            while(numTransfer >= THRESHOLD){
+                    numTransfer = 0;
+                    for(i = 0; i < numPixel; i++){
+                            if(!visit[i]){
+                                    continue;
+                            }
+                            visit[i] = 0;
+
+                            struct pixel* currentPixel = &pixelArray[i];
+                            if(!isBoundaryPixel(currentPixel, pixelArray)){
+                                    continue;
+                            }
+
+                            int oldNearestGenerator = currentPixel->indexCluster;
+                            int newNearestGenerator = oldNearestGenerator;
+                            if(EW){
+                                    // as getShortestEWDist, without the square root
+                                    double shortestEWDist = 0;
+                                    for(j = 0; j < currentPixel->numNeiCluster; j++){
+                                            if(currentPixel->indexNeiClusters[j] == oldNearestGenerator){
+                                                    break;
+                                            }
+                                    }
+                                    for(k = 0; k < 3; k++){
+                                            shortestEWDist += (generatorColor[k][oldNearestGenerator] - pixelColor[k][i])*(generatorColor[k][oldNearestGenerator] - pixelColor[k][i]);
+                                    }
+                                    shortestEWDist += 2 * WEIGHT_LENGTH * (currentPixel->numNeiPixels - currentPixel->numNeiPixelEachCluster[j]);
+
+                                    for(j = 0; j < currentPixel->numNeiCluster; j++){
+                                            int indexNeiCluster = currentPixel->indexNeiClusters[j];
+                                            if(currentPixel->numNeiPixelEachCluster[j]!=0 && indexNeiCluster!=oldNearestGenerator){
+                                                    double EWDist = 0;
+                                                    for(k = 0; k < 3; k++){
+                                                            EWDist += (generatorColor[k][indexNeiCluster] - pixelColor[k][i])*(generatorColor[k][indexNeiCluster] - pixelColor[k][i]);
+                                                    }
+                                                    EWDist += 2 * WEIGHT_LENGTH * (currentPixel->numNeiPixels - currentPixel->numNeiPixelEachCluster[j]-1);
+                                                    if(EWDist < shortestEWDist){
+                                                            shortestEWDist = EWDist;
+                                                            newNearestGenerator = indexNeiCluster;
+                                                    }
+                                            }
+                                    }
+                            }else{
+                                    // as getNearestGenerator with indicator 1
+                                    double dr = pixelRow[i] - generatorRow[oldNearestGenerator];
+                                    double dc = pixelColumn[i] - generatorColumn[oldNearestGenerator];
+                                    double euclideanDist2 = dr*dr + dc*dc;
+                                    for(j = 0; j < currentPixel->numNeiCluster; j++){
+                                            if(j!=oldNearestGenerator && currentPixel->numNeiPixelEachCluster[j]!=0){
+                                                    int indexNeiCluster = currentPixel->indexNeiClusters[j];
+                                                    dr = pixelRow[i] - generatorRow[indexNeiCluster];
+                                                    dc = pixelColumn[i] - generatorColumn[indexNeiCluster];
+                                                    if(dr*dr + dc*dc < euclideanDist2){
+                                                            newNearestGenerator = indexNeiCluster;
+                                                            euclideanDist2 = dr*dr + dc*dc;
+                                                    }
+                                            }
+                                    }
+                            }
+
+                            if(newNearestGenerator == oldNearestGenerator){
+                                    continue;
+                            }
+
+                            dataTransfer(currentPixel, newNearestGenerator, pixelArray);
+                            numTransfer++;
+
+                            // as updateGenerator, the pixel comes into the new cluster ...
+                            int n = generatorNumPixels[newNearestGenerator];
+                            generatorRow[newNearestGenerator] = generatorRow[newNearestGenerator]*n/(n+1) + pixelRow[i]/(n+1);
+                            generatorColumn[newNearestGenerator] = generatorColumn[newNearestGenerator]*n/(n+1) + pixelColumn[i]/(n+1);
+                            for(k = 0; k < 3; k++){
+                                    generatorColor[k][newNearestGenerator] = generatorColor[k][newNearestGenerator]*n/(n+1) + pixelColor[k][i]/(n+1);
+                            }
+                            generatorNumPixels[newNearestGenerator]++;
+
+                            // ... and goes out of the old one
+                            n = generatorNumPixels[oldNearestGenerator];
+                            if(n > 1){
+                                    generatorRow[oldNearestGenerator] = generatorRow[oldNearestGenerator]*n/(n-1) - pixelRow[i]/(n-1);
+                                    generatorColumn[oldNearestGenerator] = generatorColumn[oldNearestGenerator]*n/(n-1) - pixelColumn[i]/(n-1);
+                                    for(k = 0; k < 3; k++){
+                                            generatorColor[k][oldNearestGenerator] = generatorColor[k][oldNearestGenerator]*n/(n-1) - pixelColor[k][i]/(n-1);
+                                    }
+                                    generatorNumPixels[oldNearestGenerator]--;
+                            }else{
+                                    generatorRow[oldNearestGenerator] = -1;
+                                    generatorColumn[oldNearestGenerator] = -1;
+                                    generatorNumPixels[oldNearestGenerator] = 0;
+                                    for(k = 0; k < 3; k++){
+                                            generatorColor[k][oldNearestGenerator] = 0;
+                                    }
+                            }
+
+                            // the cluster counts of all pixels in the neighborhood (including
+                            // the pixel itself) changed; revisit them in this and the next pass
+                            for(j = 0; j < currentPixel->numNeiPixels; j++){
+                                    int neiIndex = currentPixel->neiPixel[j];
+                                    visitNext[neiIndex] = 1;
+                                    if(neiIndex > i){
+                                            visit[neiIndex] = 1;
+                                    }
+                            }
+                    }
+
+                    visit.swap(visitNext);
+                    (*numPasses)++;
+                    *numTransfers += numTransfer;
+            }
+
+            for(j = 0; j < NUM_CLUSTER; j++){
+                    generators[j].row = generatorRow[j];
+                    generators[j].column = generatorColumn[j];
+                    generators[j].numPixels = generatorNumPixels[j];
+                    for(k = 0; k < 3; k++){
+                            generators[j].color[k] = generatorColor[k][j];
+                    }
+            }
+    }
 };
 
 #endif	/* VCELLS_H */
\ No newline at end of file
@@ -49,14 +49,19 @@ public:
      * \param[in] num_direct_nei see paper
      * \param[in] threshold see paper
      * \param[out] labels superpixel labels
+     * \param[in] restricted only revisit pixels whose neighborhood changed in the previous pass
+     * \param[out] statistics if not null, number of passes and transfers of both stages
      */
     static void computeSuperpixels(const cv::Mat &image, int superpixels, 
             double weight_length, int radius, int num_nei_cluster, 
-            int num_direct_nei, int threshold, cv::Mat &labels) {
+            int num_direct_nei, int threshold, cv::Mat &labels,
+            bool restricted = false, cvtStatistics* statistics = 0) {
         
         // i: height, j: width, k: channels
         // (pBmpBuf + i * lineByte + j * 3 + k)
-        VCells vc(superpixels, weight_length);
+        VCells vc(superpixels, weight_length, radius, num_nei_cluster, 
+                num_direct_nei, threshold);
+        vc.RESTRICTED = restricted;
 //	vc.pBmpBuf = new unsigned char[image.rows*image.cols*image.channels()];
         vc.bmpWidth = image.cols;
         vc.bmpHeight = image.rows;
@@ -96,6 +101,10 @@ public:
         
 	delete[] pixelArray;
 	delete[] generators;
+        
+        if (statistics) {
+            *statistics = vc.statistics;
+        }
     }
 };
 
@@ -29,6 +29,8 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cmath>
+#include <cassert>
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include <pcl/features/normal_3d.h>
@@ -67,21 +69,27 @@ void VCCS_OpenCV_PCL::computeSuperpixels(const cv::Mat &image, const cv::Mat &cl
 //    }
 
     pcl::PointCloud<pcl::PointXYZRGBA>::Ptr point_cloud(new pcl::PointCloud<pcl::PointXYZRGBA>);
+    point_cloud->resize(cloud.rows*cloud.cols);
+    
+    int index = 0;
     for (int i = 0; i < cloud.rows; ++i) {
+        const cv::Vec3f* cloud_ptr = cloud.ptr<cv::Vec3f>(i);
+        const cv::Vec3b* image_ptr = image.ptr<cv::Vec3b>(i);
+        
         for (int j = 0; j < cloud.cols; ++j) {
-            pcl::PointXYZRGBA point;
-
+            pcl::PointXYZRGBA &point = point_cloud->points[index];
+            
             // x,y,z coordinates are in meters, but depth is given in meters*1000.
-            point.x = cloud.at<cv::Vec3f>(i, j)[0];
-            point.y = cloud.at<cv::Vec3f>(i, j)[1];
-            point.z = cloud.at<cv::Vec3f>(i, j)[2];
+            point.x = cloud_ptr[j][0];
+            point.y = cloud_ptr[j][1];
+            point.z = cloud_ptr[j][2];
 
-            point.r = image.at<cv::Vec3b>(i, j)[2];
-            point.g = image.at<cv::Vec3b>(i, j)[1];
-            point.b = image.at<cv::Vec3b>(i, j)[0];
-
-            // Note that row and column are switched here.
-            point_cloud->push_back(point);
+            point.r = image_ptr[j][2];
+            point.g = image_ptr[j][1];
+            point.b = image_ptr[j][0];
+            point.a = 255;
+            
+            ++index;
         }
     }
     
@@ -97,7 +105,7 @@ void VCCS_OpenCV_PCL::computeSuperpixels(const cv::Mat &image, const cv::Mat &cl
     std::map<uint32_t, pcl::Supervoxel<pcl::PointXYZRGBA>::Ptr> supervoxel_clusters;
     super.extract(supervoxel_clusters);
 
-    int index = 0;
+    index = 0;
     pcl::PointCloud<pcl::PointXYZL>::Ptr label_cloud = super.getLabeledCloud();
     pcl::PointXYZL label;
 
@@ -133,4 +141,94 @@ void VCCS_OpenCV_PCL::computeSuperpixels(const cv::Mat &image, const cv::Mat &cl
 //    while (!viewer->wasStopped()) {
 //        viewer->spinOnce(100);
 //    }
-}
\ No newline at end of file
+}
+
+struct VCCS_OpenCV_PCL_Organized::Cloud {
+    pcl::PointCloud<pcl::PointXYZRGBA>::Ptr points;
+};
+
+VCCS_OpenCV_PCL_Organized::VCCS_OpenCV_PCL_Organized(float voxel_resolution_, 
+        float seed_resolution_, float spatial_weight_, float normal_weight_, 
+        bool use_transform_) 
+        : voxel_resolution(voxel_resolution_), seed_resolution(seed_resolution_),
+        spatial_weight(spatial_weight_), normal_weight(normal_weight_), 
+        use_transform(use_transform_), point_cloud(new Cloud()) {
+    
+    point_cloud->points.reset(new pcl::PointCloud<pcl::PointXYZRGBA>);
+}
+
+VCCS_OpenCV_PCL_Organized::~VCCS_OpenCV_PCL_Organized() {
+    delete point_cloud;
+}
+
+void VCCS_OpenCV_PCL_Organized::computeSuperpixels(const cv::Mat &image, 
+        const cv::Mat &cloud, cv::Mat &labels) {
+    
+    assert(image.rows == cloud.rows && image.cols == cloud.cols);
+    assert(cloud.type() == CV_32FC3 && image.type() == CV_8UC3);
+    
+    // Collect valid points; the buffers only grow, so for a stream of
+    // equally sized frames nothing is reallocated.
+    pcl::PointCloud<pcl::PointXYZRGBA> &points = *point_cloud->points;
+    points.points.resize(cloud.rows*cloud.cols);
+    point_to_pixel.resize(cloud.rows*cloud.cols);
+    
+    int n = 0;
+    for (int i = 0; i < cloud.rows; ++i) {
+        const cv::Vec3f* cloud_ptr = cloud.ptr<cv::Vec3f>(i);
+        const cv::Vec3b* image_ptr = image.ptr<cv::Vec3b>(i);
+        
+        for (int j = 0; j < cloud.cols; ++j) {
+            if (!(cloud_ptr[j][2] > 0) || std::isinf(cloud_ptr[j][2])) {
+                continue;
+            }
+            
+            pcl::PointXYZRGBA &point = points.points[n];
+            point.x = cloud_ptr[j][0];
+            point.y = cloud_ptr[j][1];
+            point.z = cloud_ptr[j][2];
+            
+            point.r = image_ptr[j][2];
+            point.g = image_ptr[j][1];
+            point.b = image_ptr[j][0];
+            point.a = 255;
+            
+            point_to_pixel[n] = i*cloud.cols + j;
+            ++n;
+        }
+    }
+    
+    points.points.resize(n);
+    points.width = n;
+    points.height = 1;
+    points.is_dense = true;
+    
+    labels.create(image.rows, image.cols, CV_32SC1);
+    labels.setTo(0);
+    
+    if (n == 0) {
+        return;
+    }
+    
+    // The adjacency octree cannot be cleared through PCL's public interface,
+    // so the clustering itself is set up per frame.
+    pcl::SupervoxelClustering<pcl::PointXYZRGBA> super(voxel_resolution, 
+            seed_resolution, use_transform);
+    super.setInputCloud(point_cloud->points);
+    
+    float color_weight = 1.f - spatial_weight - normal_weight;
+    super.setColorImportance(color_weight);
+    super.setSpatialImportance(spatial_weight);
+    super.setNormalImportance(normal_weight);
+    
+    std::map<uint32_t, pcl::Supervoxel<pcl::PointXYZRGBA>::Ptr> supervoxel_clusters;
+    super.extract(supervoxel_clusters);
+    
+    // The labeled cloud has the same order as the input cloud.
+    pcl::PointCloud<pcl::PointXYZL>::Ptr label_cloud = super.getLabeledCloud();
+    
+    int* labels_ptr = labels.ptr<int>(0);
+    for (int k = 0; k < n; ++k) {
+        labels_ptr[point_to_pixel[k]] = label_cloud->points[k].label;
+    }
+}
@@ -32,6 +32,7 @@
 #ifndef VCCS_OPENCV_PCL_H
 #define	VCCS_OPENCV_PCL_H
 
+#include <vector>
 #include <opencv2/opencv.hpp>
 
 /** \brief Wrapper for running PCL on OpenCV images given the point cloud as OpenCV image.
@@ -54,5 +55,67 @@ public:
             float normal_weight, bool use_transform, cv::Mat &labels);
 };
 
+/** \brief Fast path for running VCCS on organized point clouds, i.e. clouds 
+ * given as three-channel float images as computed by 
+ * DepthTools::computeCloudFromDepth.
+ * 
+ * Only points with valid depth are put into the PCL cloud, which is built in 
+ * bulk. The index map from points to pixels is kept, so the labels are
+ * written back in a single pass. Point cloud and index map are kept between
+ * frames and only reallocated when the number of valid points grows; the
+ * VCCS settings are fixed per instance. Pixels without valid depth get label 0
+ * (PCL's label for points not assigned to any supervoxel).
+ * \author David Stutz
+ */
+class VCCS_OpenCV_PCL_Organized {
+public:
+    /** \brief Constructor.
+     * \param[in] voxel_resolution resolution of voxels in meters
+     * \param[in] seed_resolution step between superpixels in the cloud (in meters)
+     * \param[in] spatial_weight spatial weight
+     * \param[in] normal_weight normal weight
+     * \param[in] use_transform whether to use the transform, see PCL docs
+     */
+    VCCS_OpenCV_PCL_Organized(float voxel_resolution, float seed_resolution, 
+            float spatial_weight, float normal_weight, bool use_transform);
+    
+    /** \brief Destructor. */
+    ~VCCS_OpenCV_PCL_Organized();
+    
+    /** \brief Compute superpixels using VCCS.
+     * \param[in] image image to compute superpixels on
+     * \param[in] cloud point cloud as three-channel float image, same size as image
+     * \param[out] labels superpixel labels
+     */
+    void computeSuperpixels(const cv::Mat &image, const cv::Mat &cloud, 
+            cv::Mat &labels);
+    
+private:
+    
+    /** \brief Not copyable as the point cloud is owned. */
+    VCCS_OpenCV_PCL_Organized(const VCCS_OpenCV_PCL_Organized&);
+    VCCS_OpenCV_PCL_Organized& operator=(const VCCS_OpenCV_PCL_Organized&);
+    
+    /** \brief Point cloud, hidden to keep PCL out of this header. */
+    struct Cloud;
+    
+    /** \brief Resolution of voxels in meters. */
+    float voxel_resolution;
+    /** \brief Step between superpixels in meters. */
+    float seed_resolution;
+    /** \brief Spatial weight. */
+    float spatial_weight;
+    /** \brief Normal weight. */
+    float normal_weight;
+    /** \brief Whether to use the single camera transform. */
+    bool use_transform;
+    
+    /** \brief Point cloud reused between frames. */
+    Cloud* point_cloud;
+    /** \brief For each point, the index of the corresponding pixel. */
+    std::vector<int> point_to_pixel;
+    
+};
+
 #endif	/* VCCS_OPENCV_PCL_H */
 
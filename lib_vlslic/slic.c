@@ -140,6 +140,14 @@ is changed to the one of a neighbour
 region at @f$ p @f$ that has already been vistied (there is always one
 except for the very first pixel).
 
+::vl_slic_segment_mt splits the rows of the image among several
+threads. Each thread assigns the pixels of its rows to the centers and
+accumulates the new centers of mass in its own buffers, which are then
+merged. The energy is summed per row and then over the rows, so the
+iterations do not depend on the number of threads. With at least four
+channels, the appearance distances use the SIMD kernels of
+::vl_get_vector_comparison_function_f.
+
 */
 
 #include "slic.h"
@@ -147,6 +155,10 @@ except for the very first pixel).
 #include <math.h>
 #include <string.h>
 
+#if ! defined(VL_DISABLE_THREADS) && defined(VL_THREADS_POSIX)
+#include <pthread.h>
+#endif
+
 /** @brief SLIC superpixel segmentation
  ** @param segmentation segmentation.
  ** @param image image to segment.
@@ -189,18 +201,191 @@ vl_slic_segment_t (vl_uint32 * segmentation,
                  float regularization,
                  vl_size minRegionSize,
                  vl_size maxNumIterations)
+{
+  vl_slic_segment_mt(segmentation, image, width, height, numChannels, regionSize,
+                     regularization, minRegionSize, maxNumIterations, 1) ;
+}
+
+/** @internal @brief State shared by the threads of a k-means iteration */
+typedef struct _VlSlicIteration
+{
+  vl_uint32 * segmentation ;
+  float const * features ; /* image with the channels of a pixel stored contiguously */
+  float const * centers ;
+  float * rowEnergies ;
+  vl_size width ;
+  vl_size height ;
+  vl_size numChannels ;
+  vl_size regionSize ;
+  vl_size numRegionsX ;
+  vl_size numRegionsY ;
+  vl_size numRegions ;
+  float factor ;
+  VlFloatVectorComparisonFunction distance ; /* NULL for few channels */
+} VlSlicIteration ;
+
+/** @internal @brief Rows of a thread and its accumulators */
+typedef struct _VlSlicStrip
+{
+  VlSlicIteration const * iteration ;
+  vl_index yBegin ;
+  vl_index yEnd ;
+  double * sums ; /* (2 + numChannels) * numRegions */
+  vl_uint32 * masses ; /* numRegions */
+} VlSlicStrip ;
+
+/** @internal @brief Assign the pixels of a strip and accumulate the centers
+ ** @param data strip (::VlSlicStrip).
+ ** @return @c NULL.
+ **/
+
+static void *
+vl_slic_process_strip (void * data)
+{
+  VlSlicStrip * strip = data ;
+  VlSlicIteration const * it = strip->iteration ;
+  vl_size const width = it->width ;
+  vl_size const numChannels = it->numChannels ;
+  vl_size const regionSize = it->regionSize ;
+  float const * centers = it->centers ;
+  vl_index x, y, k ;
+
+  memset(strip->sums, 0, sizeof(double) * (2 + numChannels) * it->numRegions) ;
+  memset(strip->masses, 0, sizeof(vl_uint32) * it->numRegions) ;
+
+  for (y = strip->yBegin ; y < strip->yEnd ; ++y) {
+    float energy = 0 ;
+    for (x = 0 ; x < (signed)width ; ++x) {
+      vl_index u = floor((double)x / regionSize - 0.5) ;
+      vl_index v = floor((double)y / regionSize - 0.5) ;
+      vl_index up, vp ;
+      vl_index pixel = x + y * width ;
+      float const * feature = it->features + pixel * numChannels ;
+      float minDistance = VL_INFINITY_F ;
+      vl_uint32 nearest = it->segmentation[pixel] ;
+      double * sums ;
+
+      for (vp = VL_MAX(0, v) ; vp <= VL_MIN((signed)it->numRegionsY-1, v+1) ; ++vp) {
+        for (up = VL_MAX(0, u) ; up <= VL_MIN((signed)it->numRegionsX-1, u+1) ; ++up) {
+          vl_index region = up  + vp * it->numRegionsX ;
+          float const * center = centers + (2 + numChannels) * region ;
+          float spatial = (x - center[0]) * (x - center[0]) + (y - center[1]) * (y - center[1]) ;
+          float appearance = 0 ;
+          float distance ;
+          if (it->distance) {
+            appearance = it->distance(numChannels, feature, center + 2) ;
+          } else {
+            for (k = 0 ; k < (signed)numChannels ; ++k) {
+              appearance += (feature[k] - center[k + 2]) * (feature[k] - center[k + 2]) ;
+            }
+          }
+          distance = appearance + it->factor * spatial ;
+          if (minDistance > distance) {
+            minDistance = distance ;
+            nearest = (vl_uint32)region ;
+          }
+        }
+      }
+      it->segmentation[pixel] = nearest ;
+      energy += minDistance ;
+
+      /* accumulate the center of mass of the nearest region */
+      strip->masses[nearest] ++ ;
+      sums = strip->sums + nearest * (2 + numChannels) ;
+      sums[0] += x ;
+      sums[1] += y ;
+      for (k = 0 ; k < (signed)numChannels ; ++k) {
+        sums[k + 2] += feature[k] ;
+      }
+    }
+    it->rowEnergies[y] = energy ;
+  }
+  return NULL ;
+}
+
+/** @internal @brief Process the strips on one thread each
+ ** @param strips strips.
+ ** @param numStrips number of strips.
+ **
+ ** The calling thread processes the first strip; if a thread cannot be
+ ** created, its strip is processed by the calling thread as well.
+ **/
+
+static void
+vl_slic_process_strips (VlSlicStrip * strips, vl_size numStrips)
+{
+#if ! defined(VL_DISABLE_THREADS) && defined(VL_THREADS_POSIX)
+  vl_uindex s ;
+  pthread_t * threads = vl_malloc(sizeof(pthread_t) * numStrips) ;
+  vl_bool * started = vl_calloc(numStrips, sizeof(vl_bool)) ;
+
+  for (s = 1 ; s < numStrips ; ++s) {
+    started[s] = (pthread_create(threads + s, NULL, vl_slic_process_strip, strips + s) == 0) ;
+  }
+  vl_slic_process_strip(strips) ;
+  for (s = 1 ; s < numStrips ; ++s) {
+    if (started[s]) {
+      pthread_join(threads[s], NULL) ;
+    } else {
+      vl_slic_process_strip(strips + s) ;
+    }
+  }
+
+  vl_free(started) ;
+  vl_free(threads) ;
+#else
+  vl_uindex s ;
+  for (s = 0 ; s < numStrips ; ++s) {
+    vl_slic_process_strip(strips + s) ;
+  }
+#endif
+}
+
+/** @brief SLIC superpixel segmentation using several threads
+ ** @param segmentation segmentation.
+ ** @param image image to segment.
+ ** @param width image width.
+ ** @param height image height.
+ ** @param numChannels number of image channels (depth).
+ ** @param regionSize nominal size of the regions.
+ ** @param regularization trade-off between appearance and spatial terms.
+ ** @param minRegionSize minimum size of a segment.
+ ** @param maxNumIterations maximum number of k-means iterations.
+ ** @param numThreads number of threads (0 for the number of CPUs).
+ **
+ ** Same as ::vl_slic_segment, with the assignment and update steps of
+ ** the k-means iterations split among @a numThreads threads.
+ **
+ ** @sa @ref slic-tech
+ **/
+
+void
+vl_slic_segment_mt (vl_uint32 * segmentation,
+                 float const * image,
+                 vl_size width,
+                 vl_size height,
+                 vl_size numChannels,
+                 vl_size regionSize,
+                 float regularization,
+                 vl_size minRegionSize,
+                 vl_size maxNumIterations,
+                 vl_size numThreads)
 {
   vl_index i, x, y, u, v, k, region ;
-  vl_uindex iter ;
+  vl_uindex iter, s ;
   vl_size const numRegionsX = (vl_size) ceil((double) width / regionSize) ;
   vl_size const numRegionsY = (vl_size) ceil((double) height / regionSize) ;
   vl_size const numRegions = numRegionsX * numRegionsY ;
   vl_size const numPixels = width * height ;
   float * centers ;
   float * edgeMap ;
+  float * features ;
+  float * rowEnergies ;
   float previousEnergy = VL_INFINITY_F ;
   float startingEnergy ;
-  vl_uint32 * masses ;
+  VlSlicIteration iteration ;
+  VlSlicStrip * strips ;
+  vl_size numStrips ;
 //  vl_size const maxNumIterations = 100 ;
 
   assert(segmentation) ;
@@ -215,8 +400,9 @@ vl_slic_segment_t (vl_uint32 * segmentation,
 #define atEdgeMap(x,y) edgeMap[(x)+(y)*width]
 
   edgeMap = vl_calloc(numPixels, sizeof(float)) ;
-  masses = vl_malloc(sizeof(vl_uint32) * numPixels) ;
   centers = vl_malloc(sizeof(float) * (2 + numChannels) * numRegions) ;
+  features = vl_malloc(sizeof(float) * numChannels * numPixels) ;
+  rowEnergies = vl_malloc(sizeof(float) * height) ;
 
   /* compute edge map (gradient strength) */
   for (k = 0 ; k < (signed)numChannels ; ++k) {
@@ -231,6 +417,13 @@ vl_slic_segment_t (vl_uint32 * segmentation,
     }
   }
 
+  /* store the channels of each pixel contiguously */
+  for (k = 0 ; k < (signed)numChannels ; ++k) {
+    for (i = 0 ; i < (signed)numPixels ; ++i) {
+      features[i * numChannels + k] = image[i + k * numPixels] ;
+    }
+  }
+
   /* initialize K-means centers */
   i = 0 ;
   for (v = 0 ; v < (signed)numRegionsY ; ++v) {
@@ -267,42 +460,46 @@ vl_slic_segment_t (vl_uint32 * segmentation,
       }
     }
   }
-  
+
+  /* split the rows among the threads, each with its own accumulators */
+  if (numThreads == 0) {
+    numThreads = vl_get_num_cpus() ;
+  }
+  numStrips = VL_MAX(VL_MIN(numThreads, height), 1) ;
+  strips = vl_malloc(sizeof(VlSlicStrip) * numStrips) ;
+  for (s = 0 ; s < numStrips ; ++s) {
+    strips[s].iteration = &iteration ;
+    strips[s].yBegin = (vl_index) (height * s / numStrips) ;
+    strips[s].yEnd = (vl_index) (height * (s + 1) / numStrips) ;
+    strips[s].sums = vl_malloc(sizeof(double) * (2 + numChannels) * numRegions) ;
+    strips[s].masses = vl_malloc(sizeof(vl_uint32) * numRegions) ;
+  }
+
+  iteration.segmentation = segmentation ;
+  iteration.features = features ;
+  iteration.centers = centers ;
+  iteration.rowEnergies = rowEnergies ;
+  iteration.width = width ;
+  iteration.height = height ;
+  iteration.numChannels = numChannels ;
+  iteration.regionSize = regionSize ;
+  iteration.numRegionsX = numRegionsX ;
+  iteration.numRegionsY = numRegionsY ;
+  iteration.numRegions = numRegions ;
+  iteration.factor = regularization / (regionSize * regionSize) ;
+  iteration.distance = (numChannels >= 4) ? vl_get_vector_comparison_function_f(VlDistanceL2) : NULL ;
+
+  memset(segmentation, 0, sizeof(vl_uint32) * numPixels) ;
+
   /* run k-means iterations */
   for (iter = 0 ; iter < maxNumIterations ; ++iter) {
-    float factor = regularization / (regionSize * regionSize) ;
     float energy = 0 ;
-    
-    /* assign pixels to centers */
+
+    /* assign pixels to centers and accumulate the new centers */
+    vl_slic_process_strips(strips, numStrips) ;
+
     for (y = 0 ; y < (signed)height ; ++y) {
-      for (x = 0 ; x < (signed)width ; ++x) {
-        vl_index u = floor((double)x / regionSize - 0.5) ;
-        vl_index v = floor((double)y / regionSize - 0.5) ;
-        vl_index up, vp ;
-        float minDistance = VL_INFINITY_F ;
-
-        for (vp = VL_MAX(0, v) ; vp <= VL_MIN((signed)numRegionsY-1, v+1) ; ++vp) {
-          for (up = VL_MAX(0, u) ; up <= VL_MIN((signed)numRegionsX-1, u+1) ; ++up) {
-            vl_index region = up  + vp * numRegionsX ;
-            float centerx = centers[(2 + numChannels) * region + 0]  ;
-            float centery = centers[(2 + numChannels) * region + 1] ;
-            float spatial = (x - centerx) * (x - centerx) + (y - centery) * (y - centery) ;
-            float appearance = 0 ;
-            float distance ;
-            for (k = 0 ; k < (signed)numChannels ; ++k) {
-              float centerz = centers[(2 + numChannels) * region + k + 2]  ;
-              float z = atimage(x,y,k) ;
-              appearance += (z - centerz) * (z - centerz) ;
-            }
-            distance = appearance + factor * spatial ;
-            if (minDistance > distance) {
-              minDistance = distance ;
-              segmentation[x + y * width] = (vl_uint32)region ;
-            }
-          }
-        }
-        energy += minDistance ;
-      }
+      energy += rowEnergies[y] ;
     }
 
     /*
@@ -320,33 +517,32 @@ vl_slic_segment_t (vl_uint32 * segmentation,
     previousEnergy = energy ;
 
     /* recompute centers */
-    memset(masses, 0, sizeof(vl_uint32) * width * height) ;
-    memset(centers, 0, sizeof(float) * (2 + numChannels) * numRegions) ;
-
-    for (y = 0 ; y < (signed)height ; ++y) {
-      for (x = 0 ; x < (signed)width ; ++x) {
-        vl_index pixel = x + y * width ;
-        vl_index region = segmentation[pixel] ;
-        masses[region] ++ ;
-        centers[region * (2 + numChannels) + 0] += x ;
-        centers[region * (2 + numChannels) + 1] += y ;
-        for (k = 0 ; k < (signed)numChannels ; ++k) {
-          centers[region * (2 + numChannels) + k + 2] += atimage(x,y,k) ;
-        }
-      }
-    }
-
     for (region = 0 ; region < (signed)numRegions ; ++region) {
-      float mass = VL_MAX(masses[region], 1e-8) ;
+      vl_uint32 masses = 0 ;
+      float mass ;
+      for (s = 0 ; s < numStrips ; ++s) {
+        masses += strips[s].masses[region] ;
+      }
+      mass = VL_MAX(masses, 1e-8) ;
       for (i = (2 + numChannels) * region ;
            i < (signed)(2 + numChannels) * (region + 1) ;
            ++i) {
-        centers[i] /= mass ;
+        double sum = 0 ;
+        for (s = 0 ; s < numStrips ; ++s) {
+          sum += strips[s].sums[i] ;
+        }
+        centers[i] = (float) (sum / mass) ;
       }
     }
   }
 
-  vl_free(masses) ;
+  for (s = 0 ; s < numStrips ; ++s) {
+    vl_free(strips[s].sums) ;
+    vl_free(strips[s].masses) ;
+  }
+  vl_free(strips) ;
+  vl_free(rowEnergies) ;
+  vl_free(features) ;
   vl_free(centers) ;
   vl_free(edgeMap) ;
 
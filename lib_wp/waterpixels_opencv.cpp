@@ -0,0 +1,480 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <queue>
+#include <vector>
+#include "waterpixels_opencv.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// find
+////////////////////////////////////////////////////////////////////////////////
+
+int Waterpixels_OpenCV::find(std::vector<int> &parents, int p) {
+    int root = p;
+    while (parents[root] != root) {
+        root = parents[root];
+    }
+    
+    while (parents[p] != root) {
+        int parent = parents[p];
+        parents[p] = root;
+        p = parent;
+    }
+    
+    return root;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeSuperpixels
+////////////////////////////////////////////////////////////////////////////////
+
+void Waterpixels_OpenCV::computeSuperpixels(const cv::Mat &image, int superpixels, 
+        float weight, bool filter, cv::Mat &labels) {
+    
+    int step = std::floor(0.5f + std::sqrt(image.rows*image.cols/((float) superpixels)));
+    step = std::max(step, 1);
+    
+    std::vector<cv::Mat> channels;
+    cv::split(image, channels);
+    
+    if (filter) {
+        for (unsigned int c = 0; c < channels.size(); c++) {
+            areaClose(channels[c], step*step/16);
+            areaOpen(channels[c], step*step/16);
+        }
+    }
+    
+    // Morphological gradient on the green channel (or the gray image).
+    cv::Mat gray = (channels.size() >= 3 ? channels[1] : channels[0]);
+    cv::Mat cross = cv::getStructuringElement(cv::MORPH_CROSS, cv::Size(3, 3));
+    cv::Mat gradient;
+    cv::morphologyEx(gray, gradient, cv::MORPH_GRADIENT, cross);
+    
+    labels.create(image.rows, image.cols, CV_32SC1);
+    if (computeMarkers(gradient, step, labels) == 0) {
+        labels.setTo(1);
+    }
+    
+    // Chessboard distance to the markers is used for regularization.
+    cv::Mat relief;
+    gradient.convertTo(relief, CV_32FC1);
+    
+    if (weight > 0) {
+        cv::Mat background = (labels == 0);
+        cv::Mat distance;
+        cv::distanceTransform(background, distance, CV_DIST_C, 3);
+        
+        relief += distance*(2*weight/step);
+    }
+    
+    watershed(relief, labels);
+    labels -= 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// areaOpen
+////////////////////////////////////////////////////////////////////////////////
+
+void Waterpixels_OpenCV::areaOpen(cv::Mat &image, int area) {
+    CV_Assert(image.type() == CV_8UC1);
+    
+    if (area <= 1) {
+        return;
+    }
+    
+    const int rows = image.rows;
+    const int cols = image.cols;
+    const int N = rows*cols;
+    
+    cv::Mat values = image.isContinuous() ? image : image.clone();
+    const uchar* f = values.ptr<uchar>(0);
+    
+    // Counting sort by decreasing value, stable in raster order.
+    std::vector<int> histogram(257, 0);
+    for (int p = 0; p < N; p++) {
+        histogram[255 - f[p] + 1]++;
+    }
+    for (int v = 1; v < 257; v++) {
+        histogram[v] += histogram[v - 1];
+    }
+    
+    std::vector<int> order(N);
+    for (int p = 0; p < N; p++) {
+        order[histogram[255 - f[p]]++] = p;
+    }
+    
+    // Union-find by Meijster and Wilkinson, parents point to pixels of
+    // lower or equal value; -1 marks unprocessed pixels.
+    std::vector<int> parents(N, -1);
+    std::vector<int> areas(N, 0);
+    
+    for (int k = 0; k < N; k++) {
+        int p = order[k];
+        parents[p] = p;
+        areas[p] = 1;
+        
+        int i = p/cols;
+        int j = p%cols;
+        int neighbors[4] = {
+            (i > 0 ? p - cols : -1), 
+            (j > 0 ? p - 1 : -1), 
+            (j < cols - 1 ? p + 1 : -1), 
+            (i < rows - 1 ? p + cols : -1)
+        };
+        
+        for (int n = 0; n < 4; n++) {
+            if (neighbors[n] < 0 || parents[neighbors[n]] < 0) {
+                continue;
+            }
+            
+            int r = find(parents, neighbors[n]);
+            if (r != p) {
+                if (f[r] == f[p] || areas[r] < area) {
+                    areas[p] += areas[r];
+                    parents[r] = p;
+                }
+                else {
+                    areas[p] = area;
+                }
+            }
+        }
+    }
+    
+    std::vector<uchar> result(N);
+    for (int k = N - 1; k >= 0; k--) {
+        int p = order[k];
+        if (parents[p] == p) {
+            result[p] = f[p];
+        }
+        else {
+            result[p] = result[parents[p]];
+        }
+    }
+    
+    for (int i = 0; i < rows; i++) {
+        std::copy(result.begin() + i*cols, result.begin() + (i + 1)*cols, 
+                image.ptr<uchar>(i));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// areaClose
+////////////////////////////////////////////////////////////////////////////////
+
+void Waterpixels_OpenCV::areaClose(cv::Mat &image, int area) {
+    cv::Mat inverted = 255 - image;
+    areaOpen(inverted, area);
+    image = 255 - inverted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// computeMarkers
+////////////////////////////////////////////////////////////////////////////////
+
+int Waterpixels_OpenCV::computeMarkers(const cv::Mat &gradient, int step, cv::Mat &markers) {
+    CV_Assert(gradient.type() == CV_8UC1);
+    
+    const int rows = gradient.rows;
+    const int cols = gradient.cols;
+    const int N = rows*cols;
+    const int margin = step/6;
+    const int cell_cols = cols/step + 1;
+    
+    cv::Mat values = gradient.isContinuous() ? gradient : gradient.clone();
+    const uchar* f = values.ptr<uchar>(0);
+    
+    // Cell of each pixel, -1 for pixels on the cell margins.
+    std::vector<int> cells(N, -1);
+    for (int i = 0; i < rows; i++) {
+        if (i%step < margin || i%step >= step - margin) {
+            continue;
+        }
+        
+        for (int j = 0; j < cols; j++) {
+            if (j%step >= margin && j%step < step - margin) {
+                cells[i*cols + j] = (i/step)*cell_cols + j/step;
+            }
+        }
+    }
+    
+    // Regional minima restricted to cell interiors, labeled per cell; flat
+    // zones are flooded and discarded if they have a lower neighbor.
+    std::vector<int> candidates(N, 0);
+    std::vector<bool> visited(N, false);
+    std::vector<int> zone;
+    std::vector<int> candidate_cells(1, -1);
+    
+    for (int p = 0; p < N; p++) {
+        if (visited[p]) {
+            continue;
+        }
+        
+        zone.clear();
+        zone.push_back(p);
+        visited[p] = true;
+        bool minimum = true;
+        
+        for (unsigned int k = 0; k < zone.size(); k++) {
+            int q = zone[k];
+            int i = q/cols;
+            int j = q%cols;
+            int neighbors[4] = {
+                (i > 0 ? q - cols : -1), 
+                (j > 0 ? q - 1 : -1), 
+                (j < cols - 1 ? q + 1 : -1), 
+                (i < rows - 1 ? q + cols : -1)
+            };
+            
+            for (int n = 0; n < 4; n++) {
+                int r = neighbors[n];
+                if (r < 0) {
+                    continue;
+                }
+                
+                if (f[r] < f[q]) {
+                    minimum = false;
+                }
+                else if (f[r] == f[q] && !visited[r]) {
+                    visited[r] = true;
+                    zone.push_back(r);
+                }
+            }
+        }
+        
+        if (!minimum) {
+            continue;
+        }
+        
+        // The margins may split a minimum into several candidates.
+        for (unsigned int k = 0; k < zone.size(); k++) {
+            int q = zone[k];
+            if (cells[q] < 0 || candidates[q] > 0) {
+                continue;
+            }
+            
+            int candidate = candidate_cells.size();
+            candidate_cells.push_back(cells[q]);
+            candidates[q] = candidate;
+            
+            std::vector<int> stack(1, q);
+            while (!stack.empty()) {
+                int s = stack.back();
+                stack.pop_back();
+                
+                int i = s/cols;
+                int j = s%cols;
+                int neighbors[4] = {
+                    (i > 0 ? s - cols : -1), 
+                    (j > 0 ? s - 1 : -1), 
+                    (j < cols - 1 ? s + 1 : -1), 
+                    (i < rows - 1 ? s + cols : -1)
+                };
+                
+                for (int n = 0; n < 4; n++) {
+                    int r = neighbors[n];
+                    if (r >= 0 && f[r] == f[s] && cells[r] == cells[q] && candidates[r] == 0) {
+                        candidates[r] = candidate;
+                        stack.push_back(r);
+                    }
+                }
+            }
+        }
+    }
+    
+    // Area extinction values by flooding in increasing order: when two
+    // basins meet, the candidate of the smaller one goes extinct.
+    std::vector<int> histogram(257, 0);
+    for (int p = 0; p < N; p++) {
+        histogram[f[p] + 1]++;
+    }
+    for (int v = 1; v < 257; v++) {
+        histogram[v] += histogram[v - 1];
+    }
+    
+    std::vector<int> order(N);
+    for (int p = 0; p < N; p++) {
+        order[histogram[f[p]]++] = p;
+    }
+    
+    std::vector<int> parents(N, -1);
+    std::vector<int> areas(N, 0);
+    std::vector<int> owners(N, 0);
+    std::vector<int> extinctions(candidate_cells.size(), N + 1);
+    
+    for (int k = 0; k < N; k++) {
+        int p = order[k];
+        parents[p] = p;
+        areas[p] = 1;
+        owners[p] = candidates[p];
+        
+        int i = p/cols;
+        int j = p%cols;
+        int neighbors[4] = {
+            (i > 0 ? p - cols : -1), 
+            (j > 0 ? p - 1 : -1), 
+            (j < cols - 1 ? p + 1 : -1), 
+            (i < rows - 1 ? p + cols : -1)
+        };
+        
+        for (int n = 0; n < 4; n++) {
+            if (neighbors[n] < 0 || parents[neighbors[n]] < 0) {
+                continue;
+            }
+            
+            int r = find(parents, neighbors[n]);
+            int s = find(parents, p);
+            if (r == s) {
+                continue;
+            }
+            
+            if (areas[r] > areas[s]) {
+                std::swap(r, s);
+            }
+            
+            if (owners[r] > 0 && owners[s] > 0) {
+                extinctions[owners[r]] = areas[r];
+            }
+            else if (owners[r] > 0) {
+                owners[s] = owners[r];
+            }
+            
+            parents[r] = s;
+            areas[s] += areas[r];
+        }
+    }
+    
+    // Best candidate per cell, otherwise the first lowest pixel of the cell.
+    const int cell_count = (rows/step + 1)*cell_cols;
+    std::vector<int> best(cell_count, 0);
+    for (unsigned int c = 1; c < candidate_cells.size(); c++) {
+        int cell = candidate_cells[c];
+        if (best[cell] == 0 || extinctions[c] > extinctions[best[cell]]) {
+            best[cell] = c;
+        }
+    }
+    
+    std::vector<int> lowest(cell_count, -1);
+    for (int p = 0; p < N; p++) {
+        int cell = cells[p];
+        if (cell >= 0 && best[cell] == 0 && (lowest[cell] < 0 || f[p] < f[lowest[cell]])) {
+            lowest[cell] = p;
+        }
+    }
+    
+    std::vector<int> marker_ids(cell_count, 0);
+    int count = 0;
+    for (int c = 0; c < cell_count; c++) {
+        if (best[c] > 0 || lowest[c] >= 0) {
+            marker_ids[c] = ++count;
+        }
+    }
+    
+    markers.create(rows, cols, CV_32SC1);
+    for (int i = 0; i < rows; i++) {
+        int* markers_i = markers.ptr<int>(i);
+        for (int j = 0; j < cols; j++) {
+            int p = i*cols + j;
+            int cell = cells[p];
+            
+            markers_i[j] = 0;
+            if (cell >= 0 && ((best[cell] > 0 && candidates[p] == best[cell]) 
+                    || lowest[cell] == p)) {
+                markers_i[j] = marker_ids[cell];
+            }
+        }
+    }
+    
+    return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// watershed
+////////////////////////////////////////////////////////////////////////////////
+
+/** \brief Pixel in the flooding queue, ordered by level and then by insertion
+ * to flood plateaus breadth first. */
+struct WaterpixelsQueueEntry {
+    float level;
+    int order;
+    int p;
+    
+    bool operator>(const WaterpixelsQueueEntry &other) const {
+        return level > other.level || (level == other.level && order > other.order);
+    }
+};
+
+void Waterpixels_OpenCV::watershed(const cv::Mat &relief, cv::Mat &labels) {
+    CV_Assert(relief.type() == CV_32FC1 && labels.type() == CV_32SC1);
+    
+    const int rows = relief.rows;
+    const int cols = relief.cols;
+    
+    std::priority_queue<WaterpixelsQueueEntry, std::vector<WaterpixelsQueueEntry>, 
+            std::greater<WaterpixelsQueueEntry> > queue;
+    int order = 0;
+    
+    for (int i = 0; i < rows; i++) {
+        const int* labels_i = labels.ptr<int>(i);
+        const float* relief_i = relief.ptr<float>(i);
+        for (int j = 0; j < cols; j++) {
+            if (labels_i[j] > 0) {
+                WaterpixelsQueueEntry entry = {relief_i[j], order++, i*cols + j};
+                queue.push(entry);
+            }
+        }
+    }
+    
+    while (!queue.empty()) {
+        WaterpixelsQueueEntry entry = queue.top();
+        queue.pop();
+        
+        int i = entry.p/cols;
+        int j = entry.p%cols;
+        int label = labels.at<int>(i, j);
+        
+        const int di[4] = {-1, 0, 0, 1};
+        const int dj[4] = {0, -1, 1, 0};
+        for (int n = 0; n < 4; n++) {
+            int ii = i + di[n];
+            int jj = j + dj[n];
+            
+            if (ii < 0 || ii >= rows || jj < 0 || jj >= cols || labels.at<int>(ii, jj) > 0) {
+                continue;
+            }
+            
+            labels.at<int>(ii, jj) = label;
+            WaterpixelsQueueEntry neighbor = {std::max(entry.level, relief.at<float>(ii, jj)), 
+                order++, ii*cols + jj};
+            queue.push(neighbor);
+        }
+    }
+}
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef WATERPIXELS_OPENCV_H
+#define	WATERPIXELS_OPENCV_H
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/** \brief Native implementation of m-waterpixels following
+ * demo_waterpixels_smil_with_parser.py, so WP can be run without Python and SMIL.
+ * 
+ * Waterpixels are computed by flooding a spatially regularized morphological
+ * gradient from one marker per cell of a regular grid; the marker of each cell
+ * is the gradient minimum with the highest area extinction value.
+ * \author David Stutz
+ */
+class Waterpixels_OpenCV {
+public:
+    /** \brief Compute superpixels using WP, see README.md for details.
+     * \param[in] image image to compute superpixels on
+     * \param[in] superpixels number of superpixels
+     * \param[in] weight weight of the distance function added to the gradient
+     * \param[in] filter whether to apply area filtering on the image
+     * \param[out] labels superpixel labels
+     */
+    static void computeSuperpixels(const cv::Mat &image, int superpixels, 
+            float weight, bool filter, cv::Mat &labels);
+    
+    /** \brief Grayscale area opening (4-connected) using union-find.
+     * \param[in,out] image image of type CV_8UC1
+     * \param[in] area minimum area of bright structures to keep
+     */
+    static void areaOpen(cv::Mat &image, int area);
+    
+    /** \brief Grayscale area closing (4-connected), dual of areaOpen.
+     * \param[in,out] image image of type CV_8UC1
+     * \param[in] area minimum area of dark structures to keep
+     */
+    static void areaClose(cv::Mat &image, int area);
+    
+    /** \brief Select one marker per grid cell: the regional minimum of the
+     * gradient with highest area extinction, or the cell's lowest pixel if the
+     * cell does not contain a minimum.
+     * \param[in] gradient gradient of type CV_8UC1
+     * \param[in] step grid step
+     * \param[out] markers markers of type CV_32SC1, 0 for unmarked pixels
+     * \return number of markers
+     */
+    static int computeMarkers(const cv::Mat &gradient, int step, cv::Mat &markers);
+    
+    /** \brief Marker based watershed (flooding) without watershed lines.
+     * \param[in] relief relief to flood of type CV_32FC1
+     * \param[in,out] labels markers of type CV_32SC1 (> 0), flooded basins on return
+     */
+    static void watershed(const cv::Mat &relief, cv::Mat &labels);
+    
+private:
+    
+    /** \brief Find root in a union-find forest, compressing the path.
+     * \param[in,out] parents parent of each element
+     * \param[in] p element
+     * \return root
+     */
+    static int find(std::vector<int> &parents, int p);
+    
+};
+
+#endif	/* WATERPIXELS_OPENCV_H */
+
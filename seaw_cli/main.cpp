@@ -0,0 +1,213 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "seaw_opencv.h"
+#include "io_util.h"
+#include "benchmark.h"
+#include "batch_server.h"
+#include "superpixel_tools.h"
+#include "async_loader.h"
+#include "async_writer.h"
+
+/** \brief Command line tool for running the native SEAW.
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/seaw_cli --help
+ *   Allowed options:
+ *     -h [ --help ]                   produce help message
+ *     -i [ --input ] arg              the folder to process
+ *     -l [ --level ] arg (=4)         level of the scaling functions, implicitly 
+ *                                     defining the number of superpixels
+ *     -c [ --dist-func ] arg (=1)     distance function; 0 = exp(-(sigma*d)^2), 
+ *                                     1 = 1/(|d| + eps)^sigma
+ *     -g [ --sigma ] arg (=1)         sigma of the distance function
+ *     --threads arg (=1)              number of threads per image (0 = all 
+ *                                     hardware threads)
+ *     -o [ --csv ] arg                save segmentation as CSV file
+ *     -v [ --vis ] arg                visualize contours
+ *     -x [ --prefix ] arg             output file prefix
+ *     --warm-up arg (=0)              number of discarded runs per image
+ *     --repeat arg (=1)               number of timed runs per image
+ *     --queue-depth arg (=4)          number of images loaded ahead and written behind
+ *     --load-threads arg (=1)         number of threads loading images
+ *     --write-threads arg (=1)        number of threads writing results
+ *     --jobs arg (=1)                 number of images processed concurrently
+ *     -w [ --wordy ]                  verbose/wordy/debug
+ *     --batch                         read jobs (arguments) line by line from stdin
+ *     --socket arg                    read jobs from the given UNIX socket
+ * \endcode
+ * \author David Stutz
+ */
+int run(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("input,i", boost::program_options::value<std::string>(), "the folder to process")
+        ("level,l", boost::program_options::value<int>()->default_value(4), "level of the scaling functions, implicitly defining the number of superpixels")
+        ("dist-func,c", boost::program_options::value<int>()->default_value(1), "distance function; 0 = exp(-(sigma*d)^2), 1 = 1/(|d| + eps)^sigma")
+        ("sigma,g", boost::program_options::value<double>()->default_value(1), "sigma of the distance function")
+        ("threads", boost::program_options::value<int>()->default_value(1), "number of threads per image (0 = all hardware threads)")
+        ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
+        ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
+        ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("warm-up", boost::program_options::value<int>()->default_value(0), "number of discarded runs per image")
+        ("repeat", boost::program_options::value<int>()->default_value(1), "number of timed runs per image")
+        ("queue-depth", boost::program_options::value<int>()->default_value(4), "number of images loaded ahead and written behind")
+        ("load-threads", boost::program_options::value<int>()->default_value(1), "number of threads loading images")
+        ("write-threads", boost::program_options::value<int>()->default_value(1), "number of threads writing results")
+        ("jobs", boost::program_options::value<int>()->default_value(1), "number of images processed concurrently")
+        ("wordy,w", "verbose/wordy/debug");
+
+    boost::program_options::positional_options_description positionals;
+    positionals.add("input", 1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
+    if (!output_dir.empty()) {
+        if (!boost::filesystem::is_directory(output_dir)) {
+            boost::filesystem::create_directories(output_dir);
+        }
+    }
+    
+    boost::filesystem::path vis_dir(parameters["vis"].as<std::string>());
+    if (!vis_dir.empty()) {
+        if (!boost::filesystem::is_directory(vis_dir)) {
+            boost::filesystem::create_directories(vis_dir);
+        }
+    }
+    
+    boost::filesystem::path input_dir(parameters["input"].as<std::string>());
+    if (!boost::filesystem::is_directory(input_dir)) {
+        std::cout << "Image directory not found ..." << std::endl;
+        return 1;
+    }
+    
+    std::string prefix = parameters["prefix"].as<std::string>();
+    
+    bool wordy = false;
+    if (parameters.find("wordy") != parameters.end()) {
+        wordy = true;
+    }
+    
+    int level = parameters["level"].as<int>();
+    int dist_func = parameters["dist-func"].as<int>();
+    double sigma = parameters["sigma"].as<double>();
+    int threads = parameters["threads"].as<int>();
+    
+    std::multimap<std::string, boost::filesystem::path> images;
+    std::vector<std::string> extensions;
+    IOUtil::getImageExtensions(extensions);
+    IOUtil::readDirectory(input_dir, extensions, images);
+    
+    Benchmark benchmark(parameters["warm-up"].as<int>(), parameters["repeat"].as<int>());
+    int queue_depth = parameters["queue-depth"].as<int>();
+    AsyncLoader loader(images, parameters["load-threads"].as<int>(), queue_depth);
+    AsyncWriter writer(parameters["write-threads"].as<int>(), queue_depth);
+    benchmark.forEachImage(images, parameters["jobs"].as<int>(), [&](
+            std::multimap<std::string, boost::filesystem::path>::const_iterator it,
+            Benchmark &benchmark) {
+        
+        benchmark.startImage(it->second.stem().string());
+        benchmark.startPhase(Benchmark::LOAD);
+        cv::Mat image = loader.read(it->first);
+        
+        cv::Mat labels;
+        while (benchmark.repeat(Benchmark::SEGMENTATION)) {
+            SEAW_OpenCV::computeSuperpixels(image, level, dist_func, sigma, 
+                    labels, threads);
+        }
+        float elapsed = benchmark.getWallTime(Benchmark::SEGMENTATION);
+        
+        benchmark.startPhase(Benchmark::POST_PROCESSING);
+        int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
+        benchmark.stopPhase();
+        
+        if (wordy) {
+            std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
+                    << " (" << unconnected_components << " not connected; " 
+                    << elapsed <<")." << std::endl;
+        }
+        
+        benchmark.startPhase(Benchmark::WRITE);
+        if (!output_dir.empty()) {
+            boost::filesystem::path csv_file(output_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
+            writer.writeCSV(csv_file, labels);
+        }
+        
+        if (!vis_dir.empty()) {
+            boost::filesystem::path contours_file(vis_dir 
+                    / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
+            writer.writeContours(contours_file, image, labels);
+        }
+        
+        benchmark.stopImage();
+    });
+    
+    writer.finish();
+    
+    if (wordy) {
+        std::cout << "Average time: " 
+                << benchmark.getAverageWallTime(Benchmark::SEGMENTATION) << "." << std::endl;
+    }
+    
+    if (!output_dir.empty()) {
+        std::ofstream runtime_file(output_dir.string() + "/" + prefix + "runtime.txt", 
+                std::ofstream::out | std::ofstream::app);
+        
+        runtime_file << benchmark.getAverageWallTime(Benchmark::SEGMENTATION) << "\n";
+        runtime_file.close();
+        
+        benchmark.writeCSV(output_dir / boost::filesystem::path(prefix + "benchmark.csv"));
+        benchmark.writeJSON(output_dir / boost::filesystem::path(prefix + "benchmark.json"));
+    }
+    
+    return 0;
+}
+
+/** \brief Run a single invocation or serve jobs, see BatchServer.
+ */
+int main(int argc, const char** argv) {
+    return BatchServer::main(argc, argv, run);
+}
@@ -0,0 +1,305 @@
+/**
+ * Copyright (c) 2016, David Stutz
+ * Contact: david.stutz@rwth-aachen.de, davidstutz.de
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the copyright holder nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <opencv2/opencv.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include "streaming_slic.h"
+#include "io_util.h"
+#include "benchmark.h"
+#include "batch_server.h"
+#include "superpixel_tools.h"
+#include "async_loader.h"
+#include "async_writer.h"
+
+/** \brief Command line tool for running streaming supervoxel SLIC on videos,
+ * see StreamingSLIC. The input is either a video file or a directory of 
+ * frames, which are processed in the order of their file names. Labels are
+ * written per frame and are consistent over time (they are not relabeled 
+ * into connected components). The benchmark records the segmentation time
+ * of the frame added, which finalizes the frame added window - 1 frames 
+ * earlier.
+ * Usage:
+ * \code{sh}
+ *   $ ../bin/slic_video_cli --help
+ *   Allowed options:
+ *     -h [ --help ]                   produce help message
+ *     -i [ --input ] arg              the video or the folder of frames to 
+ *                                     process (can also be passed as 
+ *                                     positional argument)
+ *     -s [ --superpixels ] arg (=400) number of superpixels per frame
+ *     -d [ --temporal-step ] arg (=5) frames between seed layers
+ *     --window arg (=0)               number of frames kept in memory, 0 for 
+ *                                     twice the temporal step
+ *     -c [ --compactness ] arg (=40)  compactness
+ *     -p [ --perturb-seeds ] arg (=1) perturb seeds: > 0 yes, = 0 no
+ *     -t [ --iterations ] arg (=3)    iterations per frame
+ *     -o [ --csv ] arg                specify the output directory (default is 
+ *                                     ./output)
+ *     -v [ --vis ] arg                visualize contours
+ *     -x [ --prefix ] arg             output file prefix
+ *     --queue-depth arg (=4)          number of frames loaded ahead and written behind
+ *     --load-threads arg (=1)         number of threads loading frames
+ *     --write-threads arg (=1)        number of threads writing results
+ *     -w [ --wordy ]                  verbose/wordy/debug
+ *     --batch                         read jobs (arguments) line by line from stdin
+ *     --socket arg                    read jobs from the given UNIX socket
+ * \endcode
+ * \author David Stutz
+ */
+int run(int argc, const char** argv) {
+    
+    boost::program_options::options_description desc("Allowed options");
+    desc.add_options()
+        ("help,h", "produce help message")
+        ("input,i", boost::program_options::value<std::string>(), "the video or the folder of frames to process (can also be passed as positional argument)")
+        ("superpixels,s", boost::program_options::value<int>()->default_value(400), "number of superpixels per frame")
+        ("temporal-step,d", boost::program_options::value<int>()->default_value(5), "frames between seed layers")
+        ("window", boost::program_options::value<int>()->default_value(0), "number of frames kept in memory, 0 for twice the temporal step")
+        ("compactness,c", boost::program_options::value<double>()->default_value(40.), "compactness")
+        ("perturb-seeds,p", boost::program_options::value<int>()->default_value(1), "perturb seeds: > 0 yes, = 0 no")
+        ("iterations,t", boost::program_options::value<int>()->default_value(3), "iterations per frame")
+        ("csv,o", boost::program_options::value<std::string>()->default_value(""), "specify the output directory (default is ./output)")
+        ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
+        ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("queue-depth", boost::program_options::value<int>()->default_value(4), "number of frames loaded ahead and written behind")
+        ("load-threads", boost::program_options::value<int>()->default_value(1), "number of threads loading frames")
+        ("write-threads", boost::program_options::value<int>()->default_value(1), "number of threads writing results")
+        ("wordy,w", "verbose/wordy/debug");
+        
+    boost::program_options::positional_options_description positionals;
+    positionals.add("input", 1);
+    
+    boost::program_options::variables_map parameters;
+    boost::program_options::store(boost::program_options::command_line_parser(argc, argv).options(desc).positional(positionals).run(), parameters);
+    boost::program_options::notify(parameters);
+
+    if (parameters.find("help") != parameters.end()) {
+        std::cout << desc << std::endl;
+        return 1;
+    }
+    
+    boost::filesystem::path output_dir(parameters["csv"].as<std::string>());
+    if (!output_dir.empty()) {
+        if (!boost::filesystem::is_directory(output_dir)) {
+            boost::filesystem::create_directories(output_dir);
+        }
+    }
+    
+    boost::filesystem::path vis_dir(parameters["vis"].as<std::string>());
+    if (!vis_dir.empty()) {
+        if (!boost::filesystem::is_directory(vis_dir)) {
+            boost::filesystem::create_directories(vis_dir);
+        }
+    }
+    
+    boost::filesystem::path input(parameters["input"].as<std::string>());
+    if (!boost::filesystem::exists(input)) {
+        std::cout << "Video or frame directory not found ..." << std::endl;
+        return 1;
+    }
+    
+    std::string prefix = parameters["prefix"].as<std::string>();
+    
+    bool wordy = false;
+    if (parameters.find("wordy") != parameters.end()) {
+        wordy = true;
+    }
+    
+    int superpixels = parameters["superpixels"].as<int>();
+    int temporal_step = parameters["temporal-step"].as<int>();
+    int window = parameters["window"].as<int>();
+    double compactness = parameters["compactness"].as<double>();
+    int iterations = parameters["iterations"].as<int>();
+    int perturb_seeds_int = parameters["perturb-seeds"].as<int>();
+    bool perturb_seeds = perturb_seeds_int > 0 ? true : false;
+    
+    // Frames are either read from the video or from the directory.
+    std::multimap<std::string, boost::filesystem::path> images;
+    std::multimap<std::string, boost::filesystem::path>::iterator image_it;
+    cv::VideoCapture video;
+    
+    if (boost::filesystem::is_directory(input)) {
+        std::vector<std::string> extensions;
+        IOUtil::getImageExtensions(extensions);
+        IOUtil::readDirectory(input, extensions, images);
+    }
+    else if (!video.open(input.string())) {
+        std::cout << "Could not open video ..." << std::endl;
+        return 1;
+    }
+    
+    image_it = images.begin();
+    
+    Benchmark benchmark;
+    int queue_depth = parameters["queue-depth"].as<int>();
+    AsyncLoader loader(images, parameters["load-threads"].as<int>(), queue_depth);
+    AsyncWriter writer(parameters["write-threads"].as<int>(), queue_depth);
+    
+    // Frames not yet finalized, needed for the names and visualizations.
+    std::deque<std::pair<std::string, cv::Mat> > pending;
+    StreamingSLIC* slic = 0;
+    
+    auto write = [&](const cv::Mat &labels) {
+        std::string name = pending.front().first;
+        cv::Mat frame = pending.front().second;
+        pending.pop_front();
+        
+        if (wordy) {
+            std::cout << SuperpixelTools::countSuperpixels(labels) << " supervoxels in " 
+                    << name << " (" << slic->getSupervoxels() << " in total)." << std::endl;
+        }
+        
+        benchmark.startPhase(Benchmark::WRITE);
+        if (!output_dir.empty()) {
+            boost::filesystem::path csv_file(output_dir 
+                    / boost::filesystem::path(prefix + name + ".csv"));
+            writer.writeCSV(csv_file, labels);
+        }
+        
+        if (!vis_dir.empty()) {
+            boost::filesystem::path contours_file(vis_dir 
+                    / boost::filesystem::path(prefix + name + ".png"));
+            writer.writeContours(contours_file, frame, labels);
+        }
+        benchmark.stopPhase();
+    };
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int frames = 0;
+    
+    while (true) {
+        std::string name;
+        cv::Mat frame;
+        
+        if (video.isOpened()) {
+            std::stringstream stream;
+            stream << std::setw(5) << std::setfill('0') << frames;
+            name = stream.str();
+            
+            if (!video.grab()) {
+                break;
+            }
+            
+            benchmark.startImage(name);
+            benchmark.startPhase(Benchmark::LOAD);
+            if (!video.retrieve(frame) || frame.empty()) {
+                break;
+            }
+        }
+        else {
+            if (image_it == images.end()) {
+                break;
+            }
+            
+            name = image_it->second.stem().string();
+            
+            benchmark.startImage(name);
+            benchmark.startPhase(Benchmark::LOAD);
+            frame = loader.read(image_it->first);
+            ++image_it;
+        }
+        
+        if (slic == 0) {
+            int region_size = SuperpixelTools::computeRegionSizeFromSuperpixels(frame, 
+                    superpixels);
+            slic = new StreamingSLIC(region_size, temporal_step, window, 
+                    compactness, iterations, perturb_seeds);
+        }
+        
+        pending.push_back(std::pair<std::string, cv::Mat>(name, frame));
+        
+        cv::Mat labels;
+        benchmark.startPhase(Benchmark::SEGMENTATION);
+        bool finalized = slic->push(frame, labels);
+        benchmark.stopPhase();
+        
+        if (finalized) {
+            write(labels);
+        }
+        
+        frames++;
+    }
+    
+    // The remaining frames are finalized (and timed) as part of the last frame.
+    if (slic != 0) {
+        cv::Mat labels;
+        while (true) {
+            benchmark.startPhase(Benchmark::SEGMENTATION);
+            bool finalized = slic->flush(labels);
+            benchmark.stopPhase();
+            
+            if (!finalized) {
+                break;
+            }
+            
+            write(labels);
+        }
+        
+        delete slic;
+    }
+    
+    benchmark.stopImage();
+    writer.finish();
+    
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double segmentation_seconds = benchmark.getAverageWallTime(Benchmark::SEGMENTATION)
+            *benchmark.getNumImages();
+    
+    std::cout << frames << " frames in " << seconds << "s: " 
+            << (seconds > 0 ? frames/seconds : 0) << " fps (segmentation only: "
+            << (segmentation_seconds > 0 ? frames/segmentation_seconds : 0) 
+            << " fps)." << std::endl;
+    
+    if (!output_dir.empty()) {
+        std::ofstream runtime_file(output_dir.string() + "/" + prefix + "runtime.txt", 
+                std::ofstream::out | std::ofstream::app);
+        
+        runtime_file << benchmark.getAverageWallTime(Benchmark::SEGMENTATION) << "\n";
+        runtime_file.close();
+        
+        benchmark.writeCSV(output_dir / boost::filesystem::path(prefix + "benchmark.csv"));
+        benchmark.writeJSON(output_dir / boost::filesystem::path(prefix + "benchmark.json"));
+    }
+    
+    return 0;
+}
+
+/** \brief Run a single invocation or serve jobs, see BatchServer.
+ */
+int main(int argc, const char** argv) {
+    return BatchServer::main(argc, argv, run);
+}
@@ -33,13 +33,15 @@
 #include <opencv2/opencv.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
-#include <boost/timer.hpp>
 #include <bitset>
 #include "vccs_opencv_pcl.h"
 #include "io_util.h"
+#include "benchmark.h"
+#include "batch_server.h"
 #include "superpixel_tools.h"
 #include "depth_tools.h"
-#include "visualization.h"
+#include "async_loader.h"
+#include "async_writer.h"
 
 /** \brief Command line tool for running VCCS.
  * Usage:
@@ -71,14 +73,25 @@
  *                                           spatial weight
  *     -n [ --normal-weight ] arg (=0.200000003)
  *                                           normal weight
+ *     --organized                           use the organized cloud fast path:
+ *                                           only points with valid depth are 
+ *                                           clustered, buffers are kept between
+ *                                           images
  *     -o [ --csv ] arg                      save segmentation as CSV file
  *     -v [ --vis ] arg                      visualize contours
  *     -x [ --prefix ] arg                   output file prefix
+ *     --warm-up arg (=0)                    number of discarded runs per image
+ *     --repeat arg (=1)                     number of timed runs per image
+ *     --queue-depth arg (=4)                number of images loaded ahead and written behind
+ *     --load-threads arg (=1)               number of threads loading images
+ *     --write-threads arg (=1)              number of threads writing results
  *     -w [ --wordy ]                        verbose/wordy/debug
+ *     --batch                               read jobs (arguments) line by line from stdin
+ *     --socket arg                          read jobs from the given UNIX socket
  * \endcode
  * \author David Stutz
  */
-int main(int argc, const char** argv) {
+int run(int argc, const char** argv) {
     
     boost::program_options::options_description desc("Allowed options");
     desc.add_options()
@@ -96,9 +109,15 @@ int main(int argc, const char** argv) {
         ("seed-resolution,s", boost::program_options::value<float>()->default_value(0.1f), "seed resolution")
         ("spatial-weight,p", boost::program_options::value<float>()->default_value(0.3f), "spatial weight")
         ("normal-weight,n", boost::program_options::value<float>()->default_value(0.2f), "normal weight")
+        ("organized", "use the organized cloud fast path: only points with valid depth are clustered, buffers are kept between images")
         ("csv,o", boost::program_options::value<std::string>()->default_value(""), "save segmentation as CSV file")
         ("vis,v", boost::program_options::value<std::string>()->default_value(""), "visualize contours")
         ("prefix,x", boost::program_options::value<std::string>()->default_value(""), "output file prefix")
+        ("warm-up", boost::program_options::value<int>()->default_value(0), "number of discarded runs per image")
+        ("repeat", boost::program_options::value<int>()->default_value(1), "number of timed runs per image")
+        ("queue-depth", boost::program_options::value<int>()->default_value(4), "number of images loaded ahead and written behind")
+        ("load-threads", boost::program_options::value<int>()->default_value(1), "number of threads loading images")
+        ("write-threads", boost::program_options::value<int>()->default_value(1), "number of threads writing results")
         ("wordy,w", "verbose/wordy/debug");
         
     boost::program_options::positional_options_description positionals;
@@ -172,16 +191,29 @@ int main(int argc, const char** argv) {
         use_transform = true;
 //    }
     
+    bool organized = false;
+    if (parameters.find("organized") != parameters.end()) {
+        organized = true;
+    }
+    
+    VCCS_OpenCV_PCL_Organized vccs_organized(voxel_resolution, seed_resolution, 
+            spatial_weight, normal_weight, use_transform);
+    
     std::multimap<std::string, boost::filesystem::path> images;
     std::vector<std::string> extensions;
     IOUtil::getImageExtensions(extensions);
     IOUtil::readDirectory(input_dir, extensions, images);
     
-    float total = 0;
+    Benchmark benchmark(parameters["warm-up"].as<int>(), parameters["repeat"].as<int>());
+    int queue_depth = parameters["queue-depth"].as<int>();
+    AsyncLoader loader(images, parameters["load-threads"].as<int>(), queue_depth);
+    AsyncWriter writer(parameters["write-threads"].as<int>(), queue_depth);
     for (std::multimap<std::string, boost::filesystem::path>::iterator it = images.begin();
             it != images.end(); it++) {
         
-        cv::Mat image = cv::imread(it->first);
+        benchmark.startImage(it->second.stem().string());
+        benchmark.startPhase(Benchmark::LOAD);
+        cv::Mat image = loader.read(it->first);
         
         boost::filesystem::path depth_file = depth_dir 
                 / boost::filesystem::path(it->second.stem().string() + ".png");
@@ -196,14 +228,6 @@ int main(int argc, const char** argv) {
             }
         }
         
-        cv::Mat depth = cv::imread(depth_file.string(), CV_LOAD_IMAGE_ANYDEPTH);
-        
-        if (depth.rows != image.rows || depth.cols != image.cols) {
-            std::cout << "Image and depth dimensions do not match for: " 
-                    << it->first << std::endl;
-            return 1;
-        }
-        
         if (!intrinsics_dir.empty()) {
             boost::filesystem::path intrinsics_file = intrinsics_dir 
                     / boost::filesystem::path(it->second.stem().string() + ".csv");
@@ -228,20 +252,35 @@ int main(int argc, const char** argv) {
             camera.focal_y = intrinsics.at<float>(1, 1);
         }
         
+        // Clouds are cached per depth file and camera when serving jobs.
+        benchmark.startPhase(Benchmark::CONVERSION);
         cv::Mat cloud;
         cv::Mat labels;
-        DepthTools::computeCloudFromDepth(depth, camera, cloud);
+        DepthTools::readCloudFromDepth(depth_file.string(), camera, cloud);
+        
+        if (cloud.rows != image.rows || cloud.cols != image.cols) {
+            std::cout << "Image and depth dimensions do not match for: " 
+                    << it->first << std::endl;
+            return 1;
+        }
         
-        boost::timer timer;
-        VCCS_OpenCV_PCL::computeSuperpixels(image, cloud, voxel_resolution, 
-                seed_resolution, spatial_weight, normal_weight, use_transform, labels);
-        float elapsed = timer.elapsed();
-        total += elapsed;
+        while (benchmark.repeat(Benchmark::SEGMENTATION)) {
+            if (organized) {
+                vccs_organized.computeSuperpixels(image, cloud, labels);
+            }
+            else {
+                VCCS_OpenCV_PCL::computeSuperpixels(image, cloud, voxel_resolution, 
+                        seed_resolution, spatial_weight, normal_weight, use_transform, labels);
+            }
+        }
+        float elapsed = benchmark.getWallTime(Benchmark::SEGMENTATION);
         
+        benchmark.startPhase(Benchmark::POST_PROCESSING);
         int unconnected_components = SuperpixelTools::relabelConnectedSuperpixels(labels);
 //        int merged_components = SuperpixelTools::enforceMinimumSuperpixelSize(image, labels, 5);
         int merged_components = SuperpixelTools::enforceMinimumSuperpixelSizeUpTo(image, labels, unconnected_components);
         SuperpixelTools::relabelSuperpixels(labels);
+        benchmark.stopPhase();
         
         if (wordy) {
             std::cout << SuperpixelTools::countSuperpixels(labels) << " superpixels for " << it->first 
@@ -250,32 +289,45 @@ int main(int argc, const char** argv) {
                     << elapsed <<")." << std::endl;
         }
         
+        benchmark.startPhase(Benchmark::WRITE);
         if (!output_dir.empty()) {
             boost::filesystem::path csv_file(output_dir 
                     / boost::filesystem::path(prefix + it->second.stem().string() + ".csv"));
-            IOUtil::writeMatCSV<int>(csv_file, labels);
+            writer.writeCSV(csv_file, labels);
         }
         
         if (!vis_dir.empty()) {
             boost::filesystem::path contours_file(vis_dir 
                     / boost::filesystem::path(prefix + it->second.stem().string() + ".png"));
-            cv::Mat image_contours;
-            Visualization::drawContours(image, labels, image_contours);
-            cv::imwrite(contours_file.string(), image_contours);
+            writer.writeContours(contours_file, image, labels);
         }
+        
+        benchmark.stopImage();
     }
     
+    writer.finish();
+    
     if (wordy) {
-        std::cout << "Average time: " << total / images.size() << "." << std::endl;
+        std::cout << "Average time: " 
+                << benchmark.getAverageWallTime(Benchmark::SEGMENTATION) << "." << std::endl;
     }
     
     if (!output_dir.empty()) {
         std::ofstream runtime_file(output_dir.string() + "/" + prefix + "runtime.txt", 
                 std::ofstream::out | std::ofstream::app);
         
-        runtime_file << total / images.size() << "\n";
+        runtime_file << benchmark.getAverageWallTime(Benchmark::SEGMENTATION) << "\n";
         runtime_file.close();
+        
+        benchmark.writeCSV(output_dir / boost::filesystem::path(prefix + "benchmark.csv"));
+        benchmark.writeJSON(output_dir / boost::filesystem::path(prefix + "benchmark.json"));
     }
     
     return 0;
-}
\ No newline at end of file
+}
+
+/** \brief Run a single invocation or serve jobs, see BatchServer.
+ */
+int main(int argc, const char** argv) {
+    return BatchServer::main(argc, argv, run);
+}